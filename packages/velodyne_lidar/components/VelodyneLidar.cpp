@@ -27,34 +27,117 @@
  */
 #include "VelodyneLidar.hpp"
 
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include <algorithm>
 #include <cerrno>
 #include <cmath>
 #include <cstring>
+#include <memory>
 #include <utility>
 #include <vector>
 
-#include "engine/core/assert.hpp"
-#include "engine/core/constants.hpp"
 #include "engine/core/logger.hpp"
+#include "engine/core/math/utils.hpp"
 #include "messages/tensor.hpp"
-#include "packages/coms/gems/socket.hpp"
+#include "packages/velodyne_lidar/gems/decoder_tuning.hpp"
+#include "packages/velodyne_lidar/gems/raw_packet_batch.hpp"
+#include "packages/velodyne_lidar/gems/rigid_transform.hpp"
 
 namespace isaac {
 namespace velodyne_lidar {
 
 namespace {
-constexpr uint16_t kBlockFlag = 0xEEFF;
 constexpr int kNumberOfAccumulatedPackets = 5;
+constexpr double kSecondsToNanoseconds = 1e9;
+constexpr double kSecondsPerMinute = 60.0;
+constexpr int64_t kNanosecondsPerMicrosecond = 1'000;
+constexpr int64_t kMicrosecondsPerHour = 3'600'000'000;
+constexpr double kMicrosecondsToSeconds = 1e-6;
+// Number of horizontal sectors of the azimuth mask, i.e. a resolution of a quarter degree
+constexpr size_t kMaskSectors = 1440;
+
+// Converts a pose into the transformation which the gems use
+RigidTransform ToRigidTransform(const Pose3d& pose) {
+  const Matrix3d rotation = pose.rotation.matrix();
+  RigidTransform transform;
+  for (int row = 0; row < 3; row++) {
+    for (int column = 0; column < 3; column++) {
+      transform.rotation[3 * row + column] = rotation(row, column);
+    }
+    transform.translation[row] = pose.translation[row];
+  }
+  return transform;
+}
 }  // namespace
 
 void VelodyneLidar::start() {
   initLaser(get_type());
-  previous_packet_ = std::nullopt;
+  const auto vertical_angles = try_get_vertical_angles();
+  if (vertical_angles && !SetVerticalAngles(*vertical_angles, parameters_)) {
+    reportFailure("Expected %u vertical angles but got %zu", parameters_.vertical_beams,
+                  vertical_angles->size());
+    return;
+  }
+  if (parameters_.vertical_angles.size() != parameters_.vertical_beams) {
+    reportFailure("The vertical angles of this sensor model need to be configured");
+    return;
+  }
 
-  socket_.reset(Socket::CreateRxUDPSocket(get_ip(), get_port()));
-  int res = socket_->startSocket();
-  if (res < 0) {
-    reportFailure("Could not start socket: code=%d, errno=%d", res, errno);
+  if (!createAzimuthMask() || !createProducts() || !tuneDecoder() || !createSafetyMonitor()) {
+    return;
+  }
+  if (registration_) {
+    // Revolutions are aligned on a background thread whose results are published by `tick`
+    scan_motions_.clear();
+    registration_->start([this](bool aligned, const RegistrationResult& result) {
+      if (aligned) {
+        std::lock_guard<std::mutex> lock(scan_motions_mutex_);
+        scan_motions_.push_back(result);
+      }
+    });
+  }
+
+  ring_health_.reset();
+  if (get_ring_health_period() > 0.0) {
+    RingHealthOptions options;
+    options.degraded_fraction = get_ring_degraded_fraction();
+    options.alarm_windows = get_ring_alarm_windows();
+    ring_health_ = std::make_unique<RingHealthMonitor>(parameters_, options);
+  }
+  last_ring_health_time_ = -1;
+  alarm_rings_.clear();
+
+  last_dump_black_box_acqtime_ = -1;
+  if (!allocateBuffers()) {
+    return;
+  }
+
+  packet_id_ = 0;
+  scan_id_ = 0;
+  last_dump_trace_acqtime_ = -1;
+
+  metrics_ = std::make_shared<SensorMetrics>(node()->name());
+  publish_duration_ = 0;
+  last_revolutions_ = 0;
+  last_revolution_time_ = -1;
+  if (get_metrics_port() > 0) {
+    metrics_server_ = MetricsServer::Acquire(get_metrics_port());
+    if (!metrics_server_) {
+      reportFailure("Could not start metrics endpoint: errno=%d", errno);
+      return;
+    }
+    MetricsRegistry::Get().add(metrics_);
+  }
+
+  if (!openReceiver()) {
+    reportFailure("Could not start socket: errno=%d", errno);
+    return;
+  }
+  last_status_timestamp_ = 0;
+  if (!startConfigClient()) {
+    reportFailure("Could not start sensor configuration client: errno=%d", errno);
     return;
   }
 
@@ -62,146 +145,935 @@ void VelodyneLidar::start() {
 }
 
 void VelodyneLidar::tick() {
-  // Start preparing the outgoing message
-  auto range_scan_proto = tx_scan().initProto();
-  range_scan_proto.setRangeDenormalizer(kDistanceToMeters * 65535.0f);
-  range_scan_proto.setIntensityDenormalizer(kMaxIntensity);
-  range_scan_proto.setInvalidRangeThreshold(parameters_.minimum_range);
-  range_scan_proto.setOutOfRangeThreshold(parameters_.maximum_range);
-  range_scan_proto.setDeltaTime(kDeltaTime);
-
-  // Prepares vertical angles
-  range_scan_proto.initPhi(parameters_.vertical_beams);
-  for (uint32_t i = 0; i < parameters_.vertical_beams; i++) {
-    range_scan_proto.getPhi().set(i, parameters_.vertical_angles[i]);
-  }
-
-  // We need room for one package more as we need it to interpolate the missing azimuth angles.
-  std::vector<double> azimuths((kNumberOfAccumulatedPackets + 1) * parameters_.blocks_per_packet);
-
-  // Prepare the rays
-  const uint32_t number_of_rays =
-      kNumberOfAccumulatedPackets * parameters_.blocks_per_packet * parameters_.channels_per_block;
-  if (parameters_.vertical_beams <= 0) {
-    reportFailure("Number of vertical beams needs to be positive");
-    return;
-  }
-  if (number_of_rays % parameters_.vertical_beams != 0) {
-    reportFailure("Number of rays (%d) is not divisible by number of vertical beams (%d)",
-                  number_of_rays, parameters_.vertical_beams);
-    return;
-  }
-  const size_t number_of_slices = number_of_rays / parameters_.vertical_beams;
-  Tensor2ui16 ranges(number_of_slices, parameters_.vertical_beams);
-  Tensor2ub intensities(number_of_slices, parameters_.vertical_beams);
-
-  // For the very first time we run this we do not have a previous package and need to do some
-  // special handling.
-  const bool is_first_batch = !previous_packet_;
-
-  // read and parse packages
-  for (uint32_t i = 0; i < kNumberOfAccumulatedPackets + 1; i++) {
-    // acquire package
-    if (i == 0) {
-      // as the first package we use the last package from the previous run
-      if (previous_packet_) {
-        raw_packet_ = *previous_packet_;
+  const size_t packet_size = parameters_.packet_sans_header_size;
+  if (rx_dump_trace().available() && rx_dump_trace().acqtime() != last_dump_trace_acqtime_) {
+    last_dump_trace_acqtime_ = rx_dump_trace().acqtime();
+    writeTrace();
+  }
+  if (rx_dump_black_box().available() &&
+      rx_dump_black_box().acqtime() != last_dump_black_box_acqtime_) {
+    last_dump_black_box_acqtime_ = rx_dump_black_box().acqtime();
+    dumpBlackBox("on request");
+  }
+  updateSensorStatus();
+  updatePose();
+  publishScanMotions();
+
+  // The deadline of a scan is measured from the kernel receive time of its first packet. If no
+  // packet of the scan arrived yet we wait at most one deadline for it.
+  const double scan_deadline = get_scan_deadline();
+  const int64_t deadline_duration =
+      scan_deadline > 0.0 ? static_cast<int64_t>(scan_deadline * kSecondsToNanoseconds) : -1;
+  int64_t first_packet_timestamp = pendingTimestamp();
+  deadline_ = -1;
+  if (deadline_duration >= 0) {
+    deadline_ = (first_packet_timestamp >= 0 ? first_packet_timestamp : PacketReceiver::NowNs()) +
+                deadline_duration;
+  }
+
+  // Receive packets until a scan was published or the deadline expired
+  scan_published_ = false;
+  while (!scan_published_) {
+    const int64_t timeout =
+        deadline_ < 0 ? -1 : std::max<int64_t>(0, deadline_ - PacketReceiver::NowNs());
+    const byte* packet = nullptr;
+    size_t size = 0;
+    int64_t timestamp = 0;
+    PacketReceiver::Status status;
+    {
+      VELODYNE_TRACE_SCOPE("receive", packet_id_);
+      status = receivePacket(packet, size, timeout, timestamp);
+    }
+    if (status == PacketReceiver::Status::kError) {
+      reportFailure("Could not receive packet: errno=%d", errno);
+      return;
+    }
+    if (status == PacketReceiver::Status::kTimeout) {
+      // Publish whatever arrived in time including the packet which waits for the next azimuth
+      if (decode_) {
+        VELODYNE_TRACE_SCOPE("decode", packet_id_);
+        finishDecoder();
       }
-    } else {
-      // read data from lidar proto
-      raw_packet_.resize(parameters_.packet_sans_header_size, '\0');
-      const uint32_t res = socket_->readPacket(reinterpret_cast<char*>(raw_packet_.data()),
-                                               parameters_.packet_sans_header_size);
-      if (res != parameters_.packet_sans_header_size) {
-        reportFailure("Empty message or timeout: code=%u, errno=%d", res, errno);
-        return;
+      if (raw_packet_count_ > 0) {
+        publishRawPackets();
       }
+      if (!scan_published_ && decode_) {
+        // Nothing arrived in time. Consumers still get to know that there is no data.
+        publishScanStatus(0, 0, first_packet_timestamp);
+      }
+      return;
     }
-    // process rays
-    if (i == kNumberOfAccumulatedPackets) {
-      // The last package we read will be saved and published next time.
-      previous_packet_ = raw_packet_;
-    } else {
-      if (!is_first_batch) {
-        // Extract rays from package blocks.
-        for (uint32_t j = 0; j < parameters_.blocks_per_packet; j++) {
-          processDataBlockVPL16(
-              *reinterpret_cast<VelodyneRawDataBlock*>(raw_packet_.data() +
-                                                       j * parameters_.block_size),
-              ranges.view(), intensities.view(),
-              (i * parameters_.blocks_per_packet + j) * parameters_.channels_per_block);
-        }
+    if (size != packet_size) {
+      LOG_WARNING("Ignoring packet with unexpected size %zu", size);
+      metrics_->rejected_packets.add();
+      continue;
+    }
+    // Safety fields come first to keep the time until a stop is published short
+    if (safety_) {
+      checkSafety(packet, timestamp);
+    }
+    if (black_box_.capacity() > 0) {
+      black_box_.record(packet, timestamp);
+    }
+    // A packet which the kernel received after the deadline starts the next scan
+    bool is_late = false;
+    if (first_packet_timestamp < 0) {
+      first_packet_timestamp = timestamp;
+      if (deadline_duration >= 0) {
+        deadline_ = timestamp + deadline_duration;
       }
+    } else if (deadline_ >= 0 && timestamp > deadline_) {
+      is_late = true;
     }
-    // process angles
-    if (!is_first_batch) {
-      // Extract angles from package blocks.
-      for (uint32_t j = 0; j < parameters_.blocks_per_packet; j++) {
-        const double azimuth =
-            -DegToRad(static_cast<double>(reinterpret_cast<VelodyneRawDataBlock*>(
-                                              raw_packet_.data() + j * parameters_.block_size)
-                                              ->azimuth) /
-                      100.0);
-        azimuths[i * parameters_.blocks_per_packet + j] = azimuth;
+
+    if (get_publish_raw_packets()) {
+      if (is_late && raw_packet_count_ > 0) {
+        publishRawPackets();
+      }
+      std::memcpy(raw_packets_ + raw_packet_count_ * packet_size, packet, packet_size);
+      raw_packet_timestamps_[raw_packet_count_] = timestamp;
+      raw_packet_count_++;
+      if (raw_packet_count_ == kNumberOfAccumulatedPackets) {
+        publishRawPackets();
       }
     }
+    if (decode_) {
+      VELODYNE_TRACE_SCOPE("decode", packet_id_);
+      // The late packet still provides the azimuth for the columns of the previous packet.
+      const int64_t decode_start = PacketReceiver::NowNs();
+      publish_duration_ = 0;
+      feedDecoder(packet, size, timestamp);
+      if (is_late) {
+        decoder_->flush();
+      }
+      // The products see the new columns while they are still in the cache
+      if (!products_->empty() && ++product_packets_ >= product_interval_) {
+        product_packets_ = 0;
+        products_->update(decoder_->output(), decoder_->bufferedColumns(), getTickTimestamp());
+        publishElevationMap();
+        publishOccupancyGrid();
+        publishPillars();
+        publishFeatures();
+      }
+      metrics_->decode_time.observe(PacketReceiver::NowNs() - decode_start - publish_duration_);
+    }
+    updateMetrics(packet, timestamp);
+    packet_id_++;
   }
-  // If this is the first time we run this loop we are only interested in the last package
-  // and won't publish any data.
-  if (is_first_batch) {
+}
+
+void VelodyneLidar::stop() {
+  if (registration_) {
+    registration_->stop();
+  }
+  config_client_.stop();
+  black_box_.close();
+  arena_.close();
+  receiver_.close();
+  xdp_receiver_.close();
+  if (metrics_server_) {
+    MetricsRegistry::Get().remove(metrics_);
+    metrics_server_.reset();
+  }
+  if (trace::kEnabled) {
+    writeTrace();
+  }
+}
+
+bool VelodyneLidar::startConfigClient() {
+  SensorSettings settings;
+  settings.rpm = try_get_sensor_rpm();
+  settings.return_mode = try_get_sensor_return_mode();
+  if (const auto fov = try_get_sensor_fov()) {
+    settings.fov = std::make_pair((*fov)[0], (*fov)[1]);
+  }
+  settings.phase_lock_offset = try_get_sensor_phase_lock_offset();
+  const double status_period = get_sensor_status_period();
+  if (settings.empty() && status_period <= 0.0) {
+    return true;
+  }
+  return config_client_.start(get_ip(), get_sensor_http_port(), settings, status_period,
+                              get_sensor_http_timeout());
+}
+
+void VelodyneLidar::updateSensorStatus() {
+  metrics_->failed_requests.set(config_client_.failedRequests());
+  const SensorStatus status = config_client_.status();
+  if (!status.valid || status.timestamp == last_status_timestamp_) {
     return;
   }
-  // Fill in the missing azimuths: every second angle is missing and interpolated
-  ASSERT(parameters_.vertical_beams * 2 == parameters_.channels_per_block,
-         "Expecting one azimuth every second set.");
-  const size_t number_of_azimuth_used = kNumberOfAccumulatedPackets * parameters_.blocks_per_packet;
-  auto thetas_proto = range_scan_proto.initTheta(2 * number_of_azimuth_used);
-  for (size_t i = 0; i < number_of_azimuth_used; i++) {
-    const double a1 = azimuths[i];
-    const double a2 = azimuths[i + 1];
-    thetas_proto.set(2 * i, a1);
-    thetas_proto.set(2 * i + 1, a1 + 0.5 * DeltaAngle(a2, a1));
+  if (!status.laser_on || !status.motor_on) {
+    LOG_WARNING("Sensor reports motor %s and laser %s", status.motor_on ? "on" : "off",
+                status.laser_on ? "on" : "off");
   }
-  ToProto(std::move(ranges), range_scan_proto.initRanges(), tx_scan().buffers());
-  ToProto(std::move(intensities), range_scan_proto.initIntensities(), tx_scan().buffers());
-  // publish
-  tx_scan().publish();
+  last_status_timestamp_ = status.timestamp;
+  metrics_->phase_locked.set(status.phase_locked ? 1.0 : 0.0);
 }
 
-void VelodyneLidar::stop() {
-  socket_->closeSocket();
-}
-
-void VelodyneLidar::processDataBlockVPL16(const VelodyneRawDataBlock& raw_block,
-                                          TensorView2ui16 ranges, TensorView2ub intensities,
-                                          int offset) {
-  const uint16_t min_range_u16 =
-      static_cast<uint16_t>(parameters_.minimum_range / kDistanceToMeters);
-  const uint16_t max_range_u16 =
-      static_cast<uint16_t>(parameters_.maximum_range / kDistanceToMeters);
-  // Block structure depends on the channels available
-  for (size_t i = 0; i < parameters_.channels_per_block; i++) {
-    if (raw_block.dataBlockFlag != kBlockFlag) {
-      LOG_ERROR("Invalid raw_packet");
-    }
-    const VelodyneRawChannel& channel = raw_block.channels[i];
-    const size_t index = offset + i;
-    ASSERT(parameters_.vertical_beams > 0, "Number of vertical beams needs to be positive");
-    const size_t phi_index = index % parameters_.vertical_beams;
-    const size_t theta_index = index / parameters_.vertical_beams;
-    if (channel.distance < min_range_u16 || max_range_u16 < channel.distance) {
-      ranges(theta_index, phi_index) = 0;
-      intensities(theta_index, phi_index) = 0;
-    } else {
-      ranges(theta_index, phi_index) = channel.distance;
-      intensities(theta_index, phi_index) = channel.reflectivity;
+int64_t VelodyneLidar::pendingTimestamp() const {
+  if (decode_) {
+    return decoder_->pendingTimestamp();
+  }
+  return raw_packet_count_ > 0 ? raw_packet_timestamps_[0] : -1;
+}
+
+void VelodyneLidar::publishScan(const ColumnBatch& batch) {
+  const int64_t acqtime = getTickTimestamp();
+  const uint64_t scan_id = scan_id_++;
+  const int64_t publish_start = PacketReceiver::NowNs();
+
+  // The products already saw all columns except those of the packet which completed the batch
+  if (!products_->empty()) {
+    VELODYNE_TRACE_SCOPE("products", scan_id);
+    products_->update(decoder_->output(), batch.size, acqtime);
+    publishElevationMap();
+    publishOccupancyGrid();
+    publishPillars();
+    publishFeatures();
+    publishProducts(acqtime);
+    products_->begin();
+  }
+
+  if (get_publish_scan()) {
+    VELODYNE_TRACE_SCOPE("serialize", scan_id);
+    scan_writer_->write(batch.size, tx_scan().initProto(), tx_scan().buffers());
+    VELODYNE_TRACE_SCOPE("publish", scan_id);
+    tx_scan().publish(acqtime);
+  }
+  publishScanStatus(batch.size, batch.packets, batch.first_timestamp);
+  const int64_t publish_end = PacketReceiver::NowNs();
+  publish_duration_ += publish_end - publish_start;
+  metrics_->publish_latency.observe(publish_end - batch.first_timestamp);
+  metrics_->scans.add();
+  if (batch.size < number_of_slices_) {
+    metrics_->partial_scans.add();
+  }
+
+  // The decoder continues with fresh buffers as the old ones are now owned by the message.
+  // Without a range scan the decoder keeps its buffers.
+  if (get_publish_scan()) {
+    resetScanBuffers();
+  }
+  scan_published_ = true;
+}
+
+void VelodyneLidar::publishProducts(int64_t acqtime) {
+  if (flatscan_writer_) {
+    const std::vector<float>& angles = flatscan_writer_->angles();
+    const std::vector<float>& ranges = flatscan_writer_->ranges();
+    auto flatscan_proto = tx_flatscan().initProto();
+    auto angles_proto = flatscan_proto.initAngles(angles.size());
+    auto ranges_proto = flatscan_proto.initRanges(ranges.size());
+    for (size_t i = 0; i < angles.size(); i++) {
+      angles_proto.set(i, angles[i]);
+      ranges_proto.set(i, ranges[i]);
+    }
+    flatscan_proto.setInvalidRangeThreshold(parameters_.minimum_range);
+    flatscan_proto.setOutOfRangeThreshold(parameters_.maximum_range);
+    tx_flatscan().publish(acqtime);
+  }
+  if (cloud_writer_) {
+    const size_t count = cloud_writer_->size();
+    Tensor2f positions(count, 3);
+    Tensor1f intensities(count);
+    std::copy(cloud_writer_->positions().begin(), cloud_writer_->positions().end(),
+              positions.element_wise_begin());
+    std::copy(cloud_writer_->intensities().begin(), cloud_writer_->intensities().end(),
+              intensities.element_wise_begin());
+    auto cloud_proto = tx_cloud().initProto();
+    ToProto(std::move(positions), cloud_proto.initPositions(), tx_cloud().buffers());
+    ToProto(std::move(intensities), cloud_proto.initIntensities(), tx_cloud().buffers());
+    tx_cloud().publish(acqtime);
+  }
+}
+
+void VelodyneLidar::publishFeatures() {
+  if (!features_ || features_->revolutions() == features_revolutions_) {
+    return;
+  }
+  const int64_t publish_start = PacketReceiver::NowNs();
+  features_revolutions_ = features_->revolutions();
+  auto features_proto = tx_features().initProto();
+  auto fill = [](const std::vector<ScanFeature>& features,
+                 ::capnp::List<VelodyneScanFeaturesProto::Feature>::Builder builder) {
+    for (size_t i = 0; i < features.size(); i++) {
+      builder[i].setX(features[i].x);
+      builder[i].setY(features[i].y);
+      builder[i].setZ(features[i].z);
+      builder[i].setLaser(features[i].laser);
+      builder[i].setCurvature(features[i].curvature);
+    }
+  };
+  fill(features_->edges(), features_proto.initEdges(features_->edges().size()));
+  fill(features_->planes(), features_proto.initPlanes(features_->planes().size()));
+  tx_features().publish(getTickTimestamp());
+  publish_duration_ += PacketReceiver::NowNs() - publish_start;
+}
+
+void VelodyneLidar::publishElevationMap() {
+  if (!elevation_map_ || elevation_map_->revolutions() == elevation_map_revolutions_) {
+    return;
+  }
+  const int64_t publish_start = PacketReceiver::NowNs();
+  elevation_map_revolutions_ = elevation_map_->revolutions();
+  const ElevationLayers& layers = elevation_map_->completed();
+  auto map_proto = tx_elevation_map().initProto();
+  map_proto.setCells(layers.cells);
+  map_proto.setCellSize(layers.cell_size);
+  map_proto.setOriginX(layers.origin_x);
+  map_proto.setOriginY(layers.origin_y);
+  const size_t count = layers.count.size();
+  auto minimum_proto = map_proto.initMinimumHeight(count);
+  auto maximum_proto = map_proto.initMaximumHeight(count);
+  auto mean_proto = map_proto.initMeanHeight(count);
+  auto count_proto = map_proto.initCount(count);
+  for (size_t i = 0; i < count; i++) {
+    minimum_proto.set(i, layers.minimum[i]);
+    maximum_proto.set(i, layers.maximum[i]);
+    mean_proto.set(i, layers.mean[i]);
+    count_proto.set(i, layers.count[i]);
+  }
+  tx_elevation_map().publish(getTickTimestamp());
+  publish_duration_ += PacketReceiver::NowNs() - publish_start;
+}
+
+void VelodyneLidar::publishOccupancyGrid() {
+  if (!occupancy_grid_ || decoder_->statistics().revolutions == occupancy_grid_revolutions_) {
+    return;
+  }
+  const int64_t publish_start = PacketReceiver::NowNs();
+  occupancy_grid_revolutions_ = decoder_->statistics().revolutions;
+  occupancy_grid_->copy(occupancy_cells_.data());
+  auto grid_proto = tx_occupancy_grid().initProto();
+  grid_proto.setCells(occupancy_grid_->cells());
+  grid_proto.setCellSize(occupancy_grid_->cellSize());
+  grid_proto.setOriginX(occupancy_grid_->originX());
+  grid_proto.setOriginY(occupancy_grid_->originY());
+  auto log_odds_proto = grid_proto.initLogOdds(occupancy_cells_.size());
+  for (size_t i = 0; i < occupancy_cells_.size(); i++) {
+    log_odds_proto.set(i, occupancy_cells_[i]);
+  }
+  tx_occupancy_grid().publish(getTickTimestamp());
+  publish_duration_ += PacketReceiver::NowNs() - publish_start;
+}
+
+void VelodyneLidar::updatePose() {
+  if (!elevation_map_ && !occupancy_grid_) {
+    return;
+  }
+  const auto odom_T_robot = try_get_odom_T_robot(getTickTime());
+  if (!odom_T_robot) {
+    return;
+  }
+  const double x = odom_T_robot->translation.x();
+  const double y = odom_T_robot->translation.y();
+  const double yaw = odom_T_robot->rotation.angle();
+  if (elevation_map_) {
+    elevation_map_->setPose(x, y, yaw);
+  }
+  if (occupancy_grid_) {
+    // Rays start at the sensor, thus the grid needs its position instead of the one of the robot
+    const RigidTransform robot_T_lidar = ToRigidTransform(get_robot_T_lidar());
+    const double cos_yaw = std::cos(yaw);
+    const double sin_yaw = std::sin(yaw);
+    const double lidar_x = robot_T_lidar.translation[0];
+    const double lidar_y = robot_T_lidar.translation[1];
+    const double lidar_yaw = std::atan2(robot_T_lidar.rotation[3], robot_T_lidar.rotation[0]);
+    occupancy_grid_->setPose(x + cos_yaw * lidar_x - sin_yaw * lidar_y,
+                             y + sin_yaw * lidar_x + cos_yaw * lidar_y, yaw + lidar_yaw);
+  }
+}
+
+void VelodyneLidar::publishPillars() {
+  if (!pillar_grid_ || pillar_grid_->revolutions() == pillar_revolutions_) {
+    return;
+  }
+  const int64_t publish_start = PacketReceiver::NowNs();
+  pillar_revolutions_ = pillar_grid_->revolutions();
+  Tensor3f pillars(PillarGrid::kChannels, pillar_grid_->rows(), pillar_grid_->columns());
+  pillar_grid_->mergeCompleted(pillars.element_wise_begin());
+  ToProto(std::move(pillars), tx_pillars().initProto(), tx_pillars().buffers());
+  tx_pillars().publish(getTickTimestamp());
+  publish_duration_ += PacketReceiver::NowNs() - publish_start;
+}
+
+void VelodyneLidar::publishScanMotions() {
+  if (!registration_) {
+    return;
+  }
+  std::vector<RegistrationResult> results;
+  {
+    std::lock_guard<std::mutex> lock(scan_motions_mutex_);
+    results.swap(scan_motions_);
+  }
+  for (const RegistrationResult& result : results) {
+    auto motion_proto = tx_scan_motion().initProto();
+    auto rotation_proto = motion_proto.initRotation(9);
+    for (int i = 0; i < 9; i++) {
+      rotation_proto.set(i, result.transform.rotation[i]);
     }
+    auto translation_proto = motion_proto.initTranslation(3);
+    for (int i = 0; i < 3; i++) {
+      translation_proto.set(i, result.transform.translation[i]);
+    }
+    motion_proto.setCorrespondences(result.correspondences);
+    motion_proto.setRmsError(result.rms_error);
+    motion_proto.setIterations(result.iterations);
+    motion_proto.setConverged(result.converged);
+    motion_proto.setReferenceAcqtime(result.target_timestamp);
+    tx_scan_motion().publish(result.source_timestamp);
+  }
+}
+
+void VelodyneLidar::publishScanStatus(size_t valid_slices, int received_packets,
+                                      int64_t first_packet_timestamp) {
+  auto status_proto = tx_scan_status().initProto();
+  status_proto.setPartial(valid_slices < number_of_slices_);
+  auto valid_columns = status_proto.initValidColumns(number_of_slices_);
+  for (size_t i = 0; i < number_of_slices_; i++) {
+    valid_columns.set(i, i < valid_slices);
+  }
+  status_proto.setReceivedPackets(received_packets);
+  status_proto.setExpectedPackets(kNumberOfAccumulatedPackets);
+  status_proto.setFirstPacketTimestamp(first_packet_timestamp);
+  status_proto.setDeadline(deadline_);
+  tx_scan_status().publish(getTickTimestamp());
+}
+
+void VelodyneLidar::publishRawPackets() {
+  VELODYNE_TRACE_SCOPE("publish_raw_packets", packet_id_);
+  WriteRawPacketBatch(model_type_, parameters_.packet_sans_header_size, raw_packets_,
+                      raw_packet_timestamps_, raw_packet_count_,
+                      tx_raw_packets().initProto());
+  tx_raw_packets().publish(getTickTimestamp());
+  raw_packet_count_ = 0;
+  // Without decoding a batch of raw packets takes the role of a scan
+  if (!decode_) {
+    scan_published_ = true;
+  }
+}
+
+void VelodyneLidar::resetScanBuffers() {
+  decoder_->setOutput(scan_writer_->buffers());
+}
+
+void VelodyneLidar::writeTrace() {
+  if (!trace::WriteChromeTrace(get_trace_file())) {
+    LOG_WARNING("Could not write trace to '%s'", get_trace_file().c_str());
+  } else if (!trace::kEnabled) {
+    LOG_WARNING("Tracing is disabled in this build, the trace is empty");
   }
 }
 
+void VelodyneLidar::updateMetrics(const byte* packet, int64_t timestamp) {
+  metrics_->packets.add();
+  metrics_->kernel_drops.set(use_xdp_ ? xdp_receiver_.kernelDrops() : receiver_.kernelDrops());
+  if (!use_xdp_) {
+    metrics_->truncated_packets.set(receiver_.truncatedPackets());
+  }
+
+  // The sensor stamps packets in microseconds since the top of the hour
+  uint32_t sensor_time;
+  std::memcpy(&sensor_time, packet + parameters_.blocks_per_packet * parameters_.block_size,
+              sizeof(sensor_time));
+  int64_t offset = (timestamp / kNanosecondsPerMicrosecond) % kMicrosecondsPerHour - sensor_time;
+  if (offset >= kMicrosecondsPerHour / 2) offset -= kMicrosecondsPerHour;
+  if (offset < -kMicrosecondsPerHour / 2) offset += kMicrosecondsPerHour;
+  metrics_->clock_offset.set(offset * kMicrosecondsToSeconds);
+
+  if (!decode_) {
+    return;
+  }
+  const DecoderStatistics& statistics = decoder_->statistics();
+  metrics_->lost_packets.set(statistics.lost_packets);
+  metrics_->invalid_blocks.set(statistics.invalid_blocks);
+  if (statistics.revolutions > last_revolutions_) {
+    if (last_revolution_time_ >= 0 && timestamp > last_revolution_time_) {
+      metrics_->rpm.set(kSecondsPerMinute * kSecondsToNanoseconds *
+                        (statistics.revolutions - last_revolutions_) /
+                        (timestamp - last_revolution_time_));
+    }
+    last_revolutions_ = statistics.revolutions;
+    last_revolution_time_ = timestamp;
+  }
+  updateRingHealth(timestamp);
+}
+
+void VelodyneLidar::updateRingHealth(int64_t timestamp) {
+  if (!ring_health_) {
+    return;
+  }
+  if (last_ring_health_time_ < 0) {
+    last_ring_health_time_ = timestamp;
+    return;
+  }
+  if (timestamp - last_ring_health_time_ < get_ring_health_period() * kSecondsToNanoseconds) {
+    return;
+  }
+  last_ring_health_time_ = timestamp;
+  if (!ring_health_->update(decoder_->ringStatistics(), ring_health_report_)) {
+    return;
+  }
+
+  const RingHealthReport& report = ring_health_report_;
+  const size_t beams = report.rings.size();
+  auto proto = tx_ring_health().initProto();
+  proto.setColumns(report.columns);
+  auto return_ratio = proto.initReturnRatio(beams);
+  auto mean_range = proto.initMeanRange(beams);
+  auto mean_intensity = proto.initMeanIntensity(beams);
+  size_t degraded = 0;
+  for (size_t k = 0; k < beams; k++) {
+    return_ratio.set(k, report.rings[k].return_ratio);
+    mean_range.set(k, report.rings[k].mean_range);
+    mean_intensity.set(k, report.rings[k].mean_intensity);
+    degraded += report.rings[k].degraded ? 1 : 0;
+  }
+  auto degraded_rings = proto.initDegradedRings(degraded);
+  for (size_t k = 0, i = 0; k < beams; k++) {
+    if (report.rings[k].degraded) {
+      degraded_rings.set(i++, k);
+    }
+  }
+  auto alarm_rings = proto.initAlarmRings(report.alarm_rings.size());
+  for (size_t i = 0; i < report.alarm_rings.size(); i++) {
+    alarm_rings.set(i, report.alarm_rings[i]);
+  }
+  tx_ring_health().publish(getTickTimestamp());
+
+  metrics_->alarm_rings.set(report.alarm_rings.size());
+  for (uint32_t laser : report.alarm_rings) {
+    if (std::find(alarm_rings_.begin(), alarm_rings_.end(), laser) == alarm_rings_.end()) {
+      LOG_ERROR("Ring %u is degraded: return ratio %.2f, mean intensity %.1f. The window may be "
+                "dirty or the laser may be failing.",
+                laser, report.rings[laser].return_ratio, report.rings[laser].mean_intensity);
+      if (get_black_box_on_alarm() && black_box_.capacity() > 0) {
+        dumpBlackBox("after a ring alarm");
+      }
+    }
+  }
+  alarm_rings_ = report.alarm_rings;
+}
+
+void VelodyneLidar::dumpBlackBox(const char* reason) {
+  if (black_box_.capacity() == 0) {
+    LOG_WARNING("Ignoring request to dump the black box because it is disabled");
+    return;
+  }
+  in_addr source;
+  if (inet_pton(AF_INET, get_ip().c_str(), &source) != 1) {
+    source.s_addr = INADDR_ANY;
+  }
+  const std::string filename = get_black_box_directory() + "/" + node()->name() + "_" +
+                               std::to_string(PacketReceiver::NowNs()) + ".pcap";
+  if (!black_box_.dump(filename, get_port(), ntohl(source.s_addr))) {
+    LOG_WARNING("Could not dump the black box %s, the previous dump is still written", reason);
+    return;
+  }
+  LOG_INFO("Dumping %zu packets of the black box to '%s' %s", black_box_.size(), filename.c_str(),
+           reason);
+}
+
 void VelodyneLidar::initLaser(VelodyneModelType model_type) {
+  model_type_ = model_type;
   parameters_ = GetVelodyneParameters(model_type);
-  raw_packet_.resize(parameters_.packet_sans_header_size, '\0');
+  raw_packet_count_ = 0;
+
+  // A scan contains the columns of a fixed number of packets
+  DecoderOptions options;
+  options.batch_size = kNumberOfAccumulatedPackets * ColumnsPerPacket(parameters_);
+  if (get_ring_health_period() > 0.0) {
+    options.ring_statistics_stride = std::max(1, get_ring_health_stride());
+  }
+  decoder_ = std::make_unique<Decoder>(parameters_, options);
+  decoder_->setCallback([this](const ColumnBatch& batch) { publishScan(batch); });
+  number_of_slices_ = options.batch_size;
+}
+
+bool VelodyneLidar::allocateBuffers() {
+  const size_t packet_size = parameters_.packet_sans_header_size;
+  size_t black_box_capacity = 0;
+  if (get_black_box_duration() > 0.0) {
+    // In dual return mode every firing fills two columns, which doubles the packet rate
+    const auto return_mode = try_get_sensor_return_mode();
+    const double returns = return_mode && *return_mode == "Dual" ? 2.0 : 1.0;
+    const double packet_period = ColumnsPerPacket(parameters_) * parameters_.firing_cycle / returns;
+    black_box_capacity =
+        static_cast<size_t>(std::ceil(get_black_box_duration() / packet_period));
+  }
+  const size_t size = Arena::Footprint(packet_size) +
+                      Arena::Footprint(kNumberOfAccumulatedPackets * packet_size) +
+                      Arena::Footprint(kNumberOfAccumulatedPackets * sizeof(int64_t)) +
+                      Arena::Footprint(number_of_slices_ * sizeof(double)) +
+                      BlackBox::ArenaSize(packet_size, black_box_capacity);
+  if (!arena_.open(size, get_huge_pages())) {
+    reportFailure("Could not allocate %zu bytes for buffers: errno=%d", size, errno);
+    return false;
+  }
+  if (arena_.pages() != get_huge_pages()) {
+    LOG_WARNING("Buffers use %s pages instead of %s pages", HugePagesName(arena_.pages()),
+                HugePagesName(get_huge_pages()));
+  }
+  // The receive buffer is next to the decoder outputs and the black box follows at the end
+  packet_ = static_cast<byte*>(arena_.allocate(packet_size));
+  raw_packets_ = static_cast<byte*>(arena_.allocate(kNumberOfAccumulatedPackets * packet_size));
+  raw_packet_timestamps_ = arena_.allocate<int64_t>(kNumberOfAccumulatedPackets);
+  scan_writer_ = std::make_unique<RangeScanWriter>(
+      parameters_, number_of_slices_, arena_.allocate<double>(number_of_slices_));
+  if (black_box_capacity > 0 && !black_box_.open(arena_, packet_size, black_box_capacity)) {
+    reportFailure("Could not allocate black box for %zu packets", black_box_capacity);
+    return false;
+  }
+  resetScanBuffers();
+  return true;
+}
+
+bool VelodyneLidar::createAzimuthMask() {
+  azimuth_mask_.reset();
+  const Json sectors = get_masked_sectors();
+  if (sectors.is_array() && sectors.empty()) {
+    return true;
+  }
+  azimuth_mask_ = std::make_unique<AzimuthMask>(parameters_.vertical_beams, kMaskSectors);
+  if (!ParseAzimuthMask(sectors, *azimuth_mask_)) {
+    reportFailure("Could not parse the masked sectors");
+    return false;
+  }
+  return true;
+}
+
+void VelodyneLidar::feedDecoder(const byte* packet, size_t size, int64_t timestamp) {
+  if (azimuth_mask_) {
+    decoder_->feed(packet, size, timestamp, *azimuth_mask_);
+  } else {
+    decoder_->feed(packet, size, timestamp);
+  }
+}
+
+void VelodyneLidar::finishDecoder() {
+  if (azimuth_mask_) {
+    decoder_->finish(*azimuth_mask_);
+  } else {
+    decoder_->finish();
+  }
+}
+
+bool VelodyneLidar::createProducts() {
+  decode_ = get_publish_scan() || get_publish_flatscan() || get_publish_cloud() ||
+            get_publish_elevation_map() || get_publish_occupancy_grid() || get_publish_pillars() ||
+            get_publish_features() || get_publish_scan_motion();
+  products_ = std::make_unique<OutputEngine>(parameters_.vertical_beams);
+  flatscan_writer_.reset();
+  cloud_writer_.reset();
+  elevation_map_.reset();
+  occupancy_grid_.reset();
+  pillar_grid_.reset();
+  features_.reset();
+  registration_.reset();
+  if (get_publish_flatscan()) {
+    const Vector2d angles = get_flatscan_angles();
+    flatscan_writer_ =
+        std::make_unique<FlatscanWriter>(parameters_, DegToRad(angles[0]), DegToRad(angles[1]));
+    if (flatscan_writer_->beams() == 0) {
+      reportFailure("No beam has a vertical angle between %f and %f degrees", angles[0],
+                    angles[1]);
+      return false;
+    }
+    products_->add(flatscan_writer_.get());
+  }
+  if (get_publish_cloud()) {
+    PointCloudOptions options;
+    options.column_stride = std::max(1, get_cloud_column_stride());
+    options.beam_stride = std::max(1, get_cloud_beam_stride());
+    if (!ParseRegionOfInterest(get_cloud_region(), options.region)) {
+      reportFailure("Could not parse the region of interest of the point cloud");
+      return false;
+    }
+    options.region.vehicle_T_sensor = ToRigidTransform(get_robot_T_lidar());
+    cloud_writer_ = std::make_unique<PointCloudWriter>(parameters_, options);
+    products_->add(cloud_writer_.get());
+  }
+  if (get_publish_elevation_map()) {
+    const int cells = get_elevation_map_cells();
+    if (cells <= 0 || (cells & (cells - 1)) != 0) {
+      reportFailure("The number of cells of the elevation map needs to be a power of two: %d",
+                    cells);
+      return false;
+    }
+    if (get_elevation_map_cell_size() <= 0.0) {
+      reportFailure("The cell size of the elevation map needs to be positive");
+      return false;
+    }
+    ElevationMapOptions options;
+    options.cells = static_cast<size_t>(cells);
+    options.cell_size = get_elevation_map_cell_size();
+    options.extrinsic = ToRigidTransform(get_robot_T_lidar());
+    const Vector2d heights = get_elevation_map_heights();
+    options.minimum_height = heights[0];
+    options.maximum_height = heights[1];
+    elevation_map_ = std::make_unique<ElevationMap>(parameters_, options);
+    products_->add(elevation_map_.get());
+  }
+  elevation_map_revolutions_ = 0;
+  if (get_publish_occupancy_grid()) {
+    const int cells = get_occupancy_grid_cells();
+    if (cells <= 0 || (cells & (cells - 1)) != 0) {
+      reportFailure("The number of cells of the occupancy grid needs to be a power of two: %d",
+                    cells);
+      return false;
+    }
+    if (get_occupancy_grid_cell_size() <= 0.0) {
+      reportFailure("The cell size of the occupancy grid needs to be positive");
+      return false;
+    }
+    const Vector2d angles = get_occupancy_grid_angles();
+    OccupancyGridOptions options;
+    options.cells = static_cast<size_t>(cells);
+    options.cell_size = get_occupancy_grid_cell_size();
+    options.minimum_angle = DegToRad(angles[0]);
+    options.maximum_angle = DegToRad(angles[1]);
+    occupancy_grid_ = std::make_unique<OccupancyGrid>(parameters_, options);
+    if (occupancy_grid_->beams() == 0) {
+      reportFailure("No beam has a vertical angle between %f and %f degrees", angles[0],
+                    angles[1]);
+      return false;
+    }
+    occupancy_cells_.resize(options.cells * options.cells);
+    products_->add(occupancy_grid_.get());
+  }
+  occupancy_grid_revolutions_ = decoder_->statistics().revolutions;
+  if (get_publish_pillars()) {
+    const Vector2i cells = get_pillar_cells();
+    const Vector2d origin = get_pillar_origin();
+    const Vector2d heights = get_pillar_heights();
+    if (cells[0] <= 0 || cells[1] <= 0 || get_pillar_cell_size() <= 0.0 ||
+        heights[1] <= heights[0]) {
+      reportFailure("Invalid size of the bird's-eye-view tensor");
+      return false;
+    }
+    PillarGridOptions options;
+    options.rows = static_cast<size_t>(cells[0]);
+    options.columns = static_cast<size_t>(cells[1]);
+    options.minimum_x = origin[0];
+    options.minimum_y = origin[1];
+    options.cell_size = get_pillar_cell_size();
+    options.minimum_height = heights[0];
+    options.maximum_height = heights[1];
+    pillar_grid_ = std::make_unique<PillarGrid>(parameters_, options);
+    products_->add(pillar_grid_.get());
+  }
+  pillar_revolutions_ = 0;
+  if (get_publish_features()) {
+    if (get_feature_sectors() <= 0) {
+      reportFailure("There needs to be at least one feature sector");
+      return false;
+    }
+    const Vector2d thresholds = get_feature_thresholds();
+    FeatureOptions options;
+    options.sectors = static_cast<size_t>(get_feature_sectors());
+    options.edges_per_sector = static_cast<size_t>(std::max(0, get_feature_edges_per_sector()));
+    options.planes_per_sector = static_cast<size_t>(std::max(0, get_feature_planes_per_sector()));
+    options.edge_threshold = static_cast<float>(thresholds[0]);
+    options.plane_threshold = static_cast<float>(thresholds[1]);
+    features_ = std::make_unique<FeatureExtractor>(parameters_, options);
+    products_->add(features_.get());
+  }
+  features_revolutions_ = 0;
+  if (get_publish_scan_motion()) {
+    RegistrationOptions options;
+    options.threads = static_cast<size_t>(std::max(1, get_registration_threads()));
+    options.column_stride = static_cast<size_t>(std::max(1, get_registration_column_stride()));
+    options.maximum_distance = get_registration_maximum_distance();
+    registration_ = std::make_unique<ScanRegistration>(parameters_, options);
+    products_->add(registration_.get());
+  }
+  products_->begin();
+  return true;
+}
+
+bool VelodyneLidar::tuneDecoder() {
+  product_packets_ = 0;
+  DecoderTuningOptions options;
+  options.batch_size = number_of_slices_;
+  options.budget = get_autotune_budget();
+  options.kernel = get_kernel();
+  options.product_interval = static_cast<size_t>(std::max(0, get_product_interval()));
+  if (!options.kernel.empty() && FindChannelKernel(options.kernel) == nullptr) {
+    reportFailure("Channel kernel '%s' is not available on this CPU", options.kernel.c_str());
+    return false;
+  }
+  DecoderTuning tuning;
+  tuning.kernel = options.kernel;
+  tuning.product_interval = std::max<size_t>(1, options.product_interval);
+  const bool fixed =
+      !options.kernel.empty() && (options.product_interval > 0 || products_->empty());
+  if (decode_ && get_autotune() && !fixed) {
+    // The cost of the products depends on which ones are computed
+    std::string products;
+    if (flatscan_writer_) {
+      products += "flatscan " + std::to_string(flatscan_writer_->beams());
+    }
+    if (cloud_writer_) {
+      products += (products.empty() ? "cloud " : ", cloud ") +
+                  std::to_string(get_cloud_column_stride()) + "x" +
+                  std::to_string(get_cloud_beam_stride()) +
+                  (get_cloud_region().empty() ? "" : " region");
+    }
+    if (elevation_map_) {
+      products += (products.empty() ? "elevation " : ", elevation ") +
+                  std::to_string(get_elevation_map_cells());
+    }
+    if (occupancy_grid_) {
+      products += (products.empty() ? "occupancy " : ", occupancy ") +
+                  std::to_string(get_occupancy_grid_cells()) + " " +
+                  std::to_string(occupancy_grid_->beams());
+    }
+    if (pillar_grid_) {
+      products += (products.empty() ? "pillars " : ", pillars ") +
+                  std::to_string(pillar_grid_->rows()) + "x" +
+                  std::to_string(pillar_grid_->columns());
+    }
+    if (features_) {
+      products += products.empty() ? "features" : ", features";
+    }
+    if (registration_) {
+      products += products.empty() ? "registration" : ", registration";
+    }
+    const std::string cache = get_autotune_cache();
+    const std::string key = DecoderTuningKey(parameters_, options, products);
+    if (!cache.empty() && LoadDecoderTuning(cache, key, tuning)) {
+      LOG_INFO("Using decoder configuration from '%s': kernel %s, product interval %zu",
+               cache.c_str(), tuning.kernel.c_str(), tuning.product_interval);
+    } else {
+      if (!TuneDecoder(parameters_, *products_, options, tuning)) {
+        reportFailure("No channel kernel decodes the synthetic packets correctly");
+        return false;
+      }
+      // Products which span scans, like the elevation map, kept state of the synthetic packets
+      if (!createProducts()) {
+        return false;
+      }
+      LOG_INFO("Measured %zu decoder configurations: kernel %s, product interval %zu, %.1f ns per "
+               "column", tuning.candidates, tuning.kernel.c_str(), tuning.product_interval,
+               tuning.column_time);
+      if (!cache.empty() && !StoreDecoderTuning(cache, key, tuning)) {
+        LOG_WARNING("Could not write the decoder configuration to '%s'", cache.c_str());
+      }
+    }
+  }
+  if (!decoder_->setKernel(tuning.kernel)) {
+    reportFailure("Channel kernel '%s' is not available", tuning.kernel.c_str());
+    return false;
+  }
+  product_interval_ = tuning.product_interval;
+  return true;
+}
+
+bool VelodyneLidar::createSafetyMonitor() {
+  safety_.reset();
+  last_safety_time_ = -1;
+  std::vector<SafetyField> fields;
+  if (!ParseSafetyFields(get_safety_fields(), fields)) {
+    reportFailure("Could not parse the safety fields");
+    return false;
+  }
+  if (fields.empty()) {
+    return true;
+  }
+  SafetyMonitorOptions options;
+  options.sectors = static_cast<size_t>(std::max(1, get_safety_sectors()));
+  options.min_returns = static_cast<uint32_t>(std::max(1, get_safety_min_returns()));
+  safety_ = std::make_unique<SafetyMonitor>(parameters_, options);
+  for (const SafetyField& field : fields) {
+    if (!safety_->addField(field)) {
+      reportFailure("Safety field '%s' needs at least three corners around the sensor and at "
+                    "most %zu fields are supported", field.name.c_str(), SafetyMonitor::kMaxFields);
+      return false;
+    }
+  }
+  return true;
+}
+
+void VelodyneLidar::checkSafety(const byte* packet, int64_t timestamp) {
+  const uint64_t previous = safety_->violated();
+  const bool changed = safety_->process(packet);
+  if (!changed && last_safety_time_ >= 0 &&
+      timestamp - last_safety_time_ < get_safety_period() * kSecondsToNanoseconds) {
+    return;
+  }
+  last_safety_time_ = timestamp;
+  const uint64_t violated = safety_->violated();
+  const auto& fields = safety_->fields();
+  auto proto = tx_safety().initProto();
+  switch (safety_->action()) {
+    case SafetyAction::kNone:
+      proto.setAction(::VelodyneSafetyAction::NONE);
+      break;
+    case SafetyAction::kSlowDown:
+      proto.setAction(::VelodyneSafetyAction::SLOW_DOWN);
+      break;
+    case SafetyAction::kStop:
+      proto.setAction(::VelodyneSafetyAction::STOP);
+      break;
+  }
+  size_t count = 0;
+  for (size_t k = 0; k < fields.size(); k++) {
+    count += (violated >> k) & 1;
+  }
+  auto names = proto.initViolatedFields(count);
+  for (size_t k = 0, i = 0; k < fields.size(); k++) {
+    if ((violated >> k) & 1) {
+      names.set(i++, fields[k].name);
+    }
+  }
+  proto.setPacketTimestamp(timestamp);
+  tx_safety().publish(getTickTimestamp());
+
+  metrics_->safety_latency.observe(PacketReceiver::NowNs() - timestamp);
+  const uint64_t started = violated & ~previous;
+  for (size_t k = 0; k < fields.size(); k++) {
+    if ((started >> k) & 1) {
+      metrics_->safety_violations.add();
+      LOG_WARNING("Safety field '%s' is violated", fields[k].name.c_str());
+    }
+  }
+}
+
+bool VelodyneLidar::openReceiver() {
+  use_xdp_ = false;
+  if (!get_xdp_interface().empty()) {
+    if (xdp_receiver_.open(get_xdp_interface(), get_xdp_queue(), get_ip(), get_port(),
+                           get_huge_pages())) {
+      use_xdp_ = true;
+      LOG_INFO("Receiving with AF_XDP on %s queue %d in %s mode%s", get_xdp_interface().c_str(),
+               get_xdp_queue(), xdp_receiver_.nativeMode() ? "native" : "generic",
+               xdp_receiver_.zeroCopy() ? " with zero copy" : "");
+      return true;
+    }
+    LOG_WARNING("Could not receive with AF_XDP on %s, falling back to a socket: errno=%d",
+                get_xdp_interface().c_str(), errno);
+  }
+  if (!receiver_.open(get_ip(), get_port())) {
+    return false;
+  }
+  if (!receiver_.kernelTimestamps()) {
+    LOG_WARNING("Kernel receive timestamps are not available, stamping packets when they are read");
+  }
+  if (receiver_.receiveBufferSize() < PacketReceiver::kRequestedBufferSize) {
+    LOG_WARNING("The socket receive buffer has %zu bytes instead of %zu, raise net.core.rmem_max",
+                receiver_.receiveBufferSize(), PacketReceiver::kRequestedBufferSize);
+  }
+  return true;
+}
+
+PacketReceiver::Status VelodyneLidar::receivePacket(const byte*& packet, size_t& size,
+                                                    int64_t timeout, int64_t& timestamp) {
+  if (use_xdp_) {
+    return xdp_receiver_.receive(packet, size, timeout, timestamp);
+  }
+  packet = packet_;
+  return receiver_.receive(packet_, parameters_.packet_sans_header_size, timeout, size,
+                           timestamp);
 }
 
 }  // namespace velodyne_lidar
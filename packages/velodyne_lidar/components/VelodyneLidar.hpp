@@ -28,27 +28,55 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 #include "engine/alice/alice_codelet.hpp"
 #include "engine/core/byte.hpp"
-#include "engine/core/optional.hpp"
+#include "engine/core/math/pose3.hpp"
+#include "engine/core/math/types.hpp"
+#include "engine/core/tensor/tensor.hpp"
+#include "messages/flatscan.capnp.h"
+#include "messages/ping.capnp.h"
+#include "messages/point_cloud.capnp.h"
 #include "messages/range_scan.capnp.h"
+#include "messages/tensor.capnp.h"
+#include "packages/velodyne_lidar/components/velodyne_model_type.hpp"
+#include "packages/velodyne_lidar/gems/arena.hpp"
+#include "packages/velodyne_lidar/gems/black_box.hpp"
+#include "packages/velodyne_lidar/gems/column_policies.hpp"
+#include "packages/velodyne_lidar/gems/decoder.hpp"
+#include "packages/velodyne_lidar/gems/elevation_map.hpp"
+#include "packages/velodyne_lidar/gems/metrics.hpp"
+#include "packages/velodyne_lidar/gems/metrics_server.hpp"
+#include "packages/velodyne_lidar/gems/occupancy_grid.hpp"
+#include "packages/velodyne_lidar/gems/output_products.hpp"
+#include "packages/velodyne_lidar/gems/packet_receiver.hpp"
+#include "packages/velodyne_lidar/gems/pillar_grid.hpp"
+#include "packages/velodyne_lidar/gems/range_scan_writer.hpp"
+#include "packages/velodyne_lidar/gems/region_of_interest.hpp"
+#include "packages/velodyne_lidar/gems/ring_health.hpp"
+#include "packages/velodyne_lidar/gems/safety_fields.hpp"
+#include "packages/velodyne_lidar/gems/scan_features.hpp"
+#include "packages/velodyne_lidar/gems/scan_registration.hpp"
+#include "packages/velodyne_lidar/gems/sensor_config_client.hpp"
+#include "packages/velodyne_lidar/gems/trace.hpp"
 #include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+#include "packages/velodyne_lidar/gems/xdp_receiver.hpp"
+#include "packages/velodyne_lidar/messages/velodyne_lidar.capnp.h"
 
 namespace isaac {
-
-class Socket;
-
 namespace velodyne_lidar {
-// Serialization helper for :VelodyneModelType to JSON
-NLOHMANN_JSON_SERIALIZE_ENUM(VelodyneModelType, {
-                                                    {VelodyneModelType::VLP16, "VLP16"},
-                                                    {VelodyneModelType::INVALID, nullptr},
-                                                });
 
-// A driver for the Velodyne VLP16 Lidar.
+// Serialization helper for :HugePages to JSON
+NLOHMANN_JSON_SERIALIZE_ENUM(HugePages, {
+                                            {HugePages::kNone, "none"},
+                                            {HugePages::kTransparent, "transparent"},
+                                            {HugePages::kExplicit, "explicit"},
+                                        });
+
+// A driver for the Velodyne VLP16, VLP32C and VLS128 Lidars.
 class VelodyneLidar : public alice::Codelet {
  public:
   void start() override;
@@ -57,27 +85,355 @@ class VelodyneLidar : public alice::Codelet {
 
   // A range scan slice published by the Lidar
   ISAAC_PROTO_TX(RangeScanProto, scan);
+  // A planar scan made of the closest return within `flatscan_angles` of every column. Published
+  // together with every scan if `publish_flatscan` is enabled.
+  ISAAC_PROTO_TX(FlatscanProto, flatscan);
+  // A decimated point cloud of every scan. Only published if `publish_cloud` is enabled.
+  ISAAC_PROTO_TX(PointCloudProto, cloud);
+  // The elevation map of every revolution of the sensor. Only published if
+  // `publish_elevation_map` is enabled.
+  ISAAC_PROTO_TX(VelodyneElevationMapProto, elevation_map);
+  // The occupancy grid once the sensor completes a revolution. Only published if
+  // `publish_occupancy_grid` is enabled.
+  ISAAC_PROTO_TX(VelodyneOccupancyGridProto, occupancy_grid);
+  // A bird's-eye-view tensor of every revolution for object detectors with the channels, rows and
+  // columns of `PillarGrid`. Only published if `publish_pillars` is enabled.
+  ISAAC_PROTO_TX(TensorProto, pillars);
+  // Edge and planar features of every revolution of the sensor. Only published if
+  // `publish_features` is enabled.
+  ISAAC_PROTO_TX(VelodyneScanFeaturesProto, features);
+  // Motion of the sensor since the previous revolution found by aligning every revolution to the
+  // previous one. Only published if `publish_scan_motion` is enabled and the alignment succeeded.
+  // Published by the next tick after the alignment on a background thread is done, with the
+  // acquisition time of the aligned revolution.
+  ISAAC_PROTO_TX(VelodyneScanMotionProto, scan_motion);
+  // Describes which columns of the corresponding range scan are valid. Published together with
+  // every scan, and on its own if the deadline expires before any packet was received.
+  ISAAC_PROTO_TX(VelodyneScanStatusProto, scan_status);
+  // Batches of raw packets in the order in which they were received. Only published if
+  // `publish_raw_packets` is enabled. See `RawPacketBatch` for decoding packets on demand.
+  ISAAC_PROTO_TX(VelodyneRawPacketBatchProto, raw_packets);
+  // Return ratio, mean range and mean intensity of every ring and the rings which are degraded.
+  // Published every `ring_health_period` seconds if packets are decoded.
+  ISAAC_PROTO_TX(VelodyneRingHealthProto, ring_health);
+  // The most restrictive action of the violated safety fields. Published as soon as a packet
+  // changes the set of violated fields, before the packet is decoded, and every `safety_period`
+  // seconds otherwise.
+  ISAAC_PROTO_TX(VelodyneSafetyProto, safety);
+  // Writes the recorded trace events to `trace_file` whenever a message arrives. Trace events
+  // are only recorded if the package was built with tracing enabled.
+  ISAAC_PROTO_RX(PingProto, dump_trace);
+  // Writes the raw packets kept in the black box to a capture file whenever a message arrives
+  ISAAC_PROTO_RX(PingProto, dump_black_box);
 
   // The IP address of the Lidar device
   ISAAC_PARAM(std::string, ip, "192.168.2.201");
   // The port at which the Lidar device publishes data.
   ISAAC_PARAM(int, port, 2368);
-  // The type of the Lidar (currently only VLP16 is supported).
+  // The type of the Lidar: VLP16, VLP32C or VLS128
   ISAAC_PARAM(VelodyneModelType, type, VelodyneModelType::VLP16);
+  // Vertical angles of the beams in degrees ordered by laser ID. Overrides the angles of the
+  // sensor model and is required for the VLS128 whose angles are specific to every unit.
+  ISAAC_PARAM(std::vector<double>, vertical_angles);
+  // Maximum time in seconds between the kernel receive time of the first packet of a scan and the
+  // publication of the scan. If the deadline expires the columns received so far are published as
+  // a partial scan. A non-positive value waits for complete scans.
+  ISAAC_PARAM(double, scan_deadline, 0.02);
+  // If enabled packets are decoded and published as range scans on `scan`.
+  ISAAC_PARAM(bool, publish_scan, true);
+  // If enabled raw packets are published on `raw_packets`. Consumers which only record or forward
+  // sensor data can disable `publish_scan` to skip decoding entirely.
+  ISAAC_PARAM(bool, publish_raw_packets, false);
+  // The flat scan and the point cloud are computed while packets are decoded from the same column
+  // buffers as the range scan, which is much cheaper than consumers which each read the full
+  // range scan. Only the products which are enabled are computed.
+  ISAAC_PARAM(bool, publish_flatscan, false);
+  // Band of vertical angles in degrees whose beams contribute to the flat scan
+  ISAAC_PARAM(Vector2d, flatscan_angles, Vector2d(-1.5, 1.5));
+  ISAAC_PARAM(bool, publish_cloud, false);
+  // The point cloud keeps every n-th column and every n-th beam
+  ISAAC_PARAM(int, cloud_column_stride, 2);
+  ISAAC_PARAM(int, cloud_beam_stride, 1);
+  // Points outside of this region in the frame of the robot are dropped from the cloud, see
+  // `ParseRegionOfInterest` for the format. The cloud itself stays in the frame of the sensor.
+  // The region is not free: building the cloud takes about 2.6 ns per point on one core without
+  // a region, about 8.7 ns with a box and about 10 ns with a box and a polygon.
+  ISAAC_PARAM(Json, cloud_region, Json::object());
+  // The elevation map is updated with the columns of every packet and published once the sensor
+  // completes a revolution
+  ISAAC_PARAM(bool, publish_elevation_map, false);
+  // Number of cells along each side of the elevation map. Needs to be a power of two.
+  ISAAC_PARAM(int, elevation_map_cells, 256);
+  // Length of a side of a cell of the elevation map in meters
+  ISAAC_PARAM(double, elevation_map_cell_size, 0.2);
+  // Band of heights in meters in the frame of the robot whose points enter the elevation map
+  ISAAC_PARAM(Vector2d, elevation_map_heights, Vector2d(-5.0, 5.0));
+  // The occupancy grid is updated with the columns of every packet and keeps integrating returns
+  // across revolutions. It is published once the sensor completes a revolution.
+  ISAAC_PARAM(bool, publish_occupancy_grid, false);
+  // Number of cells along each side of the occupancy grid. Needs to be a power of two.
+  ISAAC_PARAM(int, occupancy_grid_cells, 512);
+  // Length of a side of a cell of the occupancy grid in meters
+  ISAAC_PARAM(double, occupancy_grid_cell_size, 0.1);
+  // Band of vertical angles in degrees whose beams are cast into the occupancy grid
+  ISAAC_PARAM(Vector2d, occupancy_grid_angles, Vector2d(-2.0, 2.0));
+  // The bird's-eye-view tensor covers `pillar_cells` cells along x and y in the frame of the
+  // sensor starting at `pillar_origin` in meters
+  ISAAC_PARAM(bool, publish_pillars, false);
+  ISAAC_PARAM(Vector2i, pillar_cells, Vector2i(512, 512));
+  ISAAC_PARAM(Vector2d, pillar_origin, Vector2d(-51.2, -51.2));
+  ISAAC_PARAM(double, pillar_cell_size, 0.2);
+  // Band of heights in meters in the frame of the sensor whose points enter the tensor
+  ISAAC_PARAM(Vector2d, pillar_heights, Vector2d(-3.0, 1.0));
+  // Edge and planar features are selected from every ring in each of `feature_sectors` sectors.
+  // They are published once the sensor completes a revolution.
+  ISAAC_PARAM(bool, publish_features, false);
+  ISAAC_PARAM(int, feature_sectors, 6);
+  ISAAC_PARAM(int, feature_edges_per_sector, 2);
+  ISAAC_PARAM(int, feature_planes_per_sector, 4);
+  // Curvature above which a return is an edge and below which it is planar
+  ISAAC_PARAM(Vector2d, feature_thresholds, Vector2d(0.1, 0.01));
+  // Every revolution is aligned to the previous one with projective ICP using
+  // `registration_threads` threads and every n-th column. The alignment runs on a background
+  // thread and revolutions which complete while the previous one is aligned are skipped.
+  ISAAC_PARAM(bool, publish_scan_motion, false);
+  ISAAC_PARAM(int, registration_threads, 2);
+  ISAAC_PARAM(int, registration_column_stride, 2);
+  // Correspondences which are farther apart in meters are rejected
+  ISAAC_PARAM(double, registration_maximum_distance, 1.0);
+  // Pose of the sensor on the robot
+  ISAAC_PARAM(Pose3d, robot_T_lidar, Pose3d::Identity());
+  // Pose of the robot in the odometry frame. The elevation map and the occupancy grid move with
+  // it and stay at the origin while it is not known.
+  ISAAC_POSE2(odom, robot);
+  // Sectors in which rays are masked out while decoding, for example where the sensor sees the
+  // vehicle, see `ParseAzimuthMask` for the format. Masked rays are published as invalid.
+  ISAAC_PARAM(Json, masked_sectors, Json::array());
+  // Channel kernel which unpacks the packets, for example "scalar" or "avx2". If empty the kernel
+  // is chosen by measuring all kernels supported by the CPU at start.
+  ISAAC_PARAM(std::string, kernel, "");
+  // Number of packets after which the output products are updated with the new columns. If zero
+  // the interval is chosen by measurements at start.
+  ISAAC_PARAM(int, product_interval, 0);
+  // If disabled the fastest kernel supported by the CPU is used without measurements and the
+  // products are updated after every packet
+  ISAAC_PARAM(bool, autotune, true);
+  // Time in seconds spent measuring decoder configurations on synthetic packets at start
+  ISAAC_PARAM(double, autotune_budget, 0.005);
+  // File in which the measured configuration is stored per host and sensor model and reused on
+  // the next start. Empty disables the cache.
+  ISAAC_PARAM(std::string, autotune_cache, "/tmp/velodyne_lidar_tuning.json");
+  // File to which trace events are written in the Chrome trace format, on request and when the
+  // driver stops
+  ISAAC_PARAM(std::string, trace_file, "/tmp/velodyne_lidar_trace.json");
+  // Port on the loopback interface at which health and performance metrics are served in the
+  // Prometheus text format. Drivers in the same process may share a port. Zero disables it.
+  ISAAC_PARAM(int, metrics_port, 0);
+  // Period in seconds at which the health of the rings is evaluated. Zero disables it.
+  ISAAC_PARAM(double, ring_health_period, 5.0);
+  // Every n-th packet is sampled for the ring health which keeps the overhead below one percent of
+  // the decoding time
+  ISAAC_PARAM(int, ring_health_stride, 256);
+  // A ring is degraded if its return ratio or mean intensity is below this fraction of the average
+  // of its neighbors
+  ISAAC_PARAM(double, ring_degraded_fraction, 0.5);
+  // Number of consecutive windows in which a ring needs to be degraded to raise the alarm
+  ISAAC_PARAM(int, ring_alarm_windows, 3);
+  // Polygonal fields around the sensor in the sensor frame which are checked against every packet
+  // as soon as it is received, see `ParseSafetyFields` for the format. An empty list disables the
+  // safety output.
+  ISAAC_PARAM(Json, safety_fields, Json::array());
+  // Number of returns within a field in a single packet at which the field is violated
+  ISAAC_PARAM(int, safety_min_returns, 3);
+  // Number of horizontal sectors for which range thresholds are precomputed per laser
+  ISAAC_PARAM(int, safety_sectors, 720);
+  // Period in seconds at which the safety state is published while it does not change
+  ISAAC_PARAM(double, safety_period, 0.1);
+  // Duration in seconds of the raw data which is kept in memory and written to a capture file in
+  // `black_box_directory` on request or when a ring raises an alarm. The memory is allocated at
+  // startup for the packet rate of the sensor model, which doubles if `sensor_return_mode` is
+  // "Dual". A sensor which is left in dual return mode without setting `sensor_return_mode` only
+  // keeps half the duration. Zero disables the black box.
+  ISAAC_PARAM(double, black_box_duration, 0.0);
+  ISAAC_PARAM(std::string, black_box_directory, "/tmp");
+  // If enabled the black box is dumped when a ring raises an alarm
+  ISAAC_PARAM(bool, black_box_on_alarm, true);
+  // Pages which back the buffers of the driver: "none", "transparent" or "explicit". All buffers
+  // including the black box are allocated from one contiguous arena. Explicit huge pages need to
+  // be reserved with vm.nr_hugepages and fall back to transparent huge pages.
+  ISAAC_PARAM(HugePages, huge_pages, HugePages::kNone);
+  // Network interface on which packets are received with AF_XDP, bypassing the network stack of
+  // the kernel. Only the packets which arrive on receive queue `xdp_queue` are seen, thus the
+  // flow of the sensor needs to be steered to that queue, for example with `ethtool -N`. Falls
+  // back to a regular socket if the backend is not compiled in or can not be attached. Empty
+  // always uses a regular socket.
+  ISAAC_PARAM(std::string, xdp_interface, "");
+  ISAAC_PARAM(int, xdp_queue, 0);
+  // Port of the web interface of the sensor which is used to apply the `sensor_*` settings and to
+  // poll the status of the sensor. Requests are sent from a background thread and never delay
+  // the reception of packets.
+  ISAAC_PARAM(int, sensor_http_port, 80);
+  // Rotation speed in revolutions per minute which is set at startup. Left unchanged if not set.
+  ISAAC_PARAM(int, sensor_rpm);
+  // Return mode which is set at startup: "Strongest", "Last" or "Dual"
+  ISAAC_PARAM(std::string, sensor_return_mode);
+  // Start and end azimuth in degrees of the field of view which is set at startup
+  ISAAC_PARAM(Vector2i, sensor_fov);
+  // If set the rotation is locked to the PPS signal with this azimuth offset in degrees
+  ISAAC_PARAM(int, sensor_phase_lock_offset);
+  // Period in seconds at which the status of the sensor is polled. Zero disables polling.
+  ISAAC_PARAM(double, sensor_status_period, 0.0);
+  // Time in seconds after which a request to the web interface is aborted
+  ISAAC_PARAM(double, sensor_http_timeout, 2.0);
 
  private:
-  // Process a packet of data coming on the wire with VLP16Format
-  void processDataBlockVPL16(const VelodyneRawDataBlock& raw_block, TensorView2ui16 ranges,
-                             TensorView2ub intensities, int offset);
+  // Kernel receive timestamp of the oldest packet which was received but not yet published
+  int64_t pendingTimestamp() const;
+  // Publishes a batch of decoded columns as a range scan. Called by the decoder.
+  void publishScan(const ColumnBatch& batch);
+  // Publishes the enabled output products of the current scan
+  void publishProducts(int64_t acqtime);
+  // Publishes the elevation map if the sensor completed a revolution since it was last published
+  void publishElevationMap();
+  // Publishes the occupancy grid if the sensor completed a revolution since it was last published
+  void publishOccupancyGrid();
+  // Moves the elevation map and the occupancy grid to the current pose of the robot
+  void updatePose();
+  // Publishes the features if the sensor completed a revolution since they were last published
+  void publishFeatures();
+  // Publishes the pillar tensor if the sensor completed a revolution since it was last published
+  void publishPillars();
+  // Publishes the motions of the sensor which the background thread of the scan registration
+  // found since the last tick
+  void publishScanMotions();
+  // Publishes the status message for the current scan
+  void publishScanStatus(size_t valid_slices, int received_packets, int64_t first_packet_timestamp);
+  // Publishes the raw packets received since the last batch
+  void publishRawPackets();
+  // Allocates new tensors for the next scan and hands them to the decoder
+  void resetScanBuffers();
+  // Writes the recorded trace events to the configured file
+  void writeTrace();
+  // Updates the metrics after a packet was received and decoded
+  void updateMetrics(const byte* packet, int64_t timestamp);
+
+  // Evaluates and publishes the health of the rings if the period expired
+  void updateRingHealth(int64_t timestamp);
+  // Starts writing the black box to a new capture file
+  void dumpBlackBox(const char* reason);
+  // Starts the client of the web interface of the sensor if it is needed
+  bool startConfigClient();
+  // Exports the status reported by the web interface of the sensor
+  void updateSensorStatus();
 
   // Configures some member variables according to the lidar type
   void initLaser(VelodyneModelType model_type);
+  // Allocates the buffers of the driver from the arena
+  bool allocateBuffers();
+  // Creates the mask of the configured sectors
+  bool createAzimuthMask();
+  // Decodes a packet applying the mask if configured
+  void feedDecoder(const byte* packet, size_t size, int64_t timestamp);
+  // Decodes the held back packet applying the mask if configured and emits all columns
+  void finishDecoder();
+  // Creates the writers of the enabled output products
+  bool createProducts();
+  // Chooses the channel kernel and the product interval, see `TuneDecoder`
+  bool tuneDecoder();
+  // Creates the monitor of the configured safety fields
+  bool createSafetyMonitor();
+  // Checks a packet against the safety fields and publishes the state if needed
+  void checkSafety(const byte* packet, int64_t timestamp);
+  // Opens the AF_XDP receiver if configured and the socket otherwise
+  bool openReceiver();
+  // Waits for the next packet with the active receiver. `packet` stays valid until the next call.
+  PacketReceiver::Status receivePacket(const byte*& packet, size_t& size, int64_t timeout,
+                                       int64_t& timestamp);
+
+  PacketReceiver receiver_;
+  XdpReceiver xdp_receiver_;
+  // True if packets are received with `xdp_receiver_`
+  bool use_xdp_;
+  std::unique_ptr<Decoder> decoder_;
+  // Masks rays while they are decoded, or null if no sectors are masked
+  std::unique_ptr<AzimuthMask> azimuth_mask_;
+  // True if packets are decoded because at least one product is published
+  bool decode_;
+  // Computes the flat scan and the point cloud from the columns of the decoder
+  std::unique_ptr<OutputEngine> products_;
+  std::unique_ptr<FlatscanWriter> flatscan_writer_;
+  std::unique_ptr<PointCloudWriter> cloud_writer_;
+  std::unique_ptr<ElevationMap> elevation_map_;
+  std::unique_ptr<OccupancyGrid> occupancy_grid_;
+  // Revolutions of the decoder when the occupancy grid was last published
+  uint64_t occupancy_grid_revolutions_;
+  std::vector<int16_t> occupancy_cells_;
+  std::unique_ptr<PillarGrid> pillar_grid_;
+  // Revolutions of the pillar grid when it was last published
+  uint64_t pillar_revolutions_;
+  std::unique_ptr<FeatureExtractor> features_;
+  // Revolutions of the feature extractor when its features were last published
+  uint64_t features_revolutions_;
+  std::unique_ptr<ScanRegistration> registration_;
+  // Successful alignments which the background thread of the scan registration hands to `tick`
+  std::mutex scan_motions_mutex_;
+  std::vector<RegistrationResult> scan_motions_;
+  // Revolutions of the elevation map when it was last published
+  uint64_t elevation_map_revolutions_;
+  // The products are updated every `product_interval_` packets
+  size_t product_interval_;
+  size_t product_packets_;
+  // Memory of all buffers below which live as long as the driver runs
+  Arena arena_;
+  // The packet which is currently received with the socket. The AF_XDP receiver hands out
+  // packets in its own memory instead.
+  byte* packet_;
+
+  // Owns the buffers into which the decoder writes the columns of the current scan. Only the
+  // angles are part of the arena as the ranges and intensities are handed over to the message.
+  std::unique_ptr<RangeScanWriter> scan_writer_;
+  size_t number_of_slices_;
+  // Deadline of the current scan in nanoseconds, or -1 if there is none
+  int64_t deadline_;
+  // Set when a scan was published during the current tick
+  bool scan_published_;
+
+  // Raw packets which were received since the last raw packet batch was published
+  byte* raw_packets_;
+  int64_t* raw_packet_timestamps_;
+  int raw_packet_count_;
+
+  // Identifiers of packets and scans used in trace events
+  uint64_t packet_id_;
+  uint64_t scan_id_;
+  int64_t last_dump_trace_acqtime_;
 
-  std::unique_ptr<Socket> socket_;
-  std::optional<std::vector<byte>> previous_packet_;
-  std::vector<byte> raw_packet_;
+  std::shared_ptr<SensorMetrics> metrics_;
+  std::shared_ptr<MetricsServer> metrics_server_;
+  std::unique_ptr<RingHealthMonitor> ring_health_;
+  RingHealthReport ring_health_report_;
+  // Receive time of the packet at which the ring health was last evaluated
+  int64_t last_ring_health_time_;
+  // Laser IDs of the rings for which an alarm was raised
+  std::vector<uint32_t> alarm_rings_;
+  // Checks packets against the safety fields, or null if there are none
+  std::unique_ptr<SafetyMonitor> safety_;
+  // Receive time of the packet at which the safety state was last published
+  int64_t last_safety_time_;
+  BlackBox black_box_;
+  int64_t last_dump_black_box_acqtime_;
+  SensorConfigClient config_client_;
+  // Receive time of the last status of the sensor which was exported
+  int64_t last_status_timestamp_;
+  // Time spent publishing scans while decoding the current packet
+  int64_t publish_duration_;
+  // Revolutions counted by the decoder when the rotation speed was last updated and the receive
+  // time of the packet which completed that revolution
+  uint64_t last_revolutions_;
+  int64_t last_revolution_time_;
 
   // Model specific parameters
+  VelodyneModelType model_type_;
   VelodyneLidarParameters parameters_;
 };
 
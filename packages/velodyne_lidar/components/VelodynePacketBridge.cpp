@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "VelodynePacketBridge.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "engine/core/constants.hpp"
+#include "engine/core/logger.hpp"
+#include "messages/tensor.hpp"
+#include "packages/velodyne_lidar/gems/packet_receiver.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+constexpr double kSecondsToNanoseconds = 1e9;
+constexpr double kSecondsPerMinute = 60.0;
+constexpr double kTwoPi = 2.0 * Pi<double>;
+
+// Wraps an angle to the interval [0, 2 pi[
+double WrapTwoPi(double angle) {
+  angle = std::fmod(angle, kTwoPi);
+  return angle < 0.0 ? angle + kTwoPi : angle;
+}
+}  // namespace
+
+void VelodynePacketBridge::start() {
+  parameters_ = GetVelodyneParameters(get_type());
+  const auto vertical_angles = try_get_vertical_angles();
+  if (vertical_angles && !SetVerticalAngles(*vertical_angles, parameters_)) {
+    reportFailure("Expected %u vertical angles but got %zu", parameters_.vertical_beams,
+                  vertical_angles->size());
+    return;
+  }
+  if (parameters_.vertical_angles.size() != parameters_.vertical_beams) {
+    reportFailure("The vertical angles of this sensor model need to be configured");
+    return;
+  }
+  const double rpm = get_rpm();
+  if (rpm <= 0.0) {
+    reportFailure("The rotation speed needs to be positive: %f", rpm);
+    return;
+  }
+
+  // The sensor fires at a fixed rate, thus the rotation speed defines the horizontal resolution
+  columns_per_revolution_ = std::max<size_t>(
+      1, std::lround(kSecondsPerMinute / (rpm * parameters_.firing_cycle)));
+  column_angle_ = kTwoPi / columns_per_revolution_;
+  firing_cycle_ns_ = parameters_.firing_cycle * kSecondsToNanoseconds;
+
+  encoder_ = std::make_unique<PacketEncoder>(parameters_);
+  empty_ranges_.assign(parameters_.vertical_beams, 0);
+  empty_intensities_.assign(parameters_.vertical_beams, 0);
+  beam_map_.clear();
+  mapped_phis_.clear();
+  slice_map_.clear();
+  mapped_thetas_.clear();
+  last_scan_acqtime_ = -1;
+  has_scan_ = false;
+  start_time_ = -1;
+  column_index_ = 0;
+  outgoing_count_ = 0;
+
+  if (!sender_.open(get_ip(), get_port())) {
+    reportFailure("Could not start socket: errno=%d", errno);
+    return;
+  }
+
+  tickPeriodically(get_send_period());
+}
+
+void VelodynePacketBridge::tick() {
+  if (rx_scan().available() && rx_scan().acqtime() != last_scan_acqtime_) {
+    last_scan_acqtime_ = rx_scan().acqtime();
+    convertScan();
+  }
+  if (!has_scan_) {
+    return;
+  }
+
+  // Columns are fired on the same clock on which the driver timestamps received packets
+  const int64_t now = PacketReceiver::NowNs();
+  if (start_time_ < 0) {
+    start_time_ = now;
+    column_index_ = 0;
+  }
+  const int64_t next_time = start_time_ + static_cast<int64_t>(column_index_ * firing_cycle_ns_);
+  const int64_t max_lag = static_cast<int64_t>(get_max_lag() * kSecondsToNanoseconds);
+  if (now - next_time > max_lag) {
+    // Like a real sensor the bridge keeps rotating while no packets are sent
+    LOG_WARNING("Skipping %.3f s of packets", (now - next_time) / kSecondsToNanoseconds);
+    column_index_ = static_cast<uint64_t>((now - start_time_) / firing_cycle_ns_);
+    encoder_->reset();
+  }
+
+  // Encode all columns which were fired until now
+  const size_t packet_size = encoder_->packetSize();
+  const size_t beams = parameters_.vertical_beams;
+  outgoing_count_ = 0;
+  while (true) {
+    const int64_t time = start_time_ + static_cast<int64_t>(column_index_ * firing_cycle_ns_);
+    if (time > now) {
+      break;
+    }
+    const size_t column = column_index_ % columns_per_revolution_;
+    const int slice = slice_map_[column];
+    const uint16_t* ranges = slice < 0 ? empty_ranges_.data() : ranges_.data() + slice * beams;
+    const uint8_t* intensities =
+        slice < 0 ? empty_intensities_.data() : intensities_.data() + slice * beams;
+    column_index_++;
+    if (!encoder_->addColumn(-static_cast<double>(column) * column_angle_, ranges, intensities,
+                             time)) {
+      continue;
+    }
+    if (outgoing_.size() < (outgoing_count_ + 1) * packet_size) {
+      outgoing_.resize((outgoing_count_ + 1) * packet_size);
+    }
+    std::memcpy(outgoing_.data() + outgoing_count_ * packet_size, encoder_->packet(),
+                packet_size);
+    outgoing_count_++;
+  }
+  if (outgoing_count_ > 0 && sender_.send(outgoing_.data(), packet_size, outgoing_count_) < 0) {
+    LOG_WARNING("Could not send packets: errno=%d", errno);
+  }
+}
+
+void VelodynePacketBridge::stop() {
+  sender_.close();
+}
+
+void VelodynePacketBridge::convertScan() {
+  auto scan = rx_scan().getProto();
+  auto thetas_proto = scan.getTheta();
+  auto phis_proto = scan.getPhi();
+  std::vector<double> thetas(thetas_proto.begin(), thetas_proto.end());
+  std::vector<double> phis(phis_proto.begin(), phis_proto.end());
+  if (thetas.empty() || phis.empty()) {
+    LOG_WARNING("Ignoring scan without angles");
+    return;
+  }
+
+  // Ranges are either normalized or in meters
+  TensorConstView2ui16 normalized_ranges;
+  TensorConstView2f metric_ranges;
+  const bool is_normalized = FromProto(scan.getRanges(), rx_scan().buffers(), normalized_ranges);
+  if (!is_normalized && !FromProto(scan.getRanges(), rx_scan().buffers(), metric_ranges)) {
+    LOG_WARNING("Ignoring scan with unsupported range element type");
+    return;
+  }
+  const auto dimensions =
+      is_normalized ? normalized_ranges.dimensions() : metric_ranges.dimensions();
+  if (static_cast<size_t>(dimensions[0]) != thetas.size() ||
+      static_cast<size_t>(dimensions[1]) != phis.size()) {
+    LOG_WARNING("Ignoring scan with inconsistent dimensions");
+    return;
+  }
+  TensorConstView2ub scan_intensities;
+  const bool has_intensities =
+      FromProto(scan.getIntensities(), rx_scan().buffers(), scan_intensities) &&
+      scan_intensities.dimensions()[0] == dimensions[0] &&
+      scan_intensities.dimensions()[1] == dimensions[1];
+
+  updateBeamMap(phis);
+  updateSliceMap(thetas);
+
+  const double range_denormalizer = scan.getRangeDenormalizer() / 65535.0;
+  const double minimum_range = std::max<double>(scan.getInvalidRangeThreshold(),
+                                                parameters_.minimum_range);
+  const double maximum_range = std::min<double>(scan.getOutOfRangeThreshold(),
+                                                parameters_.maximum_range);
+  const size_t beams = parameters_.vertical_beams;
+  ranges_.resize(thetas.size() * beams);
+  intensities_.resize(thetas.size() * beams);
+  for (size_t i = 0; i < thetas.size(); i++) {
+    uint16_t* ranges = ranges_.data() + i * beams;
+    uint8_t* intensities = intensities_.data() + i * beams;
+    for (size_t j = 0; j < beams; j++) {
+      const int k = beam_map_[j];
+      const double range = is_normalized ? normalized_ranges(i, k) * range_denormalizer
+                                         : static_cast<double>(metric_ranges(i, k));
+      if (range < minimum_range || maximum_range < range) {
+        // The sensor reports a distance of zero if there is no return
+        ranges[j] = 0;
+        intensities[j] = 0;
+        continue;
+      }
+      ranges[j] = static_cast<uint16_t>(
+          std::min<long>(65535, std::lround(range / parameters_.distance_resolution)));
+      intensities[j] = has_intensities ? scan_intensities(i, k) : 0;
+    }
+  }
+  has_scan_ = true;
+}
+
+void VelodynePacketBridge::updateBeamMap(const std::vector<double>& phis) {
+  if (phis == mapped_phis_) {
+    return;
+  }
+  mapped_phis_ = phis;
+  beam_map_.resize(parameters_.vertical_beams);
+  for (size_t i = 0; i < parameters_.vertical_beams; i++) {
+    const double angle = parameters_.vertical_angles[i];
+    int best = 0;
+    for (size_t j = 1; j < phis.size(); j++) {
+      if (std::abs(phis[j] - angle) < std::abs(phis[best] - angle)) {
+        best = j;
+      }
+    }
+    beam_map_[i] = best;
+  }
+}
+
+void VelodynePacketBridge::updateSliceMap(const std::vector<double>& thetas) {
+  if (thetas == mapped_thetas_) {
+    return;
+  }
+  mapped_thetas_ = thetas;
+
+  // Sort the slices by angle to look up the closest slice of every column
+  std::vector<std::pair<double, int>> sorted(thetas.size());
+  for (size_t i = 0; i < thetas.size(); i++) {
+    sorted[i] = {WrapTwoPi(thetas[i]), static_cast<int>(i)};
+  }
+  std::sort(sorted.begin(), sorted.end());
+  // Columns further away from any slice than the spacing of the slices are outside of the field
+  // of view of the simulated sensor
+  const double spacing = sorted.size() > 1
+                             ? (sorted.back().first - sorted.front().first) / (sorted.size() - 1)
+                             : kTwoPi;
+  const double tolerance = std::max(spacing, column_angle_);
+
+  slice_map_.resize(columns_per_revolution_);
+  for (size_t i = 0; i < columns_per_revolution_; i++) {
+    const double angle = WrapTwoPi(-static_cast<double>(i) * column_angle_);
+    const auto upper = std::lower_bound(sorted.begin(), sorted.end(),
+                                        std::make_pair(angle, std::numeric_limits<int>::min()));
+    // The closest slice is either the first slice after the angle or the one before it
+    const auto& after = upper == sorted.end() ? sorted.front() : *upper;
+    const auto& before = upper == sorted.begin() ? sorted.back() : *(upper - 1);
+    const double distance_after = WrapTwoPi(after.first - angle);
+    const double distance_before = WrapTwoPi(angle - before.first);
+    const bool use_after = distance_after < distance_before;
+    const double distance = use_after ? distance_after : distance_before;
+    slice_map_[i] = distance <= tolerance ? (use_after ? after.second : before.second) : -1;
+  }
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
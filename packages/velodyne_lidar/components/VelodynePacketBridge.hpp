@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "engine/alice/alice_codelet.hpp"
+#include "messages/range_scan.capnp.h"
+#include "packages/velodyne_lidar/components/velodyne_model_type.hpp"
+#include "packages/velodyne_lidar/gems/packet_encoder.hpp"
+#include "packages/velodyne_lidar/gems/packet_sender.hpp"
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+// Converts simulated range scans, for example from navsim, into Velodyne data packets and sends
+// them via UDP. The packets have the same layout as the packets of the sensor so that the real
+// driver, network path and timing are exercised in simulation. Packets are sent at the firing
+// rate of the sensor model using the most recent scan, independently of the simulation rate.
+class VelodynePacketBridge : public alice::Codelet {
+ public:
+  void start() override;
+  void tick() override;
+  void stop() override;
+
+  // Simulated range scans. Every beam of the sensor uses the simulated beam with the closest
+  // vertical angle and every column the simulated slice with the closest horizontal angle.
+  ISAAC_PROTO_RX(RangeScanProto, scan);
+
+  // The IP address to which packets are sent
+  ISAAC_PARAM(std::string, ip, "127.0.0.1");
+  // The port to which packets are sent
+  ISAAC_PARAM(int, port, 2368);
+  // The type of the simulated Lidar: VLP16, VLP32C or VLS128
+  ISAAC_PARAM(VelodyneModelType, type, VelodyneModelType::VLP16);
+  // Vertical angles of the beams in degrees ordered by laser ID. Overrides the angles of the
+  // sensor model and is required for the VLS128 whose angles are specific to every unit.
+  ISAAC_PARAM(std::vector<double>, vertical_angles);
+  // Rotation speed of the simulated sensor in revolutions per minute
+  ISAAC_PARAM(double, rpm, 600.0);
+  // Time in seconds between two batches of packets sent to the network
+  ISAAC_PARAM(double, send_period, 0.001);
+  // If the bridge falls behind by more than this time in seconds the missed packets are skipped
+  ISAAC_PARAM(double, max_lag, 0.1);
+
+ private:
+  // Converts the received scan into columns of the sensor model
+  void convertScan();
+  // Finds the simulated beam closest to every beam of the sensor
+  void updateBeamMap(const std::vector<double>& phis);
+  // Finds the simulated slice closest to every column of a revolution of the sensor
+  void updateSliceMap(const std::vector<double>& thetas);
+
+  PacketSender sender_;
+  std::unique_ptr<PacketEncoder> encoder_;
+  VelodyneLidarParameters parameters_;
+
+  // Number of columns in a full revolution and the angle between two columns
+  size_t columns_per_revolution_;
+  double column_angle_;
+  // Time between two columns in nanoseconds
+  double firing_cycle_ns_;
+
+  // Index of the simulated beam for every beam of the sensor
+  std::vector<int> beam_map_;
+  std::vector<double> mapped_phis_;
+  // Index of the simulated slice for every column of a revolution, or -1 if no slice is close
+  std::vector<int> slice_map_;
+  std::vector<double> mapped_thetas_;
+
+  // The most recent scan converted to one column per simulated slice in units of the sensor
+  std::vector<uint16_t> ranges_;
+  std::vector<uint8_t> intensities_;
+  // A column without any returns for angles not covered by the simulated scan
+  std::vector<uint16_t> empty_ranges_;
+  std::vector<uint8_t> empty_intensities_;
+  int64_t last_scan_acqtime_;
+  bool has_scan_;
+
+  // Time at which the first column was fired and the number of columns fired since then
+  int64_t start_time_;
+  uint64_t column_index_;
+  // Packets which are sent at the end of the tick
+  std::vector<uint8_t> outgoing_;
+  size_t outgoing_count_;
+};
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
+
+ISAAC_ALICE_REGISTER_CODELET(isaac::velodyne_lidar::VelodynePacketBridge);
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "VelodynePreviewCloud.hpp"
+
+#include <utility>
+
+#include "engine/core/logger.hpp"
+#include "engine/core/tensor/tensor.hpp"
+#include "messages/tensor.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+void VelodynePreviewCloud::start() {
+  tickOnMessage(rx_preview());
+}
+
+void VelodynePreviewCloud::tick() {
+  auto preview = rx_preview().getProto();
+  auto voxels = preview.getVoxels();
+  if (voxels.size() % 3 != 0) {
+    LOG_WARNING("Ignoring preview with %u voxel coordinates", voxels.size());
+    return;
+  }
+  const float resolution = preview.getResolution();
+  const size_t count = voxels.size() / 3;
+  Tensor2f positions(count, 3);
+  for (size_t i = 0; i < count; i++) {
+    for (size_t j = 0; j < 3; j++) {
+      positions(i, j) = voxels[3 * i + j] * resolution;
+    }
+  }
+  auto proto = tx_cloud().initProto();
+  ToProto(std::move(positions), proto.initPositions(), tx_cloud().buffers());
+  tx_cloud().publish(rx_preview().acqtime());
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
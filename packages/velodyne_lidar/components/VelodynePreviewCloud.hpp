@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include "engine/alice/alice_codelet.hpp"
+#include "messages/point_cloud.capnp.h"
+#include "packages/velodyne_lidar/messages/velodyne_lidar.capnp.h"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+// Turns the previews of VelodyneScanPreview back into point clouds with one point in the center
+// of every voxel. Runs on the remote side of the link, for example next to websight.
+class VelodynePreviewCloud : public alice::Codelet {
+ public:
+  void start() override;
+  void tick() override;
+
+  // Previews as published by VelodyneScanPreview
+  ISAAC_PROTO_RX(VelodyneScanPreviewProto, preview);
+  // The points of the preview
+  ISAAC_PROTO_TX(PointCloudProto, cloud);
+};
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
+
+ISAAC_ALICE_REGISTER_CODELET(isaac::velodyne_lidar::VelodynePreviewCloud);
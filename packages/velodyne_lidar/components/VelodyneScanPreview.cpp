@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "VelodyneScanPreview.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "engine/core/logger.hpp"
+#include "engine/core/tensor/tensor.hpp"
+#include "messages/tensor.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+// Bytes needed for a single point in a point cloud message, which drive the decimation, and for a
+// single voxel in the preview
+constexpr size_t kBytesPerPoint = 3 * sizeof(float);
+constexpr size_t kBytesPerVoxel = 3 * sizeof(int16_t);
+constexpr int64_t kMaximumCoordinate = std::numeric_limits<int16_t>::max();
+// Number of bits of every voxel coordinate in the voxel key
+constexpr int kVoxelBits = 21;
+constexpr int64_t kVoxelOffset = int64_t{1} << (kVoxelBits - 1);
+constexpr uint64_t kVoxelMask = (uint64_t{1} << kVoxelBits) - 1;
+
+// Combines the coordinates of a voxel into a single key
+uint64_t VoxelKey(int64_t x, int64_t y, int64_t z) {
+  return ((static_cast<uint64_t>(x + kVoxelOffset) & kVoxelMask) << (2 * kVoxelBits)) |
+         ((static_cast<uint64_t>(y + kVoxelOffset) & kVoxelMask) << kVoxelBits) |
+         (static_cast<uint64_t>(z + kVoxelOffset) & kVoxelMask);
+}
+}  // namespace
+
+void VelodyneScanPreview::start() {
+  budget_ = std::make_unique<PreviewBudget>(get_byte_budget(), get_burst(), get_max_decimation());
+  tickOnMessage(rx_scan());
+}
+
+void VelodyneScanPreview::tick() {
+  auto scan = rx_scan().getProto();
+  TensorConstView2ui16 ranges;
+  if (!FromProto(scan.getRanges(), rx_scan().buffers(), ranges)) {
+    LOG_WARNING("Ignoring scan with unsupported range element type");
+    return;
+  }
+  auto thetas = scan.getTheta();
+  auto phis = scan.getPhi();
+  const size_t slices = ranges.dimensions()[0];
+  const size_t beams = ranges.dimensions()[1];
+  if (thetas.size() != slices || phis.size() != beams) {
+    LOG_WARNING("Ignoring scan with inconsistent dimensions");
+    return;
+  }
+
+  // The size of the full scan as a point cloud drives the decimation
+  size_t full_points = 0;
+  for (size_t i = 0; i < slices; i++) {
+    for (size_t j = 0; j < beams; j++) {
+      if (ranges(i, j) != 0) full_points++;
+    }
+  }
+  const int64_t now = getTickTimestamp();
+  const size_t full_bytes = full_points * kBytesPerPoint;
+  const int decimation = budget_->decimation(full_bytes, now);
+
+  // Keep every n-th column and at most one point per voxel
+  const double range_scale = scan.getRangeDenormalizer() / 65535.0;
+  const double minimum_range = scan.getInvalidRangeThreshold();
+  const double resolution = get_quantization();
+  std::vector<double> cos_phis(beams), sin_phis(beams);
+  for (size_t j = 0; j < beams; j++) {
+    cos_phis[j] = std::cos(phis[j]);
+    sin_phis[j] = std::sin(phis[j]);
+  }
+  std::vector<int16_t> voxels;
+  voxels.reserve(3 * (full_points / decimation + 1));
+  voxels_.clear();
+  for (size_t i = 0; i < slices; i += decimation) {
+    const double cos_theta = std::cos(thetas[i]);
+    const double sin_theta = std::sin(thetas[i]);
+    for (size_t j = 0; j < beams; j++) {
+      const double range = ranges(i, j) * range_scale;
+      if (ranges(i, j) == 0 || range < minimum_range) continue;
+      const int64_t x = std::llround(range * cos_phis[j] * cos_theta / resolution);
+      const int64_t y = std::llround(range * cos_phis[j] * sin_theta / resolution);
+      const int64_t z = std::llround(range * sin_phis[j] / resolution);
+      if (std::max({std::abs(x), std::abs(y), std::abs(z)}) > kMaximumCoordinate) continue;
+      if (!voxels_.insert(VoxelKey(x, y, z)).second) continue;
+      voxels.push_back(static_cast<int16_t>(x));
+      voxels.push_back(static_cast<int16_t>(y));
+      voxels.push_back(static_cast<int16_t>(z));
+    }
+  }
+
+  const size_t count = voxels.size() / 3;
+  if (!budget_->consume(full_bytes, count * kBytesPerVoxel, now)) {
+    return;
+  }
+  auto proto = tx_preview().initProto();
+  auto voxels_proto = proto.initVoxels(voxels.size());
+  for (size_t i = 0; i < voxels.size(); i++) {
+    voxels_proto.set(i, voxels[i]);
+  }
+  proto.setResolution(static_cast<float>(resolution));
+  tx_preview().publish(rx_scan().acqtime());
+
+  show("decimation", decimation);
+  show("dropped", budget_->dropped());
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_set>
+
+#include "engine/alice/alice_codelet.hpp"
+#include "messages/range_scan.capnp.h"
+#include "packages/velodyne_lidar/gems/preview_budget.hpp"
+#include "packages/velodyne_lidar/messages/velodyne_lidar.capnp.h"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+// Publishes a cheap preview of the range scans of the driver for remote visualization. Columns
+// are decimated and points are quantized to a voxel grid with one point per voxel. The decimation
+// adapts so that the preview stays below a byte budget per second, thus the full rate data can be
+// kept local while the preview is streamed over a slow link. On the remote side
+// VelodynePreviewCloud turns the preview into a point cloud for websight.
+class VelodyneScanPreview : public alice::Codelet {
+ public:
+  void start() override;
+  void tick() override;
+
+  // Range scans as published by the driver
+  ISAAC_PROTO_RX(RangeScanProto, scan);
+  // The integer coordinates of the voxels of the decimated scan
+  ISAAC_PROTO_TX(VelodyneScanPreviewProto, preview);
+
+  // Maximum number of bytes per second published on `preview`
+  ISAAC_PARAM(double, byte_budget, 250000.0);
+  // Time in seconds for which unused budget is saved up for bursts
+  ISAAC_PARAM(double, burst, 0.5);
+  // Size of the voxels in meters to which points are quantized. Points whose voxel coordinates do
+  // not fit into 16 bits are dropped.
+  ISAAC_PARAM(double, quantization, 0.05);
+  // Upper bound for the number of columns which are merged into one
+  ISAAC_PARAM(int, max_decimation, 64);
+
+ private:
+  std::unique_ptr<PreviewBudget> budget_;
+  // Voxels which already contain a point of the current preview
+  std::unordered_set<uint64_t> voxels_;
+};
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
+
+ISAAC_ALICE_REGISTER_CODELET(isaac::velodyne_lidar::VelodyneScanPreview);
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "arena.hpp"
+
+#include <sys/mman.h>
+
+#include <cerrno>
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+constexpr size_t kPageSize = 4096;
+
+size_t RoundUp(size_t value, size_t multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+}  // namespace
+
+const char* HugePagesName(HugePages huge_pages) {
+  switch (huge_pages) {
+    case HugePages::kNone:
+      return "none";
+    case HugePages::kTransparent:
+      return "transparent";
+    case HugePages::kExplicit:
+      return "explicit";
+  }
+  return "invalid";
+}
+
+Arena::~Arena() {
+  close();
+}
+
+bool Arena::open(size_t size, HugePages huge_pages) {
+  close();
+  if (size == 0) {
+    errno = EINVAL;
+    return false;
+  }
+  // All pages are prefaulted such that no buffer waits for the kernel to provide a page later
+  void* data = MAP_FAILED;
+  if (huge_pages == HugePages::kExplicit) {
+    size_ = RoundUp(size, kHugePageSize);
+    data = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+    pages_ = HugePages::kExplicit;
+  }
+  if (data == MAP_FAILED && huge_pages != HugePages::kNone) {
+    // Transparent huge pages need a mapping which is aligned to the huge page size. Map more than
+    // needed and trim the unaligned ends.
+    size_ = RoundUp(size, kHugePageSize);
+    void* mapping = ::mmap(nullptr, size_ + kHugePageSize, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping != MAP_FAILED) {
+      uint8_t* begin = static_cast<uint8_t*>(mapping);
+      uint8_t* aligned = reinterpret_cast<uint8_t*>(
+          RoundUp(reinterpret_cast<uintptr_t>(begin), kHugePageSize));
+      uint8_t* end = begin + size_ + kHugePageSize;
+      if (aligned > begin) {
+        ::munmap(begin, aligned - begin);
+      }
+      if (end > aligned + size_) {
+        ::munmap(aligned + size_, end - aligned - size_);
+      }
+      if (::madvise(aligned, size_, MADV_HUGEPAGE) == 0) {
+        // Touching the pages after the advice lets the kernel fault in huge pages
+        for (size_t offset = 0; offset < size_; offset += kPageSize) {
+          aligned[offset] = 0;
+        }
+        data = aligned;
+        pages_ = HugePages::kTransparent;
+      } else {
+        ::munmap(aligned, size_);
+      }
+    }
+  }
+  if (data == MAP_FAILED) {
+    size_ = RoundUp(size, Arena::kDefaultAlignment);
+    data = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    pages_ = HugePages::kNone;
+  }
+  if (data == MAP_FAILED) {
+    size_ = 0;
+    return false;
+  }
+  data_ = static_cast<uint8_t*>(data);
+  used_ = 0;
+  return true;
+}
+
+void Arena::close() {
+  if (data_ != nullptr) {
+    ::munmap(data_, size_);
+    data_ = nullptr;
+  }
+  size_ = 0;
+  used_ = 0;
+  pages_ = HugePages::kNone;
+}
+
+void* Arena::allocate(size_t size, size_t alignment) {
+  const size_t offset = RoundUp(used_, alignment);
+  if (data_ == nullptr || offset > size_ || size > size_ - offset) {
+    return nullptr;
+  }
+  used_ = offset + size;
+  return data_ + offset;
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+namespace isaac {
+namespace velodyne_lidar {
+
+// Pages which back the memory of an arena
+enum class HugePages {
+  kNone,         // Regular pages
+  kTransparent,  // Transparent huge pages which the kernel assembles if it can
+  kExplicit,     // Huge pages from the pool reserved with vm.nr_hugepages
+};
+
+// Returns a human readable name of the page type
+const char* HugePagesName(HugePages huge_pages);
+
+// A single contiguous and prefaulted memory mapping from which all buffers of a sensor are carved.
+// Buffers live as long as the arena and are never freed individually. Keeping them together in
+// huge pages reduces the TLB misses of decoding, which otherwise grow with the number of sensors
+// and the size of their packet rings.
+class Arena {
+ public:
+  // Alignment of allocations unless requested otherwise. Avoids false sharing between buffers.
+  static constexpr size_t kDefaultAlignment = 64;
+
+  Arena() = default;
+  ~Arena();
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  // Number of bytes an allocation needs in the worst case including alignment
+  static constexpr size_t Footprint(size_t size, size_t alignment = kDefaultAlignment) {
+    return size + alignment - 1;
+  }
+
+  // Maps at least `size` bytes. Explicit huge pages fall back to transparent huge pages if the
+  // pool is exhausted, and transparent huge pages to regular pages if the kernel does not support
+  // them. Returns false on failure in which case errno is set.
+  bool open(size_t size, HugePages huge_pages);
+  // Unmaps the memory. All buffers of the arena become invalid.
+  void close();
+
+  // Returns `size` bytes with the given alignment, which needs to be a power of two, or nullptr
+  // if the arena is exhausted. The memory is zero initialized.
+  void* allocate(size_t size, size_t alignment = kDefaultAlignment);
+  // Returns an array of `count` value initialized objects, or nullptr if the arena is exhausted
+  template <typename T>
+  T* allocate(size_t count) {
+    static_assert(std::is_trivially_destructible<T>::value,
+                  "Objects in an arena are never destroyed");
+    void* memory = allocate(count * sizeof(T), alignof(T) > kDefaultAlignment ? alignof(T)
+                                                                              : kDefaultAlignment);
+    if (memory == nullptr) {
+      return nullptr;
+    }
+    T* objects = static_cast<T*>(memory);
+    for (size_t i = 0; i < count; i++) {
+      new (objects + i) T();
+    }
+    return objects;
+  }
+
+  // Number of bytes which are mapped
+  size_t size() const { return size_; }
+  // Number of bytes which are allocated
+  size_t used() const { return used_; }
+  // Pages which actually back the arena after falling back
+  HugePages pages() const { return pages_; }
+
+ private:
+  uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+  size_t used_ = 0;
+  HugePages pages_ = HugePages::kNone;
+};
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
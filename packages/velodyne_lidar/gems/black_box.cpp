@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "black_box.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "packages/velodyne_lidar/gems/pcap_writer.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+// Sequence number of a slot which is being overwritten
+constexpr uint64_t kWriting = std::numeric_limits<uint64_t>::max();
+
+// Number of words of a slot which holds a packet of the given size
+size_t SlotWords(size_t packet_size) {
+  return (packet_size + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+}
+}  // namespace
+
+BlackBox::~BlackBox() {
+  close();
+}
+
+size_t BlackBox::ArenaSize(size_t packet_size, size_t capacity) {
+  return Arena::Footprint(SlotWords(packet_size) * capacity * sizeof(std::atomic<uint64_t>)) +
+         Arena::Footprint(capacity * sizeof(std::atomic<uint64_t>)) +
+         Arena::Footprint(capacity * sizeof(std::atomic<int64_t>));
+}
+
+bool BlackBox::open(Arena& arena, size_t packet_size, size_t capacity) {
+  close();
+  if (packet_size == 0 || capacity == 0) {
+    errno = EINVAL;
+    return false;
+  }
+  slot_words_ = SlotWords(packet_size);
+  data_ = arena.allocate<std::atomic<uint64_t>>(slot_words_ * capacity);
+  sequences_ = arena.allocate<std::atomic<uint64_t>>(capacity);
+  timestamps_ = arena.allocate<std::atomic<int64_t>>(capacity);
+  if (data_ == nullptr || sequences_ == nullptr || timestamps_ == nullptr) {
+    data_ = nullptr;
+    errno = ENOMEM;
+    return false;
+  }
+  packet_size_ = packet_size;
+  capacity_ = capacity;
+  for (size_t i = 0; i < capacity; i++) {
+    sequences_[i].store(kWriting, std::memory_order_relaxed);
+  }
+  head_ = 0;
+  dumped_packets_ = 0;
+  dump_succeeded_ = true;
+  return true;
+}
+
+void BlackBox::close() {
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  data_ = nullptr;
+  sequences_ = nullptr;
+  timestamps_ = nullptr;
+  packet_size_ = 0;
+  slot_words_ = 0;
+  capacity_ = 0;
+}
+
+void BlackBox::record(const uint8_t* packet, int64_t timestamp) {
+  // The slot is marked while it is overwritten such that a concurrent dump can detect torn copies
+  const uint64_t sequence = head_.load(std::memory_order_relaxed);
+  const size_t slot = sequence % capacity_;
+  sequences_[slot].store(kWriting, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  // The packet is copied in words which a concurrent dump may read while they are overwritten
+  std::atomic<uint64_t>* words = data_ + slot * slot_words_;
+  const size_t full_words = packet_size_ / sizeof(uint64_t);
+  for (size_t i = 0; i < full_words; i++) {
+    uint64_t word;
+    std::memcpy(&word, packet + i * sizeof(uint64_t), sizeof(word));
+    words[i].store(word, std::memory_order_relaxed);
+  }
+  if (full_words < slot_words_) {
+    uint64_t word = 0;
+    std::memcpy(&word, packet + full_words * sizeof(uint64_t),
+                packet_size_ - full_words * sizeof(uint64_t));
+    words[full_words].store(word, std::memory_order_relaxed);
+  }
+  timestamps_[slot].store(timestamp, std::memory_order_relaxed);
+  sequences_[slot].store(sequence, std::memory_order_release);
+  head_.store(sequence + 1, std::memory_order_release);
+}
+
+size_t BlackBox::size() const {
+  return std::min<uint64_t>(head_.load(std::memory_order_acquire), capacity_);
+}
+
+bool BlackBox::dump(const std::string& filename, uint16_t port, uint32_t source_ip) {
+  if (data_ == nullptr || dumping_) {
+    return false;
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  const uint64_t last = head_.load(std::memory_order_acquire);
+  const uint64_t first = last > capacity_ ? last - capacity_ : 0;
+  dumping_ = true;
+  thread_ = std::thread([=] {
+    dump_succeeded_ = write(filename, first, last, port, source_ip);
+    dumping_ = false;
+  });
+  return true;
+}
+
+bool BlackBox::waitForDump() {
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  return dump_succeeded_;
+}
+
+bool BlackBox::write(const std::string& filename, uint64_t first, uint64_t last, uint16_t port,
+                     uint32_t source_ip) {
+  dumped_packets_ = 0;
+  PcapWriter writer;
+  if (!writer.open(filename)) {
+    return false;
+  }
+  std::vector<uint8_t> packet(slot_words_ * sizeof(uint64_t));
+  for (uint64_t sequence = first; sequence < last; sequence++) {
+    // Copy the packet and check that it was not overwritten in the meantime
+    const size_t slot = sequence % capacity_;
+    if (sequences_[slot].load(std::memory_order_acquire) != sequence) {
+      continue;
+    }
+    const std::atomic<uint64_t>* words = data_ + slot * slot_words_;
+    for (size_t i = 0; i < slot_words_; i++) {
+      const uint64_t word = words[i].load(std::memory_order_relaxed);
+      std::memcpy(packet.data() + i * sizeof(uint64_t), &word, sizeof(word));
+    }
+    const int64_t timestamp = timestamps_[slot].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequences_[slot].load(std::memory_order_relaxed) != sequence) {
+      continue;
+    }
+    if (!writer.write(packet.data(), packet_size_, timestamp, port, source_ip)) {
+      return false;
+    }
+    dumped_packets_++;
+  }
+  writer.close();
+  return true;
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
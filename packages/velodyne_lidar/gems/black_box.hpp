@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include "packages/velodyne_lidar/gems/arena.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+// Keeps the most recent raw packets in a ring of preallocated memory, like the flight recorder of
+// an aircraft, and writes them to a capture file on request. Recording a packet copies it into the
+// ring and never blocks or allocates. Dumps are written by a background thread while recording
+// continues. Packets which are overwritten while the dump is written are skipped.
+class BlackBox {
+ public:
+  BlackBox() = default;
+  ~BlackBox();
+
+  BlackBox(const BlackBox&) = delete;
+  BlackBox& operator=(const BlackBox&) = delete;
+
+  // Number of bytes of an arena which a black box with the given dimensions needs
+  static size_t ArenaSize(size_t packet_size, size_t capacity);
+
+  // Allocates room for `capacity` packets of `packet_size` bytes from the arena, which needs to
+  // outlive the black box. Returns false if the arena is too small or an argument is zero.
+  bool open(Arena& arena, size_t packet_size, size_t capacity);
+  // Waits for a running dump
+  void close();
+
+  // Copies a packet of `packetSize()` bytes with its receive time in nanoseconds into the ring
+  // overwriting the oldest packet
+  void record(const uint8_t* packet, int64_t timestamp);
+
+  // Starts writing the packets recorded so far to the given capture file, oldest first. Packets
+  // are written as datagrams from `source_ip` to `port`. Returns false if a dump is in progress.
+  bool dump(const std::string& filename, uint16_t port, uint32_t source_ip);
+  // True while a dump is written
+  bool dumping() const { return dumping_; }
+  // Waits until the current dump is written. Returns false if the last dump failed.
+  bool waitForDump();
+  // Number of packets which were written by the last dump
+  uint64_t dumpedPackets() const { return dumped_packets_; }
+
+  size_t packetSize() const { return packet_size_; }
+  // Maximum number of packets in the ring
+  size_t capacity() const { return capacity_; }
+  // Number of packets in the ring
+  size_t size() const;
+
+ private:
+  // Writes the packets [first, last) to the given file
+  bool write(const std::string& filename, uint64_t first, uint64_t last, uint16_t port,
+             uint32_t source_ip);
+
+  size_t packet_size_ = 0;
+  size_t capacity_ = 0;
+  // Packets are stored in atomic words since a dump reads slots which may be overwritten. Every
+  // slot is padded to `slot_words_` words.
+  std::atomic<uint64_t>* data_ = nullptr;
+  size_t slot_words_ = 0;
+  // Number of the packet stored in every slot, or kWriting while the slot is overwritten
+  std::atomic<uint64_t>* sequences_ = nullptr;
+  std::atomic<int64_t>* timestamps_ = nullptr;
+  // Number of packets recorded so far
+  std::atomic<uint64_t> head_{0};
+
+  std::thread thread_;
+  std::atomic<bool> dumping_{false};
+  bool dump_succeeded_ = true;
+  std::atomic<uint64_t> dumped_packets_{0};
+};
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
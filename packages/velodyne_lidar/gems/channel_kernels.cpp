@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "channel_kernels.hpp"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define VELODYNE_LIDAR_X86_KERNELS
+#endif
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define VELODYNE_LIDAR_NEON_KERNELS
+#endif
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+// Size of a channel in a data block in bytes
+constexpr size_t kChannelSize = sizeof(VelodyneRawChannel);
+
+void ScalarKernel(const VelodyneRawChannel* channels, size_t count, uint16_t min_range,
+                  uint16_t max_range, uint16_t* ranges, uint8_t* intensities) {
+  for (size_t i = 0; i < count; i++) {
+    const VelodyneRawChannel& channel = channels[i];
+    if (channel.distance < min_range || max_range < channel.distance) {
+      ranges[i] = 0;
+      intensities[i] = 0;
+    } else {
+      ranges[i] = channel.distance;
+      intensities[i] = channel.reflectivity;
+    }
+  }
+}
+
+bool AlwaysSupported() {
+  return true;
+}
+
+#ifdef VELODYNE_LIDAR_X86_KERNELS
+
+// Byte shuffles which gather the little endian distances and the reflectivities of 8 channels
+// (24 bytes) from two overlapping 16 byte loads at offset 0 and 8. The first load provides
+// channels 0 to 3 and the second load channels 4 to 7. A value of -1 clears the byte.
+#define VELODYNE_DISTANCES_LOW 0, 1, 3, 4, 6, 7, 9, 10, -1, -1, -1, -1, -1, -1, -1, -1
+#define VELODYNE_DISTANCES_HIGH -1, -1, -1, -1, -1, -1, -1, -1, 4, 5, 7, 8, 10, 11, 13, 14
+#define VELODYNE_REFLECTIVITIES_LOW 2, 5, 8, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+#define VELODYNE_REFLECTIVITIES_HIGH -1, -1, -1, -1, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1
+
+// Unpacks 8 channels given as the two overlapping loads described above. Returns the ranges and
+// the intensities in the lower 8 bytes.
+__attribute__((target("ssse3"))) inline void UnpackChannels(__m128i low, __m128i high,
+                                                            __m128i min_range, __m128i max_range,
+                                                            __m128i& ranges,
+                                                            __m128i& intensities) {
+  const __m128i distances = _mm_or_si128(
+      _mm_shuffle_epi8(low, _mm_setr_epi8(VELODYNE_DISTANCES_LOW)),
+      _mm_shuffle_epi8(high, _mm_setr_epi8(VELODYNE_DISTANCES_HIGH)));
+  const __m128i reflectivities = _mm_or_si128(
+      _mm_shuffle_epi8(low, _mm_setr_epi8(VELODYNE_REFLECTIVITIES_LOW)),
+      _mm_shuffle_epi8(high, _mm_setr_epi8(VELODYNE_REFLECTIVITIES_HIGH)));
+  // Unsigned comparisons with saturating subtraction: a <= b exactly if a - b saturates to zero
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i valid =
+      _mm_and_si128(_mm_cmpeq_epi16(_mm_subs_epu16(min_range, distances), zero),
+                    _mm_cmpeq_epi16(_mm_subs_epu16(distances, max_range), zero));
+  ranges = _mm_and_si128(distances, valid);
+  intensities = _mm_and_si128(reflectivities, _mm_packs_epi16(valid, valid));
+}
+
+__attribute__((target("ssse3"))) void SseKernel(const VelodyneRawChannel* channels, size_t count,
+                                                uint16_t min_range, uint16_t max_range,
+                                                uint16_t* ranges, uint8_t* intensities) {
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(channels);
+  const __m128i min_ranges = _mm_set1_epi16(static_cast<int16_t>(min_range));
+  const __m128i max_ranges = _mm_set1_epi16(static_cast<int16_t>(max_range));
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const uint8_t* source = data + i * kChannelSize;
+    __m128i block_ranges, block_intensities;
+    UnpackChannels(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source)),
+                   _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 8)), min_ranges,
+                   max_ranges, block_ranges, block_intensities);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(ranges + i), block_ranges);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(intensities + i), block_intensities);
+  }
+  ScalarKernel(channels + i, count - i, min_range, max_range, ranges + i, intensities + i);
+}
+
+bool IsSseSupported() {
+  return __builtin_cpu_supports("ssse3");
+}
+
+// Loads 16 bytes from each of the given addresses into the lower and the upper lane
+__attribute__((target("avx2"))) inline __m256i Load2x128(const uint8_t* lower,
+                                                        const uint8_t* upper) {
+  return _mm256_inserti128_si256(
+      _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lower))),
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(upper)), 1);
+}
+
+// The same as the SSE kernel but for 16 channels at once. Shuffles operate on the two 128 bit
+// lanes independently, thus every lane processes 8 channels.
+__attribute__((target("avx2"))) void Avx2Kernel(const VelodyneRawChannel* channels, size_t count,
+                                                uint16_t min_range, uint16_t max_range,
+                                                uint16_t* ranges, uint8_t* intensities) {
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(channels);
+  const __m256i min_ranges = _mm256_set1_epi16(static_cast<int16_t>(min_range));
+  const __m256i max_ranges = _mm256_set1_epi16(static_cast<int16_t>(max_range));
+  const __m256i distances_low = _mm256_setr_epi8(VELODYNE_DISTANCES_LOW, VELODYNE_DISTANCES_LOW);
+  const __m256i distances_high =
+      _mm256_setr_epi8(VELODYNE_DISTANCES_HIGH, VELODYNE_DISTANCES_HIGH);
+  const __m256i reflectivities_low =
+      _mm256_setr_epi8(VELODYNE_REFLECTIVITIES_LOW, VELODYNE_REFLECTIVITIES_LOW);
+  const __m256i reflectivities_high =
+      _mm256_setr_epi8(VELODYNE_REFLECTIVITIES_HIGH, VELODYNE_REFLECTIVITIES_HIGH);
+  const __m256i zero = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    const uint8_t* source = data + i * kChannelSize;
+    // Channels 0 to 7 go into the lower lane and channels 8 to 15 into the upper lane
+    const __m256i low = Load2x128(source, source + 24);
+    const __m256i high = Load2x128(source + 8, source + 32);
+    const __m256i distances = _mm256_or_si256(_mm256_shuffle_epi8(low, distances_low),
+                                              _mm256_shuffle_epi8(high, distances_high));
+    const __m256i reflectivities =
+        _mm256_or_si256(_mm256_shuffle_epi8(low, reflectivities_low),
+                        _mm256_shuffle_epi8(high, reflectivities_high));
+    const __m256i valid =
+        _mm256_and_si256(_mm256_cmpeq_epi16(_mm256_subs_epu16(min_ranges, distances), zero),
+                         _mm256_cmpeq_epi16(_mm256_subs_epu16(distances, max_ranges), zero));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(ranges + i),
+                        _mm256_and_si256(distances, valid));
+    // The intensities of each lane are in its lower 8 bytes
+    const __m256i lane_intensities =
+        _mm256_and_si256(reflectivities, _mm256_packs_epi16(valid, valid));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(intensities + i),
+                     _mm256_castsi256_si128(_mm256_permute4x64_epi64(lane_intensities, 0x08)));
+  }
+  // Mixing AVX with legacy SSE instructions is expensive unless the upper lanes are cleared
+  _mm256_zeroupper();
+  SseKernel(channels + i, count - i, min_range, max_range, ranges + i, intensities + i);
+}
+
+bool IsAvx2Supported() {
+  return __builtin_cpu_supports("avx2");
+}
+
+#undef VELODYNE_DISTANCES_LOW
+#undef VELODYNE_DISTANCES_HIGH
+#undef VELODYNE_REFLECTIVITIES_LOW
+#undef VELODYNE_REFLECTIVITIES_HIGH
+
+#endif  // VELODYNE_LIDAR_X86_KERNELS
+
+#ifdef VELODYNE_LIDAR_NEON_KERNELS
+
+// Structured loads split 16 channels into their three bytes
+void NeonKernel(const VelodyneRawChannel* channels, size_t count, uint16_t min_range,
+                uint16_t max_range, uint16_t* ranges, uint8_t* intensities) {
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(channels);
+  const uint16x8_t min_ranges = vdupq_n_u16(min_range);
+  const uint16x8_t max_ranges = vdupq_n_u16(max_range);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    const uint8x16x3_t bytes = vld3q_u8(data + i * kChannelSize);
+    const uint16x8_t distances_low = vorrq_u16(
+        vmovl_u8(vget_low_u8(bytes.val[0])), vshlq_n_u16(vmovl_u8(vget_low_u8(bytes.val[1])), 8));
+    const uint16x8_t distances_high =
+        vorrq_u16(vmovl_u8(vget_high_u8(bytes.val[0])),
+                  vshlq_n_u16(vmovl_u8(vget_high_u8(bytes.val[1])), 8));
+    const uint16x8_t valid_low = vandq_u16(vcgeq_u16(distances_low, min_ranges),
+                                           vcleq_u16(distances_low, max_ranges));
+    const uint16x8_t valid_high = vandq_u16(vcgeq_u16(distances_high, min_ranges),
+                                            vcleq_u16(distances_high, max_ranges));
+    vst1q_u16(ranges + i, vandq_u16(distances_low, valid_low));
+    vst1q_u16(ranges + i + 8, vandq_u16(distances_high, valid_high));
+    const uint8x16_t valid = vcombine_u8(vmovn_u16(valid_low), vmovn_u16(valid_high));
+    vst1q_u8(intensities + i, vandq_u8(bytes.val[2], valid));
+  }
+  ScalarKernel(channels + i, count - i, min_range, max_range, ranges + i, intensities + i);
+}
+
+#endif  // VELODYNE_LIDAR_NEON_KERNELS
+
+}  // namespace
+
+const std::vector<ChannelKernelInfo>& ChannelKernels() {
+  static const std::vector<ChannelKernelInfo> kernels = {
+      {"scalar", &ScalarKernel, &AlwaysSupported},
+#ifdef VELODYNE_LIDAR_X86_KERNELS
+      {"sse", &SseKernel, &IsSseSupported},
+      {"avx2", &Avx2Kernel, &IsAvx2Supported},
+#endif
+#ifdef VELODYNE_LIDAR_NEON_KERNELS
+      {"neon", &NeonKernel, &AlwaysSupported},
+#endif
+  };
+  return kernels;
+}
+
+const ChannelKernelInfo* FindChannelKernel(const std::string& name) {
+  const std::vector<ChannelKernelInfo>& kernels = ChannelKernels();
+  for (auto it = kernels.rbegin(); it != kernels.rend(); ++it) {
+    if ((name.empty() || name == it->name) && it->is_supported()) {
+      return &*it;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
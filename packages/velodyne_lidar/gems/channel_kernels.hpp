@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+// Unpacks `count` consecutive channels of a data block into ranges and intensities. Distances
+// outside of [min_range, max_range] are written as zero together with a zero intensity. This is
+// the innermost loop of the decoder.
+using ChannelKernel = void (*)(const VelodyneRawChannel* channels, size_t count,
+                               uint16_t min_range, uint16_t max_range, uint16_t* ranges,
+                               uint8_t* intensities);
+
+// An implementation of the channel kernel for a specific instruction set. All implementations
+// produce bit-exact identical results.
+struct ChannelKernelInfo {
+  // Name used to select the kernel, for example "scalar" or "avx2"
+  const char* name;
+  ChannelKernel function;
+  // Returns true if the CPU executing the program supports the instructions of the kernel
+  bool (*is_supported)();
+};
+
+// All kernels compiled into this build ordered from the slowest to the fastest. Kernels which the
+// CPU does not support are included.
+const std::vector<ChannelKernelInfo>& ChannelKernels();
+
+// Returns the kernel with the given name, or the fastest supported kernel if the name is empty.
+// Returns nullptr if there is no kernel with that name or if the CPU does not support it.
+const ChannelKernelInfo* FindChannelKernel(const std::string& name);
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
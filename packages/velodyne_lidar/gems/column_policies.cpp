@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "column_policies.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "engine/core/assert.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+constexpr double kTwoPi = 2.0 * 3.14159265358979323846;
+
+// Normalizes an angle to [0, 2 pi[
+double NormalizeAngle(double angle) {
+  angle = std::fmod(angle, kTwoPi);
+  return angle < 0.0 ? angle + kTwoPi : angle;
+}
+}  // namespace
+
+AzimuthMask::AzimuthMask(size_t beams, size_t bins)
+    : beams_(beams), bins_(std::max<size_t>(1, bins)), keep_(beams_ * bins_, 0xffff) {}
+
+void AzimuthMask::mask(size_t beam, double start, double end) {
+  ASSERT(beam < beams_, "Laser out of range: %zu >= %zu", beam, beams_);
+  const double width = kTwoPi / bins_;
+  // Sectors whose center is within the masked range
+  const double first = NormalizeAngle(start);
+  const double length = end - start >= kTwoPi ? kTwoPi : NormalizeAngle(end - start);
+  for (size_t i = 0; i < bins_; i++) {
+    if (NormalizeAngle((i + 0.5) * width - first) < length) {
+      keep_[i * beams_ + beam] = 0;
+    }
+  }
+}
+
+void AzimuthMask::mask(double start, double end) {
+  for (size_t i = 0; i < beams_; i++) {
+    mask(i, start, end);
+  }
+}
+
+size_t AzimuthMask::bin(double theta) const {
+  const size_t index = static_cast<size_t>(NormalizeAngle(theta) * (bins_ / kTwoPi));
+  return index < bins_ ? index : bins_ - 1;
+}
+
+bool ParseAzimuthMask(const Json& json, AzimuthMask& mask) {
+  if (!json.is_array()) {
+    return false;
+  }
+  for (const Json& sector : json) {
+    if (!sector.is_object()) return false;
+    const auto angles = sector.find("angles");
+    if (angles == sector.end() || !angles->is_array() || angles->size() != 2 ||
+        !(*angles)[0].is_number() || !(*angles)[1].is_number()) {
+      return false;
+    }
+    const double start = (*angles)[0].get<double>();
+    const double end = (*angles)[1].get<double>();
+    const auto lasers = sector.find("lasers");
+    if (lasers == sector.end()) {
+      mask.mask(start, end);
+      continue;
+    }
+    if (!lasers->is_array()) return false;
+    for (const Json& laser : *lasers) {
+      if (!laser.is_number_unsigned() || laser.get<size_t>() >= mask.beams()) return false;
+    }
+    for (const Json& laser : *lasers) {
+      mask.mask(laser.get<size_t>(), start, end);
+    }
+  }
+  return true;
+}
+
+RangeHistogram::RangeHistogram(size_t beams, uint16_t bin_size, size_t bins)
+    : beams_(beams),
+      bin_size_(std::max<uint16_t>(1, bin_size)),
+      bins_(std::max<size_t>(1, bins)),
+      counts_(beams_ * bins_, 0) {}
+
+void RangeHistogram::reset() {
+  std::fill(counts_.begin(), counts_.end(), 0);
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+#include "engine/gems/serialization/json.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+// Column policies which can be passed to `Decoder::feed` and `Decoder::finish`. They run inside
+// the inner loop of the decoder, right after the channels of a firing were unpacked, thus custom
+// processing does not need another pass over the published data. Columns which do not fit into
+// the output buffers are dropped before they reach the policies. The driver applies an
+// `AzimuthMask` configured with its `masked_sectors` parameter.
+
+// Masks out rays by horizontal angle and laser, for example the parts of the vehicle which are
+// seen by the sensor at a specific site. Masked rays are decoded as invalid with zero range and
+// intensity.
+class AzimuthMask {
+ public:
+  // The full turn is split into `bins` sectors of equal size
+  AzimuthMask(size_t beams, size_t bins);
+
+  // Masks the given laser between the horizontal angles `start` and `end` in radians, in the
+  // direction of increasing angles. Angles are in the convention of the decoded thetas. Sectors
+  // are masked if their center is within the range, a range of a full turn masks all sectors.
+  void mask(size_t beam, double start, double end);
+  // Masks all lasers between the given angles
+  void mask(double start, double end);
+  // Number of rays which were masked
+  uint64_t maskedRays() const { return masked_rays_; }
+  size_t beams() const { return beams_; }
+
+  void operator()(uint16_t* ranges, uint8_t* intensities, size_t /*beams*/, double theta) {
+    const uint16_t* keep = keep_.data() + bin(theta) * beams_;
+    size_t masked = 0;
+    for (size_t i = 0; i < beams_; i++) {
+      masked += ranges[i] != 0 && keep[i] == 0;
+      ranges[i] &= keep[i];
+      intensities[i] &= static_cast<uint8_t>(keep[i]);
+    }
+    masked_rays_ += masked;
+  }
+
+ private:
+  // Sector which contains the given angle
+  size_t bin(double theta) const;
+
+  size_t beams_;
+  size_t bins_;
+  // All ones for rays which are kept and zero for rays which are masked, one row per sector
+  std::vector<uint16_t> keep_;
+  uint64_t masked_rays_ = 0;
+};
+
+// Adds the sectors of a JSON array like [{"angles": [-0.5, 0.5]}, {"angles": [2.8, 3.4],
+// "lasers": [0, 1, 2]}] to the mask. Angles are in radians like for `AzimuthMask::mask`. Without
+// a list of lasers all lasers are masked. Returns false if the JSON does not describe valid
+// sectors.
+bool ParseAzimuthMask(const Json& json, AzimuthMask& mask);
+
+// Counts the valid returns of every laser in bins of equal range, for example to notice a laser
+// whose returns are cut short by dirt on the window
+class RangeHistogram {
+ public:
+  // Ranges are counted in `bins` bins of `bin_size` units of the distance resolution each. Larger
+  // ranges are counted in the last bin.
+  RangeHistogram(size_t beams, uint16_t bin_size, size_t bins);
+
+  // Number of returns of the given laser in the given bin
+  uint64_t count(size_t beam, size_t bin) const { return counts_[beam * bins_ + bin]; }
+  size_t bins() const { return bins_; }
+  // Sets all counts to zero
+  void reset();
+
+  void operator()(uint16_t* ranges, uint8_t* /*intensities*/, size_t /*beams*/,
+                  double /*theta*/) {
+    for (size_t i = 0; i < beams_; i++) {
+      if (ranges[i] == 0) continue;
+      const size_t bin = ranges[i] / bin_size_;
+      counts_[i * bins_ + (bin < bins_ ? bin : bins_ - 1)]++;
+    }
+  }
+
+ private:
+  size_t beams_;
+  uint16_t bin_size_;
+  size_t bins_;
+  std::vector<uint64_t> counts_;
+};
+
+// Applies several policies in the given order to every column. The policies are referenced and
+// need to outlive the chain.
+template <typename... Policies>
+class PolicyChain {
+ public:
+  explicit PolicyChain(Policies&... policies) : policies_(policies...) {}
+
+  void operator()(uint16_t* ranges, uint8_t* intensities, size_t beams, double theta) {
+    std::apply([&](auto&... policy) { (policy(ranges, intensities, beams, theta), ...); },
+               policies_);
+  }
+
+ private:
+  std::tuple<Policies&...> policies_;
+};
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
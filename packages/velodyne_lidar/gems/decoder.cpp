@@ -0,0 +1,341 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "decoder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "engine/core/assert.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+// A packet is considered lost if the azimuth advances by more than this factor times the usual
+// advance between two packets
+constexpr double kLostPacketThreshold = 1.5;
+// Number of rings whose statistics are accumulated together. All sensor models have a multiple of
+// this number of beams.
+constexpr size_t kRingGroupSize = 16;
+}  // namespace
+
+size_t FiringsPerBlock(const VelodyneLidarParameters& parameters) {
+  const size_t beams = std::max<uint32_t>(1, parameters.vertical_beams);
+  return std::max<size_t>(1, parameters.channels_per_block / beams);
+}
+
+size_t BlocksPerColumn(const VelodyneLidarParameters& parameters) {
+  const size_t channels = std::max<uint32_t>(1, parameters.channels_per_block);
+  return std::max<size_t>(1, parameters.vertical_beams / channels);
+}
+
+size_t ColumnsPerPacket(const VelodyneLidarParameters& parameters) {
+  return parameters.blocks_per_packet / BlocksPerColumn(parameters) * FiringsPerBlock(parameters);
+}
+
+void FillMissingColumns(size_t valid, size_t total, size_t beams, uint16_t* ranges,
+                        uint8_t* intensities, double* thetas) {
+  if (valid >= total) {
+    return;
+  }
+  std::fill(ranges + valid * beams, ranges + total * beams, 0);
+  std::fill(intensities + valid * beams, intensities + total * beams, 0);
+  for (size_t i = valid; i < total; i++) {
+    thetas[i] = i >= 2 ? 2.0 * thetas[i - 1] - thetas[i - 2] : 0.0;
+  }
+}
+
+void DecodePackets(const VelodyneLidarParameters& parameters, const uint8_t* packets,
+                   size_t count, const uint8_t* next_packet, const ColumnBuffers& buffers,
+                   size_t threads, const std::string& kernel) {
+  const size_t packet_size = parameters.packet_sans_header_size;
+  const size_t columns_per_packet = ColumnsPerPacket(parameters);
+  const size_t beams = parameters.vertical_beams;
+  ASSERT(buffers.capacity >= count * columns_per_packet, "Buffers are too small: %zu < %zu",
+         buffers.capacity, count * columns_per_packet);
+  // Decodes the packets [first, last). The following packet only provides its azimuth.
+  auto decode_range = [&](size_t first, size_t last) {
+    DecoderOptions options;
+    options.kernel = kernel;
+    Decoder decoder(parameters, options);
+    const size_t offset = first * columns_per_packet;
+    decoder.setOutput({buffers.ranges + offset * beams, buffers.intensities + offset * beams,
+                       buffers.thetas + offset, (last - first) * columns_per_packet});
+    for (size_t i = first; i < last; i++) {
+      decoder.feed(packets + i * packet_size, packet_size, 0);
+    }
+    const uint8_t* following = last < count ? packets + last * packet_size : next_packet;
+    if (following != nullptr) {
+      decoder.feed(following, packet_size, 0);
+      decoder.flush();
+    } else {
+      decoder.finish();
+    }
+  };
+  threads = std::max<size_t>(1, std::min(threads, count));
+  if (threads == 1) {
+    decode_range(0, count);
+    return;
+  }
+  std::vector<std::thread> workers;
+  workers.reserve(threads - 1);
+  for (size_t t = 1; t < threads; t++) {
+    workers.emplace_back(decode_range, t * count / threads, (t + 1) * count / threads);
+  }
+  decode_range(0, count / threads);
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+}
+
+Decoder::Decoder(const VelodyneLidarParameters& parameters, const DecoderOptions& options)
+    : parameters_(parameters), options_(options) {
+  kernel_ = FindChannelKernel(options_.kernel);
+  ASSERT(kernel_ != nullptr, "Channel kernel '%s' is not available", options_.kernel.c_str());
+  firings_per_block_ = FiringsPerBlock(parameters_);
+  blocks_per_column_ = BlocksPerColumn(parameters_);
+  columns_per_packet_ = ColumnsPerPacket(parameters_);
+  min_range_ = static_cast<uint16_t>(parameters_.minimum_range / parameters_.distance_resolution);
+  max_range_ = static_cast<uint16_t>(parameters_.maximum_range / parameters_.distance_resolution);
+  held_packet_.resize(parameters_.packet_sans_header_size);
+  reset();
+}
+
+void Decoder::setOutput(const ColumnBuffers& buffers) {
+  output_ = buffers;
+}
+
+void Decoder::setCallback(Callback callback) {
+  callback_ = std::move(callback);
+}
+
+bool Decoder::setKernel(const std::string& name) {
+  const ChannelKernelInfo* kernel = FindChannelKernel(name);
+  if (kernel == nullptr) {
+    return false;
+  }
+  kernel_ = kernel;
+  options_.kernel = name;
+  return true;
+}
+
+bool Decoder::feed(const uint8_t* packet, size_t size, int64_t timestamp) {
+  NoColumnPolicy policy;
+  return feed(packet, size, timestamp, policy);
+}
+
+void Decoder::flush() {
+  if (size_ > 0) {
+    emit(false);
+  }
+}
+
+void Decoder::finish() {
+  NoColumnPolicy policy;
+  finish(policy);
+}
+
+void Decoder::reset() {
+  has_held_packet_ = false;
+  held_timestamp_ = -1;
+  size_ = 0;
+  first_column_ = 0;
+  batch_packets_ = 0;
+  batch_first_timestamp_ = -1;
+  batch_last_timestamp_ = -1;
+  has_previous_theta_ = false;
+  previous_theta_ = 0.0;
+  counted_packet_ = false;
+  decoded_packets_ = 0;
+  sample_rings_ = false;
+  ring_first_ = 0;
+  statistics_ = DecoderStatistics();
+  ring_statistics_ = RingStatistics();
+  if (options_.ring_statistics_stride > 0) {
+    ring_statistics_.returns.resize(parameters_.vertical_beams, 0);
+    ring_statistics_.range_sums.resize(parameters_.vertical_beams, 0);
+    ring_statistics_.intensity_sums.resize(parameters_.vertical_beams, 0);
+  }
+}
+
+int64_t Decoder::pendingTimestamp() const {
+  if (size_ > 0) {
+    return batch_first_timestamp_;
+  }
+  return has_held_packet_ ? held_timestamp_ : -1;
+}
+
+void Decoder::countLostPackets(double next_azimuth) {
+  const size_t groups = parameters_.blocks_per_packet / blocks_per_column_;
+  if (groups < 2) {
+    return;
+  }
+  // The azimuth advances by about the same angle with every packet
+  const size_t group_size = blocks_per_column_ * parameters_.block_size;
+  const double first = BlockAzimuth(held_packet_.data());
+  const double last = BlockAzimuth(held_packet_.data() + (groups - 1) * group_size);
+  const double expected = std::abs(DeltaAzimuth(last, first)) / (groups - 1) * groups;
+  const double advance = std::abs(DeltaAzimuth(next_azimuth, first));
+  if (expected > 0.0 && advance > kLostPacketThreshold * expected) {
+    statistics_.lost_packets += std::lround(advance / expected) - 1;
+  }
+}
+
+bool Decoder::acceptPacket(size_t size) {
+  if (size != parameters_.packet_sans_header_size) {
+    statistics_.rejected_packets++;
+    return false;
+  }
+  statistics_.packets++;
+  return true;
+}
+
+void Decoder::holdPacket(const uint8_t* packet, size_t size, int64_t timestamp) {
+  std::memcpy(held_packet_.data(), packet, size);
+  held_timestamp_ = timestamp;
+  has_held_packet_ = true;
+}
+
+double Decoder::extrapolatedAzimuth() const {
+  // Extrapolate the azimuth of the next block from the last two columns of the packet
+  const size_t groups = parameters_.blocks_per_packet / blocks_per_column_;
+  const size_t group_size = blocks_per_column_ * parameters_.block_size;
+  double next_azimuth = BlockAzimuth(held_packet_.data() + (groups - 1) * group_size);
+  if (groups >= 2) {
+    const double previous = BlockAzimuth(held_packet_.data() + (groups - 2) * group_size);
+    next_azimuth += DeltaAzimuth(next_azimuth, previous);
+  }
+  return next_azimuth;
+}
+
+size_t Decoder::beginHeldPacket() {
+  has_held_packet_ = false;
+  counted_packet_ = false;
+  // Columns of sampled packets are added to the ring statistics before they are emitted
+  const size_t stride = options_.ring_statistics_stride;
+  sample_rings_ = stride > 0 && decoded_packets_ % stride == 0;
+  decoded_packets_++;
+  ring_first_ = size_;
+  return parameters_.blocks_per_packet / blocks_per_column_;
+}
+
+void Decoder::startRevolution() {
+  statistics_.revolutions++;
+  if (options_.split_at_revolution && size_ > 0) {
+    endBatch(true);
+  }
+}
+
+void Decoder::countPacket() {
+  if (batch_packets_ == 0) {
+    batch_first_timestamp_ = held_timestamp_;
+  }
+  batch_last_timestamp_ = held_timestamp_;
+  batch_packets_++;
+  counted_packet_ = true;
+}
+
+void Decoder::endBatch(bool end_of_revolution) {
+  if (sample_rings_) {
+    accumulateRings(ring_first_, size_);
+    ring_first_ = 0;
+  }
+  emit(end_of_revolution);
+  counted_packet_ = false;
+}
+
+void Decoder::accumulateRings(size_t first, size_t last) {
+  if (last <= first) {
+    return;
+  }
+  // The columns are at most one packet, thus the sums fit into 32 bits. Rings are processed in
+  // groups of a fixed size such that the sums of a group stay in vector registers.
+  const size_t beams = parameters_.vertical_beams;
+  const size_t columns = last - first;
+  const uint16_t* ranges = output_.ranges + first * beams;
+  const uint8_t* intensities = output_.intensities + first * beams;
+  for (size_t k = 0; k < beams; k += kRingGroupSize) {
+    const size_t group_size = std::min(kRingGroupSize, beams - k);
+    uint32_t returns[kRingGroupSize] = {};
+    uint32_t range_sums[kRingGroupSize] = {};
+    uint32_t intensity_sums[kRingGroupSize] = {};
+    for (size_t c = 0; c < columns; c++) {
+      const uint16_t* column_ranges = ranges + c * beams + k;
+      const uint8_t* column_intensities = intensities + c * beams + k;
+      if (group_size == kRingGroupSize) {
+        for (size_t j = 0; j < kRingGroupSize; j++) {
+          returns[j] += column_ranges[j] != 0;
+          range_sums[j] += column_ranges[j];
+          intensity_sums[j] += column_intensities[j];
+        }
+      } else {
+        for (size_t j = 0; j < group_size; j++) {
+          returns[j] += column_ranges[j] != 0;
+          range_sums[j] += column_ranges[j];
+          intensity_sums[j] += column_intensities[j];
+        }
+      }
+    }
+    for (size_t j = 0; j < group_size; j++) {
+      ring_statistics_.returns[k + j] += returns[j];
+      ring_statistics_.range_sums[k + j] += range_sums[j];
+      ring_statistics_.intensity_sums[k + j] += intensity_sums[j];
+    }
+  }
+  ring_statistics_.columns += columns;
+}
+
+void Decoder::emit(bool end_of_revolution) {
+  ColumnBatch batch;
+  batch.ranges = output_.ranges;
+  batch.intensities = output_.intensities;
+  batch.thetas = output_.thetas;
+  batch.size = size_;
+  batch.first_column = first_column_;
+  batch.packets = batch_packets_;
+  batch.first_timestamp = batch_first_timestamp_;
+  batch.last_timestamp = batch_last_timestamp_;
+  batch.end_of_revolution = end_of_revolution;
+
+  // Reset the batch before calling the callback so that it can install new buffers
+  first_column_ += size_;
+  size_ = 0;
+  batch_packets_ = 0;
+  batch_first_timestamp_ = -1;
+  batch_last_timestamp_ = -1;
+  if (callback_) {
+    callback_(batch);
+  }
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,368 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "packages/velodyne_lidar/gems/channel_kernels.hpp"
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+// Memory owned by the caller into which the decoder writes decoded columns. A column holds one
+// value per vertical beam and columns are stored one after another.
+struct ColumnBuffers {
+  // Ranges in multiples of the distance resolution of the sensor. Needs room for
+  // `capacity * vertical_beams` values.
+  uint16_t* ranges = nullptr;
+  // Intensities with the same layout as `ranges`
+  uint8_t* intensities = nullptr;
+  // Horizontal angle of every column in radians. Needs room for `capacity` values.
+  double* thetas = nullptr;
+  // Maximum number of columns which fit into the buffers
+  size_t capacity = 0;
+};
+
+// Consecutive columns which were decoded into the output buffers
+struct ColumnBatch {
+  const uint16_t* ranges;
+  const uint8_t* intensities;
+  const double* thetas;
+  // Number of columns in the batch
+  size_t size;
+  // Index of the first column of the batch counted since the decoder was created or reset
+  uint64_t first_column;
+  // Number of packets which contributed columns to the batch
+  uint32_t packets;
+  // Kernel receive timestamps of the first and the last packet which contributed to the batch
+  int64_t first_timestamp;
+  int64_t last_timestamp;
+  // True if the batch ends because the sensor completed a revolution
+  bool end_of_revolution;
+};
+
+// Controls when the decoder emits batches
+struct DecoderOptions {
+  // A batch is emitted once it holds this many columns. If zero batches are only limited by the
+  // capacity of the output buffers.
+  size_t batch_size = 0;
+  // If enabled a batch is also emitted whenever the sensor completes a revolution
+  bool split_at_revolution = false;
+  // Name of the channel kernel which unpacks data blocks, see `ChannelKernels`. The fastest kernel
+  // supported by the CPU is used if empty.
+  std::string kernel;
+  // If positive every n-th packet contributes to the `RingStatistics`. Collecting them for every
+  // packet more than doubles the decoding time.
+  size_t ring_statistics_stride = 0;
+};
+
+// Counters since the decoder was created or reset
+struct DecoderStatistics {
+  uint64_t packets = 0;           // Number of packets which were accepted
+  uint64_t rejected_packets = 0;  // Number of packets with an unexpected size
+  uint64_t invalid_blocks = 0;    // Number of data blocks with an unexpected block flag
+  uint64_t columns = 0;           // Number of columns which were decoded
+  uint64_t dropped_columns = 0;   // Number of columns dropped because no output buffer was set
+  uint64_t revolutions = 0;       // Number of completed revolutions
+  uint64_t lost_packets = 0;      // Number of packets missing judging by the azimuth
+};
+
+// Sums per ring, that is per vertical beam, over the sampled packets since the decoder was created
+// or reset. Every vector has one entry per ring ordered by laser ID.
+struct RingStatistics {
+  uint64_t columns = 0;                  // Number of columns which were sampled
+  std::vector<uint64_t> returns;         // Number of valid ranges
+  std::vector<uint64_t> range_sums;      // Sum of ranges in multiples of the distance resolution
+  std::vector<uint64_t> intensity_sums;  // Sum of intensities
+};
+
+// Number of times all vertical beams fire within a single data block
+size_t FiringsPerBlock(const VelodyneLidarParameters& parameters);
+// Number of data blocks which together hold a single column. Sensors with more beams than
+// channels per block spread a column over one block per bank of lasers.
+size_t BlocksPerColumn(const VelodyneLidarParameters& parameters);
+// Number of columns in a single data packet of the given sensor model
+size_t ColumnsPerPacket(const VelodyneLidarParameters& parameters);
+
+// True if a column at the horizontal angle `theta` starts a new revolution after a column at
+// `previous_theta`. The angle jumps by a full turn when the sensor starts a new revolution.
+inline bool StartsRevolution(double previous_theta, double theta) {
+  return theta - previous_theta > 3.14159265358979323846;
+}
+
+// Completes a scan with `total` columns of which only the first `valid` ones were decoded. The
+// missing columns get zero ranges and intensities and angles extrapolated from the columns before.
+void FillMissingColumns(size_t valid, size_t total, size_t beams, uint16_t* ranges,
+                        uint8_t* intensities, double* thetas);
+
+// Decodes `count` packets which are stored one after another into consecutive columns of
+// `buffers`, which needs room for `count * ColumnsPerPacket(parameters)` columns. The angles of
+// the last packet are interpolated towards `next_packet` if given and extrapolated otherwise.
+// The packets are split into contiguous ranges which are decoded by up to `threads` threads. The
+// result is identical to feeding all packets into a single decoder.
+void DecodePackets(const VelodyneLidarParameters& parameters, const uint8_t* packets,
+                   size_t count, const uint8_t* next_packet, const ColumnBuffers& buffers,
+                   size_t threads = 1, const std::string& kernel = "");
+
+// A column policy which leaves the decoded columns untouched. Policies are user types with the same
+// call operator which `Decoder::feed` and `Decoder::finish` invoke for every column right after it
+// was unpacked, while it is still in the L1 cache. The call is resolved at compile time and
+// inlined into the inner loop of the decoder. Policies may modify the column, for example to mask
+// out rays, or collect statistics. See column_policies.hpp for examples.
+struct NoColumnPolicy {
+  // `ranges` and `intensities` hold one value per vertical beam ordered by laser ID. `theta` is
+  // the horizontal angle of the column in radians.
+  void operator()(uint16_t* /*ranges*/, uint8_t* /*intensities*/, size_t /*beams*/,
+                  double /*theta*/) {}
+};
+
+// A streaming decoder for Velodyne data packets which does not depend on the Isaac runtime.
+// Packets are fed one by one and decoded columns are written into buffers owned by the caller.
+// Whenever a batch is complete the callback is invoked. The callback may install new output
+// buffers with `setOutput`, otherwise the same buffers are reused for the next batch.
+//
+// Only the first firing of every data block carries an azimuth. The angles of the other firings
+// are interpolated towards the next block, thus the decoder holds back the most recent packet
+// until the next one arrives.
+class Decoder {
+ public:
+  using Callback = std::function<void(const ColumnBatch&)>;
+
+  explicit Decoder(const VelodyneLidarParameters& parameters,
+                   const DecoderOptions& options = DecoderOptions());
+
+  // Sets the buffers into which the following columns are decoded
+  void setOutput(const ColumnBuffers& buffers);
+  // Sets the function which is called for every completed batch
+  void setCallback(Callback callback);
+  // Switches to the channel kernel with the given name, see `FindChannelKernel`. Returns false and
+  // keeps the current kernel if the kernel is not available.
+  bool setKernel(const std::string& name);
+
+  // Feeds the payload of a data packet with its kernel receive timestamp in nanoseconds. Returns
+  // false if the packet was rejected because it does not have the expected size.
+  bool feed(const uint8_t* packet, size_t size, int64_t timestamp);
+  // Like `feed` but applies `policy` to every column which is decoded
+  template <typename Policy>
+  bool feed(const uint8_t* packet, size_t size, int64_t timestamp, Policy& policy);
+  // Emits the columns decoded so far as a batch. The held back packet is kept.
+  void flush();
+  // Decodes the held back packet extrapolating its missing angles and emits all columns
+  void finish();
+  // Like `finish` but applies `policy` to every column which is decoded
+  template <typename Policy>
+  void finish(Policy& policy);
+  // Discards the held back packet, buffered columns and statistics
+  void reset();
+
+  // Kernel receive timestamp of the oldest packet which was fed but whose columns were not yet
+  // emitted, or -1 if there is no such packet
+  int64_t pendingTimestamp() const;
+  // The buffers into which columns are currently decoded
+  const ColumnBuffers& output() const { return output_; }
+  // Number of columns in the output buffers which were decoded but not yet emitted
+  size_t bufferedColumns() const { return size_; }
+  // Number of columns in a single data packet
+  size_t columnsPerPacket() const { return columns_per_packet_; }
+  // Number of values in a single column
+  size_t verticalBeams() const { return parameters_.vertical_beams; }
+  // Parameters of the sensor model
+  const VelodyneLidarParameters& parameters() const { return parameters_; }
+  // Name of the channel kernel which is used
+  const char* kernelName() const { return kernel_->name; }
+  // Counters since the decoder was created or reset
+  const DecoderStatistics& statistics() const { return statistics_; }
+  // Sums per ring since the decoder was created or reset. Only collected if enabled.
+  const RingStatistics& ringStatistics() const { return ring_statistics_; }
+
+ private:
+  // Counts packets missing between the held back packet and a packet starting at `next_azimuth`
+  void countLostPackets(double next_azimuth);
+  // Decodes the held back packet. `next_azimuth` is the azimuth of the block following it.
+  template <typename Policy>
+  void decodeHeldPacket(double next_azimuth, Policy& policy);
+  // Steps of decoding the held back packet which do not depend on the policy
+  bool acceptPacket(size_t size);
+  void holdPacket(const uint8_t* packet, size_t size, int64_t timestamp);
+  // Extrapolates the azimuth of the block following the held back packet
+  double extrapolatedAzimuth() const;
+  // Returns the number of groups of blocks which share an azimuth
+  size_t beginHeldPacket();
+  // Counts a new revolution and emits the buffered columns if batches are split at revolutions
+  void startRevolution();
+  // Adds the held packet to the current batch
+  void countPacket();
+  // Emits the buffered columns after adding them to the ring statistics if needed
+  void endBatch(bool end_of_revolution);
+  // Adds the buffered columns [first, last) to the ring statistics
+  void accumulateRings(size_t first, size_t last);
+  // Emits the buffered columns
+  void emit(bool end_of_revolution);
+
+  static constexpr double kPi = 3.14159265358979323846;
+
+  // Reads the azimuth of a data block in radians
+  static double BlockAzimuth(const uint8_t* block) {
+    const uint16_t azimuth = reinterpret_cast<const VelodyneRawDataBlock*>(block)->azimuth;
+    return -(static_cast<double>(azimuth) / 100.0) * (kPi / 180.0);
+  }
+  // The signed difference a - b between two angles normalized to [-pi, pi[
+  static double DeltaAzimuth(double a, double b) {
+    double delta = std::fmod(a - b + kPi, 2.0 * kPi);
+    if (delta < 0.0) delta += 2.0 * kPi;
+    return delta - kPi;
+  }
+
+  VelodyneLidarParameters parameters_;
+  DecoderOptions options_;
+  Callback callback_;
+  ColumnBuffers output_;
+  const ChannelKernelInfo* kernel_;
+
+  size_t firings_per_block_;
+  size_t blocks_per_column_;
+  size_t columns_per_packet_;
+  uint16_t min_range_;
+  uint16_t max_range_;
+
+  // The packet which waits for the azimuth of the following packet
+  std::vector<uint8_t> held_packet_;
+  int64_t held_timestamp_;
+  bool has_held_packet_;
+
+  // State of the batch which is currently filled
+  size_t size_;
+  uint64_t first_column_;
+  uint32_t batch_packets_;
+  int64_t batch_first_timestamp_;
+  int64_t batch_last_timestamp_;
+  double previous_theta_;
+  bool has_previous_theta_;
+  // True if the packet which is decoded contributed to the current batch
+  bool counted_packet_;
+
+  DecoderStatistics statistics_;
+  RingStatistics ring_statistics_;
+  // Number of packets which were decoded, used to sample packets for the ring statistics
+  uint64_t decoded_packets_;
+  // True if the packet which is decoded is sampled for the ring statistics, and the first of its
+  // buffered columns which was not yet added to them
+  bool sample_rings_;
+  size_t ring_first_;
+};
+
+template <typename Policy>
+bool Decoder::feed(const uint8_t* packet, size_t size, int64_t timestamp, Policy& policy) {
+  if (!acceptPacket(size)) {
+    return false;
+  }
+  if (has_held_packet_) {
+    const double next_azimuth = BlockAzimuth(packet);
+    countLostPackets(next_azimuth);
+    decodeHeldPacket(next_azimuth, policy);
+  }
+  holdPacket(packet, size, timestamp);
+  return true;
+}
+
+template <typename Policy>
+void Decoder::finish(Policy& policy) {
+  if (has_held_packet_) {
+    decodeHeldPacket(extrapolatedAzimuth(), policy);
+  }
+  flush();
+}
+
+template <typename Policy>
+void Decoder::decodeHeldPacket(double next_azimuth, Policy& policy) {
+  const size_t groups = beginHeldPacket();
+  const size_t beams = parameters_.vertical_beams;
+  // Number of beams of a column which are stored in a single block
+  const size_t bank_beams = beams / blocks_per_column_;
+  const size_t group_size = blocks_per_column_ * parameters_.block_size;
+  for (size_t j = 0; j < groups; j++) {
+    // A group consists of one block per bank of lasers which all share the same azimuth
+    const uint8_t* group_data = held_packet_.data() + j * group_size;
+    for (size_t b = 0; b < blocks_per_column_; b++) {
+      const auto& block = *reinterpret_cast<const VelodyneRawDataBlock*>(
+          group_data + b * parameters_.block_size);
+      if (block.dataBlockFlag != kBankBlockFlags[b]) {
+        statistics_.invalid_blocks++;
+      }
+    }
+    const double azimuth = BlockAzimuth(group_data);
+    const double delta = DeltaAzimuth(
+        j + 1 < groups ? BlockAzimuth(group_data + group_size) : next_azimuth, azimuth);
+    for (size_t f = 0; f < firings_per_block_; f++) {
+      const double theta =
+          f == 0 ? azimuth : azimuth + (static_cast<double>(f) / firings_per_block_) * delta;
+      if (has_previous_theta_ && StartsRevolution(previous_theta_, theta)) {
+        startRevolution();
+      }
+      previous_theta_ = theta;
+      has_previous_theta_ = true;
+      if (size_ >= output_.capacity) {
+        statistics_.dropped_columns++;
+        continue;
+      }
+      if (!counted_packet_) {
+        countPacket();
+      }
+
+      // Copy the channels of this firing from all banks into the column
+      uint16_t* ranges = output_.ranges + size_ * beams;
+      uint8_t* intensities = output_.intensities + size_ * beams;
+      for (size_t b = 0; b < blocks_per_column_; b++) {
+        const auto& block = *reinterpret_cast<const VelodyneRawDataBlock*>(
+            group_data + b * parameters_.block_size);
+        kernel_->function(block.channels + f * bank_beams, bank_beams, min_range_, max_range_,
+                          ranges + b * bank_beams, intensities + b * bank_beams);
+      }
+      policy(ranges, intensities, beams, theta);
+      output_.thetas[size_] = theta;
+      size_++;
+      statistics_.columns++;
+
+      if (size_ == output_.capacity || (options_.batch_size > 0 && size_ == options_.batch_size)) {
+        endBatch(false);
+      }
+    }
+  }
+  if (sample_rings_) {
+    accumulateRings(ring_first_, size_);
+  }
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
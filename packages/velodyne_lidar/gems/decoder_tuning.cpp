@@ -0,0 +1,283 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "decoder_tuning.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "engine/gems/serialization/json.hpp"
+#include "packages/velodyne_lidar/gems/channel_kernels.hpp"
+#include "packages/velodyne_lidar/gems/decoder.hpp"
+#include "packages/velodyne_lidar/gems/packet_encoder.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+// Number of synthetic packets decoded in a single measurement
+constexpr size_t kSyntheticPackets = 96;
+// Horizontal resolution of the synthetic columns in radians
+constexpr double kSyntheticResolution = 0.2 * 3.14159265358979323846 / 180.0;
+// Product intervals in packets which are considered
+constexpr size_t kProductIntervals[] = {1, 2, 4, 8};
+
+using Clock = std::chrono::steady_clock;
+
+// Encodes packets with pseudo-random ranges, some of them invalid or outside of the valid range
+std::vector<uint8_t> SyntheticPackets(const VelodyneLidarParameters& parameters) {
+  PacketEncoder encoder(parameters);
+  const size_t beams = parameters.vertical_beams;
+  std::vector<uint16_t> ranges(beams);
+  std::vector<uint8_t> intensities(beams);
+  std::vector<uint8_t> packets;
+  packets.reserve(kSyntheticPackets * encoder.packetSize());
+  uint32_t state = 12345;
+  const int64_t firing_cycle = static_cast<int64_t>(parameters.firing_cycle * 1e9);
+  for (size_t c = 0; packets.size() < kSyntheticPackets * encoder.packetSize(); c++) {
+    for (size_t i = 0; i < beams; i++) {
+      state = state * 1664525u + 1013904223u;
+      ranges[i] = (state >> 29) == 0 ? 0 : static_cast<uint16_t>(state >> 16);
+      intensities[i] = static_cast<uint8_t>(state >> 8);
+    }
+    const int64_t timestamp = static_cast<int64_t>(c) * firing_cycle;
+    if (encoder.addColumn(-kSyntheticResolution * c, ranges.data(), intensities.data(),
+                          timestamp)) {
+      packets.insert(packets.end(), encoder.packet(), encoder.packet() + encoder.packetSize());
+    }
+  }
+  return packets;
+}
+
+// A decoder with its output buffers which decodes the synthetic packets
+class Bench {
+ public:
+  Bench(const VelodyneLidarParameters& parameters, size_t batch_size, const std::string& kernel)
+      : beams_(parameters.vertical_beams) {
+    DecoderOptions options;
+    options.kernel = kernel;
+    options.batch_size = batch_size;
+    decoder_ = std::make_unique<Decoder>(parameters, options);
+    const size_t capacity =
+        batch_size > 0 ? batch_size : kSyntheticPackets * decoder_->columnsPerPacket();
+    ranges_.resize(capacity * beams_);
+    intensities_.resize(capacity * beams_);
+    thetas_.resize(capacity);
+    decoder_->setOutput({ranges_.data(), intensities_.data(), thetas_.data(), capacity});
+  }
+
+  // Decodes all packets. The output products are updated every `interval` packets and at the end
+  // of every batch if `products` is given, otherwise the decoded columns are appended to `result`.
+  void run(const std::vector<uint8_t>& packets, OutputEngine* products, size_t interval,
+           std::vector<uint16_t>* result) {
+    decoder_->reset();
+    decoder_->setCallback([&](const ColumnBatch& batch) {
+      if (products != nullptr) {
+        products->update(decoder_->output(), batch.size, 0);
+        products->begin();
+      }
+      if (result != nullptr) {
+        result->insert(result->end(), batch.ranges, batch.ranges + batch.size * beams_);
+        result->insert(result->end(), batch.intensities, batch.intensities + batch.size * beams_);
+      }
+    });
+    const size_t packet_size = decoder_->parameters().packet_sans_header_size;
+    const size_t count = packets.size() / packet_size;
+    for (size_t i = 0; i < count; i++) {
+      decoder_->feed(packets.data() + i * packet_size, packet_size, 0);
+      if (products != nullptr && (i + 1) % interval == 0) {
+        products->update(decoder_->output(), decoder_->bufferedColumns(), 0);
+      }
+    }
+    decoder_->finish();
+  }
+
+  size_t columns() const { return decoder_->statistics().columns; }
+
+ private:
+  size_t beams_;
+  std::unique_ptr<Decoder> decoder_;
+  std::vector<uint16_t> ranges_;
+  std::vector<uint8_t> intensities_;
+  std::vector<double> thetas_;
+};
+
+// A configuration which is measured
+struct Candidate {
+  const ChannelKernelInfo* kernel;
+  size_t product_interval;
+  std::unique_ptr<Bench> bench;
+  double best_time = std::numeric_limits<double>::max();
+};
+
+// The model name of the CPU as reported by the kernel
+std::string CpuName() {
+  std::ifstream cpuinfo("/proc/cpuinfo");
+  std::string line;
+  while (std::getline(cpuinfo, line)) {
+    if (line.compare(0, 10, "model name") == 0) {
+      const size_t colon = line.find(':');
+      if (colon != std::string::npos) {
+        return line.substr(line.find_first_not_of(' ', colon + 1));
+      }
+    }
+  }
+  return "unknown CPU";
+}
+}  // namespace
+
+bool TuneDecoder(const VelodyneLidarParameters& parameters, OutputEngine& products,
+                 const DecoderTuningOptions& options, DecoderTuning& tuning) {
+  const Clock::time_point start = Clock::now();
+  const std::vector<uint8_t> packets = SyntheticPackets(parameters);
+
+  // Every kernel needs to reproduce the output of the reference implementation
+  std::vector<uint16_t> expected;
+  Bench(parameters, options.batch_size, "scalar").run(packets, nullptr, 1, &expected);
+  std::vector<Candidate> candidates;
+  for (const ChannelKernelInfo& kernel : ChannelKernels()) {
+    if (!kernel.is_supported() || (!options.kernel.empty() && options.kernel != kernel.name)) {
+      continue;
+    }
+    auto bench = std::make_unique<Bench>(parameters, options.batch_size, kernel.name);
+    std::vector<uint16_t> result;
+    bench->run(packets, nullptr, 1, &result);
+    if (result != expected) {
+      continue;
+    }
+    if (options.product_interval > 0 || products.empty()) {
+      candidates.push_back({&kernel, std::max<size_t>(1, options.product_interval),
+                            std::move(bench)});
+      continue;
+    }
+    for (size_t interval : kProductIntervals) {
+      candidates.push_back({&kernel, interval,
+                            std::make_unique<Bench>(parameters, options.batch_size, kernel.name)});
+    }
+  }
+  if (candidates.empty()) {
+    return false;
+  }
+
+  // Measures all candidates in turns so that they are affected alike by noise on the host
+  const Clock::time_point deadline =
+      start + std::chrono::duration_cast<Clock::duration>(
+                  std::chrono::duration<double>(std::max(0.0, options.budget)));
+  OutputEngine* engine = products.empty() ? nullptr : &products;
+  do {
+    for (Candidate& candidate : candidates) {
+      if (engine != nullptr) {
+        engine->begin();
+      }
+      const Clock::time_point round_start = Clock::now();
+      candidate.bench->run(packets, engine, candidate.product_interval, nullptr);
+      const double time = std::chrono::duration<double, std::nano>(Clock::now() - round_start)
+                              .count() / candidate.bench->columns();
+      candidate.best_time = std::min(candidate.best_time, time);
+    }
+  } while (Clock::now() < deadline);
+  products.begin();
+
+  const auto best = std::min_element(candidates.begin(), candidates.end(),
+                                     [](const Candidate& lhs, const Candidate& rhs) {
+                                       return lhs.best_time < rhs.best_time;
+                                     });
+  tuning.kernel = best->kernel->name;
+  tuning.product_interval = best->product_interval;
+  tuning.column_time = best->best_time;
+  tuning.candidates = candidates.size();
+  return true;
+}
+
+std::string DecoderTuningKey(const VelodyneLidarParameters& parameters,
+                             const DecoderTuningOptions& options, const std::string& products) {
+  std::string kernels;
+  for (const ChannelKernelInfo& kernel : ChannelKernels()) {
+    kernels += kernels.empty() ? kernel.name : std::string(",") + kernel.name;
+  }
+  char sensor[64];
+  std::snprintf(sensor, sizeof(sensor), "product %02x, %u beams, batch %zu",
+                parameters.product_id, parameters.vertical_beams, options.batch_size);
+  return CpuName() + "; " + sensor + "; kernels " + kernels + "; kernel " +
+         (options.kernel.empty() ? "auto" : options.kernel) + "; interval " +
+         (options.product_interval > 0 ? std::to_string(options.product_interval) : "auto") +
+         "; products " + products;
+}
+
+bool LoadDecoderTuning(const std::string& filename, const std::string& key,
+                       DecoderTuning& tuning) {
+  const auto json = serialization::TryLoadJsonFromFile(filename);
+  if (!json || !json->is_object()) {
+    return false;
+  }
+  const auto it = json->find(key);
+  if (it == json->end() || !it->is_object()) {
+    return false;
+  }
+  const std::string kernel = it->value("kernel", "");
+  const int64_t product_interval = it->value("product_interval", int64_t{0});
+  if (kernel.empty() || FindChannelKernel(kernel) == nullptr || product_interval < 1) {
+    return false;
+  }
+  tuning.kernel = kernel;
+  tuning.product_interval = static_cast<size_t>(product_interval);
+  tuning.column_time = it->value("column_time", 0.0);
+  tuning.candidates = 0;
+  return true;
+}
+
+bool StoreDecoderTuning(const std::string& filename, const std::string& key,
+                        const DecoderTuning& tuning) {
+  auto json = serialization::TryLoadJsonFromFile(filename);
+  if (!json || !json->is_object()) {
+    json = Json::object();
+  }
+  (*json)[key] = {{"kernel", tuning.kernel},
+                  {"product_interval", tuning.product_interval},
+                  {"column_time", tuning.column_time}};
+  // Drivers which start at the same time either see the old or the new file
+  const std::string temporary = filename + "." + std::to_string(getpid());
+  {
+    std::ofstream file(temporary);
+    file << json->dump(2) << std::endl;
+    if (!file) {
+      return false;
+    }
+  }
+  return std::rename(temporary.c_str(), filename.c_str()) == 0;
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
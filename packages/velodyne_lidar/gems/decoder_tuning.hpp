@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "packages/velodyne_lidar/gems/output_products.hpp"
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+// Limits of the search for the fastest decoder configuration
+struct DecoderTuningOptions {
+  // Number of columns per batch of the decoder. The batch size defines the scans which are
+  // published and is thus not tuned.
+  size_t batch_size = 0;
+  // Time in seconds which is spent on measurements. Every candidate is measured at least once.
+  double budget = 0.005;
+  // If not empty only this channel kernel is considered
+  std::string kernel;
+  // If positive only this product interval is considered
+  size_t product_interval = 0;
+};
+
+// The decoder configuration which was the fastest on this host
+struct DecoderTuning {
+  // Name of the channel kernel, see `ChannelKernels`
+  std::string kernel;
+  // Number of packets after which the output products are updated with the new columns. Small
+  // intervals read the columns while they are still in the cache, larger intervals process more
+  // columns per call.
+  size_t product_interval = 1;
+  // Time per decoded column in nanoseconds measured for this configuration
+  double column_time = 0.0;
+  // Number of configurations which were measured. Zero if the result was read from a cache.
+  size_t candidates = 0;
+};
+
+// Decodes synthetic packets with every channel kernel supported by the CPU and every candidate
+// product interval and returns the fastest configuration in `tuning`. Kernels whose output
+// differs from the scalar kernel are skipped. `products` is updated like the driver does and is
+// reset with `begin` before returning. Returns false if no kernel produced correct output.
+bool TuneDecoder(const VelodyneLidarParameters& parameters, OutputEngine& products,
+                 const DecoderTuningOptions& options, DecoderTuning& tuning);
+
+// Identifies the host CPU, the sensor model, the build and the options for which a tuning is
+// valid. `products` describes the output products, for example "flatscan,cloud".
+std::string DecoderTuningKey(const VelodyneLidarParameters& parameters,
+                             const DecoderTuningOptions& options, const std::string& products);
+
+// Reads the tuning stored under `key` from a JSON file written by `StoreDecoderTuning`. Returns
+// false if the file or the key does not exist or if the kernel is not available in this build.
+bool LoadDecoderTuning(const std::string& filename, const std::string& key,
+                       DecoderTuning& tuning);
+// Stores the tuning under `key` in a JSON file and keeps the entries for other keys. Returns false
+// if the file could not be written.
+bool StoreDecoderTuning(const std::string& filename, const std::string& key,
+                        const DecoderTuning& tuning);
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
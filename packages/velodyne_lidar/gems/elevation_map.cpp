@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "elevation_map.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "engine/core/assert.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+ElevationMap::ElevationMap(const VelodyneLidarParameters& parameters,
+                           const ElevationMapOptions& options)
+    : vertical_beams_(parameters.vertical_beams),
+      distance_resolution_(static_cast<float>(parameters.distance_resolution)),
+      options_(options),
+      grid_(options.cells, Cell{0.0f, 0.0f, 0.0f, 0}),
+      cos_terms_(3 * parameters.vertical_beams),
+      sin_terms_(3 * parameters.vertical_beams),
+      constant_terms_(3 * parameters.vertical_beams) {
+  ASSERT(options_.cell_size > 0.0, "The cell size needs to be positive: %f", options_.cell_size);
+  ASSERT(parameters.vertical_angles.size() == parameters.vertical_beams,
+         "The vertical angles of the sensor are not known");
+  for (double angle : parameters.vertical_angles) {
+    cos_phis_.push_back(std::cos(angle));
+    sin_phis_.push_back(std::sin(angle));
+  }
+  x_ = 0.0;
+  y_ = 0.0;
+  yaw_ = 0.0;
+  updateTransform();
+  revolutions_ = 0;
+}
+
+void ElevationMap::write(const uint16_t* ranges, const uint8_t* intensities, const double* thetas,
+                         size_t count) {
+  const float scale = static_cast<float>(1.0 / options_.cell_size);
+  const float minimum_height = static_cast<float>(options_.minimum_height);
+  const float maximum_height = static_cast<float>(options_.maximum_height);
+  for (size_t c = 0; c < count; c++) {
+    const float theta = static_cast<float>(thetas[c]);
+    const float cos_theta = std::cos(theta);
+    const float sin_theta = std::sin(theta);
+    const uint16_t* column = ranges + c * vertical_beams_;
+    for (size_t j = 0; j < vertical_beams_; j++) {
+      if (column[j] == 0) continue;
+      const float distance = column[j] * distance_resolution_;
+      const float* a = cos_terms_.data() + 3 * j;
+      const float* b = sin_terms_.data() + 3 * j;
+      const float* d = constant_terms_.data() + 3 * j;
+      const float z = distance * (cos_theta * a[2] + sin_theta * b[2] + d[2]) + translation_[2];
+      if (z < minimum_height || z > maximum_height) continue;
+      const float x = distance * (cos_theta * a[0] + sin_theta * b[0] + d[0]) + translation_[0];
+      const float y = distance * (cos_theta * a[1] + sin_theta * b[1] + d[1]) + translation_[1];
+      const int64_t cell_x = static_cast<int64_t>(std::floor(x * scale));
+      const int64_t cell_y = static_cast<int64_t>(std::floor(y * scale));
+      if (!grid_.contains(cell_x, cell_y)) continue;
+      Cell& cell = grid_[grid_.index(cell_x, cell_y)];
+      if (cell.count == 0) {
+        cell.minimum = z;
+        cell.maximum = z;
+      } else {
+        cell.minimum = std::min(cell.minimum, z);
+        cell.maximum = std::max(cell.maximum, z);
+      }
+      cell.sum += z;
+      cell.count++;
+    }
+  }
+}
+
+void ElevationMap::endRevolution(int64_t /*timestamp*/) {
+  if (!options_.clear_at_revolution) {
+    return;
+  }
+  snapshot(completed_);
+  clear();
+  revolutions_++;
+}
+
+void ElevationMap::setPose(double x, double y, double yaw) {
+  x_ = x;
+  y_ = y;
+  yaw_ = yaw;
+  updateTransform();
+  grid_.center(static_cast<int64_t>(std::floor(x / options_.cell_size)),
+               static_cast<int64_t>(std::floor(y / options_.cell_size)));
+}
+
+void ElevationMap::clear() {
+  grid_.clear();
+}
+
+void ElevationMap::snapshot(ElevationLayers& layers) const {
+  const size_t size = grid_.size();
+  const size_t total = size * size;
+  layers.cells = size;
+  layers.cell_size = options_.cell_size;
+  layers.origin_x = grid_.originX();
+  layers.origin_y = grid_.originY();
+  layers.minimum.resize(total);
+  layers.maximum.resize(total);
+  layers.mean.resize(total);
+  layers.count.resize(total);
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  for (size_t row = 0; row < size; row++) {
+    for (size_t column = 0; column < size; column++) {
+      const Cell& cell = grid_.at(row, column);
+      const size_t i = row * size + column;
+      const bool empty = cell.count == 0;
+      layers.minimum[i] = empty ? nan : cell.minimum;
+      layers.maximum[i] = empty ? nan : cell.maximum;
+      layers.mean[i] = empty ? nan : cell.sum / cell.count;
+      layers.count[i] = cell.count;
+    }
+  }
+}
+
+void ElevationMap::updateTransform() {
+  // world_R_sensor is the rotation by the heading of the robot followed by the extrinsic rotation
+  const double cos_yaw = std::cos(yaw_);
+  const double sin_yaw = std::sin(yaw_);
+  const auto& r = options_.extrinsic.rotation;
+  const auto& t = options_.extrinsic.translation;
+  double rotation[9];
+  for (int column = 0; column < 3; column++) {
+    rotation[column] = cos_yaw * r[column] - sin_yaw * r[3 + column];
+    rotation[3 + column] = sin_yaw * r[column] + cos_yaw * r[3 + column];
+    rotation[6 + column] = r[6 + column];
+  }
+  translation_ = {static_cast<float>(cos_yaw * t[0] - sin_yaw * t[1] + x_),
+                  static_cast<float>(sin_yaw * t[0] + cos_yaw * t[1] + y_),
+                  static_cast<float>(t[2])};
+  // The direction of a beam in the sensor frame is (cos phi cos theta, cos phi sin theta, sin phi)
+  for (size_t j = 0; j < vertical_beams_; j++) {
+    for (int row = 0; row < 3; row++) {
+      cos_terms_[3 * j + row] = static_cast<float>(cos_phis_[j] * rotation[3 * row]);
+      sin_terms_[3 * j + row] = static_cast<float>(cos_phis_[j] * rotation[3 * row + 1]);
+      constant_terms_[3 * j + row] = static_cast<float>(sin_phis_[j] * rotation[3 * row + 2]);
+    }
+  }
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "packages/velodyne_lidar/gems/output_products.hpp"
+#include "packages/velodyne_lidar/gems/rigid_transform.hpp"
+#include "packages/velodyne_lidar/gems/rolling_grid.hpp"
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+// Parameters of an `ElevationMap`
+struct ElevationMapOptions {
+  // Number of cells along each side of the map. Needs to be a power of two.
+  size_t cells = 256;
+  // Length of a side of a cell in meters
+  double cell_size = 0.2;
+  // Pose of the sensor on the robot
+  RigidTransform extrinsic;
+  // Points outside of this band of heights in meters in the robot frame are ignored
+  double minimum_height = -1e9;
+  double maximum_height = 1e9;
+  // If enabled the map is copied to `completed` and cleared whenever the sensor completes a
+  // revolution, otherwise it accumulates all points until it is cleared
+  bool clear_at_revolution = true;
+};
+
+// The layers of an elevation map in row-major order starting at the origin cell. Heights are in
+// meters in the robot frame and NaN for cells without points.
+struct ElevationLayers {
+  size_t cells = 0;
+  double cell_size = 0.0;
+  // World coordinates in cells of the first cell
+  int64_t origin_x = 0;
+  int64_t origin_y = 0;
+  std::vector<float> minimum;
+  std::vector<float> maximum;
+  std::vector<float> mean;
+  std::vector<uint32_t> count;
+};
+
+// A 2.5D elevation map which keeps the minimum, maximum and mean height and the number of points
+// of every cell. It is updated with every chunk of decoded columns, thus the map of a revolution
+// is ready as soon as its last packet was decoded.
+//
+// The extrinsic transformation and the pose of the robot are fused with the direction of every
+// beam, thus transforming a return costs a few multiplications. The map is a `RollingGrid` which
+// moves with the robot and allocates all storage up front.
+class ElevationMap : public ProductWriter {
+ public:
+  // The vertical angles of the sensor need to be known
+  ElevationMap(const VelodyneLidarParameters& parameters, const ElevationMapOptions& options);
+
+  // Keeps the map which spans scans
+  void begin() override {}
+  void write(const uint16_t* ranges, const uint8_t* intensities, const double* thetas,
+             size_t count) override;
+  // Keeps the map of the revolution and clears it if `clear_at_revolution` is enabled
+  void endRevolution(int64_t timestamp) override;
+
+  // Sets the pose of the robot in the world frame in meters and radians. The window is moved such
+  // that the robot is in its center cell, and cells which enter the window are empty.
+  void setPose(double x, double y, double yaw);
+  // Removes all points
+  void clear();
+  // Copies the current map into `layers`
+  void snapshot(ElevationLayers& layers) const;
+
+  // Number of revolutions which were completed if `clear_at_revolution` is enabled
+  uint64_t revolutions() const { return revolutions_; }
+  // The map of the last completed revolution if `clear_at_revolution` is enabled
+  const ElevationLayers& completed() const { return completed_; }
+
+ private:
+  // A cell of the map
+  struct Cell {
+    float minimum;
+    float maximum;
+    float sum;
+    uint32_t count;
+  };
+
+  // Fuses the extrinsic transformation, the pose and the directions of the beams
+  void updateTransform();
+
+  size_t vertical_beams_;
+  std::vector<double> cos_phis_;
+  std::vector<double> sin_phis_;
+  float distance_resolution_;
+  ElevationMapOptions options_;
+  RollingGrid<Cell> grid_;
+  double x_;
+  double y_;
+  double yaw_;
+  // Per beam the terms of the direction in world coordinates which are multiplied with the cosine
+  // and the sine of the horizontal angle and the constant term. Three values per beam each.
+  std::vector<float> cos_terms_;
+  std::vector<float> sin_terms_;
+  std::vector<float> constant_terms_;
+  // Position of the sensor in world coordinates in meters
+  std::array<float, 3> translation_;
+  uint64_t revolutions_;
+  ElevationLayers completed_;
+};
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
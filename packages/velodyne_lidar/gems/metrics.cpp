@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdarg>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+// Upper bound of the first bucket in nanoseconds
+constexpr double kFirstBucket = 100.0;
+constexpr double kNanosecondsToSeconds = 1e-9;
+constexpr double kQuantiles[] = {0.5, 0.9, 0.99};
+
+// Upper bound of the given bucket in nanoseconds
+double BucketBound(size_t bucket) {
+  return kFirstBucket * std::exp2(0.5 * bucket);
+}
+
+void Append(std::string& text, const char* format, ...) __attribute__((format(printf, 2, 3)));
+void Append(std::string& text, const char* format, ...) {
+  va_list arguments;
+  va_start(arguments, format);
+  va_list retry;
+  va_copy(retry, arguments);
+  char line[256];
+  const int length = std::vsnprintf(line, sizeof(line), format, arguments);
+  va_end(arguments);
+  if (length > 0 && static_cast<size_t>(length) < sizeof(line)) {
+    text.append(line, length);
+  } else if (length > 0) {
+    // Long sensor names do not fit into the line buffer, thus format directly into the text
+    const size_t offset = text.size();
+    text.resize(offset + length + 1);
+    std::vsnprintf(&text[offset], length + 1, format, retry);
+    text.resize(offset + length);
+  }
+  va_end(retry);
+}
+
+// Escapes a label value as required by the text exposition format
+std::string EscapeLabel(const std::string& value) {
+  std::string escaped;
+  escaped.reserve(value.size());
+  for (char c : value) {
+    if (c == '\\') {
+      escaped += "\\\\";
+    } else if (c == '"') {
+      escaped += "\\\"";
+    } else if (c == '\n') {
+      escaped += "\\n";
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+}  // namespace
+
+void Gauge::set(double value) {
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  bits_.store(bits, std::memory_order_relaxed);
+}
+
+double Gauge::value() const {
+  const uint64_t bits = bits_.load(std::memory_order_relaxed);
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+void Histogram::observe(int64_t nanoseconds) {
+  size_t bucket = 0;
+  if (nanoseconds > kFirstBucket) {
+    bucket = std::min<size_t>(
+        kBuckets - 1, static_cast<size_t>(std::ceil(2.0 * std::log2(nanoseconds / kFirstBucket))));
+  }
+  buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+double Histogram::quantile(double q) const {
+  std::array<uint64_t, kBuckets> counts;
+  uint64_t total = 0;
+  for (size_t i = 0; i < kBuckets; i++) {
+    counts[i] = buckets_[i].load(std::memory_order_relaxed);
+    total += counts[i];
+  }
+  if (total == 0) {
+    return 0.0;
+  }
+  // Interpolate linearly within the bucket which contains the quantile
+  const double rank = q * total;
+  uint64_t below = 0;
+  for (size_t i = 0; i < kBuckets; i++) {
+    if (below + counts[i] >= rank && counts[i] > 0) {
+      const double lower = i == 0 ? 0.0 : BucketBound(i - 1);
+      const double fraction = (rank - below) / counts[i];
+      return lower + fraction * (BucketBound(i) - lower);
+    }
+    below += counts[i];
+  }
+  return BucketBound(kBuckets - 1);
+}
+
+MetricsRegistry& MetricsRegistry::Get() {
+  static MetricsRegistry registry;
+  return registry;
+}
+
+void MetricsRegistry::add(std::shared_ptr<SensorMetrics> metrics) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  sensors_.push_back(std::move(metrics));
+}
+
+void MetricsRegistry::remove(const std::shared_ptr<SensorMetrics>& metrics) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  sensors_.erase(std::remove(sensors_.begin(), sensors_.end(), metrics), sensors_.end());
+}
+
+std::string MetricsRegistry::render() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::string text;
+  auto counter = [&](const char* name, const char* help,
+                     std::function<const Counter&(const SensorMetrics&)> get) {
+    Append(text, "# HELP velodyne_%s %s\n# TYPE velodyne_%s counter\n", name, help, name);
+    for (const auto& sensor : sensors_) {
+      Append(text, "velodyne_%s{sensor=\"%s\"} %" PRIu64 "\n", name,
+             EscapeLabel(sensor->name).c_str(), get(*sensor).value());
+    }
+  };
+  auto gauge = [&](const char* name, const char* help,
+                   std::function<const Gauge&(const SensorMetrics&)> get) {
+    Append(text, "# HELP velodyne_%s %s\n# TYPE velodyne_%s gauge\n", name, help, name);
+    for (const auto& sensor : sensors_) {
+      Append(text, "velodyne_%s{sensor=\"%s\"} %.9g\n", name, EscapeLabel(sensor->name).c_str(),
+             get(*sensor).value());
+    }
+  };
+  auto summary = [&](const char* name, const char* help,
+                     std::function<const Histogram&(const SensorMetrics&)> get) {
+    Append(text, "# HELP velodyne_%s %s\n# TYPE velodyne_%s summary\n", name, help, name);
+    for (const auto& sensor : sensors_) {
+      const Histogram& histogram = get(*sensor);
+      const std::string label = EscapeLabel(sensor->name);
+      for (double q : kQuantiles) {
+        Append(text, "velodyne_%s{sensor=\"%s\",quantile=\"%g\"} %.9g\n", name, label.c_str(), q,
+               histogram.quantile(q) * kNanosecondsToSeconds);
+      }
+      Append(text, "velodyne_%s_sum{sensor=\"%s\"} %.9g\n", name, label.c_str(),
+             histogram.sum() * kNanosecondsToSeconds);
+      Append(text, "velodyne_%s_count{sensor=\"%s\"} %" PRIu64 "\n", name, label.c_str(),
+             histogram.count());
+    }
+  };
+
+  counter("packets_total", "Packets received with the expected size",
+          [](const SensorMetrics& m) -> const Counter& { return m.packets; });
+  counter("rejected_packets_total", "Packets received with an unexpected size",
+          [](const SensorMetrics& m) -> const Counter& { return m.rejected_packets; });
+  counter("kernel_drops_total", "Packets dropped by the kernel",
+          [](const SensorMetrics& m) -> const Counter& { return m.kernel_drops; });
+  counter("truncated_packets_total", "Packets dropped because they were larger than expected",
+          [](const SensorMetrics& m) -> const Counter& { return m.truncated_packets; });
+  counter("lost_packets_total", "Packets missing in the stream judging by the azimuth",
+          [](const SensorMetrics& m) -> const Counter& { return m.lost_packets; });
+  counter("invalid_blocks_total", "Data blocks with an unexpected block flag",
+          [](const SensorMetrics& m) -> const Counter& { return m.invalid_blocks; });
+  counter("scans_total", "Scans which were published",
+          [](const SensorMetrics& m) -> const Counter& { return m.scans; });
+  counter("partial_scans_total", "Scans which were published before all columns arrived",
+          [](const SensorMetrics& m) -> const Counter& { return m.partial_scans; });
+  gauge("rpm", "Rotation speed in revolutions per minute",
+        [](const SensorMetrics& m) -> const Gauge& { return m.rpm; });
+  gauge("clock_offset_seconds", "Receive time minus sensor time",
+        [](const SensorMetrics& m) -> const Gauge& { return m.clock_offset; });
+  gauge("phase_locked", "1 if the rotation is locked to the PPS signal",
+        [](const SensorMetrics& m) -> const Gauge& { return m.phase_locked; });
+  counter("failed_requests_total", "Requests to the web interface of the sensor which failed",
+          [](const SensorMetrics& m) -> const Counter& { return m.failed_requests; });
+  gauge("alarm_rings", "Rings which were degraded for several consecutive windows",
+        [](const SensorMetrics& m) -> const Gauge& { return m.alarm_rings; });
+  counter("safety_violations_total", "Times a safety field became violated",
+          [](const SensorMetrics& m) -> const Counter& { return m.safety_violations; });
+  summary("decode_seconds", "Time to decode a packet",
+          [](const SensorMetrics& m) -> const Histogram& { return m.decode_time; });
+  summary("publish_latency_seconds", "Time from receiving the first packet of a scan to publishing",
+          [](const SensorMetrics& m) -> const Histogram& { return m.publish_latency; });
+  summary("safety_latency_seconds", "Time from receiving a packet to publishing the safety state",
+          [](const SensorMetrics& m) -> const Histogram& { return m.safety_latency; });
+  return text;
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace isaac {
+namespace velodyne_lidar {
+
+// A monotonic counter. Updates are lock-free.
+class Counter {
+ public:
+  void add(uint64_t amount = 1) { value_.fetch_add(amount, std::memory_order_relaxed); }
+  // Sets the counter to a total which is maintained elsewhere, e.g. by the decoder
+  void set(uint64_t total) { value_.store(total, std::memory_order_relaxed); }
+  uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<uint64_t> value_{0};
+};
+
+// A value which can go up and down. Updates are lock-free.
+class Gauge {
+ public:
+  void set(double value);
+  double value() const;
+
+ private:
+  std::atomic<uint64_t> bits_{0};
+};
+
+// Distribution of durations in nanoseconds with buckets growing by a factor of sqrt(2). Updates
+// are lock-free. Quantiles are estimated from the buckets and are accurate within one bucket.
+class Histogram {
+ public:
+  static constexpr size_t kBuckets = 64;
+
+  void observe(int64_t nanoseconds);
+  // Estimates the given quantile in nanoseconds, or 0 if nothing was observed
+  double quantile(double q) const;
+  uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+  int64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+
+ private:
+  std::array<std::atomic<uint64_t>, kBuckets> buckets_{};
+  std::atomic<uint64_t> count_{0};
+  std::atomic<int64_t> sum_{0};
+};
+
+// Health and performance metrics of a single sensor
+struct SensorMetrics {
+  explicit SensorMetrics(std::string name) : name(std::move(name)) {}
+
+  // Value of the `sensor` label
+  const std::string name;
+  Counter packets;            // Packets received with the expected size
+  Counter rejected_packets;   // Packets received with an unexpected size
+  Counter kernel_drops;       // Packets dropped by the kernel because the socket buffer was full
+  Counter truncated_packets;  // Packets dropped because they were larger than a sensor packet
+  Counter lost_packets;       // Packets missing in the stream judging by the azimuth
+  Counter invalid_blocks;     // Data blocks with an unexpected block flag
+  Counter scans;              // Scans which were published
+  Counter partial_scans;      // Scans which were published before all columns arrived
+  Gauge rpm;                  // Rotation speed in revolutions per minute
+  Gauge clock_offset;         // Receive time minus sensor time in seconds
+  Gauge phase_locked;         // 1 if the web interface reports that the phase lock is achieved
+  Counter failed_requests;    // Requests to the web interface of the sensor which failed
+  Gauge alarm_rings;          // Rings which were degraded for several consecutive windows
+  Counter safety_violations;  // Times a safety field became violated
+  Histogram decode_time;      // Time to decode a packet
+  Histogram publish_latency;  // Time from receiving the first packet of a scan to publishing it
+  Histogram safety_latency;   // Time from receiving a packet to publishing the safety state
+};
+
+// All sensors whose metrics are exported
+class MetricsRegistry {
+ public:
+  static MetricsRegistry& Get();
+
+  void add(std::shared_ptr<SensorMetrics> metrics);
+  void remove(const std::shared_ptr<SensorMetrics>& metrics);
+  // Renders the metrics of all sensors in the Prometheus text exposition format
+  std::string render() const;
+
+ private:
+  mutable std::mutex mutex_;
+  std::vector<std::shared_ptr<SensorMetrics>> sensors_;
+};
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "metrics_server.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "packages/velodyne_lidar/gems/metrics.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+// Time in milliseconds after which the server checks whether it should stop
+constexpr int kPollTimeout = 100;
+// Time in milliseconds a client has to send its request
+constexpr int kRequestTimeout = 1000;
+
+// Writes all bytes unless the connection fails
+void WriteAll(int fd, const std::string& data) {
+  size_t written = 0;
+  while (written < data.size()) {
+    const ssize_t result = ::send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+    if (result < 0) {
+      if (errno == EINTR) continue;
+      return;
+    }
+    written += result;
+  }
+}
+}  // namespace
+
+std::shared_ptr<MetricsServer> MetricsServer::Acquire(int port) {
+  static std::mutex mutex;
+  static std::map<int, std::weak_ptr<MetricsServer>> servers;
+  std::lock_guard<std::mutex> lock(mutex);
+  std::shared_ptr<MetricsServer> server = servers[port].lock();
+  if (server) {
+    return server;
+  }
+  server.reset(new MetricsServer());
+  if (!server->start(port)) {
+    return nullptr;
+  }
+  servers[port] = server;
+  return server;
+}
+
+MetricsServer::~MetricsServer() {
+  running_ = false;
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+}
+
+bool MetricsServer::start(int port) {
+  fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (fd_ < 0) {
+    return false;
+  }
+  const int enable = 1;
+  ::setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+  sockaddr_in local{};
+  local.sin_family = AF_INET;
+  local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  local.sin_port = htons(static_cast<uint16_t>(port));
+  if (::bind(fd_, reinterpret_cast<sockaddr*>(&local), sizeof(local)) < 0 ||
+      ::listen(fd_, 8) < 0) {
+    const int error = errno;
+    ::close(fd_);
+    fd_ = -1;
+    errno = error;
+    return false;
+  }
+  running_ = true;
+  thread_ = std::thread([this] { run(); });
+  return true;
+}
+
+void MetricsServer::run() {
+  while (running_) {
+    pollfd descriptor{fd_, POLLIN, 0};
+    if (::poll(&descriptor, 1, kPollTimeout) <= 0) {
+      continue;
+    }
+    const int connection = ::accept(fd_, nullptr, nullptr);
+    if (connection < 0) {
+      continue;
+    }
+    handle(connection);
+    ::close(connection);
+  }
+}
+
+void MetricsServer::handle(int connection) {
+  // Read until the end of the request header. The request body is never needed.
+  std::string request;
+  char buffer[1024];
+  while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+    pollfd descriptor{connection, POLLIN, 0};
+    if (::poll(&descriptor, 1, kRequestTimeout) <= 0) {
+      return;
+    }
+    const ssize_t length = ::recv(connection, buffer, sizeof(buffer), 0);
+    if (length <= 0) {
+      return;
+    }
+    request.append(buffer, length);
+  }
+
+  std::string status = "200 OK";
+  std::string body;
+  if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 6, "GET / ") == 0) {
+    body = MetricsRegistry::Get().render();
+  } else {
+    status = "404 Not Found";
+    body = "Not found\n";
+  }
+  WriteAll(connection, "HTTP/1.0 " + status +
+                           "\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                           std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body);
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "occupancy_grid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+#include "engine/core/assert.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+OccupancyGrid::OccupancyGrid(const VelodyneLidarParameters& parameters,
+                             const OccupancyGridOptions& options)
+    : vertical_beams_(parameters.vertical_beams),
+      cell_size_(options.cell_size),
+      hit_(options.hit),
+      miss_(options.miss),
+      minimum_(options.minimum),
+      maximum_(options.maximum),
+      distance_resolution_(parameters.distance_resolution),
+      grid_(options.cells, 0) {
+  ASSERT(cell_size_ > 0.0, "The cell size needs to be positive: %f", cell_size_);
+  ASSERT(parameters.vertical_angles.size() == parameters.vertical_beams,
+         "The vertical angles of the sensor are not known");
+  for (uint32_t i = 0; i < parameters.vertical_beams; i++) {
+    const double angle = parameters.vertical_angles[i];
+    if (angle >= options.minimum_angle && angle <= options.maximum_angle) {
+      beams_.push_back(i);
+      cos_phis_.push_back(std::cos(angle));
+    }
+  }
+  distances_.resize(beams_.size());
+  x_ = 0.0;
+  y_ = 0.0;
+  yaw_ = 0.0;
+}
+
+void OccupancyGrid::write(const uint16_t* ranges, const uint8_t* intensities,
+                          const double* thetas, size_t count) {
+  // Distances are measured in cells from here on
+  const double sensor_x = x_ / cell_size_;
+  const double sensor_y = y_ / cell_size_;
+  const int64_t start_x = static_cast<int64_t>(std::floor(sensor_x));
+  const int64_t start_y = static_cast<int64_t>(std::floor(sensor_y));
+  const double scale = distance_resolution_ / cell_size_;
+  for (size_t c = 0; c < count; c++) {
+    const uint16_t* column = ranges + c * vertical_beams_;
+    size_t returns = 0;
+    double nearest = std::numeric_limits<double>::max();
+    for (size_t j = 0; j < beams_.size(); j++) {
+      const uint16_t range = column[beams_[j]];
+      if (range == 0) continue;
+      const double distance = range * scale * cos_phis_[j];
+      distances_[returns++] = distance;
+      nearest = std::min(nearest, distance);
+    }
+    if (returns == 0) continue;
+    const double dx = std::cos(thetas[c] + yaw_);
+    const double dy = std::sin(thetas[c] + yaw_);
+
+    // The ray is set up once per column and passes the free cells up to the closest return
+    const int64_t end_x = static_cast<int64_t>(std::floor(sensor_x + nearest * dx));
+    const int64_t end_y = static_cast<int64_t>(std::floor(sensor_y + nearest * dy));
+    const int64_t delta_x = std::abs(end_x - start_x);
+    const int64_t delta_y = -std::abs(end_y - start_y);
+    const int64_t step_x = start_x < end_x ? 1 : -1;
+    const int64_t step_y = start_y < end_y ? 1 : -1;
+    int64_t error = delta_x + delta_y;
+    int64_t x = start_x;
+    int64_t y = start_y;
+    while ((x != end_x || y != end_y) && grid_.contains(x, y)) {
+      update(grid_.index(x, y), miss_);
+      const int64_t error2 = 2 * error;
+      if (error2 >= delta_y) {
+        error += delta_y;
+        x += step_x;
+      }
+      if (error2 <= delta_x) {
+        error += delta_x;
+        y += step_y;
+      }
+    }
+
+    // Every cell with a return is occupied once per column
+    int64_t previous_x = std::numeric_limits<int64_t>::min();
+    int64_t previous_y = std::numeric_limits<int64_t>::min();
+    for (size_t k = 0; k < returns; k++) {
+      const int64_t hit_x = static_cast<int64_t>(std::floor(sensor_x + distances_[k] * dx));
+      const int64_t hit_y = static_cast<int64_t>(std::floor(sensor_y + distances_[k] * dy));
+      if ((hit_x == previous_x && hit_y == previous_y) || !grid_.contains(hit_x, hit_y)) continue;
+      update(grid_.index(hit_x, hit_y), hit_);
+      previous_x = hit_x;
+      previous_y = hit_y;
+    }
+  }
+}
+
+void OccupancyGrid::setPose(double x, double y, double yaw) {
+  x_ = x;
+  y_ = y;
+  yaw_ = yaw;
+  grid_.center(static_cast<int64_t>(std::floor(x / cell_size_)),
+               static_cast<int64_t>(std::floor(y / cell_size_)));
+}
+
+void OccupancyGrid::clear() {
+  grid_.clear();
+}
+
+int16_t OccupancyGrid::logOdds(int64_t x, int64_t y) const {
+  return grid_.contains(x, y) ? grid_[grid_.index(x, y)] : 0;
+}
+
+void OccupancyGrid::copy(int16_t* grid) const {
+  const size_t size = grid_.size();
+  for (size_t row = 0; row < size; row++) {
+    for (size_t column = 0; column < size; column++) {
+      grid[row * size + column] = grid_.at(row, column);
+    }
+  }
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
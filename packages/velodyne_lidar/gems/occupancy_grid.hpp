@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "packages/velodyne_lidar/gems/output_products.hpp"
+#include "packages/velodyne_lidar/gems/rolling_grid.hpp"
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+// Parameters of an `OccupancyGrid`
+struct OccupancyGridOptions {
+  // Number of cells along each side of the grid. Needs to be a power of two.
+  size_t cells = 512;
+  // Length of a side of a cell in meters
+  double cell_size = 0.1;
+  // Beams whose vertical angle in radians is within this band are cast into the grid
+  double minimum_angle = -0.035;
+  double maximum_angle = 0.035;
+  // Changes of the log-odds of a cell in which a ray ended and of a cell which a ray passed, in
+  // units of 0.01
+  int16_t hit = 85;
+  int16_t miss = -40;
+  // The log-odds of every cell are clamped to this range
+  int16_t minimum = -200;
+  int16_t maximum = 350;
+};
+
+// A robot-centric occupancy grid with fixed memory which is updated with every chunk of decoded
+// columns. Every column is cast as a single ray with integer Bresenham steps since all its beams
+// share the same horizontal angle. The cells up to the closest return of the column are free and
+// the cells of all returns are occupied. The cells between the returns of a column are left
+// untouched since some beams passed them while others did not.
+//
+// The grid rolls with the sensor: cells are stored in world coordinates modulo the size of the
+// grid, thus moving the sensor only clears the cells which enter the window. The log-odds persist
+// across scans.
+class OccupancyGrid : public ProductWriter {
+ public:
+  // The vertical angles of the sensor need to be known
+  OccupancyGrid(const VelodyneLidarParameters& parameters, const OccupancyGridOptions& options);
+
+  // Keeps the grid since it integrates all scans
+  void begin() override {}
+  void write(const uint16_t* ranges, const uint8_t* intensities, const double* thetas,
+             size_t count) override;
+
+  // Sets the pose of the sensor in the world frame in meters and radians. The window is moved
+  // such that the sensor is in its center cell, and cells which enter the window are unknown.
+  void setPose(double x, double y, double yaw);
+  // Sets the log-odds of all cells to zero
+  void clear();
+
+  // Number of cells along each side of the grid
+  size_t cells() const { return grid_.size(); }
+  double cellSize() const { return cell_size_; }
+  // World coordinates in cells of the cell in the lower left corner of the window
+  int64_t originX() const { return grid_.originX(); }
+  int64_t originY() const { return grid_.originY(); }
+  // Number of beams which are cast into the grid
+  size_t beams() const { return beams_.size(); }
+  // Log-odds in units of 0.01 of the cell with the given world coordinates in cells, or zero if
+  // it is outside of the window
+  int16_t logOdds(int64_t x, int64_t y) const;
+  // Copies the window into `grid` with `cells() * cells()` entries, row by row starting at the
+  // origin
+  void copy(int16_t* grid) const;
+
+ private:
+  // Adds `delta` to the log-odds of a cell within the window
+  void update(size_t index, int16_t delta) {
+    const int value = grid_[index] + delta;
+    grid_[index] = static_cast<int16_t>(value < minimum_ ? minimum_
+                                                         : (value > maximum_ ? maximum_ : value));
+  }
+
+  size_t vertical_beams_;
+  double cell_size_;
+  int16_t hit_;
+  int16_t miss_;
+  int16_t minimum_;
+  int16_t maximum_;
+  // Indices of the beams which are cast and the cosine of their vertical angle
+  std::vector<uint32_t> beams_;
+  std::vector<double> cos_phis_;
+  double distance_resolution_;
+  RollingGrid<int16_t> grid_;
+  // Pose of the sensor in the world frame in meters and radians
+  double x_;
+  double y_;
+  double yaw_;
+  // Horizontal distances in cells of the returns of the current column
+  std::vector<double> distances_;
+};
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
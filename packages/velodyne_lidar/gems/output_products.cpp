@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "output_products.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "engine/core/assert.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+void OutputEngine::begin() {
+  processed_ = 0;
+  for (ProductWriter* writer : writers_) {
+    writer->begin();
+  }
+}
+
+void OutputEngine::update(const ColumnBuffers& buffers, size_t columns, int64_t timestamp) {
+  while (processed_ < columns) {
+    const uint16_t* ranges = buffers.ranges + processed_ * beams_;
+    const uint8_t* intensities = buffers.intensities + processed_ * beams_;
+    const double* thetas = buffers.thetas + processed_;
+    if (has_previous_theta_ && StartsRevolution(previous_theta_, thetas[0])) {
+      for (ProductWriter* writer : writers_) {
+        writer->endRevolution(timestamp);
+      }
+      revolutions_++;
+    }
+    // The chunk ends before the first column of the next revolution
+    const size_t limit = std::min(kChunkColumns, columns - processed_);
+    size_t count = 1;
+    while (count < limit && !StartsRevolution(thetas[count - 1], thetas[count])) {
+      count++;
+    }
+    for (ProductWriter* writer : writers_) {
+      writer->write(ranges, intensities, thetas, count);
+    }
+    previous_theta_ = thetas[count - 1];
+    has_previous_theta_ = true;
+    processed_ += count;
+  }
+}
+
+FlatscanWriter::FlatscanWriter(const VelodyneLidarParameters& parameters, double minimum_angle,
+                               double maximum_angle)
+    : vertical_beams_(parameters.vertical_beams),
+      distance_resolution_(static_cast<float>(parameters.distance_resolution)),
+      maximum_range_(static_cast<float>(parameters.maximum_range)) {
+  ASSERT(parameters.vertical_angles.size() == parameters.vertical_beams,
+         "The vertical angles of the sensor are not known");
+  for (uint32_t i = 0; i < parameters.vertical_beams; i++) {
+    const double angle = parameters.vertical_angles[i];
+    if (angle >= minimum_angle && angle <= maximum_angle) {
+      beams_.push_back(i);
+    }
+  }
+}
+
+void FlatscanWriter::begin() {
+  angles_.clear();
+  ranges_.clear();
+}
+
+void FlatscanWriter::write(const uint16_t* ranges, const uint8_t*, const double* thetas,
+                           size_t count) {
+  if (beams_.empty()) {
+    return;
+  }
+  for (size_t i = 0; i < count; i++) {
+    const uint16_t* column = ranges + i * vertical_beams_;
+    // Invalid returns are zero and wrap around to the largest value
+    uint16_t closest = 0xffff;
+    for (uint32_t beam : beams_) {
+      closest = std::min<uint16_t>(closest, column[beam] - 1);
+    }
+    angles_.push_back(static_cast<float>(thetas[i]));
+    ranges_.push_back(closest == 0xffff ? maximum_range_ : (closest + 1) * distance_resolution_);
+  }
+}
+
+PointCloudWriter::PointCloudWriter(const VelodyneLidarParameters& parameters,
+                                   const PointCloudOptions& options)
+    : vertical_beams_(parameters.vertical_beams),
+      options_(options),
+      distance_resolution_(static_cast<float>(parameters.distance_resolution)),
+      filter_(options.region),
+      column_(0) {
+  ASSERT(parameters.vertical_angles.size() == parameters.vertical_beams,
+         "The vertical angles of the sensor are not known");
+  options_.column_stride = std::max<size_t>(1, options_.column_stride);
+  options_.beam_stride = std::max<size_t>(1, options_.beam_stride);
+  for (uint32_t i = 0; i < parameters.vertical_beams; i += options_.beam_stride) {
+    beams_.push_back(i);
+    cos_phis_.push_back(static_cast<float>(std::cos(parameters.vertical_angles[i])));
+    sin_phis_.push_back(static_cast<float>(std::sin(parameters.vertical_angles[i])));
+  }
+}
+
+void PointCloudWriter::begin() {
+  column_ = 0;
+  positions_.clear();
+  intensities_.clear();
+}
+
+void PointCloudWriter::write(const uint16_t* ranges, const uint8_t* intensities,
+                             const double* thetas, size_t count) {
+  // The stride continues across chunks
+  size_t i = (options_.column_stride - column_ % options_.column_stride) % options_.column_stride;
+  column_ += count;
+  // Room for all points of the chunk which is trimmed to the valid ones afterwards
+  size_t size = intensities_.size();
+  const size_t capacity = size + (count / options_.column_stride + 1) * beams_.size();
+  positions_.resize(3 * capacity);
+  intensities_.resize(capacity);
+  float* positions = positions_.data();
+  float* normalized_intensities = intensities_.data();
+  if (filter_.empty()) {
+    for (; i < count; i += options_.column_stride) {
+      const uint16_t* column_ranges = ranges + i * vertical_beams_;
+      const uint8_t* column_intensities = intensities + i * vertical_beams_;
+      const float theta = static_cast<float>(thetas[i]);
+      const float cos_theta = std::cos(theta);
+      const float sin_theta = std::sin(theta);
+      for (size_t j = 0; j < beams_.size(); j++) {
+        const uint16_t range = column_ranges[beams_[j]];
+        if (range == 0) continue;
+        const float distance = range * distance_resolution_;
+        const float horizontal = distance * cos_phis_[j];
+        positions[3 * size] = horizontal * cos_theta;
+        positions[3 * size + 1] = horizontal * sin_theta;
+        positions[3 * size + 2] = distance * sin_phis_[j];
+        normalized_intensities[size] = column_intensities[beams_[j]] * (1.0f / 255.0f);
+        size++;
+      }
+    }
+    positions_.resize(3 * size);
+    intensities_.resize(size);
+    return;
+  }
+
+  // Every point is written to the end of the cloud but only those inside the region advance it,
+  // thus the next point overwrites one which is outside
+  for (; i < count; i += options_.column_stride) {
+    const uint16_t* column_ranges = ranges + i * vertical_beams_;
+    const uint8_t* column_intensities = intensities + i * vertical_beams_;
+    const float theta = static_cast<float>(thetas[i]);
+    const float cos_theta = std::cos(theta);
+    const float sin_theta = std::sin(theta);
+    for (size_t j = 0; j < beams_.size(); j++) {
+      const uint16_t range = column_ranges[beams_[j]];
+      if (range == 0) continue;
+      const float distance = range * distance_resolution_;
+      const float horizontal = distance * cos_phis_[j];
+      const float x = horizontal * cos_theta;
+      const float y = horizontal * sin_theta;
+      const float z = distance * sin_phis_[j];
+      const uint8_t inside = filter_.contains(x, y, z);
+      positions[3 * size] = x;
+      positions[3 * size + 1] = y;
+      positions[3 * size + 2] = z;
+      normalized_intensities[size] = column_intensities[beams_[j]] * (1.0f / 255.0f);
+      size += inside;
+    }
+  }
+  positions_.resize(3 * size);
+  intensities_.resize(size);
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "packages/velodyne_lidar/gems/decoder.hpp"
+#include "packages/velodyne_lidar/gems/region_of_interest.hpp"
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+// Computes an output product, for example a flat scan or a point cloud, from the decoded columns
+// of a scan. Writers see every column exactly once in small chunks of consecutive columns. Chunks
+// never span two revolutions of the sensor.
+class ProductWriter {
+ public:
+  virtual ~ProductWriter() = default;
+
+  // Discards the product of the previous scan
+  virtual void begin() = 0;
+  // Adds `count` consecutive columns with the layout of `ColumnBuffers`
+  virtual void write(const uint16_t* ranges, const uint8_t* intensities, const double* thetas,
+                     size_t count) = 0;
+  // Called after the last column of a revolution was written and before the first column of the
+  // next revolution is written. Products which span scans complete their revolution here.
+  // `timestamp` is the acquisition time of the update of the engine in which it completed.
+  virtual void endRevolution(int64_t /*timestamp*/) {}
+};
+
+// Hands the columns of the decoder to several product writers while they are still in the cache.
+// All products are computed in a single pass over the column buffers which the decoder shares
+// with the range image, instead of every consumer reading the full scan again.
+class OutputEngine {
+ public:
+  // Number of columns which are handed to all writers before moving on to the next columns
+  static constexpr size_t kChunkColumns = 32;
+
+  explicit OutputEngine(size_t vertical_beams) : beams_(vertical_beams) {}
+
+  // Adds a writer which needs to outlive the engine
+  void add(ProductWriter* writer) { writers_.push_back(writer); }
+  // True if there is at least one writer
+  bool empty() const { return writers_.empty(); }
+
+  // Starts a new scan. Revolutions span scans.
+  void begin();
+  // Hands the columns of `buffers` which were decoded since the last call to all writers. The
+  // first `columns` columns of the buffers are decoded. Calls `endRevolution` of all writers
+  // between the columns of two revolutions with the acquisition time `timestamp` of the columns.
+  void update(const ColumnBuffers& buffers, size_t columns, int64_t timestamp);
+  // Number of columns of the current scan which were handed to the writers
+  size_t columns() const { return processed_; }
+  // Number of revolutions which were completed
+  uint64_t revolutions() const { return revolutions_; }
+
+ private:
+  size_t beams_;
+  std::vector<ProductWriter*> writers_;
+  size_t processed_ = 0;
+  // Angle of the last column which was handed to the writers
+  double previous_theta_ = 0.0;
+  bool has_previous_theta_ = false;
+  uint64_t revolutions_ = 0;
+};
+
+// A planar scan made of the closest return of the beams whose vertical angle is within the given
+// band, for example for navigation. Columns without a return are reported at the maximum range.
+class FlatscanWriter : public ProductWriter {
+ public:
+  // The angles are in radians
+  FlatscanWriter(const VelodyneLidarParameters& parameters, double minimum_angle,
+                 double maximum_angle);
+
+  void begin() override;
+  void write(const uint16_t* ranges, const uint8_t* intensities, const double* thetas,
+             size_t count) override;
+
+  // Number of beams in the band. The flat scan is empty if there are none.
+  size_t beams() const { return beams_.size(); }
+  // Horizontal angle in radians and range in meters of every column
+  const std::vector<float>& angles() const { return angles_; }
+  const std::vector<float>& ranges() const { return ranges_; }
+
+ private:
+  size_t vertical_beams_;
+  // Indices of the beams in the band
+  std::vector<uint32_t> beams_;
+  float distance_resolution_;
+  float maximum_range_;
+  std::vector<float> angles_;
+  std::vector<float> ranges_;
+};
+
+// A point cloud which keeps every n-th column and every m-th beam, for example for mapping
+struct PointCloudOptions {
+  size_t column_stride = 1;
+  size_t beam_stride = 1;
+  // Points outside of this region are dropped before they are written to the cloud
+  RegionOfInterest region;
+};
+
+class PointCloudWriter : public ProductWriter {
+ public:
+  PointCloudWriter(const VelodyneLidarParameters& parameters, const PointCloudOptions& options);
+
+  void begin() override;
+  void write(const uint16_t* ranges, const uint8_t* intensities, const double* thetas,
+             size_t count) override;
+
+  // Number of points in the cloud
+  size_t size() const { return intensities_.size(); }
+  // Positions in meters with x, y and z of every point stored one after another
+  const std::vector<float>& positions() const { return positions_; }
+  // Intensities normalized to [0, 1]
+  const std::vector<float>& intensities() const { return intensities_; }
+
+ private:
+  size_t vertical_beams_;
+  PointCloudOptions options_;
+  // Beams which are kept together with their vertical direction
+  std::vector<uint32_t> beams_;
+  std::vector<float> cos_phis_;
+  std::vector<float> sin_phis_;
+  float distance_resolution_;
+  RegionFilter filter_;
+  // Column of the scan which the next call to `write` starts with
+  size_t column_;
+  std::vector<float> positions_;
+  std::vector<float> intensities_;
+};
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "packet_encoder.hpp"
+
+#include <cmath>
+#include <cstring>
+
+#include "packages/velodyne_lidar/gems/decoder.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+constexpr double kPi = 3.14159265358979323846;
+constexpr int64_t kNanosecondsPerMicrosecond = 1'000;
+constexpr int64_t kMicrosecondsPerHour = 3'600'000'000;
+// Azimuths are transmitted in hundredths of a degree
+constexpr int kAzimuthUnitsPerTurn = 36000;
+
+// Converts an angle with the convention of the decoder into the azimuth stored in a data block
+uint16_t ToAzimuth(double theta) {
+  const int azimuth = static_cast<int>(std::lround(-theta * (18000.0 / kPi)));
+  int wrapped = azimuth % kAzimuthUnitsPerTurn;
+  if (wrapped < 0) wrapped += kAzimuthUnitsPerTurn;
+  return static_cast<uint16_t>(wrapped);
+}
+}  // namespace
+
+PacketEncoder::PacketEncoder(const VelodyneLidarParameters& parameters)
+    : parameters_(parameters) {
+  firings_per_block_ = FiringsPerBlock(parameters_);
+  blocks_per_column_ = BlocksPerColumn(parameters_);
+  columns_per_packet_ = ColumnsPerPacket(parameters_);
+  packet_.resize(parameters_.packet_sans_header_size);
+  reset();
+}
+
+bool PacketEncoder::addColumn(double theta, const uint16_t* ranges, const uint8_t* intensities,
+                              int64_t timestamp) {
+  const size_t bank_beams = parameters_.vertical_beams / blocks_per_column_;
+  const size_t group = column_ / firings_per_block_;
+  const size_t firing = column_ % firings_per_block_;
+  uint8_t* group_data = packet_.data() + group * blocks_per_column_ * parameters_.block_size;
+
+  if (column_ == 0) {
+    // The sensor stamps a packet with the time of its first firing in microseconds since the
+    // top of the hour, followed by the return mode and the product ID.
+    const uint32_t stamp =
+        static_cast<uint32_t>((timestamp / kNanosecondsPerMicrosecond) % kMicrosecondsPerHour);
+    uint8_t* factory = packet_.data() + parameters_.blocks_per_packet * parameters_.block_size;
+    std::memcpy(factory, &stamp, sizeof(stamp));
+    factory[4] = kVelodyneModeStrong;
+    factory[5] = parameters_.product_id;
+  }
+
+  for (size_t b = 0; b < blocks_per_column_; b++) {
+    auto& block = *reinterpret_cast<VelodyneRawDataBlock*>(group_data + b * parameters_.block_size);
+    if (firing == 0) {
+      block.dataBlockFlag = kBankBlockFlags[b];
+      block.azimuth = ToAzimuth(theta);
+    }
+    VelodyneRawChannel* channels = block.channels + firing * bank_beams;
+    for (size_t i = 0; i < bank_beams; i++) {
+      channels[i].distance = ranges[b * bank_beams + i];
+      channels[i].reflectivity = intensities[b * bank_beams + i];
+    }
+  }
+
+  column_++;
+  if (column_ < columns_per_packet_) {
+    return false;
+  }
+  column_ = 0;
+  return true;
+}
+
+void PacketEncoder::reset() {
+  column_ = 0;
+  std::memset(packet_.data(), 0, packet_.size());
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+// Encodes columns of measurements into data packets with the same layout as the packets sent by
+// the sensor. This is the inverse of `Decoder` and allows feeding simulated or recorded data
+// through the real network path and driver.
+//
+// Only the first firing of every data block carries an azimuth in the packet format. The angles
+// of the other firings are dropped and the decoder interpolates them as it does for real data.
+class PacketEncoder {
+ public:
+  explicit PacketEncoder(const VelodyneLidarParameters& parameters);
+
+  // Adds a column to the current packet. `ranges` and `intensities` hold one value per vertical
+  // beam in multiples of the distance resolution and as reflectivity respectively. `theta` uses
+  // the same convention as the decoder. `timestamp` is the time at which the column was fired in
+  // nanoseconds since the epoch. Returns true if the column completed a packet, which stays
+  // available via `packet` until the next column is added.
+  bool addColumn(double theta, const uint16_t* ranges, const uint8_t* intensities,
+                 int64_t timestamp);
+  // Discards the columns of the current packet
+  void reset();
+
+  // The payload of the most recently completed packet
+  const uint8_t* packet() const { return packet_.data(); }
+  // Size of a packet payload in bytes
+  size_t packetSize() const { return packet_.size(); }
+  // Number of columns in a single packet
+  size_t columnsPerPacket() const { return columns_per_packet_; }
+  // Parameters of the sensor model
+  const VelodyneLidarParameters& parameters() const { return parameters_; }
+
+ private:
+  VelodyneLidarParameters parameters_;
+  size_t firings_per_block_;
+  size_t blocks_per_column_;
+  size_t columns_per_packet_;
+  std::vector<uint8_t> packet_;
+  // Index of the next column within the current packet
+  size_t column_;
+};
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
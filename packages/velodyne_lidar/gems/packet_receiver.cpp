@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "packet_receiver.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+constexpr int64_t kNanosecondsPerSecond = 1'000'000'000;
+constexpr int kSocketReceiveBufferSize = static_cast<int>(PacketReceiver::kRequestedBufferSize);
+
+int64_t ToNanoseconds(const timespec& time) {
+  return static_cast<int64_t>(time.tv_sec) * kNanosecondsPerSecond + time.tv_nsec;
+}
+}  // namespace
+
+PacketReceiver::~PacketReceiver() {
+  close();
+}
+
+bool PacketReceiver::open(const std::string& ip, int port) {
+  close();
+  source_address_ = 0;
+  if (!ip.empty()) {
+    in_addr address;
+    if (inet_pton(AF_INET, ip.c_str(), &address) != 1) {
+      errno = EINVAL;
+      return false;
+    }
+    source_address_ = address.s_addr;
+  }
+
+  fd_ = ::socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd_ < 0) {
+    return false;
+  }
+  const int enable = 1;
+  ::setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+  // The kernel caps the buffer at net.core.rmem_max, so read back what we actually got.
+  ::setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &kSocketReceiveBufferSize,
+               sizeof(kSocketReceiveBufferSize));
+  int buffer_size = 0;
+  socklen_t option_size = sizeof(buffer_size);
+  if (::getsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &buffer_size, &option_size) < 0) {
+    buffer_size = 0;
+  }
+  // Linux reports twice the usable size to account for its bookkeeping overhead.
+  receive_buffer_size_ = static_cast<size_t>(buffer_size) / 2;
+  // Without kernel timestamps we fall back to the time at which the packet was read.
+  kernel_timestamps_ =
+      ::setsockopt(fd_, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)) == 0;
+  // Reports the number of packets dropped by the kernel with every packet
+  ::setsockopt(fd_, SOL_SOCKET, SO_RXQ_OVFL, &enable, sizeof(enable));
+  kernel_drops_ = 0;
+  truncated_packets_ = 0;
+
+  sockaddr_in local{};
+  local.sin_family = AF_INET;
+  local.sin_addr.s_addr = htonl(INADDR_ANY);
+  local.sin_port = htons(static_cast<uint16_t>(port));
+  if (::bind(fd_, reinterpret_cast<sockaddr*>(&local), sizeof(local)) < 0) {
+    const int error = errno;
+    close();
+    errno = error;
+    return false;
+  }
+  return true;
+}
+
+void PacketReceiver::close() {
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+}
+
+PacketReceiver::Status PacketReceiver::receive(byte* buffer, size_t size, int64_t timeout_ns,
+                                               size_t& received, int64_t& timestamp_ns) {
+  if (fd_ < 0) {
+    errno = EBADF;
+    return Status::kError;
+  }
+  const int64_t deadline = timeout_ns < 0 ? -1 : NowNs() + timeout_ns;
+  while (true) {
+    pollfd descriptor{fd_, POLLIN, 0};
+    timespec timeout;
+    timespec* timeout_ptr = nullptr;
+    if (deadline >= 0) {
+      const int64_t remaining = deadline > NowNs() ? deadline - NowNs() : 0;
+      timeout.tv_sec = remaining / kNanosecondsPerSecond;
+      timeout.tv_nsec = remaining % kNanosecondsPerSecond;
+      timeout_ptr = &timeout;
+    }
+    const int ready = ::ppoll(&descriptor, 1, timeout_ptr, nullptr);
+    if (ready < 0) {
+      if (errno == EINTR) continue;
+      return Status::kError;
+    }
+    if (ready == 0) {
+      return Status::kTimeout;
+    }
+
+    sockaddr_in source{};
+    iovec io{buffer, size};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(timespec)) + CMSG_SPACE(sizeof(uint32_t))];
+    msghdr message{};
+    message.msg_name = &source;
+    message.msg_namelen = sizeof(source);
+    message.msg_iov = &io;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    const ssize_t length = ::recvmsg(fd_, &message, MSG_DONTWAIT);
+    if (length < 0) {
+      if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) continue;
+      return Status::kError;
+    }
+    if (source_address_ != 0 && source.sin_addr.s_addr != source_address_) {
+      continue;
+    }
+    // The datagram did not fit into the buffer and the remainder was discarded by the kernel
+    if (message.msg_flags & MSG_TRUNC) {
+      truncated_packets_++;
+      continue;
+    }
+
+    timestamp_ns = -1;
+    for (cmsghdr* header = CMSG_FIRSTHDR(&message); header != nullptr;
+         header = CMSG_NXTHDR(&message, header)) {
+      if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_TIMESTAMPNS) {
+        timespec stamp;
+        std::memcpy(&stamp, CMSG_DATA(header), sizeof(stamp));
+        timestamp_ns = ToNanoseconds(stamp);
+      } else if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SO_RXQ_OVFL) {
+        std::memcpy(&kernel_drops_, CMSG_DATA(header), sizeof(kernel_drops_));
+      }
+    }
+    if (timestamp_ns < 0) {
+      timestamp_ns = NowNs();
+    }
+    received = static_cast<size_t>(length);
+    return Status::kSuccess;
+  }
+}
+
+int64_t PacketReceiver::NowNs() {
+  timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  return ToNanoseconds(now);
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "engine/core/byte.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+// Receives Velodyne UDP packets together with the time at which the kernel received them. Kernel
+// receive timestamps are taken on the CLOCK_REALTIME time base and are reported in nanoseconds.
+class PacketReceiver {
+ public:
+  // Result of a call to `receive`
+  enum class Status {
+    kSuccess,  // A packet was received
+    kTimeout,  // No packet arrived before the timeout expired
+    kError     // The socket reported an error, check errno for details
+  };
+
+  PacketReceiver() = default;
+  ~PacketReceiver();
+
+  PacketReceiver(const PacketReceiver&) = delete;
+  PacketReceiver& operator=(const PacketReceiver&) = delete;
+
+  // Opens a UDP socket listening on the given port. If `ip` is not empty only packets sent from
+  // that address are accepted. Returns false on failure in which case errno is set.
+  bool open(const std::string& ip, int port);
+  // Closes the socket. It is safe to call this function multiple times.
+  void close();
+
+  // Waits for the next packet for at most `timeout_ns` nanoseconds and copies its payload into
+  // `buffer`. Packets larger than `size` bytes are dropped and counted as truncated. A negative
+  // timeout waits forever. On success `received` holds the number of bytes written and
+  // `timestamp_ns` the kernel receive time of the packet.
+  Status receive(byte* buffer, size_t size, int64_t timeout_ns, size_t& received,
+                 int64_t& timestamp_ns);
+
+  // Number of packets which the kernel dropped because the receive buffer was full
+  uint32_t kernelDrops() const { return kernel_drops_; }
+  // Number of packets which were dropped because they did not fit into the receive buffer
+  uint64_t truncatedPackets() const { return truncated_packets_; }
+  // True if the kernel stamps packets on arrival. Otherwise packets are stamped when read.
+  bool kernelTimestamps() const { return kernel_timestamps_; }
+  // Size of the socket receive buffer which the kernel granted in bytes
+  size_t receiveBufferSize() const { return receive_buffer_size_; }
+  // Size of the receive buffer requested from the kernel in bytes. Large enough to absorb a few
+  // hundred milliseconds of packets while the driver is busy publishing.
+  static constexpr size_t kRequestedBufferSize = 4 * 1024 * 1024;
+
+  // The current time on the same time base as the kernel receive timestamps
+  static int64_t NowNs();
+
+ private:
+  int fd_ = -1;
+  uint32_t kernel_drops_ = 0;
+  uint64_t truncated_packets_ = 0;
+  bool kernel_timestamps_ = false;
+  size_t receive_buffer_size_ = 0;
+  // Source address filter in network byte order, or 0 to accept packets from any sender
+  uint32_t source_address_ = 0;
+};
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "packet_sender.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+// Size of the send buffer requested from the kernel
+constexpr int kSocketSendBufferSize = 4 * 1024 * 1024;
+}  // namespace
+
+PacketSender::~PacketSender() {
+  close();
+}
+
+bool PacketSender::open(const std::string& ip, int port) {
+  close();
+  sockaddr_in destination{};
+  destination.sin_family = AF_INET;
+  destination.sin_port = htons(static_cast<uint16_t>(port));
+  if (inet_pton(AF_INET, ip.c_str(), &destination.sin_addr) != 1) {
+    errno = EINVAL;
+    return false;
+  }
+
+  fd_ = ::socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd_ < 0) {
+    return false;
+  }
+  ::setsockopt(fd_, SOL_SOCKET, SO_SNDBUF, &kSocketSendBufferSize, sizeof(kSocketSendBufferSize));
+  // Connecting fixes the destination so that packets can be sent without an address
+  if (::connect(fd_, reinterpret_cast<sockaddr*>(&destination), sizeof(destination)) < 0) {
+    const int error = errno;
+    close();
+    errno = error;
+    return false;
+  }
+  return true;
+}
+
+void PacketSender::close() {
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+}
+
+int PacketSender::send(const uint8_t* packets, size_t size, size_t count) {
+  if (fd_ < 0) {
+    errno = EBADF;
+    return -1;
+  }
+  headers_.resize(count * (sizeof(mmsghdr) + sizeof(iovec)));
+  mmsghdr* messages = reinterpret_cast<mmsghdr*>(headers_.data());
+  iovec* ios = reinterpret_cast<iovec*>(headers_.data() + count * sizeof(mmsghdr));
+  for (size_t i = 0; i < count; i++) {
+    ios[i].iov_base = const_cast<uint8_t*>(packets + i * size);
+    ios[i].iov_len = size;
+    std::memset(&messages[i], 0, sizeof(mmsghdr));
+    messages[i].msg_hdr.msg_iov = &ios[i];
+    messages[i].msg_hdr.msg_iovlen = 1;
+  }
+  size_t sent = 0;
+  while (sent < count) {
+    const int result = ::sendmmsg(fd_, messages + sent, count - sent, 0);
+    if (result < 0) {
+      if (errno == EINTR) continue;
+      return sent > 0 ? static_cast<int>(sent) : -1;
+    }
+    sent += result;
+  }
+  return static_cast<int>(sent);
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
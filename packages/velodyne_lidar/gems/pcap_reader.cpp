@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "pcap_reader.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+constexpr uint32_t kMagicMicroseconds = 0xA1B2C3D4;
+constexpr uint32_t kMagicNanoseconds = 0xA1B23C4D;
+constexpr size_t kFileHeaderSize = 24;
+constexpr size_t kRecordHeaderSize = 16;
+constexpr uint32_t kLinkTypeEthernet = 1;
+constexpr uint32_t kLinkTypeRaw = 101;
+constexpr uint32_t kLinkTypeLinuxCooked = 113;
+constexpr uint16_t kEtherTypeIpv4 = 0x0800;
+constexpr uint16_t kEtherTypeVlan = 0x8100;
+constexpr uint8_t kProtocolUdp = 17;
+constexpr size_t kUdpHeaderSize = 8;
+
+// Network byte order is big endian
+uint16_t ReadBigEndian16(const uint8_t* data) {
+  return static_cast<uint16_t>((data[0] << 8) | data[1]);
+}
+
+uint32_t Swap32(uint32_t value) {
+  return ((value & 0xFF) << 24) | ((value & 0xFF00) << 8) | ((value >> 8) & 0xFF00) |
+         (value >> 24);
+}
+}  // namespace
+
+PcapReader::~PcapReader() {
+  close();
+}
+
+bool PcapReader::open(const std::string& filename) {
+  close();
+  const int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat info;
+  if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < kFileHeaderSize) {
+    ::close(fd);
+    return false;
+  }
+  void* data = ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+  ::madvise(data, info.st_size, MADV_SEQUENTIAL);
+  data_ = static_cast<const uint8_t*>(data);
+  size_ = info.st_size;
+
+  uint32_t magic;
+  std::memcpy(&magic, data_, sizeof(magic));
+  swapped_ = false;
+  if (magic == Swap32(kMagicMicroseconds) || magic == Swap32(kMagicNanoseconds)) {
+    swapped_ = true;
+    magic = Swap32(magic);
+  }
+  if (magic != kMagicMicroseconds && magic != kMagicNanoseconds) {
+    close();
+    return false;
+  }
+  nanoseconds_ = magic == kMagicNanoseconds;
+  link_type_ = read32(data_ + 20) & 0x0FFFFFFF;
+  if (link_type_ != kLinkTypeEthernet && link_type_ != kLinkTypeRaw &&
+      link_type_ != kLinkTypeLinuxCooked) {
+    close();
+    return false;
+  }
+  rewind();
+  return true;
+}
+
+void PcapReader::close() {
+  if (data_ != nullptr) {
+    ::munmap(const_cast<uint8_t*>(data_), size_);
+    data_ = nullptr;
+  }
+  size_ = 0;
+  offset_ = 0;
+}
+
+void PcapReader::rewind() {
+  offset_ = kFileHeaderSize;
+}
+
+bool PcapReader::next(UdpPacket& packet, uint16_t port) {
+  while (offset_ + kRecordHeaderSize <= size_) {
+    const uint8_t* record = data_ + offset_;
+    const uint32_t seconds = read32(record);
+    const uint32_t fraction = read32(record + 4);
+    const size_t captured = read32(record + 8);
+    offset_ += kRecordHeaderSize + captured;
+    if (offset_ > size_) {
+      // The last record was truncated
+      return false;
+    }
+    const uint8_t* frame = record + kRecordHeaderSize;
+    const uint8_t* end = frame + captured;
+
+    // Skip the link layer header
+    const uint8_t* ip = frame;
+    if (link_type_ == kLinkTypeEthernet || link_type_ == kLinkTypeLinuxCooked) {
+      const size_t type_offset = link_type_ == kLinkTypeEthernet ? 12 : 14;
+      if (frame + type_offset + 2 > end) continue;
+      uint16_t ether_type = ReadBigEndian16(frame + type_offset);
+      ip = frame + type_offset + 2;
+      if (ether_type == kEtherTypeVlan) {
+        if (ip + 4 > end) continue;
+        ether_type = ReadBigEndian16(ip + 2);
+        ip += 4;
+      }
+      if (ether_type != kEtherTypeIpv4) continue;
+    }
+
+    // IPv4 header
+    if (ip + 20 > end || (ip[0] >> 4) != 4 || ip[9] != kProtocolUdp) continue;
+    const size_t ip_header_size = (ip[0] & 0x0F) * 4;
+    const uint16_t fragment = ReadBigEndian16(ip + 6);
+    if ((fragment & 0x3FFF) != 0) continue;  // More fragments flag or a fragment offset
+    const uint8_t* udp = ip + ip_header_size;
+    if (udp + kUdpHeaderSize > end) continue;
+
+    // UDP header
+    const uint16_t destination_port = ReadBigEndian16(udp + 2);
+    if (port != 0 && destination_port != port) continue;
+    const size_t udp_size = ReadBigEndian16(udp + 4);
+    if (udp_size < kUdpHeaderSize || udp + udp_size > end) continue;
+
+    packet.payload = udp + kUdpHeaderSize;
+    packet.size = udp_size - kUdpHeaderSize;
+    packet.timestamp = static_cast<int64_t>(seconds) * 1'000'000'000 +
+                       static_cast<int64_t>(fraction) * (nanoseconds_ ? 1 : 1000);
+    packet.port = destination_port;
+    return true;
+  }
+  return false;
+}
+
+uint32_t PcapReader::read32(const uint8_t* data) const {
+  uint32_t value;
+  std::memcpy(&value, data, sizeof(value));
+  return swapped_ ? Swap32(value) : value;
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
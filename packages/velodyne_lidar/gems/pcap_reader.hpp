@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace isaac {
+namespace velodyne_lidar {
+
+// A UDP datagram read from a capture file
+struct UdpPacket {
+  // Payload of the datagram. Points into the memory mapped capture file.
+  const uint8_t* payload;
+  // Size of the payload in bytes
+  size_t size;
+  // Capture time in nanoseconds since the epoch
+  int64_t timestamp;
+  // Destination port of the datagram
+  uint16_t port;
+};
+
+// Reads UDP datagrams from a classic libpcap capture file like the ones recorded with tcpdump or
+// Wireshark. The file is memory mapped and payloads are returned without copying. Both
+// microsecond and nanosecond timestamp resolution as well as Ethernet, VLAN tagged Ethernet and
+// Linux cooked captures are supported. Fragmented IP packets are skipped.
+class PcapReader {
+ public:
+  PcapReader() = default;
+  ~PcapReader();
+
+  PcapReader(const PcapReader&) = delete;
+  PcapReader& operator=(const PcapReader&) = delete;
+
+  // Opens the given capture file. Returns false if the file can not be read or is not a capture.
+  bool open(const std::string& filename);
+  // Closes the capture file. Payloads returned earlier become invalid.
+  void close();
+
+  // Reads the next UDP datagram sent to the given port, or to any port if `port` is zero. Returns
+  // false at the end of the file.
+  bool next(UdpPacket& packet, uint16_t port = 0);
+  // Starts reading from the first record again
+  void rewind();
+
+ private:
+  // Reads a 32 bit integer from the file header or a record header
+  uint32_t read32(const uint8_t* data) const;
+
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+  size_t offset_ = 0;
+  bool swapped_ = false;
+  bool nanoseconds_ = false;
+  uint32_t link_type_ = 0;
+};
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
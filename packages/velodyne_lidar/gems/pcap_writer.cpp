@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "pcap_writer.hpp"
+
+#include <cstring>
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+constexpr uint32_t kMagicNanoseconds = 0xA1B23C4D;
+constexpr uint16_t kVersionMajor = 2;
+constexpr uint16_t kVersionMinor = 4;
+constexpr uint32_t kSnapLength = 65535;
+constexpr uint32_t kLinkTypeEthernet = 1;
+constexpr size_t kEthernetHeaderSize = 14;
+constexpr size_t kIpHeaderSize = 20;
+constexpr size_t kUdpHeaderSize = 8;
+constexpr size_t kHeadersSize = kEthernetHeaderSize + kIpHeaderSize + kUdpHeaderSize;
+constexpr uint16_t kEtherTypeIpv4 = 0x0800;
+constexpr uint8_t kProtocolUdp = 17;
+constexpr uint8_t kTimeToLive = 64;
+constexpr int64_t kNanosecondsPerSecond = 1'000'000'000;
+
+// Network byte order is big endian
+void WriteBigEndian16(uint16_t value, uint8_t* data) {
+  data[0] = static_cast<uint8_t>(value >> 8);
+  data[1] = static_cast<uint8_t>(value);
+}
+
+void WriteBigEndian32(uint32_t value, uint8_t* data) {
+  WriteBigEndian16(static_cast<uint16_t>(value >> 16), data);
+  WriteBigEndian16(static_cast<uint16_t>(value), data + 2);
+}
+
+// The one's complement checksum of an IPv4 header
+uint16_t IpChecksum(const uint8_t* header) {
+  uint32_t sum = 0;
+  for (size_t i = 0; i < kIpHeaderSize; i += 2) {
+    sum += (header[i] << 8) | header[i + 1];
+  }
+  while (sum >> 16) {
+    sum = (sum & 0xFFFF) + (sum >> 16);
+  }
+  return static_cast<uint16_t>(~sum);
+}
+}  // namespace
+
+PcapWriter::~PcapWriter() {
+  close();
+}
+
+bool PcapWriter::open(const std::string& filename) {
+  close();
+  file_ = std::fopen(filename.c_str(), "wb");
+  if (file_ == nullptr) {
+    return false;
+  }
+  // The file header is written in host byte order which readers detect from the magic number
+  uint8_t header[24] = {};
+  const uint32_t magic = kMagicNanoseconds;
+  std::memcpy(header, &magic, 4);
+  std::memcpy(header + 4, &kVersionMajor, 2);
+  std::memcpy(header + 6, &kVersionMinor, 2);
+  std::memcpy(header + 16, &kSnapLength, 4);
+  std::memcpy(header + 20, &kLinkTypeEthernet, 4);
+  if (std::fwrite(header, sizeof(header), 1, file_) != 1) {
+    close();
+    return false;
+  }
+  ip_id_ = 0;
+  return true;
+}
+
+void PcapWriter::close() {
+  if (file_ != nullptr) {
+    std::fclose(file_);
+    file_ = nullptr;
+  }
+}
+
+bool PcapWriter::write(const uint8_t* payload, size_t size, int64_t timestamp, uint16_t port,
+                       uint32_t source_ip) {
+  if (file_ == nullptr || size + kHeadersSize > kSnapLength) {
+    return false;
+  }
+  const uint32_t frame_size = static_cast<uint32_t>(size + kHeadersSize);
+  uint8_t record[16 + kHeadersSize] = {};
+  const uint32_t seconds = static_cast<uint32_t>(timestamp / kNanosecondsPerSecond);
+  const uint32_t nanoseconds = static_cast<uint32_t>(timestamp % kNanosecondsPerSecond);
+  std::memcpy(record, &seconds, 4);
+  std::memcpy(record + 4, &nanoseconds, 4);
+  std::memcpy(record + 8, &frame_size, 4);
+  std::memcpy(record + 12, &frame_size, 4);
+
+  // Ethernet header with a broadcast destination and a locally administered source address
+  uint8_t* ethernet = record + 16;
+  std::memset(ethernet, 0xFF, 6);
+  ethernet[6] = 0x02;
+  WriteBigEndian32(source_ip, ethernet + 8);
+  WriteBigEndian16(kEtherTypeIpv4, ethernet + 12);
+
+  uint8_t* ip = ethernet + kEthernetHeaderSize;
+  ip[0] = 0x45;  // Version 4 without options
+  WriteBigEndian16(static_cast<uint16_t>(size + kIpHeaderSize + kUdpHeaderSize), ip + 2);
+  WriteBigEndian16(ip_id_++, ip + 4);
+  ip[8] = kTimeToLive;
+  ip[9] = kProtocolUdp;
+  WriteBigEndian32(source_ip, ip + 12);
+  WriteBigEndian32(0xFFFFFFFF, ip + 16);
+  WriteBigEndian16(IpChecksum(ip), ip + 10);
+
+  // The UDP checksum is optional for IPv4 and left empty
+  uint8_t* udp = ip + kIpHeaderSize;
+  WriteBigEndian16(port, udp);
+  WriteBigEndian16(port, udp + 2);
+  WriteBigEndian16(static_cast<uint16_t>(size + kUdpHeaderSize), udp + 4);
+
+  return std::fwrite(record, sizeof(record), 1, file_) == 1 &&
+         std::fwrite(payload, size, 1, file_) == 1;
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace isaac {
+namespace velodyne_lidar {
+
+// Writes UDP datagrams into a classic libpcap capture file with nanosecond timestamps. Every
+// datagram is wrapped into Ethernet, IPv4 and UDP headers such that the capture can be inspected
+// with Wireshark and read back with `PcapReader`.
+class PcapWriter {
+ public:
+  PcapWriter() = default;
+  ~PcapWriter();
+
+  PcapWriter(const PcapWriter&) = delete;
+  PcapWriter& operator=(const PcapWriter&) = delete;
+
+  // Creates the given capture file and writes the file header. Returns false on failure in which
+  // case errno is set.
+  bool open(const std::string& filename);
+  // Flushes and closes the capture file. It is safe to call this function multiple times.
+  void close();
+
+  // Writes a datagram which was sent from `source_ip` to the broadcast address at `port`.
+  // `timestamp` is the capture time in nanoseconds since the epoch. Returns false on failure.
+  bool write(const uint8_t* payload, size_t size, int64_t timestamp, uint16_t port,
+             uint32_t source_ip);
+
+ private:
+  std::FILE* file_ = nullptr;
+  // Identification field of the next IPv4 header
+  uint16_t ip_id_ = 0;
+};
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "pillar_grid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#include "engine/core/assert.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+// The height of a cell without points
+constexpr float kEmptyHeight = -std::numeric_limits<float>::infinity();
+}  // namespace
+
+PillarGrid::PillarGrid(const VelodyneLidarParameters& parameters,
+                       const PillarGridOptions& options)
+    : vertical_beams_(parameters.vertical_beams),
+      distance_resolution_(static_cast<float>(parameters.distance_resolution)),
+      options_(options) {
+  ASSERT(options_.rows > 0 && options_.columns > 0, "The grid needs at least one cell");
+  ASSERT(options_.cell_size > 0.0, "The cell size needs to be positive: %f", options_.cell_size);
+  ASSERT(options_.maximum_height > options_.minimum_height, "The band of heights is empty");
+  ASSERT(parameters.vertical_angles.size() == parameters.vertical_beams,
+         "The vertical angles of the sensor are not known");
+  for (double angle : parameters.vertical_angles) {
+    cos_phis_.push_back(static_cast<float>(std::cos(angle)));
+    sin_phis_.push_back(static_cast<float>(std::sin(angle)));
+  }
+  options_.threads = std::max<size_t>(1, options_.threads);
+  options_.saturation_count = std::max<uint32_t>(2, options_.saturation_count);
+  for (Grids* grids : {&current_, &completed_}) {
+    grids->cells.resize(options_.threads);
+    for (std::vector<Cell>& grid : grids->cells) {
+      grid.resize(options_.rows * options_.columns, Cell{kEmptyHeight, 0, 0});
+    }
+    grids->dirty.resize(options_.threads, false);
+  }
+  revolutions_ = 0;
+  // The density is log(count + 1) / log(saturation_count) which saturates at the last entry
+  const double density_scale = 1.0 / std::log(static_cast<double>(options_.saturation_count));
+  for (uint32_t count = 0; count <= options_.saturation_count; count++) {
+    densities_.push_back(
+        static_cast<float>(std::min(1.0, std::log(count + 1.0) * density_scale)));
+  }
+}
+
+void PillarGrid::clear() {
+  for (size_t t = 0; t < current_.cells.size(); t++) {
+    if (current_.dirty[t]) {
+      std::fill(current_.cells[t].begin(), current_.cells[t].end(), Cell{kEmptyHeight, 0, 0});
+      current_.dirty[t] = false;
+    }
+  }
+}
+
+void PillarGrid::write(const uint16_t* ranges, const uint8_t* intensities, const double* thetas,
+                       size_t count) {
+  current_.dirty[0] = true;
+  scatter(ranges, intensities, thetas, count, current_.cells[0]);
+}
+
+void PillarGrid::endRevolution(int64_t /*timestamp*/) {
+  // The grids of the revolution before are cleared for the next one
+  std::swap(current_, completed_);
+  clear();
+  revolutions_++;
+}
+
+void PillarGrid::scatter(const uint16_t* ranges, const uint8_t* intensities, const double* thetas,
+                         size_t count, WorkerPool& pool) {
+  const size_t threads =
+      std::max<size_t>(1, std::min({pool.threads(), current_.cells.size(), count}));
+  std::fill(current_.dirty.begin(), current_.dirty.begin() + threads, true);
+  pool.run([&](size_t t) {
+    if (t >= threads) return;
+    const size_t first = t * count / threads;
+    const size_t last = (t + 1) * count / threads;
+    scatter(ranges + first * vertical_beams_, intensities + first * vertical_beams_,
+            thetas + first, last - first, current_.cells[t]);
+  });
+}
+
+void PillarGrid::scatter(const uint16_t* ranges, const uint8_t* intensities,
+                         const double* thetas, size_t count, std::vector<Cell>& grid) const {
+  const float scale = static_cast<float>(1.0 / options_.cell_size);
+  const float minimum_x = static_cast<float>(options_.minimum_x);
+  const float minimum_y = static_cast<float>(options_.minimum_y);
+  const float minimum_height = static_cast<float>(options_.minimum_height);
+  const float maximum_height = static_cast<float>(options_.maximum_height);
+  const size_t rows = options_.rows;
+  const size_t columns = options_.columns;
+  for (size_t c = 0; c < count; c++) {
+    const float theta = static_cast<float>(thetas[c]);
+    const float cos_theta = std::cos(theta);
+    const float sin_theta = std::sin(theta);
+    const uint16_t* column_ranges = ranges + c * vertical_beams_;
+    const uint8_t* column_intensities = intensities + c * vertical_beams_;
+    for (size_t j = 0; j < vertical_beams_; j++) {
+      if (column_ranges[j] == 0) continue;
+      const float distance = column_ranges[j] * distance_resolution_;
+      const float z = distance * sin_phis_[j];
+      if (z < minimum_height || z >= maximum_height) continue;
+      const float horizontal = distance * cos_phis_[j];
+      const int64_t row =
+          static_cast<int64_t>(std::floor((horizontal * cos_theta - minimum_x) * scale));
+      const int64_t column =
+          static_cast<int64_t>(std::floor((horizontal * sin_theta - minimum_y) * scale));
+      if (static_cast<uint64_t>(row) >= rows || static_cast<uint64_t>(column) >= columns) {
+        continue;
+      }
+      Cell& cell = grid[row * columns + column];
+      cell.height = std::max(cell.height, z);
+      cell.count++;
+      cell.intensity = std::max<uint32_t>(cell.intensity, column_intensities[j]);
+    }
+  }
+}
+
+void PillarGrid::merge(const Grids& all_grids, float* tensor) const {
+  const size_t cells = options_.rows * options_.columns;
+  std::vector<const Cell*> grids;
+  for (size_t t = 0; t < all_grids.cells.size(); t++) {
+    if (all_grids.dirty[t]) grids.push_back(all_grids.cells[t].data());
+  }
+  if (grids.empty()) {
+    std::fill_n(tensor, kChannels * cells, 0.0f);
+    return;
+  }
+  const float minimum_height = static_cast<float>(options_.minimum_height);
+  const float height_scale =
+      static_cast<float>(1.0 / (options_.maximum_height - options_.minimum_height));
+  const uint32_t saturation = options_.saturation_count;
+  float* heights = tensor;
+  float* densities = tensor + cells;
+  float* intensities = tensor + 2 * cells;
+  for (size_t i = 0; i < cells; i++) {
+    Cell merged = grids[0][i];
+    for (size_t t = 1; t < grids.size(); t++) {
+      const Cell& cell = grids[t][i];
+      merged.height = std::max(merged.height, cell.height);
+      merged.count += cell.count;
+      merged.intensity = std::max(merged.intensity, cell.intensity);
+    }
+    // Empty cells have no height and thus end up at zero without a branch
+    heights[i] = std::max(0.0f, (merged.height - minimum_height) * height_scale);
+    densities[i] = densities_[std::min(merged.count, saturation)];
+    intensities[i] = merged.intensity * (1.0f / 255.0f);
+  }
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "packages/velodyne_lidar/gems/output_products.hpp"
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+#include "packages/velodyne_lidar/gems/worker_pool.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+// Parameters of a `PillarGrid`. Coordinates are in meters in the frame of the sensor.
+struct PillarGridOptions {
+  // The grid covers [minimum_x, minimum_x + rows * cell_size) along x and
+  // [minimum_y, minimum_y + columns * cell_size) along y
+  size_t rows = 512;
+  size_t columns = 512;
+  double minimum_x = -51.2;
+  double minimum_y = -51.2;
+  double cell_size = 0.2;
+  // Points outside of this band of heights are ignored. The height channel is normalized to it.
+  double minimum_height = -3.0;
+  double maximum_height = 1.0;
+  // Number of points at which the density channel saturates
+  uint32_t saturation_count = 64;
+  // Maximum number of threads of a pool which `scatter` may use. Every thread has its own grid.
+  size_t threads = 1;
+};
+
+// A bird's-eye-view tensor for object detectors with three channels per cell: the maximum height,
+// the density of points and the maximum intensity. The cells are filled with every chunk of
+// decoded columns while the revolution is received. Once the sensor completes the revolution its
+// grids are kept aside and merged straight into the tensor which is published.
+//
+// Points are scattered into one grid per thread without any synchronization and the grids are
+// merged into the tensor. `write` uses the first grid and `scatter` splits the columns of a whole
+// revolution between the threads of a pool, for example for recorded scans.
+class PillarGrid : public ProductWriter {
+ public:
+  // Number of channels of the tensor
+  static constexpr size_t kChannels = 3;
+
+  // The vertical angles of the sensor need to be known
+  PillarGrid(const VelodyneLidarParameters& parameters, const PillarGridOptions& options);
+
+  // Revolutions span scans
+  void begin() override {}
+  void write(const uint16_t* ranges, const uint8_t* intensities, const double* thetas,
+             size_t count) override;
+  // Keeps the grids of the revolution for `mergeCompleted` and continues with cleared grids
+  void endRevolution(int64_t timestamp) override;
+  // Clears all grids of the current revolution
+  void clear();
+  // Scatters `count` columns with the threads of `pool`. At most `options.threads` threads are
+  // used.
+  void scatter(const uint16_t* ranges, const uint8_t* intensities, const double* thetas,
+               size_t count, WorkerPool& pool);
+
+  // Merges the grids into `tensor` with `kChannels * rows * columns` values in channel-major
+  // order. Rows are along x and columns along y. All channels are normalized to [0, 1]: the
+  // height to the band of heights, the density logarithmically up to `saturation_count` points
+  // and the intensity to 255. All channels of empty cells are zero.
+  void merge(float* tensor) const { merge(current_, tensor); }
+  // Merges the grids of the last completed revolution into `tensor` like `merge`
+  void mergeCompleted(float* tensor) const { merge(completed_, tensor); }
+
+  size_t rows() const { return options_.rows; }
+  size_t columns() const { return options_.columns; }
+  // Number of revolutions which were completed
+  uint64_t revolutions() const { return revolutions_; }
+
+ private:
+  // The state of a cell in one grid
+  struct Cell {
+    float height;
+    uint32_t count;
+    uint32_t intensity;
+  };
+
+  // One grid per thread
+  struct Grids {
+    std::vector<std::vector<Cell>> cells;
+    // Grids which may hold points
+    std::vector<bool> dirty;
+  };
+
+  // Adds the columns to one grid
+  void scatter(const uint16_t* ranges, const uint8_t* intensities, const double* thetas,
+               size_t count, std::vector<Cell>& grid) const;
+  void merge(const Grids& grids, float* tensor) const;
+
+  size_t vertical_beams_;
+  std::vector<float> cos_phis_;
+  std::vector<float> sin_phis_;
+  float distance_resolution_;
+  PillarGridOptions options_;
+  // The grids of the current and of the last completed revolution
+  Grids current_;
+  Grids completed_;
+  // The density channel for every number of points up to the saturation
+  std::vector<float> densities_;
+  uint64_t revolutions_;
+};
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "preview_budget.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+constexpr double kNanosecondsToSeconds = 1e-9;
+// Weight of a new measurement in the smoothed rates
+constexpr double kSmoothing = 0.1;
+// The decimation aims slightly below the budget so that the token bucket rarely runs empty
+constexpr double kHeadroom = 0.9;
+}  // namespace
+
+PreviewBudget::PreviewBudget(double bytes_per_second, double burst, int max_decimation)
+    : bytes_per_second_(std::max(1.0, bytes_per_second)),
+      capacity_(std::max(1.0, bytes_per_second * burst)),
+      largest_preview_(0.0),
+      max_decimation_(std::max(1, max_decimation)),
+      tokens_(capacity_),
+      last_time_(-1),
+      full_rate_(0.0),
+      ratio_(1.0),
+      last_full_time_(-1),
+      decimation_(1),
+      dropped_(0) {}
+
+int PreviewBudget::decimation(size_t full_bytes, int64_t time) {
+  if (last_full_time_ >= 0 && time > last_full_time_) {
+    const double rate = full_bytes / ((time - last_full_time_) * kNanosecondsToSeconds);
+    full_rate_ = full_rate_ == 0.0 ? rate : (1.0 - kSmoothing) * full_rate_ + kSmoothing * rate;
+  }
+  last_full_time_ = time;
+  if (full_rate_ > 0.0) {
+    const double required = full_rate_ * ratio_ / (kHeadroom * bytes_per_second_);
+    decimation_ = std::min(max_decimation_, std::max(1, static_cast<int>(std::ceil(required))));
+  }
+  return decimation_;
+}
+
+bool PreviewBudget::consume(size_t full_bytes, size_t preview_bytes, int64_t time) {
+  if (full_bytes > 0) {
+    const double ratio = static_cast<double>(preview_bytes) * decimation_ / full_bytes;
+    ratio_ = (1.0 - kSmoothing) * ratio_ + kSmoothing * ratio;
+  }
+  largest_preview_ = std::max(largest_preview_, static_cast<double>(preview_bytes));
+  refill(time);
+  if (tokens_ < preview_bytes) {
+    dropped_++;
+    return false;
+  }
+  tokens_ -= preview_bytes;
+  return true;
+}
+
+void PreviewBudget::refill(int64_t time) {
+  if (last_time_ >= 0 && time > last_time_) {
+    tokens_ = std::min(std::max(capacity_, largest_preview_),
+                       tokens_ + (time - last_time_) * kNanosecondsToSeconds * bytes_per_second_);
+  }
+  last_time_ = time;
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace isaac {
+namespace velodyne_lidar {
+
+// Keeps a stream of preview messages below a byte budget per second. The budget is enforced with
+// a token bucket while the decimation of the data is adapted so that messages rarely need to be
+// dropped: it follows the rate of the full data and how much the preview shrinks it.
+class PreviewBudget {
+ public:
+  // `bytes_per_second` is the budget, `burst` the time in seconds for which unused budget is
+  // saved up and `max_decimation` an upper bound for the decimation. The saved up budget always
+  // covers the largest preview seen so far, otherwise such a preview could never be published.
+  PreviewBudget(double bytes_per_second, double burst, int max_decimation);
+
+  // Decimation to use for a message with `full_bytes` bytes before decimation which arrives at
+  // `time` in nanoseconds
+  int decimation(size_t full_bytes, int64_t time);
+  // Reports that decimating a message with `full_bytes` bytes resulted in `preview_bytes` bytes.
+  // Returns true if the preview fits into the budget and should be published.
+  bool consume(size_t full_bytes, size_t preview_bytes, int64_t time);
+
+  // Number of previews which were dropped because the budget was exhausted
+  uint64_t dropped() const { return dropped_; }
+
+ private:
+  // Adds the budget accumulated since the last call
+  void refill(int64_t time);
+
+  double bytes_per_second_;
+  double capacity_;
+  // Size of the largest preview passed to consume
+  double largest_preview_;
+  int max_decimation_;
+  double tokens_;
+  int64_t last_time_;
+  // Smoothed rate of the full data in bytes per second and the ratio between preview bytes and
+  // full bytes after decimation
+  double full_rate_;
+  double ratio_;
+  int64_t last_full_time_;
+  int decimation_;
+  uint64_t dropped_;
+};
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
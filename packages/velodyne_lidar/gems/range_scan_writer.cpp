@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "range_scan_writer.hpp"
+
+#include <cmath>
+#include <utility>
+
+#include "engine/core/assert.hpp"
+#include "messages/tensor.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+constexpr double kSecondsToMicroseconds = 1e6;
+}  // namespace
+
+RangeScanWriter::RangeScanWriter(const VelodyneLidarParameters& parameters, size_t columns,
+                                 double* thetas)
+    : parameters_(parameters),
+      columns_(columns),
+      ranges_(columns, parameters.vertical_beams),
+      intensities_(columns, parameters.vertical_beams),
+      thetas_(thetas) {
+  ASSERT(parameters_.vertical_angles.size() == parameters_.vertical_beams,
+         "Expected %u vertical angles but got %zu", parameters_.vertical_beams,
+         parameters_.vertical_angles.size());
+}
+
+ColumnBuffers RangeScanWriter::buffers() {
+  ColumnBuffers buffers;
+  buffers.ranges = ranges_.element_wise_begin();
+  buffers.intensities = intensities_.element_wise_begin();
+  buffers.thetas = thetas_;
+  buffers.capacity = columns_;
+  return buffers;
+}
+
+void RangeScanWriter::write(size_t valid, ::RangeScanProto::Builder builder,
+                            std::vector<SharedBuffer>& buffers) {
+  builder.setRangeDenormalizer(parameters_.distance_resolution * 65535.0f);
+  builder.setIntensityDenormalizer(kMaxIntensity);
+  builder.setInvalidRangeThreshold(parameters_.minimum_range);
+  builder.setOutOfRangeThreshold(parameters_.maximum_range);
+  // Columns are fired at the firing cycle of the sensor model, as assumed by the decoder
+  builder.setDeltaTime(
+      static_cast<uint32_t>(std::lround(parameters_.firing_cycle * kSecondsToMicroseconds)));
+
+  // Prepares vertical angles
+  auto phi = builder.initPhi(parameters_.vertical_beams);
+  for (uint32_t i = 0; i < parameters_.vertical_beams; i++) {
+    phi.set(i, parameters_.vertical_angles[i]);
+  }
+
+  // Columns which did not arrive before the deadline are marked as invalid. Their angles are
+  // extrapolated from the last known rotation speed.
+  FillMissingColumns(valid, columns_, parameters_.vertical_beams, ranges_.element_wise_begin(),
+                     intensities_.element_wise_begin(), thetas_);
+  auto thetas = builder.initTheta(columns_);
+  for (size_t i = 0; i < columns_; i++) {
+    thetas.set(i, thetas_[i]);
+  }
+  ToProto(std::move(ranges_), builder.initRanges(), buffers);
+  ToProto(std::move(intensities_), builder.initIntensities(), buffers);
+
+  // The old tensors are now owned by the message
+  ranges_ = Tensor2ui16(columns_, parameters_.vertical_beams);
+  intensities_ = Tensor2ub(columns_, parameters_.vertical_beams);
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
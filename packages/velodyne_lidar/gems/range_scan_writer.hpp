@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "engine/core/buffers/shared_buffer.hpp"
+#include "engine/core/tensor/tensor.hpp"
+#include "messages/range_scan.capnp.h"
+#include "packages/velodyne_lidar/gems/decoder.hpp"
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+// Turns the columns which the decoder wrote for one scan into a range scan message. Ranges and
+// intensities are decoded into tensors which move into the message without a copy, after which
+// the writer allocates fresh tensors for the next scan.
+class RangeScanWriter {
+ public:
+  // Prepares buffers for scans with `columns` columns. The angles are written to `thetas` which
+  // needs room for `columns` values and has to outlive the writer. The vertical angles of the
+  // sensor need to be known, see `SetVerticalAngles`.
+  RangeScanWriter(const VelodyneLidarParameters& parameters, size_t columns, double* thetas);
+
+  // Number of columns in every scan
+  size_t columns() const { return columns_; }
+  // Buffers into which the decoder writes the columns of the current scan
+  ColumnBuffers buffers();
+
+  // Writes the current scan of which only the first `valid` columns were decoded into `builder`.
+  // The missing columns are marked as invalid. Afterwards the decoder needs the new `buffers`.
+  void write(size_t valid, ::RangeScanProto::Builder builder, std::vector<SharedBuffer>& buffers);
+
+ private:
+  VelodyneLidarParameters parameters_;
+  size_t columns_;
+  Tensor2ui16 ranges_;
+  Tensor2ub intensities_;
+  double* thetas_;
+};
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
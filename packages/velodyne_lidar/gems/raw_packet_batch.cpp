@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "raw_packet_batch.hpp"
+
+#include <cstring>
+
+#include "engine/core/assert.hpp"
+#include "packages/velodyne_lidar/gems/decoder.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+::VelodyneModel ToVelodyneModelProto(VelodyneModelType model_type) {
+  switch (model_type) {
+    case VelodyneModelType::VLP16:
+      return ::VelodyneModel::VLP16;
+    case VelodyneModelType::VLP32C:
+      return ::VelodyneModel::VLP32C;
+    case VelodyneModelType::VLS128:
+      return ::VelodyneModel::VLS128;
+    default:
+      PANIC("Unknown Velodyne Model: %x", model_type);
+  }
+}
+
+VelodyneModelType FromVelodyneModelProto(::VelodyneModel model) {
+  switch (model) {
+    case ::VelodyneModel::VLP16:
+      return VelodyneModelType::VLP16;
+    case ::VelodyneModel::VLP32C:
+      return VelodyneModelType::VLP32C;
+    case ::VelodyneModel::VLS128:
+      return VelodyneModelType::VLS128;
+    default:
+      return VelodyneModelType::INVALID;
+  }
+}
+
+void WriteRawPacketBatch(VelodyneModelType model_type, size_t packet_size, const byte* packets,
+                         const int64_t* timestamps, size_t count,
+                         ::VelodyneRawPacketBatchProto::Builder builder) {
+  builder.setModel(ToVelodyneModelProto(model_type));
+  builder.setPacketSize(packet_size);
+  auto payloads = builder.initPayloads(count * packet_size);
+  std::memcpy(payloads.begin(), packets, count * packet_size);
+  auto timestamps_proto = builder.initTimestamps(count);
+  for (size_t i = 0; i < count; i++) {
+    timestamps_proto.set(i, timestamps[i]);
+  }
+}
+
+bool RawPacketBatch::load(::VelodyneRawPacketBatchProto::Reader reader) {
+  const VelodyneModelType model_type = FromVelodyneModelProto(reader.getModel());
+  if (model_type == VelodyneModelType::INVALID) {
+    return false;
+  }
+  parameters_ = GetVelodyneParameters(model_type);
+  packet_size_ = reader.getPacketSize();
+  if (packet_size_ != parameters_.packet_sans_header_size) {
+    return false;
+  }
+  size_ = reader.getTimestamps().size();
+  if (reader.getPayloads().size() != size_ * packet_size_) {
+    return false;
+  }
+  columns_per_packet_ = ColumnsPerPacket(parameters_);
+  reader_ = reader;
+  return true;
+}
+
+int64_t RawPacketBatch::timestamp(size_t index) const {
+  ASSERT(index < size_, "Packet index out of range: %zu >= %zu", index, size_);
+  return reader_.getTimestamps()[index];
+}
+
+const byte* RawPacketBatch::packet(size_t index) const {
+  ASSERT(index < size_, "Packet index out of range: %zu >= %zu", index, size_);
+  return reader_.getPayloads().begin() + index * packet_size_;
+}
+
+void RawPacketBatch::decode(size_t first, size_t count, TensorView2ui16 ranges,
+                            TensorView2ub intensities, double* thetas) const {
+  ASSERT(first + count <= size_, "Packet range out of range: %zu > %zu", first + count, size_);
+  if (count == 0) {
+    return;
+  }
+  ColumnBuffers buffers;
+  buffers.ranges = ranges.element_wise_begin();
+  buffers.intensities = intensities.element_wise_begin();
+  buffers.thetas = thetas;
+  buffers.capacity = count * columns_per_packet_;
+  // Interpolating the angles of the last block needs the first block of the following packet.
+  const byte* next_packet = first + count < size_ ? packet(first + count) : nullptr;
+  DecodePackets(parameters_, packet(first), count, next_packet, buffers);
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
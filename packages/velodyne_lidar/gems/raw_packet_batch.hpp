@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "engine/core/byte.hpp"
+#include "engine/core/tensor/tensor.hpp"
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+#include "packages/velodyne_lidar/messages/velodyne_lidar.capnp.h"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+// Conversion between the sensor model used in messages and the one used in the driver
+::VelodyneModel ToVelodyneModelProto(VelodyneModelType model_type);
+VelodyneModelType FromVelodyneModelProto(::VelodyneModel model);
+
+// Writes `count` raw packets which are stored one after another in `packets` into a message
+void WriteRawPacketBatch(VelodyneModelType model_type, size_t packet_size, const byte* packets,
+                         const int64_t* timestamps, size_t count,
+                         ::VelodyneRawPacketBatchProto::Builder builder);
+
+// Gives access to the packets of a raw packet batch message without decoding them. Packets are
+// decoded only on request and into buffers owned by the caller.
+class RawPacketBatch {
+ public:
+  // Prepares reading from the given message which needs to stay alive while the batch is used.
+  // Returns false if the message is inconsistent.
+  bool load(::VelodyneRawPacketBatchProto::Reader reader);
+
+  // The number of packets in the batch
+  size_t size() const { return size_; }
+  // Parameters of the sensor model which produced the packets
+  const VelodyneLidarParameters& parameters() const { return parameters_; }
+  // Number of rows which a decoded packet occupies in the outputs of `decode`
+  size_t columnsPerPacket() const { return columns_per_packet_; }
+
+  // Kernel receive timestamp of the packet with the given index in nanoseconds
+  int64_t timestamp(size_t index) const;
+  // Raw payload of the packet with the given index
+  const byte* packet(size_t index) const;
+
+  // Decodes the packets [first, first + count). `ranges` and `intensities` need to have
+  // `count * columnsPerPacket()` rows and one column per vertical beam. `thetas` needs room for one
+  // angle per row. Angles of the last packet in the batch are extrapolated.
+  void decode(size_t first, size_t count, TensorView2ui16 ranges, TensorView2ub intensities,
+              double* thetas) const;
+
+ private:
+  ::VelodyneRawPacketBatchProto::Reader reader_;
+  VelodyneLidarParameters parameters_;
+  size_t packet_size_ = 0;
+  size_t columns_per_packet_ = 0;
+  size_t size_ = 0;
+};
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "region_of_interest.hpp"
+
+#include <algorithm>
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+// Number of points which are tested together
+constexpr size_t kBlockSize = 64;
+
+// Reads `N` numbers from a JSON array
+template <size_t N>
+bool ParseNumbers(const Json& json, std::array<double, N>& numbers) {
+  if (!json.is_array() || json.size() != N) {
+    return false;
+  }
+  for (size_t i = 0; i < N; i++) {
+    if (!json[i].is_number()) return false;
+    numbers[i] = json[i].get<double>();
+  }
+  return true;
+}
+}  // namespace
+
+bool ParseRegionOfInterest(const Json& json, RegionOfInterest& region) {
+  if (!json.is_object()) {
+    return false;
+  }
+  region.has_box = false;
+  region.polygons.clear();
+  const auto box = json.find("box");
+  if (box != json.end()) {
+    if (!box->is_object()) return false;
+    const auto minimum = box->find("min");
+    const auto maximum = box->find("max");
+    if (minimum == box->end() || maximum == box->end() ||
+        !ParseNumbers(*minimum, region.box_minimum) ||
+        !ParseNumbers(*maximum, region.box_maximum)) {
+      return false;
+    }
+    for (int i = 0; i < 3; i++) {
+      if (region.box_minimum[i] >= region.box_maximum[i]) return false;
+    }
+    region.has_box = true;
+  }
+  const auto polygons = json.find("polygons");
+  if (polygons != json.end()) {
+    if (!polygons->is_array()) return false;
+    for (const Json& item : *polygons) {
+      if (!item.is_object()) return false;
+      RegionOfInterest::Polygon polygon;
+      const auto corners = item.find("polygon");
+      if (corners == item.end() || !corners->is_array() || corners->size() < 3) {
+        return false;
+      }
+      for (const Json& corner : *corners) {
+        std::array<double, 2> point;
+        if (!ParseNumbers(corner, point)) return false;
+        polygon.corners.emplace_back(point[0], point[1]);
+      }
+      const auto heights = item.find("heights");
+      if (heights != item.end()) {
+        std::array<double, 2> band;
+        if (!ParseNumbers(*heights, band) || band[0] >= band[1]) return false;
+        polygon.min_height = band[0];
+        polygon.max_height = band[1];
+      }
+      region.polygons.push_back(std::move(polygon));
+    }
+  }
+  return true;
+}
+
+RegionFilter::RegionFilter(const RegionOfInterest& region) : empty_(region.empty()) {
+  for (int i = 0; i < 9; i++) {
+    rotation_[i] = static_cast<float>(region.vehicle_T_sensor.rotation[i]);
+  }
+  const float infinity = std::numeric_limits<float>::infinity();
+  for (int i = 0; i < 3; i++) {
+    translation_[i] = static_cast<float>(region.vehicle_T_sensor.translation[i]);
+    box_minimum_[i] = region.has_box ? static_cast<float>(region.box_minimum[i]) : -infinity;
+    box_maximum_[i] = region.has_box ? static_cast<float>(region.box_maximum[i]) : infinity;
+  }
+  for (const RegionOfInterest::Polygon& polygon : region.polygons) {
+    Polygon compiled;
+    compiled.min_height = static_cast<float>(polygon.min_height);
+    compiled.max_height = static_cast<float>(polygon.max_height);
+    const auto& corners = polygon.corners;
+    for (size_t i = 0, j = corners.size() - 1; i < corners.size(); j = i++) {
+      const double dy = corners[j].second - corners[i].second;
+      // Horizontal edges never cross a horizontal ray, thus their slope is not used
+      const double slope = dy != 0.0 ? (corners[j].first - corners[i].first) / dy : 0.0;
+      compiled.edges.push_back({static_cast<float>(corners[i].first),
+                                static_cast<float>(corners[i].second),
+                                static_cast<float>(corners[j].second),
+                                static_cast<float>(slope)});
+    }
+    polygons_.push_back(std::move(compiled));
+  }
+}
+
+void RegionFilter::test(const float* x, const float* y, const float* z, size_t count,
+                        uint8_t* inside) const {
+  if (empty_) {
+    std::fill_n(inside, count, 1);
+    return;
+  }
+  float vx[kBlockSize];
+  float vy[kBlockSize];
+  float vz[kBlockSize];
+  uint8_t any[kBlockSize];
+  uint8_t crossings[kBlockSize];
+  for (size_t first = 0; first < count; first += kBlockSize) {
+    const size_t size = std::min(kBlockSize, count - first);
+    const float* px = x + first;
+    const float* py = y + first;
+    const float* pz = z + first;
+    uint8_t* result = inside + first;
+    for (size_t i = 0; i < size; i++) {
+      vx[i] = rotation_[0] * px[i] + rotation_[1] * py[i] + rotation_[2] * pz[i] + translation_[0];
+      vy[i] = rotation_[3] * px[i] + rotation_[4] * py[i] + rotation_[5] * pz[i] + translation_[1];
+      vz[i] = rotation_[6] * px[i] + rotation_[7] * py[i] + rotation_[8] * pz[i] + translation_[2];
+      result[i] = (vx[i] >= box_minimum_[0]) & (vx[i] <= box_maximum_[0]) &
+                  (vy[i] >= box_minimum_[1]) & (vy[i] <= box_maximum_[1]) &
+                  (vz[i] >= box_minimum_[2]) & (vz[i] <= box_maximum_[2]);
+    }
+    if (polygons_.empty()) continue;
+    // Polygon loops always run over a full block since fixed trip counts vectorize best. The
+    // padding is never written to the result.
+    std::fill(vx + size, vx + kBlockSize, 0.0f);
+    std::fill(vy + size, vy + kBlockSize, 0.0f);
+    std::fill(vz + size, vz + kBlockSize, 0.0f);
+    std::fill_n(any, kBlockSize, 0);
+    for (const Polygon& polygon : polygons_) {
+      std::fill_n(crossings, kBlockSize, 0);
+      // Count the edges which cross the ray from the point along the positive x axis
+      for (const Edge& edge : polygon.edges) {
+        for (size_t i = 0; i < kBlockSize; i++) {
+          crossings[i] ^= ((edge.y > vy[i]) != (edge.other_y > vy[i])) &
+                          (vx[i] < edge.x + (vy[i] - edge.y) * edge.slope);
+        }
+      }
+      for (size_t i = 0; i < kBlockSize; i++) {
+        any[i] |= crossings[i] & (vz[i] >= polygon.min_height) & (vz[i] <= polygon.max_height);
+      }
+    }
+    for (size_t i = 0; i < size; i++) {
+      result[i] &= any[i];
+    }
+  }
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
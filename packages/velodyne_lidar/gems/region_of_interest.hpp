@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "engine/gems/serialization/json.hpp"
+#include "packages/velodyne_lidar/gems/rigid_transform.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+// A region of the vehicle frame outside of which points are dropped. A point is kept if it is
+// inside the box and inside at least one of the polygons. Without a box and without polygons all
+// points are kept.
+struct RegionOfInterest {
+  // A polygon in the horizontal plane of the vehicle frame extruded between two heights
+  struct Polygon {
+    // Corners in meters
+    std::vector<std::pair<double, double>> corners;
+    double min_height = -std::numeric_limits<double>::infinity();
+    double max_height = std::numeric_limits<double>::infinity();
+  };
+
+  // Pose of the sensor in the vehicle frame
+  RigidTransform vehicle_T_sensor;
+  // An axis-aligned box in meters in the vehicle frame
+  bool has_box = false;
+  std::array<double, 3> box_minimum = {0.0, 0.0, 0.0};
+  std::array<double, 3> box_maximum = {0.0, 0.0, 0.0};
+  std::vector<Polygon> polygons;
+
+  // True if all points are kept
+  bool empty() const { return !has_box && polygons.empty(); }
+};
+
+// Reads the box and the polygons of a region from a JSON object like {"box": {"min": [-5.0,
+// -2.0, -0.5], "max": [20.0, 2.0, 3.0]}, "polygons": [{"polygon": [[0.0, -1.0], [9.0, -1.0],
+// [9.0, 1.0], [0.0, 1.0]], "heights": [-0.5, 2.0]}]}. Both entries and the heights are optional.
+// Returns false if the JSON does not describe a valid region.
+bool ParseRegionOfInterest(const Json& json, RegionOfInterest& region);
+
+// Tests points in the sensor frame against a region of interest. `test` processes points in
+// blocks with branch-free loops over the block for the transformation, the box and every polygon
+// edge, which the compiler turns into vector instructions. `contains` tests a single point and
+// only skips the polygons of points outside of the box.
+class RegionFilter {
+ public:
+  explicit RegionFilter(const RegionOfInterest& region);
+
+  // True if all points are kept
+  bool empty() const { return empty_; }
+  // Writes 1 to `inside` for each of the `count` points which is inside the region and 0
+  // otherwise. The coordinates are in meters in the sensor frame.
+  void test(const float* x, const float* y, const float* z, size_t count, uint8_t* inside) const;
+  // Returns 1 if the point is inside the region and 0 otherwise like `test`, for writers which
+  // compact their output while they compute it
+  uint8_t contains(float x, float y, float z) const;
+
+ private:
+  // An edge of a polygon for the crossing test along the x axis
+  struct Edge {
+    float x;
+    float y;
+    float other_y;
+    // Change of x per y along the edge
+    float slope;
+  };
+  struct Polygon {
+    std::vector<Edge> edges;
+    float min_height;
+    float max_height;
+  };
+
+  bool empty_;
+  float rotation_[9];
+  float translation_[3];
+  float box_minimum_[3];
+  float box_maximum_[3];
+  std::vector<Polygon> polygons_;
+};
+
+inline uint8_t RegionFilter::contains(float x, float y, float z) const {
+  const float vx = rotation_[0] * x + rotation_[1] * y + rotation_[2] * z + translation_[0];
+  const float vy = rotation_[3] * x + rotation_[4] * y + rotation_[5] * z + translation_[1];
+  const float vz = rotation_[6] * x + rotation_[7] * y + rotation_[8] * z + translation_[2];
+  const uint8_t in_box = (vx >= box_minimum_[0]) & (vx <= box_maximum_[0]) &
+                         (vy >= box_minimum_[1]) & (vy <= box_maximum_[1]) &
+                         (vz >= box_minimum_[2]) & (vz <= box_maximum_[2]);
+  if (polygons_.empty() || !in_box) return in_box;
+  uint8_t any = 0;
+  for (const Polygon& polygon : polygons_) {
+    // Count the edges which cross the ray from the point along the positive x axis
+    uint8_t crossings = 0;
+    for (const Edge& edge : polygon.edges) {
+      crossings ^= ((edge.y > vy) != (edge.other_y > vy)) &
+                   (vx < edge.x + (vy - edge.y) * edge.slope);
+    }
+    any |= crossings & (vz >= polygon.min_height) & (vz <= polygon.max_height);
+  }
+  return in_box & any;
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <array>
+#include <cmath>
+
+namespace isaac {
+namespace velodyne_lidar {
+
+// A rigid transformation in 3D which maps a point p to rotation * p + translation
+struct RigidTransform {
+  // Rotation matrix in row-major order
+  std::array<double, 9> rotation = {1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0};
+  // Translation in meters
+  std::array<double, 3> translation = {0.0, 0.0, 0.0};
+
+  // Applies the transformation to a point
+  std::array<double, 3> operator*(const std::array<double, 3>& point) const {
+    std::array<double, 3> result;
+    for (int row = 0; row < 3; row++) {
+      result[row] = rotation[3 * row] * point[0] + rotation[3 * row + 1] * point[1] +
+                    rotation[3 * row + 2] * point[2] + translation[row];
+    }
+    return result;
+  }
+
+  // The transformation which first applies `other` and then this one
+  RigidTransform operator*(const RigidTransform& other) const {
+    RigidTransform result;
+    for (int row = 0; row < 3; row++) {
+      for (int column = 0; column < 3; column++) {
+        result.rotation[3 * row + column] = rotation[3 * row] * other.rotation[column] +
+                                            rotation[3 * row + 1] * other.rotation[3 + column] +
+                                            rotation[3 * row + 2] * other.rotation[6 + column];
+      }
+    }
+    result.translation = (*this) * other.translation;
+    return result;
+  }
+
+  // The inverse transformation
+  RigidTransform inverse() const {
+    RigidTransform result;
+    for (int row = 0; row < 3; row++) {
+      for (int column = 0; column < 3; column++) {
+        result.rotation[3 * row + column] = rotation[3 * column + row];
+      }
+    }
+    for (int row = 0; row < 3; row++) {
+      result.translation[row] = -(result.rotation[3 * row] * translation[0] +
+                                  result.rotation[3 * row + 1] * translation[1] +
+                                  result.rotation[3 * row + 2] * translation[2]);
+    }
+    return result;
+  }
+
+  // A rotation by `angle` radians around the unit `axis` followed by a translation
+  static RigidTransform FromAxisAngle(const std::array<double, 3>& axis, double angle,
+                                      const std::array<double, 3>& translation = {0, 0, 0}) {
+    const double c = std::cos(angle);
+    const double s = std::sin(angle);
+    const double t = 1.0 - c;
+    const double x = axis[0];
+    const double y = axis[1];
+    const double z = axis[2];
+    RigidTransform result;
+    result.rotation = {t * x * x + c,     t * x * y - s * z, t * x * z + s * y,
+                       t * x * y + s * z, t * y * y + c,     t * y * z - s * x,
+                       t * x * z - s * y, t * y * z + s * x, t * z * z + c};
+    result.translation = translation;
+    return result;
+  }
+};
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
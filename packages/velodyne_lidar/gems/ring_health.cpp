@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "ring_health.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+namespace isaac {
+namespace velodyne_lidar {
+
+RingHealthMonitor::RingHealthMonitor(const VelodyneLidarParameters& parameters,
+                                     const RingHealthOptions& options)
+    : options_(options), distance_resolution_(parameters.distance_resolution) {
+  const size_t beams = parameters.vertical_beams;
+  elevation_order_.resize(beams);
+  std::iota(elevation_order_.begin(), elevation_order_.end(), 0);
+  if (parameters.vertical_angles.size() == beams) {
+    std::stable_sort(elevation_order_.begin(), elevation_order_.end(),
+                     [&](uint32_t a, uint32_t b) {
+                       return parameters.vertical_angles[a] < parameters.vertical_angles[b];
+                     });
+  }
+  degraded_windows_.resize(beams, 0);
+  reset();
+}
+
+void RingHealthMonitor::reset() {
+  const size_t beams = elevation_order_.size();
+  previous_ = RingStatistics();
+  previous_.returns.assign(beams, 0);
+  previous_.range_sums.assign(beams, 0);
+  previous_.intensity_sums.assign(beams, 0);
+}
+
+bool RingHealthMonitor::update(const RingStatistics& statistics, RingHealthReport& report) {
+  const size_t beams = elevation_order_.size();
+  if (statistics.returns.size() != beams || statistics.columns < previous_.columns) {
+    // The statistics were reset or are not collected
+    reset();
+    return false;
+  }
+  const uint64_t columns = statistics.columns - previous_.columns;
+  if (columns < std::max<uint64_t>(1, options_.minimum_columns)) {
+    return false;
+  }
+
+  report.columns = columns;
+  report.rings.resize(beams);
+  for (size_t k = 0; k < beams; k++) {
+    const uint64_t returns = statistics.returns[k] - previous_.returns[k];
+    RingHealth& ring = report.rings[k];
+    ring.return_ratio = static_cast<double>(returns) / columns;
+    ring.mean_range = returns == 0 ? 0.0
+                                   : distance_resolution_ *
+                                         (statistics.range_sums[k] - previous_.range_sums[k]) /
+                                         returns;
+    ring.mean_intensity =
+        returns == 0 ? 0.0
+                     : static_cast<double>(statistics.intensity_sums[k] -
+                                           previous_.intensity_sums[k]) /
+                           returns;
+    ring.degraded = false;
+  }
+  previous_ = statistics;
+
+  // Compare every ring to the average of its neighbors in elevation order
+  report.alarm_rings.clear();
+  for (size_t i = 0; i < beams; i++) {
+    const size_t first = i >= options_.neighbors ? i - options_.neighbors : 0;
+    const size_t last = std::min(beams, i + options_.neighbors + 1);
+    double neighbor_ratio = 0.0;
+    double neighbor_intensity = 0.0;
+    size_t count = 0;
+    for (size_t j = first; j < last; j++) {
+      if (j != i) {
+        const RingHealth& neighbor = report.rings[elevation_order_[j]];
+        neighbor_ratio += neighbor.return_ratio;
+        neighbor_intensity += neighbor.mean_intensity;
+        count++;
+      }
+    }
+    const uint32_t laser = elevation_order_[i];
+    RingHealth& ring = report.rings[laser];
+    if (count > 0) {
+      neighbor_ratio /= count;
+      neighbor_intensity /= count;
+      ring.degraded = neighbor_ratio >= options_.minimum_neighbor_ratio &&
+                      (ring.return_ratio < options_.degraded_fraction * neighbor_ratio ||
+                       ring.mean_intensity < options_.degraded_fraction * neighbor_intensity);
+    }
+    degraded_windows_[laser] = ring.degraded ? degraded_windows_[laser] + 1 : 0;
+  }
+  for (size_t k = 0; k < beams; k++) {
+    if (degraded_windows_[k] >= options_.alarm_windows) {
+      report.alarm_rings.push_back(k);
+    }
+  }
+  return true;
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
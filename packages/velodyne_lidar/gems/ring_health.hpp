@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "packages/velodyne_lidar/gems/decoder.hpp"
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+// Thresholds for detecting degraded rings
+struct RingHealthOptions {
+  // A ring is degraded if its return ratio or its mean intensity is below this fraction of the
+  // average of its neighbors
+  double degraded_fraction = 0.5;
+  // Rings are only judged if their neighbors have at least this return ratio. This excludes rings
+  // which point at the sky or are blocked by the vehicle.
+  double minimum_neighbor_ratio = 0.2;
+  // Number of neighboring rings in elevation order on each side
+  size_t neighbors = 2;
+  // Number of consecutive windows in which a ring needs to be degraded before the alarm is raised
+  int alarm_windows = 3;
+  // Windows with fewer sampled columns are skipped
+  uint64_t minimum_columns = 100;
+};
+
+// Health of a single ring within a window
+struct RingHealth {
+  // Fraction of the firings with a valid range
+  double return_ratio = 0.0;
+  // Mean of the valid ranges in meters
+  double mean_range = 0.0;
+  // Mean intensity of the valid ranges
+  double mean_intensity = 0.0;
+  // True if the ring was degraded in this window
+  bool degraded = false;
+};
+
+// Health of all rings within a window
+struct RingHealthReport {
+  // Number of sampled columns in the window
+  uint64_t columns = 0;
+  // One entry per ring ordered by laser ID
+  std::vector<RingHealth> rings;
+  // Laser IDs of the rings which were degraded for at least `alarm_windows` windows
+  std::vector<uint32_t> alarm_rings;
+};
+
+// A dirty window or a failing laser shows up as a ring with far fewer returns or a far lower
+// intensity than the rings next to it. This monitor compares every ring to its neighbors in
+// elevation order over windows of the ring statistics collected by the decoder, and raises an
+// alarm for rings which are degraded over several consecutive windows.
+class RingHealthMonitor {
+ public:
+  RingHealthMonitor(const VelodyneLidarParameters& parameters,
+                    const RingHealthOptions& options = RingHealthOptions());
+
+  // Evaluates the statistics collected since the previous window. `statistics` holds the totals
+  // of the decoder. Returns false if the window has too few columns, in which case they are
+  // added to the next window.
+  bool update(const RingStatistics& statistics, RingHealthReport& report);
+
+  // Forgets the previous totals, for example after the decoder was reset
+  void reset();
+
+ private:
+  RingHealthOptions options_;
+  double distance_resolution_;
+  // Laser IDs ordered by vertical angle
+  std::vector<uint32_t> elevation_order_;
+  // Totals of the decoder at the end of the previous window
+  RingStatistics previous_;
+  // Number of consecutive windows in which every ring was degraded
+  std::vector<int> degraded_windows_;
+};
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "engine/core/assert.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+// A square window of cells in world coordinates which moves with the robot. Every cell is stored
+// at its world coordinates modulo the size of the window, thus moving the window only resets the
+// rows and columns which enter it and all storage is allocated up front.
+template <typename Cell>
+class RollingGrid {
+ public:
+  // Creates a window with `size` cells along each side which is centered at the origin. The size
+  // needs to be a power of two. Cells which enter the window are set to `empty`.
+  RollingGrid(size_t size, const Cell& empty)
+      : size_(size),
+        mask_(size - 1),
+        empty_(empty),
+        cells_(size * size, empty),
+        origin_x_(-static_cast<int64_t>(size / 2)),
+        origin_y_(-static_cast<int64_t>(size / 2)) {
+    ASSERT(size_ > 0 && (size_ & mask_) == 0,
+           "The size of the window needs to be a power of two: %zu", size_);
+  }
+
+  // Number of cells along each side of the window
+  size_t size() const { return size_; }
+  // World coordinates in cells of the cell in the lower left corner of the window
+  int64_t originX() const { return origin_x_; }
+  int64_t originY() const { return origin_y_; }
+
+  // True if the cell with the given world coordinates in cells is within the window
+  bool contains(int64_t x, int64_t y) const {
+    return static_cast<uint64_t>(x - origin_x_) < size_ &&
+           static_cast<uint64_t>(y - origin_y_) < size_;
+  }
+  // Index of the cell with the given world coordinates in cells in the storage
+  size_t index(int64_t x, int64_t y) const {
+    return (static_cast<size_t>(y) & mask_) * size_ + (static_cast<size_t>(x) & mask_);
+  }
+  Cell& operator[](size_t index) { return cells_[index]; }
+  const Cell& operator[](size_t index) const { return cells_[index]; }
+  // The cell in the given row and column of the window counted from the origin
+  const Cell& at(size_t row, size_t column) const {
+    return cells_[index(origin_x_ + column, origin_y_ + row)];
+  }
+
+  // Moves the window such that the cell with the given world coordinates in cells is its center
+  void center(int64_t x, int64_t y) {
+    const int64_t half = static_cast<int64_t>(size_ / 2);
+    roll(x - half, y - half);
+  }
+  // Resets all cells
+  void clear() { std::fill(cells_.begin(), cells_.end(), empty_); }
+
+ private:
+  // Resets the rows and columns of the window which are not within the new window
+  void roll(int64_t origin_x, int64_t origin_y) {
+    const int64_t size = static_cast<int64_t>(size_);
+    if (std::abs(origin_x - origin_x_) >= size || std::abs(origin_y - origin_y_) >= size) {
+      clear();
+    } else {
+      // The columns and rows which leave the window share their storage with those which enter it
+      for (int64_t x = std::min(origin_x, origin_x_); x < std::max(origin_x, origin_x_); x++) {
+        for (size_t row = 0; row < size_; row++) {
+          cells_[row * size_ + (static_cast<size_t>(x) & mask_)] = empty_;
+        }
+      }
+      for (int64_t y = std::min(origin_y, origin_y_); y < std::max(origin_y, origin_y_); y++) {
+        std::fill_n(cells_.begin() + (static_cast<size_t>(y) & mask_) * size_, size_, empty_);
+      }
+    }
+    origin_x_ = origin_x;
+    origin_y_ = origin_y;
+  }
+
+  size_t size_;
+  size_t mask_;
+  Cell empty_;
+  std::vector<Cell> cells_;
+  int64_t origin_x_;
+  int64_t origin_y_;
+};
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
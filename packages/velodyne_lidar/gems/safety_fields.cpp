@@ -0,0 +1,295 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "safety_fields.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "engine/core/assert.hpp"
+#include "packages/velodyne_lidar/gems/decoder.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kTwoPi = 2.0 * kPi;
+
+// Normalizes an angle to [0, 2 pi[
+double NormalizeAngle(double angle) {
+  angle = std::fmod(angle, kTwoPi);
+  return angle < 0.0 ? angle + kTwoPi : angle;
+}
+
+// The horizontal angle of the first column of a group in radians, see `Decoder`
+double BlockAzimuth(const uint8_t* block) {
+  const uint16_t azimuth = reinterpret_cast<const VelodyneRawDataBlock*>(block)->azimuth;
+  return -(static_cast<double>(azimuth) / 100.0) * (kPi / 180.0);
+}
+
+// The signed difference a - b between two angles normalized to [-pi, pi[
+double DeltaAzimuth(double a, double b) {
+  const double delta = NormalizeAngle(a - b + kPi);
+  return delta - kPi;
+}
+
+// Returns true if the origin is inside the polygon
+bool ContainsOrigin(const std::vector<std::pair<double, double>>& polygon) {
+  bool inside = false;
+  for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+    const auto& a = polygon[i];
+    const auto& b = polygon[j];
+    // Count the edges which cross the positive x axis
+    if ((a.second > 0.0) != (b.second > 0.0) &&
+        a.first - a.second * (b.first - a.first) / (b.second - a.second) > 0.0) {
+      inside = !inside;
+    }
+  }
+  return inside;
+}
+
+// Reads a pair of numbers from a JSON array
+bool ParsePair(const Json& json, std::pair<double, double>& pair) {
+  if (!json.is_array() || json.size() != 2 || !json[0].is_number() || !json[1].is_number()) {
+    return false;
+  }
+  pair = {json[0].get<double>(), json[1].get<double>()};
+  return true;
+}
+}  // namespace
+
+bool ParseSafetyFields(const Json& json, std::vector<SafetyField>& fields) {
+  if (!json.is_array()) {
+    return false;
+  }
+  fields.clear();
+  for (const Json& item : json) {
+    if (!item.is_object()) {
+      return false;
+    }
+    SafetyField field;
+    field.name = "field " + std::to_string(fields.size());
+    const auto name = item.find("name");
+    if (name != item.end()) {
+      if (!name->is_string()) return false;
+      field.name = name->get<std::string>();
+    }
+    const auto action = item.find("action");
+    if (action != item.end()) {
+      // Unknown names are read as the first value of the enum
+      if (!action->is_string()) return false;
+      field.action = action->get<SafetyAction>();
+      if (field.action == SafetyAction::kNone) return false;
+    }
+    const auto polygon = item.find("polygon");
+    if (polygon == item.end() || !polygon->is_array()) {
+      return false;
+    }
+    for (const Json& corner : *polygon) {
+      std::pair<double, double> point;
+      if (!ParsePair(corner, point)) return false;
+      field.polygon.push_back(point);
+    }
+    const auto heights = item.find("heights");
+    if (heights != item.end()) {
+      std::pair<double, double> band;
+      if (!ParsePair(*heights, band) || band.first >= band.second) return false;
+      field.min_height = band.first;
+      field.max_height = band.second;
+    }
+    fields.push_back(std::move(field));
+  }
+  return true;
+}
+
+SafetyMonitor::SafetyMonitor(const VelodyneLidarParameters& parameters,
+                             const SafetyMonitorOptions& options)
+    : parameters_(parameters), options_(options) {
+  ASSERT(parameters_.vertical_angles.size() == parameters_.vertical_beams,
+         "The vertical angles of the sensor are not known");
+  options_.sectors = std::max<size_t>(1, options_.sectors);
+  options_.min_returns = std::max<uint32_t>(1, options_.min_returns);
+  firings_per_block_ = FiringsPerBlock(parameters_);
+  blocks_per_column_ = BlocksPerColumn(parameters_);
+  groups_per_packet_ = parameters_.blocks_per_packet / blocks_per_column_;
+  // Zero is an invalid range and ranges outside of the limits are decoded as invalid
+  min_range_ = std::max<uint16_t>(
+      1, static_cast<uint16_t>(parameters_.minimum_range / parameters_.distance_resolution));
+  max_range_ = static_cast<uint16_t>(parameters_.maximum_range / parameters_.distance_resolution);
+  reset();
+}
+
+bool SafetyMonitor::addField(const SafetyField& field) {
+  if (fields_.size() >= kMaxFields || field.polygon.size() < 3 || !ContainsOrigin(field.polygon)) {
+    return false;
+  }
+  const size_t beams = parameters_.vertical_beams;
+  const double resolution = parameters_.distance_resolution;
+  FieldState state;
+  state.near.resize(options_.sectors * beams, 0);
+  state.far_minus_near.resize(options_.sectors * beams, 0);
+  state.clear_angle = 0.0;
+  const double width = kTwoPi / options_.sectors;
+  for (size_t s = 0; s < options_.sectors; s++) {
+    // The reach within a sector is the largest at its borders or at a corner of the polygon
+    const double start = s * width;
+    double reach = std::max(Reach(field.polygon, start), Reach(field.polygon, start + width));
+    for (const auto& corner : field.polygon) {
+      const double angle = NormalizeAngle(std::atan2(corner.second, corner.first));
+      if (angle >= start && angle < start + width) {
+        reach = std::max(reach, std::hypot(corner.first, corner.second));
+      }
+    }
+    for (size_t i = 0; i < beams; i++) {
+      const double cos_phi = std::cos(parameters_.vertical_angles[i]);
+      const double sin_phi = std::sin(parameters_.vertical_angles[i]);
+      // Ranges at which the ray is within the horizontal extent and between the heights
+      double near = 0.0;
+      double far = reach / cos_phi;
+      if (std::abs(sin_phi) > 1e-9) {
+        const double a = field.min_height / sin_phi;
+        const double b = field.max_height / sin_phi;
+        near = std::max(near, std::min(a, b));
+        far = std::min(far, std::max(a, b));
+      } else if (field.min_height > 0.0 || field.max_height < 0.0) {
+        continue;
+      }
+      // The conversion to raw ranges rounds towards a larger interval
+      const double raw_near = std::max<double>(min_range_, std::floor(near / resolution));
+      const double raw_far = std::min<double>(max_range_ + 1.0, std::ceil(far / resolution));
+      if (raw_near >= raw_far) continue;
+      state.near[s * beams + i] = static_cast<uint16_t>(raw_near);
+      state.far_minus_near[s * beams + i] = static_cast<uint16_t>(raw_far - raw_near);
+    }
+  }
+  fields_.push_back(field);
+  states_.push_back(std::move(state));
+  counts_.resize(fields_.size(), 0);
+  return true;
+}
+
+void SafetyMonitor::reset() {
+  violated_ = 0;
+  last_delta_ = 0.0;
+  for (FieldState& state : states_) {
+    state.clear_angle = 0.0;
+  }
+}
+
+bool SafetyMonitor::process(const uint8_t* packet) {
+  const size_t beams = parameters_.vertical_beams;
+  const size_t bank_beams = beams / blocks_per_column_;
+  const size_t group_size = blocks_per_column_ * parameters_.block_size;
+  const double sector_scale = options_.sectors / kTwoPi;
+  std::fill(counts_.begin(), counts_.end(), 0);
+  double turned = 0.0;
+  for (size_t j = 0; j < groups_per_packet_; j++) {
+    const uint8_t* group_data = packet + j * group_size;
+    const double azimuth = BlockAzimuth(group_data);
+    // The angles of the last group are extrapolated instead of waiting for the next packet
+    if (j + 1 < groups_per_packet_) {
+      last_delta_ = DeltaAzimuth(BlockAzimuth(group_data + group_size), azimuth);
+    }
+    turned += std::abs(last_delta_);
+    for (size_t f = 0; f < firings_per_block_; f++) {
+      const double theta =
+          azimuth + (static_cast<double>(f) / firings_per_block_) * last_delta_;
+      const size_t sector = std::min(
+          options_.sectors - 1, static_cast<size_t>(NormalizeAngle(theta) * sector_scale));
+      for (size_t k = 0; k < states_.size(); k++) {
+        const uint16_t* near = states_[k].near.data() + sector * beams;
+        const uint16_t* far_minus_near = states_[k].far_minus_near.data() + sector * beams;
+        uint32_t count = 0;
+        for (size_t b = 0; b < blocks_per_column_; b++) {
+          const auto& block = *reinterpret_cast<const VelodyneRawDataBlock*>(
+              group_data + b * parameters_.block_size);
+          const VelodyneRawChannel* channels = block.channels + f * bank_beams;
+          for (size_t i = 0; i < bank_beams; i++) {
+            // A single unsigned comparison checks both ends of the interval
+            const size_t laser = b * bank_beams + i;
+            count += static_cast<uint16_t>(channels[i].distance - near[laser]) <
+                     far_minus_near[laser];
+          }
+        }
+        counts_[k] += count;
+      }
+    }
+  }
+
+  uint64_t violated = violated_;
+  for (size_t k = 0; k < states_.size(); k++) {
+    const uint64_t bit = uint64_t{1} << k;
+    if (counts_[k] >= options_.min_returns) {
+      violated |= bit;
+      states_[k].clear_angle = 0.0;
+    } else if (violated & bit) {
+      states_[k].clear_angle += turned;
+      if (states_[k].clear_angle >= options_.clear_angle) {
+        violated &= ~bit;
+      }
+    }
+  }
+  const bool changed = violated != violated_;
+  violated_ = violated;
+  return changed;
+}
+
+SafetyAction SafetyMonitor::action() const {
+  SafetyAction action = SafetyAction::kNone;
+  for (size_t k = 0; k < fields_.size(); k++) {
+    if (violated_ & (uint64_t{1} << k)) {
+      action = std::max(action, fields_[k].action);
+    }
+  }
+  return action;
+}
+
+double SafetyMonitor::Reach(const std::vector<std::pair<double, double>>& polygon,
+                            double theta) {
+  const double dx = std::cos(theta);
+  const double dy = std::sin(theta);
+  // The farthest intersection of the ray from the sensor with an edge of the polygon. For a
+  // polygon which is not star-shaped around the sensor the ray leaves it several times and the
+  // closest one would hide the parts behind a concavity.
+  double reach = 0.0;
+  for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+    const double ex = polygon[i].first - polygon[j].first;
+    const double ey = polygon[i].second - polygon[j].second;
+    const double denominator = dx * ey - dy * ex;
+    if (std::abs(denominator) < 1e-12) continue;
+    const double t = (polygon[j].first * ey - polygon[j].second * ex) / denominator;
+    const double u = (polygon[j].first * dy - polygon[j].second * dx) / denominator;
+    if (t > 0.0 && u >= 0.0 && u <= 1.0) {
+      reach = std::max(reach, t);
+    }
+  }
+  return reach;
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "engine/gems/serialization/json.hpp"
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+// What the vehicle needs to do while a safety field is violated, from the least to the most
+// restrictive
+enum class SafetyAction { kNone, kSlowDown, kStop };
+
+// Serialization helper for :SafetyAction to JSON
+NLOHMANN_JSON_SERIALIZE_ENUM(SafetyAction, {
+                                               {SafetyAction::kNone, "none"},
+                                               {SafetyAction::kSlowDown, "slowdown"},
+                                               {SafetyAction::kStop, "stop"},
+                                           });
+
+// A volume around the sensor which needs to stay free of obstacles. It is a polygon in the
+// horizontal plane of the sensor frame extruded between two heights.
+struct SafetyField {
+  std::string name;
+  SafetyAction action = SafetyAction::kStop;
+  // Corners in meters in the horizontal plane of the sensor frame. The sensor needs to be inside.
+  // Along every ray from the sensor the field reaches up to the farthest border, thus concave
+  // parts hidden behind the polygon from the sensor are covered as well.
+  std::vector<std::pair<double, double>> polygon;
+  // Heights in meters relative to the sensor between which returns are considered
+  double min_height = -std::numeric_limits<double>::infinity();
+  double max_height = std::numeric_limits<double>::infinity();
+};
+
+// Reads fields from a JSON array of objects like {"name": "front", "action": "stop", "polygon":
+// [[0.0, -1.0], [2.0, -1.0], [2.0, 1.0], [0.0, 1.0]], "heights": [-0.3, 1.5]}. The heights are
+// optional. Returns false if the JSON does not describe valid fields.
+bool ParseSafetyFields(const Json& json, std::vector<SafetyField>& fields);
+
+struct SafetyMonitorOptions {
+  // Number of horizontal sectors with precomputed range thresholds. Every sector covers the
+  // farthest extent of a field within it, thus the fields grow by up to a sector at their edges.
+  size_t sectors = 720;
+  // Number of returns within a field in a single packet at which the field is violated
+  uint32_t min_returns = 3;
+  // A violated field is cleared once the sensor turned by this angle in radians without another
+  // violation, that is once it looked at the whole field again
+  double clear_angle = 2.0 * 3.14159265358979323846;
+};
+
+// Checks data packets against safety fields as soon as they are received. Every field is turned
+// into an interval of raw ranges per sector and laser when it is added, thus checking a channel
+// only takes a comparison per field. Packets are checked on their own without waiting for the
+// next packet, which the decoder needs for interpolating the angles of the last columns.
+class SafetyMonitor {
+ public:
+  // Maximum number of fields of a monitor
+  static constexpr size_t kMaxFields = 64;
+
+  // The vertical angles of the sensor need to be known
+  SafetyMonitor(const VelodyneLidarParameters& parameters, const SafetyMonitorOptions& options);
+
+  // Adds a field which is checked from the next packet on. Returns false if the polygon has fewer
+  // than three corners, does not contain the sensor or if there are too many fields.
+  bool addField(const SafetyField& field);
+  // Clears the state of all fields
+  void reset();
+
+  // Checks the payload of a data packet which needs to have the expected size. Returns true if
+  // the set of violated fields changed.
+  bool process(const uint8_t* packet);
+
+  // Bit i is set while field i is violated
+  uint64_t violated() const { return violated_; }
+  // The most restrictive action of all violated fields
+  SafetyAction action() const;
+  const std::vector<SafetyField>& fields() const { return fields_; }
+
+ private:
+  // Thresholds and state of a single field
+  struct FieldState {
+    // A raw range violates the field if it is in [near, far[. One entry per sector and laser.
+    std::vector<uint16_t> near;
+    std::vector<uint16_t> far_minus_near;
+    // Angle in radians the sensor turned since the last violation
+    double clear_angle;
+  };
+
+  // Horizontal distance in meters from the sensor to the farthest border of the polygon at angle
+  // `theta`
+  static double Reach(const std::vector<std::pair<double, double>>& polygon, double theta);
+
+  VelodyneLidarParameters parameters_;
+  SafetyMonitorOptions options_;
+  size_t firings_per_block_;
+  size_t blocks_per_column_;
+  size_t groups_per_packet_;
+  uint16_t min_range_;
+  uint16_t max_range_;
+  std::vector<SafetyField> fields_;
+  std::vector<FieldState> states_;
+  std::vector<uint32_t> counts_;
+  uint64_t violated_;
+  // Angle between two groups of the previous packet
+  double last_delta_;
+};
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
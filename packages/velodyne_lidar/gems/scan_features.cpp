@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "scan_features.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "engine/core/assert.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+constexpr double kTwoPi = 6.28318530717958647692;
+}  // namespace
+
+FeatureExtractor::FeatureExtractor(const VelodyneLidarParameters& parameters,
+                                   const FeatureOptions& options)
+    : vertical_beams_(parameters.vertical_beams),
+      distance_resolution_(static_cast<float>(parameters.distance_resolution)),
+      options_(options) {
+  ASSERT(options_.half_window > 0, "The window needs at least one neighbor on either side");
+  ASSERT(options_.sectors > 0, "There needs to be at least one sector");
+  ASSERT(parameters.vertical_angles.size() == parameters.vertical_beams,
+         "The vertical angles of the sensor are not known");
+  for (double angle : parameters.vertical_angles) {
+    cos_phis_.push_back(static_cast<float>(std::cos(angle)));
+    sin_phis_.push_back(static_cast<float>(std::sin(angle)));
+  }
+  window_ = 2 * options_.half_window + 1;
+  history_.resize(window_ * vertical_beams_);
+  history_thetas_.resize(window_);
+  sums_.resize(vertical_beams_);
+  invalid_.resize(vertical_beams_);
+  const size_t lists = vertical_beams_ * options_.sectors;
+  const size_t per_list = options_.edges_per_sector + options_.planes_per_sector;
+  candidates_.resize(lists * per_list);
+  for (size_t i = 0; i < lists; i++) {
+    edges_.push_back({i * per_list, 0});
+    planes_.push_back({i * per_list + options_.edges_per_sector, 0});
+  }
+  completed_edges_.reserve(lists * options_.edges_per_sector);
+  completed_planes_.reserve(lists * options_.planes_per_sector);
+  columns_ = 0;
+  revolution_pending_ = false;
+  revolution_start_ = 0;
+  revolutions_ = 0;
+}
+
+void FeatureExtractor::write(const uint16_t* ranges, const uint8_t* intensities,
+                             const double* thetas, size_t count) {
+  const size_t half = options_.half_window;
+  const int32_t neighbors = static_cast<int32_t>(2 * half);
+  const float scale = 1.0f / static_cast<float>(neighbors);
+  const float sector_scale = static_cast<float>(options_.sectors / kTwoPi);
+  for (size_t c = 0; c < count; c++) {
+    const float new_theta = static_cast<float>(thetas[c]);
+    const uint16_t* column = ranges + c * vertical_beams_;
+    // The slot of the new column holds the column which leaves the window
+    const size_t slot = columns_ % window_;
+    uint16_t* entering = history_.data() + slot * vertical_beams_;
+    const bool full = columns_ >= window_;
+    for (size_t j = 0; j < vertical_beams_; j++) {
+      if (full) {
+        sums_[j] -= entering[j];
+        invalid_[j] -= entering[j] == 0;
+      }
+      sums_[j] += column[j];
+      invalid_[j] += column[j] == 0;
+      entering[j] = column[j];
+    }
+    history_thetas_[slot] = new_theta;
+    columns_++;
+    if (columns_ < window_) continue;
+
+    // The center of the window is complete now
+    const uint64_t center = columns_ - 1 - half;
+    if (revolution_pending_ && center >= revolution_start_) {
+      completeRevolution();
+    }
+    const size_t center_slot = center % window_;
+    const uint16_t* center_ranges = history_.data() + center_slot * vertical_beams_;
+    const float theta = history_thetas_[center_slot];
+    // Sectors start at the azimuth zero which is a horizontal angle of zero or minus a full turn
+    float azimuth = -theta;
+    azimuth -= static_cast<float>(kTwoPi) * std::floor(azimuth / static_cast<float>(kTwoPi));
+    const size_t sector =
+        std::min(options_.sectors - 1, static_cast<size_t>(azimuth * sector_scale));
+    for (size_t j = 0; j < vertical_beams_; j++) {
+      if (invalid_[j] != 0) continue;
+      const int32_t range = center_ranges[j];
+      const int32_t difference = sums_[j] - range - neighbors * range;
+      const float curvature = std::abs(difference) * scale / range;
+      const size_t list = j * options_.sectors + sector;
+      if (curvature > options_.edge_threshold) {
+        insert(edges_[list], options_.edges_per_sector, true,
+               {center, center_ranges[j], theta, curvature});
+      } else if (curvature < options_.plane_threshold) {
+        insert(planes_[list], options_.planes_per_sector, false,
+               {center, center_ranges[j], theta, curvature});
+      }
+    }
+  }
+}
+
+void FeatureExtractor::endRevolution(int64_t /*timestamp*/) {
+  // The features are complete once the window center reaches the next column
+  revolution_pending_ = true;
+  revolution_start_ = columns_;
+}
+
+void FeatureExtractor::completeRevolution() {
+  completed_edges_.clear();
+  completed_planes_.clear();
+  for (size_t i = 0; i < edges_.size(); i++) {
+    const size_t laser = i / options_.sectors;
+    for (size_t k = 0; k < edges_[i].size; k++) {
+      completed_edges_.push_back(toFeature(laser, candidates_[edges_[i].offset + k]));
+    }
+    for (size_t k = 0; k < planes_[i].size; k++) {
+      completed_planes_.push_back(toFeature(laser, candidates_[planes_[i].offset + k]));
+    }
+    edges_[i].size = 0;
+    planes_[i].size = 0;
+  }
+  revolution_pending_ = false;
+  revolutions_++;
+}
+
+void FeatureExtractor::insert(Candidates& list, size_t capacity, bool edge,
+                              const Candidate& candidate) {
+  if (capacity == 0) return;
+  Candidate* first = candidates_.data() + list.offset;
+  auto better = [edge](const Candidate& a, const Candidate& b) {
+    return edge ? a.curvature > b.curvature : a.curvature < b.curvature;
+  };
+  // A close neighbor of a candidate only replaces it if it is better
+  for (size_t k = 0; k < list.size; k++) {
+    if (candidate.column - first[k].column <= options_.suppression) {
+      if (better(candidate, first[k])) first[k] = candidate;
+      return;
+    }
+  }
+  if (list.size < capacity) {
+    first[list.size++] = candidate;
+    return;
+  }
+  Candidate* worst = first;
+  for (size_t k = 1; k < list.size; k++) {
+    if (better(*worst, first[k])) worst = first + k;
+  }
+  if (better(candidate, *worst)) *worst = candidate;
+}
+
+ScanFeature FeatureExtractor::toFeature(size_t laser, const Candidate& candidate) const {
+  const float distance = candidate.range * distance_resolution_;
+  const float horizontal = distance * cos_phis_[laser];
+  return {horizontal * std::cos(candidate.theta), horizontal * std::sin(candidate.theta),
+          distance * sin_phis_[laser], static_cast<uint16_t>(laser), candidate.curvature};
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "packages/velodyne_lidar/gems/output_products.hpp"
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+// Parameters of a `FeatureExtractor`
+struct FeatureOptions {
+  // The curvature of a return is computed from this many neighbors on either side in its ring
+  size_t half_window = 5;
+  // Every ring is split into this many sectors of equal horizontal angle
+  size_t sectors = 6;
+  // Maximum number of edge and planar features of every ring in every sector
+  size_t edges_per_sector = 2;
+  size_t planes_per_sector = 4;
+  // Returns whose curvature is above the first threshold are edges and those whose curvature is
+  // below the second threshold are planar
+  float edge_threshold = 0.1f;
+  float plane_threshold = 0.01f;
+  // Features of the same kind in a ring are at least this many columns apart
+  size_t suppression = 5;
+};
+
+// An edge or a planar feature in the frame of the sensor
+struct ScanFeature {
+  float x;
+  float y;
+  float z;
+  // Index of the beam ordered by laser ID
+  uint16_t laser;
+  float curvature;
+};
+
+// Edge and planar features in the style of LOAM computed while the scan is decoded. The rings and
+// the firing order are known from the packets, thus the neighbors of a return are simply the
+// returns of the same laser in the adjacent columns.
+//
+// The curvature of a return is |sum of the neighbor ranges - 2 n r| / (2 n r) for the n neighbors
+// on either side and its range r. The sums are kept as sliding integer sums over the raw ranges,
+// thus every return costs a constant number of operations. Returns whose window contains an
+// invalid return are skipped. Every ring and sector keeps its best few candidates as they arrive
+// instead of sorting all returns of the sector.
+//
+// The windows and the candidates span the scans of the driver, thus the features do not depend
+// on how the columns are split into scans. The features of a revolution are complete once the
+// center of the window reaches the first column of the next revolution.
+class FeatureExtractor : public ProductWriter {
+ public:
+  FeatureExtractor(const VelodyneLidarParameters& parameters, const FeatureOptions& options);
+
+  // Keeps the windows and the candidates which span scans
+  void begin() override {}
+  void write(const uint16_t* ranges, const uint8_t* intensities, const double* thetas,
+             size_t count) override;
+  void endRevolution(int64_t timestamp) override;
+
+  // Number of revolutions which were completed
+  uint64_t revolutions() const { return revolutions_; }
+  // The features of the last completed revolution ordered by laser and sector
+  const std::vector<ScanFeature>& edges() const { return completed_edges_; }
+  const std::vector<ScanFeature>& planes() const { return completed_planes_; }
+
+ private:
+  // A return which may become a feature
+  struct Candidate {
+    // Index of the column since the first one which was written, which never wraps around
+    uint64_t column;
+    uint16_t range;
+    float theta;
+    float curvature;
+  };
+  // The best candidates of one ring in one sector
+  struct Candidates {
+    // Offset of the first candidate in `candidates_`
+    size_t offset;
+    size_t size;
+  };
+
+  // Adds a candidate to a list with room for `capacity` candidates. Edges prefer a high and
+  // planes a low curvature.
+  void insert(Candidates& list, size_t capacity, bool edge, const Candidate& candidate);
+  // Converts a candidate of a laser into a feature
+  ScanFeature toFeature(size_t laser, const Candidate& candidate) const;
+  // Moves the candidates into the features of the completed revolution
+  void completeRevolution();
+
+  size_t vertical_beams_;
+  float distance_resolution_;
+  std::vector<float> cos_phis_;
+  std::vector<float> sin_phis_;
+  FeatureOptions options_;
+  size_t window_;
+  // The last `window_` columns of ranges and their angles in a ring buffer
+  std::vector<uint16_t> history_;
+  std::vector<float> history_thetas_;
+  // Per beam the sum of the ranges and the number of invalid returns in the window
+  std::vector<int32_t> sums_;
+  std::vector<int32_t> invalid_;
+  // Columns seen since the extractor was created
+  uint64_t columns_;
+  // Set while the window has not yet reached the column `revolution_start_` which starts a new
+  // revolution
+  bool revolution_pending_;
+  uint64_t revolution_start_;
+  // Per beam and sector the edge and the planar candidates
+  std::vector<Candidates> edges_;
+  std::vector<Candidates> planes_;
+  std::vector<Candidate> candidates_;
+  uint64_t revolutions_;
+  std::vector<ScanFeature> completed_edges_;
+  std::vector<ScanFeature> completed_planes_;
+};
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
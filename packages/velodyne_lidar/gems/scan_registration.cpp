@@ -0,0 +1,424 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "scan_registration.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <utility>
+
+#include "engine/core/assert.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+constexpr double kTwoPi = 6.28318530717958647692;
+
+// Solves the symmetric positive definite system given by its upper triangle with a Cholesky
+// decomposition. Returns false if the matrix is not positive definite.
+bool SolveNormalEquations(const double* upper, const double* rhs, double* solution) {
+  double matrix[6][6];
+  for (int row = 0, k = 0; row < 6; row++) {
+    for (int column = row; column < 6; column++, k++) {
+      matrix[row][column] = upper[k];
+      matrix[column][row] = upper[k];
+    }
+  }
+  // The lower triangle of `matrix` is replaced by the factor L with L L^T = matrix
+  for (int column = 0; column < 6; column++) {
+    double diagonal = matrix[column][column];
+    for (int k = 0; k < column; k++) {
+      diagonal -= matrix[column][k] * matrix[column][k];
+    }
+    if (!(diagonal > 1e-12)) {
+      return false;
+    }
+    matrix[column][column] = std::sqrt(diagonal);
+    for (int row = column + 1; row < 6; row++) {
+      double value = matrix[row][column];
+      for (int k = 0; k < column; k++) {
+        value -= matrix[row][k] * matrix[column][k];
+      }
+      matrix[row][column] = value / matrix[column][column];
+    }
+  }
+  double temporary[6];
+  for (int row = 0; row < 6; row++) {
+    double value = rhs[row];
+    for (int k = 0; k < row; k++) {
+      value -= matrix[row][k] * temporary[k];
+    }
+    temporary[row] = value / matrix[row][row];
+  }
+  for (int row = 5; row >= 0; row--) {
+    double value = temporary[row];
+    for (int k = row + 1; k < 6; k++) {
+      value -= matrix[k][row] * solution[k];
+    }
+    solution[row] = value / matrix[row][row];
+  }
+  return true;
+}
+
+// The bin of a horizontal angle in radians among `bins` bins of a full turn
+size_t AngleBin(double theta, size_t bins) {
+  double turns = theta / kTwoPi;
+  turns -= std::floor(turns);
+  return std::min(bins - 1, static_cast<size_t>(turns * bins));
+}
+}  // namespace
+
+ScanRegistration::ScanRegistration(const VelodyneLidarParameters& parameters,
+                                   const RegistrationOptions& options)
+    : vertical_beams_(parameters.vertical_beams),
+      distance_resolution_(static_cast<float>(parameters.distance_resolution)),
+      options_(options),
+      pool_(std::max<size_t>(1, options.threads)) {
+  ASSERT(options_.image_columns > 2, "The range image needs at least three columns");
+  ASSERT(parameters.vertical_angles.size() == parameters.vertical_beams,
+         "The vertical angles of the sensor are not known");
+  options_.column_stride = std::max<size_t>(1, options_.column_stride);
+  options_.threads = std::max<size_t>(1, options_.threads);
+  for (double angle : parameters.vertical_angles) {
+    cos_phis_.push_back(static_cast<float>(std::cos(angle)));
+    sin_phis_.push_back(static_cast<float>(std::sin(angle)));
+  }
+  row_lasers_.resize(vertical_beams_);
+  std::iota(row_lasers_.begin(), row_lasers_.end(), 0);
+  std::sort(row_lasers_.begin(), row_lasers_.end(), [&](uint32_t a, uint32_t b) {
+    return parameters.vertical_angles[a] < parameters.vertical_angles[b];
+  });
+  float gap = 0.0f;
+  for (uint32_t laser : row_lasers_) {
+    row_tangents_.push_back(static_cast<float>(std::tan(parameters.vertical_angles[laser])));
+    if (row_tangents_.size() > 1) {
+      gap = std::max(gap, row_tangents_.back() - row_tangents_[row_tangents_.size() - 2]);
+    }
+  }
+  row_tolerance_ = row_tangents_.size() > 1 ? 0.5f * gap : 0.01f;
+  const size_t pixels = vertical_beams_ * options_.image_columns;
+  points_.resize(3 * pixels);
+  normals_.resize(3 * pixels);
+  valid_.resize(pixels);
+  has_reference_ = false;
+  completed_timestamp_ = 0;
+  reference_timestamp_ = 0;
+  revolutions_ = 0;
+}
+
+void ScanRegistration::write(const uint16_t* ranges, const uint8_t* intensities,
+                             const double* thetas, size_t count) {
+  ranges_.insert(ranges_.end(), ranges, ranges + count * vertical_beams_);
+  thetas_.insert(thetas_.end(), thetas, thetas + count);
+}
+
+ScanRegistration::~ScanRegistration() {
+  stop();
+}
+
+void ScanRegistration::endRevolution(int64_t timestamp) {
+  revolutions_++;
+  std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+  if (running_ && !lock.try_lock()) {
+    // The background thread still aligns the previous revolution
+    ranges_.clear();
+    thetas_.clear();
+    skipped_revolutions_++;
+    return;
+  }
+  completed_ranges_.swap(ranges_);
+  completed_thetas_.swap(thetas_);
+  completed_timestamp_ = timestamp;
+  ranges_.clear();
+  thetas_.clear();
+  if (running_) {
+    lock.unlock();
+    condition_.notify_one();
+  }
+}
+
+void ScanRegistration::start(Callback callback) {
+  ASSERT(!running_, "The background thread already runs");
+  callback_ = std::move(callback);
+  stopping_ = false;
+  running_ = true;
+  thread_ = std::thread([this] { run(); });
+}
+
+void ScanRegistration::stop() {
+  if (!running_) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  condition_.notify_one();
+  thread_.join();
+  running_ = false;
+}
+
+void ScanRegistration::run() {
+  // The motion between the last two revolutions is the initial guess
+  RigidTransform guess;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    condition_.wait(lock, [this] { return stopping_ || !completed_thetas_.empty(); });
+    if (stopping_) {
+      return;
+    }
+    RegistrationResult result;
+    const bool aligned = update(guess, result);
+    guess = aligned ? result.transform : RigidTransform();
+    lock.unlock();
+    callback_(aligned, result);
+    lock.lock();
+  }
+}
+
+bool ScanRegistration::update(const RigidTransform& guess, RegistrationResult& result) {
+  if (completed_thetas_.empty()) {
+    return false;
+  }
+  const bool aligned = has_reference_ && align(completed_ranges_.data(),
+                                               completed_thetas_.data(),
+                                               completed_thetas_.size(), guess, result);
+  result.source_timestamp = completed_timestamp_;
+  result.target_timestamp = reference_timestamp_;
+  setReference(completed_ranges_.data(), completed_thetas_.data(), completed_thetas_.size());
+  reference_timestamp_ = completed_timestamp_;
+  completed_thetas_.clear();
+  return aligned;
+}
+
+void ScanRegistration::setReference(const uint16_t* ranges, const double* thetas,
+                                    size_t count) {
+  const size_t columns = options_.image_columns;
+  std::fill(valid_.begin(), valid_.end(), 0);
+  for (size_t c = 0; c < count; c++) {
+    const size_t bin = AngleBin(thetas[c], columns);
+    const float cos_theta = static_cast<float>(std::cos(thetas[c]));
+    const float sin_theta = static_cast<float>(std::sin(thetas[c]));
+    const uint16_t* column = ranges + c * vertical_beams_;
+    for (size_t row = 0; row < vertical_beams_; row++) {
+      const uint32_t laser = row_lasers_[row];
+      if (column[laser] == 0) continue;
+      const float distance = column[laser] * distance_resolution_;
+      const size_t pixel = row * columns + bin;
+      float* point = points_.data() + 3 * pixel;
+      point[0] = distance * cos_phis_[laser] * cos_theta;
+      point[1] = distance * cos_phis_[laser] * sin_theta;
+      point[2] = distance * sin_phis_[laser];
+      valid_[pixel] = 1;
+    }
+  }
+
+  // The normal of a pixel is the cross product of the differences to its horizontal and its
+  // vertical neighbors. Neighbors across a depth discontinuity are not used, and at the border of
+  // a surface the difference to the neighbor on the other side is used alone.
+  const float maximum_squared = static_cast<float>(options_.normal_distance *
+                                                   options_.normal_distance);
+  auto near = [&](size_t pixel, size_t neighbor, bool exists) {
+    if (!exists || !valid_[neighbor]) return false;
+    const float* a = points_.data() + 3 * pixel;
+    const float* b = points_.data() + 3 * neighbor;
+    const float dx = a[0] - b[0];
+    const float dy = a[1] - b[1];
+    const float dz = a[2] - b[2];
+    return dx * dx + dy * dy + dz * dz <= maximum_squared;
+  };
+  auto difference = [&](size_t pixel, size_t before, bool has_before, size_t after,
+                        bool has_after, float* result) {
+    const bool use_before = near(pixel, before, has_before);
+    const bool use_after = near(pixel, after, has_after);
+    if (!use_before && !use_after) return false;
+    const float* first = points_.data() + 3 * (use_before ? before : pixel);
+    const float* last = points_.data() + 3 * (use_after ? after : pixel);
+    for (int i = 0; i < 3; i++) {
+      result[i] = last[i] - first[i];
+    }
+    return true;
+  };
+  std::vector<uint8_t> has_normal(valid_.size(), 0);
+  for (size_t row = 0; row < vertical_beams_; row++) {
+    for (size_t bin = 0; bin < columns; bin++) {
+      const size_t pixel = row * columns + bin;
+      if (!valid_[pixel]) continue;
+      float horizontal[3];
+      float vertical[3];
+      const size_t left = row * columns + (bin + columns - 1) % columns;
+      const size_t right = row * columns + (bin + 1) % columns;
+      if (!difference(pixel, left, true, right, true, horizontal) ||
+          !difference(pixel, pixel - columns, row > 0, pixel + columns,
+                      row + 1 < vertical_beams_, vertical)) {
+        continue;
+      }
+      float* normal = normals_.data() + 3 * pixel;
+      normal[0] = horizontal[1] * vertical[2] - horizontal[2] * vertical[1];
+      normal[1] = horizontal[2] * vertical[0] - horizontal[0] * vertical[2];
+      normal[2] = horizontal[0] * vertical[1] - horizontal[1] * vertical[0];
+      const float length =
+          std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+      if (!(length > 1e-9f)) continue;
+      for (int i = 0; i < 3; i++) normal[i] /= length;
+      has_normal[pixel] = 1;
+    }
+  }
+  valid_.swap(has_normal);
+  has_reference_ = true;
+}
+
+bool ScanRegistration::align(const uint16_t* ranges, const double* thetas, size_t count,
+                             const RigidTransform& guess, RegistrationResult& result) {
+  ASSERT(has_reference_, "There is no reference scan");
+  source_.clear();
+  for (size_t c = 0; c < count; c += options_.column_stride) {
+    const float cos_theta = static_cast<float>(std::cos(thetas[c]));
+    const float sin_theta = static_cast<float>(std::sin(thetas[c]));
+    const uint16_t* column = ranges + c * vertical_beams_;
+    for (size_t j = 0; j < vertical_beams_; j++) {
+      if (column[j] == 0) continue;
+      const float distance = column[j] * distance_resolution_;
+      source_.push_back(distance * cos_phis_[j] * cos_theta);
+      source_.push_back(distance * cos_phis_[j] * sin_theta);
+      source_.push_back(distance * sin_phis_[j]);
+    }
+  }
+  const size_t points = source_.size() / 3;
+  const size_t threads = pool_.threads();
+
+  result = RegistrationResult();
+  result.transform = guess;
+  std::vector<Equations> equations(threads);
+  for (size_t iteration = 0; iteration < options_.iterations; iteration++) {
+    pool_.run([&](size_t t) {
+      accumulate(result.transform, t * points / threads, (t + 1) * points / threads,
+                 equations[t]);
+    });
+    for (size_t t = 1; t < threads; t++) {
+      for (int i = 0; i < 21; i++) equations[0].lhs[i] += equations[t].lhs[i];
+      for (int i = 0; i < 6; i++) equations[0].rhs[i] += equations[t].rhs[i];
+      equations[0].error += equations[t].error;
+      equations[0].count += equations[t].count;
+    }
+    const Equations& sum = equations[0];
+    result.iterations = iteration + 1;
+    result.correspondences = sum.count;
+    result.rms_error = sum.count > 0 ? std::sqrt(sum.error / sum.count) : 0.0;
+    if (sum.count < std::max<size_t>(6, options_.minimum_correspondences)) {
+      return false;
+    }
+    double rhs[6];
+    for (int i = 0; i < 6; i++) rhs[i] = -sum.rhs[i];
+    double update[6];
+    if (!SolveNormalEquations(sum.lhs, rhs, update)) {
+      return false;
+    }
+    // The update is a small rotation vector followed by a translation
+    const double angle = std::sqrt(update[0] * update[0] + update[1] * update[1] +
+                                   update[2] * update[2]);
+    const double shift = std::sqrt(update[3] * update[3] + update[4] * update[4] +
+                                   update[5] * update[5]);
+    const std::array<double, 3> axis = angle > 0.0
+        ? std::array<double, 3>{update[0] / angle, update[1] / angle, update[2] / angle}
+        : std::array<double, 3>{1.0, 0.0, 0.0};
+    result.transform = RigidTransform::FromAxisAngle(axis, angle, {update[3], update[4],
+                                                                   update[5]}) *
+                       result.transform;
+    if (angle + shift < options_.convergence) {
+      result.converged = true;
+      break;
+    }
+  }
+  return true;
+}
+
+void ScanRegistration::accumulate(const RigidTransform& transform, size_t first, size_t last,
+                                  Equations& equations) const {
+  std::fill(std::begin(equations.lhs), std::end(equations.lhs), 0.0);
+  std::fill(std::begin(equations.rhs), std::end(equations.rhs), 0.0);
+  equations.error = 0.0;
+  equations.count = 0;
+  float rotation[9];
+  float translation[3];
+  for (int i = 0; i < 9; i++) rotation[i] = static_cast<float>(transform.rotation[i]);
+  for (int i = 0; i < 3; i++) translation[i] = static_cast<float>(transform.translation[i]);
+  const size_t columns = options_.image_columns;
+  const float bin_scale = static_cast<float>(columns / kTwoPi);
+  const float maximum_squared = static_cast<float>(options_.maximum_distance *
+                                                   options_.maximum_distance);
+  for (size_t i = first; i < last; i++) {
+    const float* p = source_.data() + 3 * i;
+    float q[3];
+    for (int row = 0; row < 3; row++) {
+      q[row] = rotation[3 * row] * p[0] + rotation[3 * row + 1] * p[1] +
+               rotation[3 * row + 2] * p[2] + translation[row];
+    }
+    const float horizontal = std::sqrt(q[0] * q[0] + q[1] * q[1]);
+    if (!(horizontal > 0.0f)) continue;
+    const int row = findRow(q[2] / horizontal);
+    if (row < 0) continue;
+    float theta = std::atan2(q[1], q[0]);
+    if (theta < 0.0f) theta += static_cast<float>(kTwoPi);
+    const size_t bin = std::min(columns - 1, static_cast<size_t>(theta * bin_scale));
+    const size_t pixel = row * columns + bin;
+    if (!valid_[pixel]) continue;
+    const float* r = points_.data() + 3 * pixel;
+    const float* n = normals_.data() + 3 * pixel;
+    const float dx = q[0] - r[0];
+    const float dy = q[1] - r[1];
+    const float dz = q[2] - r[2];
+    if (dx * dx + dy * dy + dz * dz > maximum_squared) continue;
+    const double error = n[0] * dx + n[1] * dy + n[2] * dz;
+    // The derivative of the error by a small rotation and a translation
+    const double jacobian[6] = {q[1] * n[2] - q[2] * n[1], q[2] * n[0] - q[0] * n[2],
+                                q[0] * n[1] - q[1] * n[0], n[0], n[1], n[2]};
+    for (int a = 0, k = 0; a < 6; a++) {
+      for (int b = a; b < 6; b++, k++) {
+        equations.lhs[k] += jacobian[a] * jacobian[b];
+      }
+      equations.rhs[a] += jacobian[a] * error;
+    }
+    equations.error += error * error;
+    equations.count++;
+  }
+}
+
+int ScanRegistration::findRow(float tangent) const {
+  const auto upper = std::lower_bound(row_tangents_.begin(), row_tangents_.end(), tangent);
+  size_t row = upper - row_tangents_.begin();
+  if (row == row_tangents_.size() ||
+      (row > 0 && tangent - row_tangents_[row - 1] < row_tangents_[row] - tangent)) {
+    row--;
+  }
+  return std::abs(tangent - row_tangents_[row]) <= row_tolerance_ ? static_cast<int>(row) : -1;
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
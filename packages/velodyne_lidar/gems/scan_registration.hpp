@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "packages/velodyne_lidar/gems/output_products.hpp"
+#include "packages/velodyne_lidar/gems/rigid_transform.hpp"
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+#include "packages/velodyne_lidar/gems/worker_pool.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+// Parameters of a `ScanRegistration`
+struct RegistrationOptions {
+  // Number of bins of horizontal angle of the reference range image
+  size_t image_columns = 1800;
+  // Maximum number of Gauss-Newton iterations
+  size_t iterations = 20;
+  // Correspondences which are farther apart in meters are rejected
+  double maximum_distance = 1.0;
+  // Neighbors in the reference image which are farther apart in meters are not used for normals
+  double normal_distance = 3.0;
+  // Only every n-th column of the scan which is aligned is used
+  size_t column_stride = 2;
+  // Number of threads which compute the normal equations
+  size_t threads = 1;
+  // The alignment fails with fewer correspondences
+  size_t minimum_correspondences = 200;
+  // The iteration stops once the update of the rotation in radians plus the update of the
+  // translation in meters is smaller than this
+  double convergence = 1e-5;
+};
+
+// The outcome of aligning a scan to the reference scan
+struct RegistrationResult {
+  // Maps points of the aligned scan into the frame of the reference scan, that is the motion of
+  // the sensor between the two scans
+  RigidTransform transform;
+  size_t iterations = 0;
+  // Number of correspondences and their root mean square point-to-plane distance in meters in
+  // the last iteration
+  size_t correspondences = 0;
+  double rms_error = 0.0;
+  // True if the iteration stopped before the maximum number of iterations
+  bool converged = false;
+  // Acquisition times of the aligned revolution and of the reference revolution as passed to
+  // `endRevolution`
+  int64_t source_timestamp = 0;
+  int64_t target_timestamp = 0;
+};
+
+// Scan-to-scan registration with projective data association. The reference scan is kept as a
+// range image with rows sorted by elevation and columns binned by horizontal angle, together with
+// a normal per pixel from its neighbors. Every point of the aligned scan is transformed with the
+// current estimate and projected into the image, and the pixel it lands on is its correspondence.
+// This replaces the nearest neighbor search of ICP with a few arithmetic operations per point.
+// The point-to-plane error is minimized with Gauss-Newton iterations whose normal equations are
+// computed in parallel by the threads of a `WorkerPool` and summed.
+//
+// As a product writer it collects the columns of every revolution of the sensor, and `update`
+// aligns the last completed revolution to the one before. Alternatively `start` aligns every
+// completed revolution on a background thread, thus the alignment of several milliseconds does
+// not delay the thread which writes the columns.
+class ScanRegistration : public ProductWriter {
+ public:
+  // Called with the outcome of aligning a revolution and true if the alignment succeeded
+  using Callback = std::function<void(bool aligned, const RegistrationResult& result)>;
+
+  // The vertical angles of the sensor need to be known
+  ScanRegistration(const VelodyneLidarParameters& parameters, const RegistrationOptions& options);
+  ~ScanRegistration();
+
+  // Revolutions span scans
+  void begin() override {}
+  void write(const uint16_t* ranges, const uint8_t* intensities, const double* thetas,
+             size_t count) override;
+  // Keeps the collected columns and `timestamp` as the last completed revolution
+  void endRevolution(int64_t timestamp) override;
+  // Number of revolutions which were completed
+  uint64_t revolutions() const { return revolutions_; }
+  // Aligns the last completed revolution to the previous one starting at `guess` and makes it the
+  // new reference. Returns false if there is no previous revolution or the alignment failed.
+  // Must not be called while the background thread runs.
+  bool update(const RigidTransform& guess, RegistrationResult& result);
+
+  // Starts a background thread which aligns every completed revolution like `update` starting at
+  // the motion of the previous one, and calls `callback` from there. A revolution which completes
+  // while the previous one is aligned is skipped, thus `endRevolution` never waits.
+  void start(Callback callback);
+  // Waits for the alignment in progress and stops the background thread
+  void stop();
+  // Number of revolutions which were skipped by the background thread
+  uint64_t skippedRevolutions() const { return skipped_revolutions_; }
+
+  // Replaces the reference scan with `count` columns in the layout of `ColumnBuffers`
+  void setReference(const uint16_t* ranges, const double* thetas, size_t count);
+  // True if a reference scan was set
+  bool hasReference() const { return has_reference_; }
+  // Aligns `count` columns to the reference scan starting at `guess`. Returns false if there are
+  // too few correspondences or the normal equations are singular.
+  bool align(const uint16_t* ranges, const double* thetas, size_t count,
+             const RigidTransform& guess, RegistrationResult& result);
+
+ private:
+  // The upper triangle of the normal equations, the right-hand side and the squared errors
+  struct Equations {
+    double lhs[21];
+    double rhs[6];
+    double error;
+    size_t count;
+  };
+
+  // Adds the correspondences of points [first, last) under `transform` to `equations`
+  void accumulate(const RigidTransform& transform, size_t first, size_t last,
+                  Equations& equations) const;
+  // Index of the row of the reference image with the elevation whose tangent is closest to
+  // `tangent`, or -1 if there is none
+  int findRow(float tangent) const;
+  // Aligns the completed revolutions until the background thread is stopped
+  void run();
+
+  size_t vertical_beams_;
+  float distance_resolution_;
+  std::vector<float> cos_phis_;
+  std::vector<float> sin_phis_;
+  RegistrationOptions options_;
+  WorkerPool pool_;
+  // Lasers sorted by elevation and the tangents of their elevations
+  std::vector<uint32_t> row_lasers_;
+  std::vector<float> row_tangents_;
+  // Maximum difference of the tangent of a point and its row
+  float row_tolerance_;
+  // The reference range image with three coordinates per pixel for the points and the normals
+  std::vector<float> points_;
+  std::vector<float> normals_;
+  std::vector<uint8_t> valid_;
+  bool has_reference_;
+  // Points of the scan which is aligned
+  std::vector<float> source_;
+  // Columns of the revolution which is collected and of the last completed revolution
+  std::vector<uint16_t> ranges_;
+  std::vector<double> thetas_;
+  std::vector<uint16_t> completed_ranges_;
+  std::vector<double> completed_thetas_;
+  // Acquisition times of the last completed revolution and of the reference scan
+  int64_t completed_timestamp_;
+  int64_t reference_timestamp_;
+  uint64_t revolutions_;
+
+  // The background thread. While it runs the mutex guards the completed revolution and the
+  // reference scan.
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  Callback callback_;
+  bool running_ = false;
+  bool stopping_ = false;
+  uint64_t skipped_revolutions_ = 0;
+};
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
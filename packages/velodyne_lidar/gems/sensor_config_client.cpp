@@ -0,0 +1,311 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "sensor_config_client.hpp"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include "engine/gems/serialization/json.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+// Bits of the settings in the mask of applied settings
+constexpr uint32_t kRpmBit = 1;
+constexpr uint32_t kReturnModeBit = 2;
+constexpr uint32_t kFovBit = 4;
+constexpr uint32_t kPhaseLockBit = 8;
+// Time in seconds between attempts to apply settings if the status is not polled
+constexpr double kRetryPeriod = 1.0;
+// Responses larger than this are cut off. The status of the sensor is less than 1 kB.
+constexpr size_t kMaximumResponseSize = 64 * 1024;
+
+int64_t SteadyNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Reads a value nested two levels deep from a JSON object
+template <typename T>
+T GetNested(const Json& json, const char* outer, const char* inner, T fallback) {
+  const auto it = json.find(outer);
+  if (it == json.end() || !it->is_object()) {
+    return fallback;
+  }
+  const auto value = it->find(inner);
+  if (value == it->end()) {
+    return fallback;
+  }
+  try {
+    return value->get<T>();
+  } catch (...) {
+    return fallback;
+  }
+}
+}  // namespace
+
+SensorConfigClient::~SensorConfigClient() {
+  stop();
+}
+
+bool SensorConfigClient::start(const std::string& ip, int port, const SensorSettings& settings,
+                               double poll_period, double timeout) {
+  stop();
+  in_addr address;
+  if (inet_pton(AF_INET, ip.c_str(), &address) != 1) {
+    errno = EINVAL;
+    return false;
+  }
+  if (::pipe2(wake_fds_, O_NONBLOCK | O_CLOEXEC) != 0) {
+    return false;
+  }
+  ip_ = ip;
+  port_ = port;
+  settings_ = settings;
+  poll_period_ = poll_period;
+  timeout_ms_ = std::max(1, static_cast<int>(timeout * 1000.0));
+  applied_ = 0;
+  settings_applied_ = settings.empty();
+  failed_requests_ = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_requested_ = false;
+    status_ = SensorStatus();
+  }
+  thread_ = std::thread([this] { run(); });
+  return true;
+}
+
+void SensorConfigClient::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_requested_ = true;
+  }
+  condition_.notify_all();
+  if (wake_fds_[1] >= 0) {
+    const char wake = 0;
+    (void)::write(wake_fds_[1], &wake, 1);
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  for (int& fd : wake_fds_) {
+    if (fd >= 0) {
+      ::close(fd);
+      fd = -1;
+    }
+  }
+}
+
+SensorStatus SensorConfigClient::status() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return status_;
+}
+
+void SensorConfigClient::run() {
+  while (true) {
+    if (!settings_applied_ && applySettings()) {
+      settings_applied_ = true;
+    }
+    if (poll_period_ > 0.0) {
+      pollStatus();
+    } else if (settings_applied_) {
+      return;
+    }
+    if (!wait(poll_period_ > 0.0 ? poll_period_ : kRetryPeriod)) {
+      return;
+    }
+  }
+}
+
+bool SensorConfigClient::applySettings() {
+  std::string response;
+  auto apply = [&](uint32_t bit, const std::string& path, const std::string& body) {
+    if ((applied_ & bit) == 0 && request(path, body, response)) {
+      applied_ |= bit;
+    }
+  };
+  if (settings_.rpm) {
+    apply(kRpmBit, "/cgi/setting", "rpm=" + std::to_string(*settings_.rpm));
+  }
+  if (settings_.return_mode) {
+    apply(kReturnModeBit, "/cgi/setting", "returns=" + *settings_.return_mode);
+  }
+  if (settings_.fov) {
+    apply(kFovBit, "/cgi/setting/fov",
+          "start=" + std::to_string(settings_.fov->first) +
+              "&end=" + std::to_string(settings_.fov->second));
+  }
+  if (settings_.phase_lock_offset) {
+    apply(kPhaseLockBit, "/cgi/setting/phaselock",
+          "enabled=on&offset=" + std::to_string(*settings_.phase_lock_offset));
+  }
+  const uint32_t expected = (settings_.rpm ? kRpmBit : 0) |
+                            (settings_.return_mode ? kReturnModeBit : 0) |
+                            (settings_.fov ? kFovBit : 0) |
+                            (settings_.phase_lock_offset ? kPhaseLockBit : 0);
+  return applied_ == expected;
+}
+
+void SensorConfigClient::pollStatus() {
+  std::string response;
+  if (!request("/cgi/status.json", "", response)) {
+    return;
+  }
+  const Json json = Json::parse(response, nullptr, false);
+  if (json.is_discarded() || !json.is_object()) {
+    failed_requests_++;
+    return;
+  }
+  SensorStatus status;
+  status.valid = true;
+  status.timestamp = SteadyNowNs();
+  status.motor_on = GetNested<std::string>(json, "motor", "state", "") == "On";
+  status.motor_rpm = GetNested<double>(json, "motor", "rpm", 0.0);
+  status.phase_locked = GetNested<std::string>(json, "motor", "lock", "") == "On";
+  status.laser_on = GetNested<std::string>(json, "laser", "state", "") == "On";
+  status.pps_state = GetNested<std::string>(json, "gps", "pps_state", "");
+  std::lock_guard<std::mutex> lock(mutex_);
+  status_ = status;
+}
+
+bool SensorConfigClient::request(const std::string& path, const std::string& body,
+                                 std::string& response) {
+  response.clear();
+  const int64_t deadline = SteadyNowNs() + static_cast<int64_t>(timeout_ms_) * 1'000'000;
+  const int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    failed_requests_++;
+    return false;
+  }
+  // Waits until the socket is ready, the deadline passed or the client is stopped
+  bool aborted = false;
+  auto wait_for = [&](int16_t events) {
+    const int remaining = static_cast<int>((deadline - SteadyNowNs()) / 1'000'000);
+    if (remaining <= 0) {
+      return false;
+    }
+    pollfd descriptors[2] = {{fd, events, 0}, {wake_fds_[0], POLLIN, 0}};
+    const int result = ::poll(descriptors, 2, remaining);
+    aborted = result > 0 && descriptors[1].revents != 0;
+    return result > 0 && !aborted && descriptors[0].revents != 0;
+  };
+  // Requests aborted by stop() are not counted as failures
+  auto fail = [&] {
+    ::close(fd);
+    if (!aborted) {
+      failed_requests_++;
+    }
+    return false;
+  };
+
+  sockaddr_in remote{};
+  remote.sin_family = AF_INET;
+  remote.sin_port = htons(static_cast<uint16_t>(port_));
+  inet_pton(AF_INET, ip_.c_str(), &remote.sin_addr);
+  if (::connect(fd, reinterpret_cast<sockaddr*>(&remote), sizeof(remote)) != 0) {
+    int error = errno;
+    if (error != EINPROGRESS || !wait_for(POLLOUT)) {
+      return fail();
+    }
+    socklen_t length = sizeof(error);
+    if (::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) != 0 || error != 0) {
+      return fail();
+    }
+  }
+
+  std::string message = (body.empty() ? "GET " : "POST ") + path + " HTTP/1.0\r\nHost: " + ip_ +
+                        "\r\nConnection: close\r\n";
+  if (!body.empty()) {
+    message += "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: " +
+               std::to_string(body.size()) + "\r\n";
+  }
+  message += "\r\n" + body;
+  size_t sent = 0;
+  while (sent < message.size()) {
+    const ssize_t result =
+        ::send(fd, message.data() + sent, message.size() - sent, MSG_NOSIGNAL);
+    if (result >= 0) {
+      sent += result;
+    } else if ((errno != EAGAIN && errno != EINTR) || !wait_for(POLLOUT)) {
+      return fail();
+    }
+  }
+
+  // The server closes the connection after the response
+  std::string data;
+  char buffer[2048];
+  while (data.size() < kMaximumResponseSize) {
+    const ssize_t result = ::recv(fd, buffer, sizeof(buffer), 0);
+    if (result > 0) {
+      data.append(buffer, result);
+    } else if (result == 0) {
+      break;
+    } else if ((errno != EAGAIN && errno != EINTR) || !wait_for(POLLIN)) {
+      return fail();
+    }
+  }
+  ::close(fd);
+
+  // Status line of the form "HTTP/1.1 200 OK" followed by the header
+  const size_t header_end = data.find("\r\n\r\n");
+  if (data.compare(0, 5, "HTTP/") != 0 || header_end == std::string::npos) {
+    failed_requests_++;
+    return false;
+  }
+  const size_t code_start = data.find(' ');
+  const int code = code_start < header_end ? std::atoi(data.c_str() + code_start + 1) : 0;
+  if (code < 200 || code >= 400) {
+    failed_requests_++;
+    return false;
+  }
+  response = data.substr(header_end + 4);
+  return true;
+}
+
+bool SensorConfigClient::wait(double seconds) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  condition_.wait_for(lock, std::chrono::duration<double>(seconds),
+                      [this] { return stop_requested_; });
+  return !stop_requested_;
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
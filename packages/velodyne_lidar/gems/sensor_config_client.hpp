@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace isaac {
+namespace velodyne_lidar {
+
+// Settings which are applied through the web interface of the sensor. Settings which are not set
+// are left unchanged.
+struct SensorSettings {
+  // Rotation speed in revolutions per minute
+  std::optional<int> rpm;
+  // Return mode: "Strongest", "Last" or "Dual"
+  std::optional<std::string> return_mode;
+  // Start and end azimuth of the field of view in degrees. The sensor only sends packets for this
+  // part of the revolution which is the cheapest way to reduce the packet rate.
+  std::optional<std::pair<int, int>> fov;
+  // If set the rotation is locked to the PPS signal with the given azimuth offset in degrees
+  std::optional<int> phase_lock_offset;
+
+  // True if no setting is set
+  bool empty() const { return !rpm && !return_mode && !fov && !phase_lock_offset; }
+};
+
+// Status reported by the web interface of the sensor
+struct SensorStatus {
+  // False until the status was received for the first time
+  bool valid = false;
+  // Steady clock time in nanoseconds at which the status was received
+  int64_t timestamp = 0;
+  bool motor_on = false;
+  // Measured rotation speed in revolutions per minute
+  double motor_rpm = 0.0;
+  // True if the rotation is locked to the PPS signal
+  bool phase_locked = false;
+  bool laser_on = false;
+  // State of the PPS signal, for example "Absent" or "Locked"
+  std::string pps_state;
+};
+
+// Applies settings to a Velodyne sensor and polls its status through the HTTP interface of the
+// sensor. All network I/O happens on a background thread such that the accessors never block.
+// Settings which could not be applied, for example because the sensor is still booting, are
+// retried with every poll.
+class SensorConfigClient {
+ public:
+  SensorConfigClient() = default;
+  ~SensorConfigClient();
+
+  SensorConfigClient(const SensorConfigClient&) = delete;
+  SensorConfigClient& operator=(const SensorConfigClient&) = delete;
+
+  // Starts the background thread which talks to the web server at the given address. The status
+  // is polled every `poll_period` seconds, or never if it is not positive. Every request is
+  // aborted after `timeout` seconds. Returns false on failure in which case errno is set.
+  bool start(const std::string& ip, int port, const SensorSettings& settings, double poll_period,
+             double timeout);
+  // Stops the background thread. Requests in flight are aborted immediately.
+  void stop();
+
+  // The most recently received status
+  SensorStatus status() const;
+  // True once all settings were applied successfully
+  bool settingsApplied() const { return settings_applied_; }
+  // Number of requests which failed since the client was started
+  uint64_t failedRequests() const { return failed_requests_; }
+
+ private:
+  // Applies the settings and polls the status until stopped
+  void run();
+  // Applies all settings which were not yet applied. Returns true if all of them are applied.
+  bool applySettings();
+  // Requests and parses the status of the sensor
+  void pollStatus();
+  // Sends a request and waits for the response. The request is a POST if `body` is not empty.
+  // Returns false if the request failed or the response has an error status.
+  bool request(const std::string& path, const std::string& body, std::string& response);
+  // Waits for the given number of seconds or until the client is stopped. Returns false if the
+  // client was stopped.
+  bool wait(double seconds);
+
+  std::string ip_;
+  int port_ = 0;
+  SensorSettings settings_;
+  double poll_period_ = 0.0;
+  int timeout_ms_ = 0;
+
+  // Bitmask of the settings which were applied successfully
+  uint32_t applied_ = 0;
+  std::atomic<bool> settings_applied_{false};
+  std::atomic<uint64_t> failed_requests_{0};
+
+  mutable std::mutex mutex_;
+  std::condition_variable condition_;
+  bool stop_requested_ = false;
+  SensorStatus status_;
+
+  // A pipe which wakes the background thread while it waits for the network
+  int wake_fds_[2] = {-1, -1};
+  std::thread thread_;
+};
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
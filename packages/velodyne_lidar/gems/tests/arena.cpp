@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <atomic>
+#include <cstdint>
+
+#include "gtest/gtest.h"
+#include "packages/velodyne_lidar/gems/arena.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+TEST(Arena, AllocatesAlignedContiguousBuffers) {
+  Arena arena;
+  ASSERT_TRUE(arena.open(10000, HugePages::kNone));
+  EXPECT_GE(arena.size(), 10000u);
+  EXPECT_EQ(arena.used(), 0u);
+
+  uint8_t* first = static_cast<uint8_t*>(arena.allocate(100));
+  uint8_t* second = static_cast<uint8_t*>(arena.allocate(100, 4096));
+  double* third = arena.allocate<double>(10);
+  ASSERT_NE(first, nullptr);
+  ASSERT_NE(second, nullptr);
+  ASSERT_NE(third, nullptr);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(first) % Arena::kDefaultAlignment, 0u);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(second) % 4096, 0u);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(third) % Arena::kDefaultAlignment, 0u);
+  EXPECT_LT(first, second);
+  EXPECT_LT(second, reinterpret_cast<uint8_t*>(third));
+  EXPECT_LE(reinterpret_cast<uint8_t*>(third + 10), first + arena.size());
+  for (int i = 0; i < 10; i++) {
+    EXPECT_EQ(third[i], 0.0);
+  }
+}
+
+TEST(Arena, FootprintIsSufficient) {
+  Arena arena;
+  const size_t size = Arena::Footprint(100) + Arena::Footprint(1000, 4096) + Arena::Footprint(8);
+  ASSERT_TRUE(arena.open(size, HugePages::kNone));
+  EXPECT_NE(arena.allocate(100), nullptr);
+  EXPECT_NE(arena.allocate(1000, 4096), nullptr);
+  EXPECT_NE(arena.allocate(8), nullptr);
+}
+
+TEST(Arena, Exhausted) {
+  Arena arena;
+  ASSERT_TRUE(arena.open(1000, HugePages::kNone));
+  EXPECT_NE(arena.allocate(arena.size()), nullptr);
+  EXPECT_EQ(arena.allocate(1), nullptr);
+  EXPECT_EQ(arena.allocate<std::atomic<uint64_t>>(1), nullptr);
+  arena.close();
+  EXPECT_EQ(arena.allocate(1), nullptr);
+  EXPECT_FALSE(arena.open(0, HugePages::kNone));
+}
+
+TEST(Arena, HugePagesFallBack) {
+  // Depending on the system the arena falls back to transparent huge pages or regular pages
+  for (HugePages huge_pages : {HugePages::kExplicit, HugePages::kTransparent}) {
+    Arena arena;
+    ASSERT_TRUE(arena.open(3 * 1000 * 1000, huge_pages)) << HugePagesName(huge_pages);
+    EXPECT_LE(static_cast<int>(arena.pages()), static_cast<int>(huge_pages));
+    if (arena.pages() != HugePages::kNone) {
+      EXPECT_EQ(arena.size() % (2 * 1024 * 1024), 0u);
+    }
+    uint8_t* buffer = static_cast<uint8_t*>(arena.allocate(3 * 1000 * 1000));
+    ASSERT_NE(buffer, nullptr);
+    buffer[0] = 1;
+    buffer[3 * 1000 * 1000 - 1] = 1;
+  }
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "packages/velodyne_lidar/gems/black_box.hpp"
+#include "packages/velodyne_lidar/gems/pcap_reader.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+constexpr size_t kPacketSize = 1206;
+constexpr uint16_t kPort = 2368;
+constexpr uint32_t kSourceIp = 0xC0A802C9;  // 192.168.2.201
+
+// A packet whose bytes all derive from its sequence number
+std::vector<uint8_t> CreatePacket(uint64_t sequence) {
+  std::vector<uint8_t> packet(kPacketSize);
+  for (size_t i = 0; i < kPacketSize; i++) {
+    packet[i] = static_cast<uint8_t>(sequence + i);
+  }
+  return packet;
+}
+
+// Returns the sequence number of a packet created with `CreatePacket`, or -1 if it is torn
+int64_t PacketSequence(const UdpPacket& packet, uint64_t minimum) {
+  if (packet.size != kPacketSize) {
+    return -1;
+  }
+  // The first byte determines the sequence number modulo 256
+  uint64_t sequence = minimum + static_cast<uint8_t>(packet.payload[0] - minimum);
+  for (size_t i = 0; i < kPacketSize; i++) {
+    if (packet.payload[i] != static_cast<uint8_t>(sequence + i)) {
+      return -1;
+    }
+  }
+  return sequence;
+}
+
+// A file in the test's temporary directory
+std::string TemporaryFile(const std::string& name) {
+  const char* directory = std::getenv("TEST_TMPDIR");
+  return std::string(directory != nullptr ? directory : "/tmp") + "/" + name + "_" +
+         std::to_string(::getpid()) + ".pcap";
+}
+}  // namespace
+
+TEST(BlackBox, DumpsMostRecentPackets) {
+  Arena arena;
+  ASSERT_TRUE(arena.open(BlackBox::ArenaSize(kPacketSize, 100), HugePages::kNone));
+  BlackBox black_box;
+  ASSERT_TRUE(black_box.open(arena, kPacketSize, 100));
+  EXPECT_EQ(black_box.size(), 0u);
+  for (uint64_t i = 0; i < 1000; i++) {
+    black_box.record(CreatePacket(i).data(), 1000 + i);
+  }
+  EXPECT_EQ(black_box.size(), 100u);
+
+  const std::string filename = TemporaryFile("black_box");
+  ASSERT_TRUE(black_box.dump(filename, kPort, kSourceIp));
+  ASSERT_TRUE(black_box.waitForDump());
+  EXPECT_FALSE(black_box.dumping());
+  EXPECT_EQ(black_box.dumpedPackets(), 100u);
+
+  PcapReader reader;
+  ASSERT_TRUE(reader.open(filename));
+  UdpPacket packet;
+  uint64_t expected = 900;
+  while (reader.next(packet)) {
+    EXPECT_EQ(packet.port, kPort);
+    EXPECT_EQ(PacketSequence(packet, expected), static_cast<int64_t>(expected));
+    EXPECT_EQ(packet.timestamp, static_cast<int64_t>(1000 + expected));
+    expected++;
+  }
+  EXPECT_EQ(expected, 1000u);
+  reader.close();
+  std::remove(filename.c_str());
+}
+
+TEST(BlackBox, PartiallyFilled) {
+  Arena arena;
+  ASSERT_TRUE(arena.open(BlackBox::ArenaSize(kPacketSize, 100), HugePages::kNone));
+  BlackBox black_box;
+  ASSERT_TRUE(black_box.open(arena, kPacketSize, 100));
+  for (uint64_t i = 0; i < 10; i++) {
+    black_box.record(CreatePacket(i).data(), i);
+  }
+  const std::string filename = TemporaryFile("black_box_partial");
+  ASSERT_TRUE(black_box.dump(filename, kPort, kSourceIp));
+  ASSERT_TRUE(black_box.waitForDump());
+  EXPECT_EQ(black_box.dumpedPackets(), 10u);
+  std::remove(filename.c_str());
+}
+
+TEST(BlackBox, RecordsWhileDumping) {
+  Arena arena;
+  ASSERT_TRUE(arena.open(BlackBox::ArenaSize(kPacketSize, 256), HugePages::kTransparent));
+  BlackBox black_box;
+  ASSERT_TRUE(black_box.open(arena, kPacketSize, 256));
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> recorded{0};
+  std::thread receiver([&] {
+    for (uint64_t i = 0; !stop; i++) {
+      black_box.record(CreatePacket(i).data(), i);
+      recorded = i + 1;
+    }
+  });
+  while (recorded < 1000) {
+    std::this_thread::yield();
+  }
+
+  // Dump several times while packets are overwritten. Dumped packets are never torn.
+  for (int dump = 0; dump < 10; dump++) {
+    const std::string filename = TemporaryFile("black_box_concurrent");
+    ASSERT_TRUE(black_box.dump(filename, kPort, kSourceIp));
+    ASSERT_TRUE(black_box.waitForDump());
+    EXPECT_LE(black_box.dumpedPackets(), 256u);
+    PcapReader reader;
+    ASSERT_TRUE(reader.open(filename));
+    UdpPacket packet;
+    int64_t previous = -1;
+    while (reader.next(packet)) {
+      // Packets are recorded with their sequence number as timestamp
+      const int64_t sequence = PacketSequence(packet, packet.timestamp);
+      ASSERT_EQ(sequence, packet.timestamp);
+      EXPECT_GT(sequence, previous);
+      previous = sequence;
+    }
+    reader.close();
+    std::remove(filename.c_str());
+  }
+  stop = true;
+  receiver.join();
+}
+
+TEST(BlackBox, SkipsPacketsOverwrittenDuringDump) {
+  // With two slots nearly every packet is overwritten while it is dumped. Packets are copied in
+  // atomic words, thus this test also runs clean with the thread sanitizer.
+  Arena arena;
+  ASSERT_TRUE(arena.open(BlackBox::ArenaSize(kPacketSize, 2), HugePages::kNone));
+  BlackBox black_box;
+  ASSERT_TRUE(black_box.open(arena, kPacketSize, 2));
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> recorded{0};
+  std::thread receiver([&] {
+    for (uint64_t i = 0; !stop; i++) {
+      black_box.record(CreatePacket(i).data(), i);
+      recorded = i + 1;
+    }
+  });
+  while (recorded < 2) {
+    std::this_thread::yield();
+  }
+  for (int dump = 0; dump < 100; dump++) {
+    const std::string filename = TemporaryFile("black_box_overwritten");
+    ASSERT_TRUE(black_box.dump(filename, kPort, kSourceIp));
+    ASSERT_TRUE(black_box.waitForDump());
+    EXPECT_LE(black_box.dumpedPackets(), 2u);
+    PcapReader reader;
+    ASSERT_TRUE(reader.open(filename));
+    UdpPacket packet;
+    while (reader.next(packet)) {
+      ASSERT_EQ(PacketSequence(packet, packet.timestamp), packet.timestamp);
+    }
+    reader.close();
+    std::remove(filename.c_str());
+  }
+  stop = true;
+  receiver.join();
+}
+
+TEST(BlackBox, InvalidArguments) {
+  Arena arena;
+  ASSERT_TRUE(arena.open(BlackBox::ArenaSize(kPacketSize, 100), HugePages::kNone));
+  BlackBox black_box;
+  EXPECT_FALSE(black_box.open(arena, 0, 100));
+  EXPECT_FALSE(black_box.open(arena, kPacketSize, 0));
+  // The arena is too small
+  EXPECT_FALSE(black_box.open(arena, kPacketSize, 200));
+  EXPECT_FALSE(black_box.dump(TemporaryFile("black_box_invalid"), kPort, kSourceIp));
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "packages/velodyne_lidar/gems/column_policies.hpp"
+#include "packages/velodyne_lidar/gems/decoder.hpp"
+#include "packages/velodyne_lidar/gems/tests/corpus.hpp"
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+constexpr double kPi = 3.14159265358979323846;
+
+// All columns decoded from a capture
+struct Columns {
+  std::vector<uint16_t> ranges;
+  std::vector<uint8_t> intensities;
+  std::vector<double> thetas;
+};
+
+// Decodes the corpus in batches of a few columns and applies `policy` while decoding
+template <typename Policy>
+Columns DecodeCorpus(const Corpus& corpus, Policy& policy) {
+  const size_t beams = corpus.parameters.vertical_beams;
+  DecoderOptions options;
+  options.batch_size = 100;
+  Decoder decoder(corpus.parameters, options);
+  const size_t capacity = options.batch_size;
+  std::vector<uint16_t> ranges(capacity * beams);
+  std::vector<uint8_t> intensities(ranges.size());
+  std::vector<double> thetas(capacity);
+  decoder.setOutput({ranges.data(), intensities.data(), thetas.data(), capacity});
+  Columns columns;
+  decoder.setCallback([&](const ColumnBatch& batch) {
+    columns.ranges.insert(columns.ranges.end(), batch.ranges, batch.ranges + batch.size * beams);
+    columns.intensities.insert(columns.intensities.end(), batch.intensities,
+                               batch.intensities + batch.size * beams);
+    columns.thetas.insert(columns.thetas.end(), batch.thetas, batch.thetas + batch.size);
+  });
+  for (size_t i = 0; i < corpus.size(); i++) {
+    decoder.feed(corpus.packet(i), corpus.packetSize(), corpus.timestamps[i], policy);
+  }
+  decoder.finish(policy);
+  return columns;
+}
+
+// Normalizes an angle to [0, 2 pi[
+double NormalizeAngle(double angle) {
+  angle = std::fmod(angle, 2.0 * kPi);
+  return angle < 0.0 ? angle + 2.0 * kPi : angle;
+}
+}  // namespace
+
+TEST(ColumnPolicies, NoPolicyMatchesPlainDecoding) {
+  for (const CorpusEntry& entry : CorpusEntries()) {
+    Corpus corpus;
+    ASSERT_TRUE(LoadCorpus(entry, corpus)) << entry.name;
+    NoColumnPolicy policy;
+    const Columns with_policy = DecodeCorpus(corpus, policy);
+
+    Decoder decoder(corpus.parameters);
+    const size_t beams = corpus.parameters.vertical_beams;
+    const size_t capacity = with_policy.thetas.size() + 1;
+    std::vector<uint16_t> ranges(capacity * beams);
+    std::vector<uint8_t> intensities(ranges.size());
+    std::vector<double> thetas(capacity);
+    decoder.setOutput({ranges.data(), intensities.data(), thetas.data(), capacity});
+    size_t size = 0;
+    decoder.setCallback([&](const ColumnBatch& batch) { size += batch.size; });
+    for (size_t i = 0; i < corpus.size(); i++) {
+      decoder.feed(corpus.packet(i), corpus.packetSize(), corpus.timestamps[i]);
+    }
+    decoder.finish();
+    ASSERT_GT(size, 0u) << entry.name;
+    ASSERT_EQ(size, with_policy.thetas.size()) << entry.name;
+    ranges.resize(size * beams);
+    intensities.resize(size * beams);
+    thetas.resize(size);
+    EXPECT_EQ(ranges, with_policy.ranges) << entry.name;
+    EXPECT_EQ(intensities, with_policy.intensities) << entry.name;
+    EXPECT_EQ(thetas, with_policy.thetas) << entry.name;
+  }
+}
+
+TEST(ColumnPolicies, MaskAndHistogram) {
+  const size_t kBins = 360;
+  const uint16_t kBinSize = 1000;
+  const size_t kRangeBins = 50;
+  for (const CorpusEntry& entry : CorpusEntries()) {
+    Corpus corpus;
+    ASSERT_TRUE(LoadCorpus(entry, corpus)) << entry.name;
+    const size_t beams = corpus.parameters.vertical_beams;
+    NoColumnPolicy none;
+    const Columns plain = DecodeCorpus(corpus, none);
+
+    // Mask a quarter turn for all lasers and everything for the first laser
+    AzimuthMask mask(beams, kBins);
+    mask.mask(0.5 * kPi, kPi);
+    mask.mask(0, -kPi, kPi);
+    RangeHistogram histogram(beams, kBinSize, kRangeBins);
+    PolicyChain<AzimuthMask, RangeHistogram> chain(mask, histogram);
+    const Columns masked = DecodeCorpus(corpus, chain);
+    ASSERT_EQ(masked.thetas, plain.thetas) << entry.name;
+
+    std::vector<uint64_t> expected(beams * kRangeBins, 0);
+    uint64_t masked_rays = 0;
+    for (size_t c = 0; c < plain.thetas.size(); c++) {
+      const double theta = NormalizeAngle(plain.thetas[c]);
+      // Stay away from the edges of the sectors
+      const bool in_sector = theta >= 0.5 * kPi && theta < kPi;
+      const double width = 2.0 * kPi / kBins;
+      const bool near_edge =
+          std::abs(theta - 0.5 * kPi) < width || std::abs(theta - kPi) < width;
+      for (size_t i = 0; i < beams; i++) {
+        const size_t index = c * beams + i;
+        const uint16_t range = masked.ranges[index];
+        if (i == 0 || (in_sector && !near_edge)) {
+          EXPECT_EQ(range, 0) << entry.name;
+          EXPECT_EQ(masked.intensities[index], 0) << entry.name;
+        } else if (!near_edge) {
+          EXPECT_EQ(range, plain.ranges[index]) << entry.name;
+          EXPECT_EQ(masked.intensities[index], plain.intensities[index]) << entry.name;
+        }
+        masked_rays += plain.ranges[index] != 0 && range == 0;
+        // The histogram sees the columns after they were masked
+        if (range != 0) {
+          expected[i * kRangeBins + std::min<size_t>(range / kBinSize, kRangeBins - 1)]++;
+        }
+      }
+    }
+    EXPECT_GT(masked_rays, 0u) << entry.name;
+    EXPECT_EQ(mask.maskedRays(), masked_rays) << entry.name;
+    for (size_t i = 0; i < beams; i++) {
+      for (size_t j = 0; j < kRangeBins; j++) {
+        EXPECT_EQ(histogram.count(i, j), expected[i * kRangeBins + j]) << entry.name;
+      }
+    }
+  }
+}
+
+TEST(ColumnPolicies, ParsesAzimuthMask) {
+  const size_t kBeams = 16;
+  const size_t kBins = 360;
+  AzimuthMask parsed(kBeams, kBins);
+  ASSERT_TRUE(ParseAzimuthMask(Json::parse(R"([
+      {"angles": [-0.5, 0.5]},
+      {"angles": [2.8, 3.4], "lasers": [0, 3, 15]}
+    ])"), parsed));
+  AzimuthMask expected(kBeams, kBins);
+  expected.mask(-0.5, 0.5);
+  for (size_t beam : {0, 3, 15}) {
+    expected.mask(beam, 2.8, 3.4);
+  }
+  for (size_t i = 0; i < kBins; i++) {
+    const double theta = (i + 0.5) * 2.0 * kPi / kBins;
+    std::vector<uint16_t> expected_ranges(kBeams, 1), ranges(kBeams, 1);
+    std::vector<uint8_t> expected_intensities(kBeams, 1), intensities(kBeams, 1);
+    expected(expected_ranges.data(), expected_intensities.data(), kBeams, theta);
+    parsed(ranges.data(), intensities.data(), kBeams, theta);
+    EXPECT_EQ(ranges, expected_ranges) << theta;
+    EXPECT_EQ(intensities, expected_intensities) << theta;
+  }
+  EXPECT_GT(parsed.maskedRays(), 0u);
+  EXPECT_EQ(parsed.maskedRays(), expected.maskedRays());
+
+  AzimuthMask mask(kBeams, kBins);
+  EXPECT_TRUE(ParseAzimuthMask(Json::array(), mask));
+  EXPECT_FALSE(ParseAzimuthMask(Json::object(), mask));
+  EXPECT_FALSE(ParseAzimuthMask(Json::parse(R"([{"angles": [0.5]}])"), mask));
+  EXPECT_FALSE(ParseAzimuthMask(Json::parse(R"([{"angles": [0, 1], "lasers": [16]}])"), mask));
+  EXPECT_FALSE(ParseAzimuthMask(Json::parse(R"([{"angles": [0, 1], "lasers": [-1]}])"), mask));
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "corpus.hpp"
+
+#include "packages/velodyne_lidar/gems/pcap_reader.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+constexpr uint16_t kDataPort = 2368;
+}  // namespace
+
+const std::vector<CorpusEntry>& CorpusEntries() {
+  static const std::vector<CorpusEntry> entries = {
+      {"vlp16", VelodyneModelType::VLP16},
+      {"vlp32c", VelodyneModelType::VLP32C},
+      {"vls128", VelodyneModelType::VLS128},
+  };
+  return entries;
+}
+
+bool LoadCorpus(const CorpusEntry& entry, Corpus& corpus) {
+  corpus.parameters = GetVelodyneParameters(entry.model_type);
+  corpus.packets.clear();
+  corpus.timestamps.clear();
+  PcapReader reader;
+  if (!reader.open(std::string(kTestDataDirectory) + entry.name + ".pcap")) {
+    return false;
+  }
+  UdpPacket packet;
+  while (reader.next(packet, kDataPort)) {
+    if (packet.size == corpus.packetSize()) {
+      corpus.packets.insert(corpus.packets.end(), packet.payload, packet.payload + packet.size);
+      corpus.timestamps.push_back(packet.timestamp);
+    }
+  }
+  return corpus.size() > 0;
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
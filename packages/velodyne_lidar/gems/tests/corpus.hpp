@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+// Directory with the packet corpus and the recorded reference values relative to the runfiles
+constexpr char kTestDataDirectory[] = "packages/velodyne_lidar/gems/tests/data/";
+
+// A capture of the packet corpus
+struct CorpusEntry {
+  const char* name;
+  VelodyneModelType model_type;
+};
+
+// All captures of the packet corpus, one for every sensor model
+const std::vector<CorpusEntry>& CorpusEntries();
+
+// The data packets of a capture stored one after another
+struct Corpus {
+  VelodyneLidarParameters parameters;
+  std::vector<uint8_t> packets;
+  std::vector<int64_t> timestamps;
+
+  // Number of packets
+  size_t size() const { return timestamps.size(); }
+  // Size of a single packet in bytes
+  size_t packetSize() const { return parameters.packet_sans_header_size; }
+  // The payload of the packet with the given index
+  const uint8_t* packet(size_t index) const { return packets.data() + index * packetSize(); }
+};
+
+// Reads the data packets of the given capture. Returns false if the capture can not be read or
+// does not contain any data packets.
+bool LoadCorpus(const CorpusEntry& entry, Corpus& corpus);
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
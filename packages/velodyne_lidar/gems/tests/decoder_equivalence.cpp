@@ -0,0 +1,351 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "engine/gems/serialization/json.hpp"
+#include "gtest/gtest.h"
+#include "packages/velodyne_lidar/gems/channel_kernels.hpp"
+#include "packages/velodyne_lidar/gems/decoder.hpp"
+#include "packages/velodyne_lidar/gems/tests/corpus.hpp"
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+
+// Checks that every variant of the decoder produces the same output for the packet corpus. The
+// scalar decoder is compared against the reference values in `data/decoder_golden.json` and all
+// other channel kernels and the parallel decoder are compared against the scalar decoder.
+//
+// The reference values are not produced by the decoder under test. They are written by
+// `reference_decoder.py` which reads the captures byte by byte following the packet layout of
+// the sensor manuals for all three models. Regenerate them with that script if the corpus changes.
+//
+// Ranges and intensities need to match bit-exactly. Angles are published as 32 bit floats and
+// the reference stores them in microradians, thus they need to match within one microradian.
+// The values computed by the current build are written to `decoder_golden.json` in the
+// undeclared test outputs to help finding the first difference.
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+// The driver publishes a scan for every 5 packets
+constexpr size_t kPacketsPerScan = 5;
+constexpr double kMicroradians = 1e6;
+constexpr double kThetaTolerance = 1.0;  // In microradians
+constexpr size_t kThreadCounts[] = {1, 2, 3, 8};
+
+// A range scan as published by the driver
+struct Scan {
+  size_t valid_columns;
+  std::vector<double> thetas;
+  std::vector<uint16_t> ranges;
+  std::vector<uint8_t> intensities;
+};
+
+// Decodes the corpus into scans in the same way as the driver does
+std::vector<Scan> DecodeScans(const Corpus& corpus, const std::string& kernel,
+                              DecoderStatistics& statistics) {
+  const VelodyneLidarParameters& parameters = corpus.parameters;
+  const size_t beams = parameters.vertical_beams;
+  const size_t columns = kPacketsPerScan * ColumnsPerPacket(parameters);
+  DecoderOptions options;
+  options.batch_size = columns;
+  options.kernel = kernel;
+  Decoder decoder(parameters, options);
+  std::vector<Scan> scans;
+  Scan current;
+  auto reset_buffers = [&] {
+    current.thetas.assign(columns, 0.0);
+    current.ranges.assign(columns * beams, 0xFFFF);
+    current.intensities.assign(columns * beams, 0xFF);
+    decoder.setOutput(
+        {current.ranges.data(), current.intensities.data(), current.thetas.data(), columns});
+  };
+  decoder.setCallback([&](const ColumnBatch& batch) {
+    current.valid_columns = batch.size;
+    FillMissingColumns(batch.size, columns, beams, current.ranges.data(),
+                       current.intensities.data(), current.thetas.data());
+    scans.push_back(current);
+    reset_buffers();
+  });
+  reset_buffers();
+  for (size_t i = 0; i < corpus.size(); i++) {
+    decoder.feed(corpus.packet(i), corpus.packetSize(), corpus.timestamps[i]);
+  }
+  decoder.finish();
+  statistics = decoder.statistics();
+  return scans;
+}
+
+// The 64 bit FNV-1a hash of the given bytes as hexadecimal string
+std::string Hash(const void* data, size_t size) {
+  uint64_t hash = 0xCBF29CE484222325ull;
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+  }
+  char text[17];
+  std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(hash));
+  return text;
+}
+
+Json ToJson(const std::vector<Scan>& scans, const DecoderStatistics& statistics) {
+  Json json;
+  json["statistics"] = {{"packets", statistics.packets},
+                        {"invalid_blocks", statistics.invalid_blocks},
+                        {"columns", statistics.columns},
+                        {"revolutions", statistics.revolutions},
+                        {"lost_packets", statistics.lost_packets}};
+  json["scans"] = Json::array();
+  for (const Scan& scan : scans) {
+    std::vector<int64_t> thetas(scan.thetas.size());
+    for (size_t i = 0; i < thetas.size(); i++) {
+      thetas[i] = std::llround(scan.thetas[i] * kMicroradians);
+    }
+    json["scans"].push_back(
+        {{"valid_columns", scan.valid_columns},
+         {"ranges", Hash(scan.ranges.data(), scan.ranges.size() * sizeof(uint16_t))},
+         {"intensities", Hash(scan.intensities.data(), scan.intensities.size())},
+         {"thetas", thetas}});
+  }
+  return json;
+}
+
+// Writes reference values with one line per scan to keep differences readable
+void WriteGolden(const Json& golden, std::ostream& out) {
+  out << "{";
+  for (auto model = golden.begin(); model != golden.end(); ++model) {
+    out << (model == golden.begin() ? "\n" : ",\n") << "\"" << model.key() << "\": {\n";
+    out << "\"statistics\": " << model.value()["statistics"].dump() << ",\n\"scans\": [";
+    const Json& scans = model.value()["scans"];
+    for (size_t i = 0; i < scans.size(); i++) {
+      out << (i == 0 ? "\n" : ",\n") << scans[i].dump();
+    }
+    out << "\n]}";
+  }
+  out << "\n}\n";
+}
+
+// Compares two scans element by element and reports the first differences
+void ExpectEqualScans(const std::vector<Scan>& expected, const std::vector<Scan>& actual,
+                      size_t beams) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t s = 0; s < expected.size(); s++) {
+    SCOPED_TRACE("scan " + std::to_string(s));
+    ASSERT_EQ(expected[s].valid_columns, actual[s].valid_columns);
+    ASSERT_EQ(expected[s].ranges.size(), actual[s].ranges.size());
+    for (size_t i = 0; i < expected[s].ranges.size(); i++) {
+      ASSERT_EQ(expected[s].ranges[i], actual[s].ranges[i])
+          << "range of column " << i / beams << " beam " << i % beams;
+      ASSERT_EQ(expected[s].intensities[i], actual[s].intensities[i])
+          << "intensity of column " << i / beams << " beam " << i % beams;
+    }
+    for (size_t i = 0; i < expected[s].thetas.size(); i++) {
+      ASSERT_EQ(expected[s].thetas[i], actual[s].thetas[i]) << "angle of column " << i;
+    }
+  }
+}
+
+// Names of all kernels which can be executed on this CPU
+std::vector<std::string> SupportedKernels() {
+  std::vector<std::string> names;
+  for (const ChannelKernelInfo& kernel : ChannelKernels()) {
+    if (kernel.is_supported()) {
+      names.push_back(kernel.name);
+    } else {
+      std::cout << "Skipping kernel '" << kernel.name << "' which this CPU does not support"
+                << std::endl;
+    }
+  }
+  return names;
+}
+
+}  // namespace
+
+TEST(ChannelKernels, MatchScalarKernel) {
+  std::mt19937 rng(1337);
+  std::uniform_int_distribution<int> byte(0, 255);
+  // Values around the range limits are more likely than random ones
+  const uint16_t min_range = 50;
+  const uint16_t max_range = 50000;
+  const uint16_t edge_cases[] = {0, 1, 49, 50, 51, 49999, 50000, 50001, 0x7FFF, 0x8000, 0xFFFF};
+  constexpr size_t kMaximumCount = 40;
+  std::vector<uint8_t> data(kMaximumCount * sizeof(VelodyneRawChannel));
+  const auto* channels = reinterpret_cast<const VelodyneRawChannel*>(data.data());
+  const ChannelKernelInfo* scalar = FindChannelKernel("scalar");
+  ASSERT_NE(scalar, nullptr);
+  for (const std::string& name : SupportedKernels()) {
+    SCOPED_TRACE(name);
+    const ChannelKernelInfo* kernel = FindChannelKernel(name);
+    ASSERT_NE(kernel, nullptr);
+    for (int trial = 0; trial < 100; trial++) {
+      for (size_t i = 0; i < kMaximumCount; i++) {
+        uint16_t distance = static_cast<uint16_t>(byte(rng) | (byte(rng) << 8));
+        if (byte(rng) < 128) {
+          distance = edge_cases[byte(rng) % (sizeof(edge_cases) / sizeof(edge_cases[0]))];
+        }
+        data[3 * i] = static_cast<uint8_t>(distance);
+        data[3 * i + 1] = static_cast<uint8_t>(distance >> 8);
+        data[3 * i + 2] = static_cast<uint8_t>(byte(rng));
+      }
+      for (size_t count = 0; count <= kMaximumCount; count++) {
+        // One more element than needed detects writes past the end
+        std::vector<uint16_t> expected_ranges(count + 1, 0xABCD), ranges(count + 1, 0xABCD);
+        std::vector<uint8_t> expected_intensities(count + 1, 0xAB), intensities(count + 1, 0xAB);
+        scalar->function(channels, count, min_range, max_range, expected_ranges.data(),
+                         expected_intensities.data());
+        kernel->function(channels, count, min_range, max_range, ranges.data(),
+                         intensities.data());
+        ASSERT_EQ(expected_ranges, ranges) << "count " << count;
+        ASSERT_EQ(expected_intensities, intensities) << "count " << count;
+      }
+    }
+  }
+}
+
+TEST(ChannelKernels, FindFastestKernel) {
+  const ChannelKernelInfo* fastest = FindChannelKernel("");
+  ASSERT_NE(fastest, nullptr);
+  EXPECT_TRUE(fastest->is_supported());
+  EXPECT_EQ(FindChannelKernel("unknown"), nullptr);
+  std::cout << "Fastest kernel: " << fastest->name << std::endl;
+}
+
+TEST(DecoderEquivalence, ScalarMatchesGolden) {
+  Json computed;
+  for (const CorpusEntry& entry : CorpusEntries()) {
+    SCOPED_TRACE(entry.name);
+    Corpus corpus;
+    ASSERT_TRUE(LoadCorpus(entry, corpus));
+    DecoderStatistics statistics;
+    computed[entry.name] = ToJson(DecodeScans(corpus, "scalar", statistics), statistics);
+  }
+  const char* directory = std::getenv("TEST_UNDECLARED_OUTPUTS_DIR");
+  if (directory != nullptr) {
+    std::ofstream file(std::string(directory) + "/decoder_golden.json");
+    WriteGolden(computed, file);
+  }
+  const auto golden =
+      serialization::TryLoadJsonFromFile(std::string(kTestDataDirectory) + "decoder_golden.json");
+  ASSERT_TRUE(golden) << "Could not load the reference values";
+
+  for (const CorpusEntry& entry : CorpusEntries()) {
+    SCOPED_TRACE(entry.name);
+    ASSERT_TRUE(golden->count(entry.name));
+    const Json& expected = (*golden)[entry.name];
+    const Json& actual = computed[entry.name];
+    EXPECT_EQ(expected["statistics"], actual["statistics"]);
+    ASSERT_EQ(expected["scans"].size(), actual["scans"].size());
+    for (size_t s = 0; s < expected["scans"].size(); s++) {
+      SCOPED_TRACE("scan " + std::to_string(s));
+      const Json& expected_scan = expected["scans"][s];
+      const Json& actual_scan = actual["scans"][s];
+      EXPECT_EQ(expected_scan["valid_columns"], actual_scan["valid_columns"]);
+      EXPECT_EQ(expected_scan["ranges"], actual_scan["ranges"]);
+      EXPECT_EQ(expected_scan["intensities"], actual_scan["intensities"]);
+      ASSERT_EQ(expected_scan["thetas"].size(), actual_scan["thetas"].size());
+      for (size_t i = 0; i < expected_scan["thetas"].size(); i++) {
+        EXPECT_LE(std::abs(expected_scan["thetas"][i].get<int64_t>() -
+                           actual_scan["thetas"][i].get<int64_t>()),
+                  kThetaTolerance)
+            << "angle of column " << i;
+      }
+    }
+  }
+}
+
+TEST(DecoderEquivalence, KernelsMatchScalar) {
+  for (const CorpusEntry& entry : CorpusEntries()) {
+    SCOPED_TRACE(entry.name);
+    Corpus corpus;
+    ASSERT_TRUE(LoadCorpus(entry, corpus));
+    DecoderStatistics expected_statistics;
+    const std::vector<Scan> expected = DecodeScans(corpus, "scalar", expected_statistics);
+    for (const std::string& kernel : SupportedKernels()) {
+      SCOPED_TRACE(kernel);
+      DecoderStatistics statistics;
+      const std::vector<Scan> actual = DecodeScans(corpus, kernel, statistics);
+      ExpectEqualScans(expected, actual, corpus.parameters.vertical_beams);
+      EXPECT_EQ(expected_statistics.columns, statistics.columns);
+      EXPECT_EQ(expected_statistics.invalid_blocks, statistics.invalid_blocks);
+    }
+  }
+}
+
+TEST(DecoderEquivalence, ParallelMatchesStreaming) {
+  for (const CorpusEntry& entry : CorpusEntries()) {
+    SCOPED_TRACE(entry.name);
+    Corpus corpus;
+    ASSERT_TRUE(LoadCorpus(entry, corpus));
+    const VelodyneLidarParameters& parameters = corpus.parameters;
+    const size_t beams = parameters.vertical_beams;
+    const size_t columns = corpus.size() * ColumnsPerPacket(parameters);
+
+    // All packets fed into a single scalar decoder
+    Scan expected;
+    expected.valid_columns = columns;
+    expected.thetas.resize(columns);
+    expected.ranges.resize(columns * beams);
+    expected.intensities.resize(columns * beams);
+    DecoderOptions options;
+    options.kernel = "scalar";
+    Decoder decoder(parameters, options);
+    decoder.setOutput(
+        {expected.ranges.data(), expected.intensities.data(), expected.thetas.data(), columns});
+    for (size_t i = 0; i < corpus.size(); i++) {
+      decoder.feed(corpus.packet(i), corpus.packetSize(), corpus.timestamps[i]);
+    }
+    decoder.finish();
+    ASSERT_EQ(decoder.statistics().columns, columns);
+
+    for (const std::string& kernel : SupportedKernels()) {
+      for (size_t threads : kThreadCounts) {
+        SCOPED_TRACE(kernel + " with " + std::to_string(threads) + " threads");
+        Scan actual;
+        actual.valid_columns = columns;
+        actual.thetas.assign(columns, 0.0);
+        actual.ranges.assign(columns * beams, 0xFFFF);
+        actual.intensities.assign(columns * beams, 0xFF);
+        DecodePackets(parameters, corpus.packets.data(), corpus.size(), nullptr,
+                      {actual.ranges.data(), actual.intensities.data(), actual.thetas.data(),
+                       columns},
+                      threads, kernel);
+        ExpectEqualScans({expected}, {actual}, beams);
+      }
+    }
+  }
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
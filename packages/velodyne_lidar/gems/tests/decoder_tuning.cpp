@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cstdio>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "packages/velodyne_lidar/gems/channel_kernels.hpp"
+#include "packages/velodyne_lidar/gems/decoder.hpp"
+#include "packages/velodyne_lidar/gems/decoder_tuning.hpp"
+#include "packages/velodyne_lidar/gems/output_products.hpp"
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+TEST(DecoderTuning, ChoosesSupportedKernel) {
+  const VelodyneLidarParameters parameters = GetVelodyneParameters(VelodyneModelType::VLP16);
+  OutputEngine products(parameters.vertical_beams);
+  DecoderTuningOptions options;
+  options.batch_size = 5 * ColumnsPerPacket(parameters);
+  options.budget = 0.002;
+  DecoderTuning tuning;
+  ASSERT_TRUE(TuneDecoder(parameters, products, options, tuning));
+  EXPECT_NE(FindChannelKernel(tuning.kernel), nullptr);
+  EXPECT_EQ(tuning.product_interval, 1u);
+  EXPECT_GT(tuning.column_time, 0.0);
+  size_t supported = 0;
+  for (const ChannelKernelInfo& kernel : ChannelKernels()) {
+    supported += kernel.is_supported() ? 1 : 0;
+  }
+  // Without products the interval is not tuned
+  EXPECT_EQ(tuning.candidates, supported);
+}
+
+TEST(DecoderTuning, ManualChoiceOverrides) {
+  VelodyneLidarParameters parameters = GetVelodyneParameters(VelodyneModelType::VLP16);
+  PointCloudWriter cloud(parameters, PointCloudOptions());
+  OutputEngine products(parameters.vertical_beams);
+  products.add(&cloud);
+  DecoderTuningOptions options;
+  options.batch_size = 5 * ColumnsPerPacket(parameters);
+  options.budget = 0.0;
+  DecoderTuning tuning;
+  ASSERT_TRUE(TuneDecoder(parameters, products, options, tuning));
+  EXPECT_GT(tuning.candidates, 1u);
+  // The products are reset for the driver
+  EXPECT_EQ(products.columns(), 0u);
+  EXPECT_EQ(cloud.size(), 0u);
+
+  options.kernel = "scalar";
+  options.product_interval = 3;
+  ASSERT_TRUE(TuneDecoder(parameters, products, options, tuning));
+  EXPECT_EQ(tuning.kernel, "scalar");
+  EXPECT_EQ(tuning.product_interval, 3u);
+  EXPECT_EQ(tuning.candidates, 1u);
+
+  options.kernel = "unknown";
+  EXPECT_FALSE(TuneDecoder(parameters, products, options, tuning));
+}
+
+TEST(DecoderTuning, Cache) {
+  const VelodyneLidarParameters parameters = GetVelodyneParameters(VelodyneModelType::VLP32C);
+  DecoderTuningOptions options;
+  const std::string key = DecoderTuningKey(parameters, options, "");
+  const std::string other_key = DecoderTuningKey(parameters, options, "cloud");
+  EXPECT_NE(key, other_key);
+  options.kernel = "scalar";
+  EXPECT_NE(DecoderTuningKey(parameters, options, ""), key);
+
+  const std::string filename = ::testing::TempDir() + "velodyne_decoder_tuning.json";
+  std::remove(filename.c_str());
+  DecoderTuning tuning;
+  EXPECT_FALSE(LoadDecoderTuning(filename, key, tuning));
+  ASSERT_TRUE(StoreDecoderTuning(filename, key, {"scalar", 4, 1.5, 12}));
+  ASSERT_TRUE(StoreDecoderTuning(filename, other_key, {"scalar", 2, 3.0, 12}));
+  ASSERT_TRUE(LoadDecoderTuning(filename, key, tuning));
+  EXPECT_EQ(tuning.kernel, "scalar");
+  EXPECT_EQ(tuning.product_interval, 4u);
+  EXPECT_DOUBLE_EQ(tuning.column_time, 1.5);
+  EXPECT_EQ(tuning.candidates, 0u);
+  ASSERT_TRUE(LoadDecoderTuning(filename, other_key, tuning));
+  EXPECT_EQ(tuning.product_interval, 2u);
+  EXPECT_FALSE(LoadDecoderTuning(filename, "missing", tuning));
+  // Kernels which are not available in this build are ignored
+  ASSERT_TRUE(StoreDecoderTuning(filename, key, {"unknown", 4, 1.5, 12}));
+  EXPECT_FALSE(LoadDecoderTuning(filename, key, tuning));
+  std::remove(filename.c_str());
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
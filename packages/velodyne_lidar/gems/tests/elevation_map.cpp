@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "packages/velodyne_lidar/gems/elevation_map.hpp"
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+constexpr double kPi = 3.14159265358979323846;
+
+// Writes a single column with a return at `range` meters for every beam
+void WriteColumn(const VelodyneLidarParameters& parameters, double theta, double range,
+                 ElevationMap& map) {
+  const std::vector<uint16_t> ranges(parameters.vertical_beams,
+                                     static_cast<uint16_t>(range / parameters.distance_resolution));
+  const std::vector<uint8_t> intensities(parameters.vertical_beams, 0);
+  map.write(ranges.data(), intensities.data(), &theta, 1);
+}
+
+// The layers index of the cell with the given world coordinates in cells
+size_t LayerIndex(const ElevationLayers& layers, int64_t x, int64_t y) {
+  return (y - layers.origin_y) * layers.cells + (x - layers.origin_x);
+}
+}  // namespace
+
+TEST(ElevationMap, MapsGroundPlane) {
+  const VelodyneLidarParameters parameters = GetVelodyneParameters(VelodyneModelType::VLP16);
+  ElevationMapOptions options;
+  options.extrinsic.translation = {0.0, 0.0, 1.0};
+  options.clear_at_revolution = false;
+  ElevationMap map(parameters, options);
+  // The beams which look down hit the ground one meter below the sensor
+  const size_t columns = 1800;
+  std::vector<uint16_t> ranges;
+  std::vector<double> thetas;
+  for (size_t c = 0; c < columns; c++) {
+    thetas.push_back(-2.0 * kPi * c / columns);
+    for (double phi : parameters.vertical_angles) {
+      ranges.push_back(phi < -0.05 ? static_cast<uint16_t>(
+          -1.0 / std::sin(phi) / parameters.distance_resolution) : 0);
+    }
+  }
+  const std::vector<uint8_t> intensities(ranges.size(), 0);
+  map.write(ranges.data(), intensities.data(), thetas.data(), columns);
+
+  ElevationLayers layers;
+  map.snapshot(layers);
+  ASSERT_EQ(layers.cells, options.cells);
+  size_t cells = 0;
+  for (size_t i = 0; i < layers.count.size(); i++) {
+    if (layers.count[i] == 0) {
+      EXPECT_TRUE(std::isnan(layers.mean[i]));
+      continue;
+    }
+    cells++;
+    EXPECT_NEAR(layers.mean[i], 0.0f, 0.01f);
+    EXPECT_LE(layers.minimum[i], layers.mean[i]);
+    EXPECT_GE(layers.maximum[i], layers.mean[i]);
+  }
+  EXPECT_GT(cells, 100u);
+  // The sensor does not see the ground right below itself
+  EXPECT_EQ(layers.count[LayerIndex(layers, 0, 0)], 0u);
+}
+
+TEST(ElevationMap, AppliesExtrinsic) {
+  const VelodyneLidarParameters parameters = GetVelodyneParameters(VelodyneModelType::VLP16);
+  ElevationMapOptions options;
+  // The sensor looks to the left of the robot
+  options.extrinsic.rotation = {0.0, -1.0, 0.0, 1.0, 0.0, 0.0, 0.0, 0.0, 1.0};
+  ElevationMap map(parameters, options);
+  WriteColumn(parameters, 0.0, 3.0, map);
+  ElevationLayers layers;
+  map.snapshot(layers);
+  // All beams of the VLP16 are within 15 degrees of the horizon
+  const size_t i = LayerIndex(layers, 0, 14);
+  EXPECT_EQ(layers.count[i], parameters.vertical_beams);
+  EXPECT_NEAR(layers.maximum[i], 3.0 * std::sin(15.0 * kPi / 180.0), 0.01);
+  EXPECT_NEAR(layers.minimum[i], -3.0 * std::sin(15.0 * kPi / 180.0), 0.01);
+  EXPECT_NEAR(layers.mean[i], 0.0, 0.01);
+  EXPECT_EQ(layers.count[LayerIndex(layers, 14, 0)], 0u);
+
+  // The pose of the robot is applied after the extrinsic
+  map.clear();
+  map.setPose(1.0, 0.0, kPi / 2.0);
+  WriteColumn(parameters, 0.0, 3.0, map);
+  map.snapshot(layers);
+  EXPECT_EQ(layers.count[LayerIndex(layers, -10, 0)], parameters.vertical_beams);
+}
+
+TEST(ElevationMap, CompletesRevolutions) {
+  const VelodyneLidarParameters parameters = GetVelodyneParameters(VelodyneModelType::VLP16);
+  ElevationMapOptions options;
+  options.minimum_height = -0.1;
+  options.maximum_height = 0.1;
+  ElevationMap map(parameters, options);
+  for (int c = 0; c < 360; c++) {
+    WriteColumn(parameters, -2.0 * kPi * c / 360, 5.0, map);
+  }
+  EXPECT_EQ(map.revolutions(), 0u);
+  map.endRevolution(0);
+  ASSERT_EQ(map.revolutions(), 1u);
+  // The next revolution starts with an empty map
+  WriteColumn(parameters, 0.0, 5.0, map);
+  const ElevationLayers& completed = map.completed();
+  // Only the beams at -1 and +1 degrees are within the band of heights
+  uint32_t points = 0;
+  for (uint32_t count : completed.count) points += count;
+  EXPECT_EQ(points, 720u);
+  EXPECT_GT(completed.count[LayerIndex(completed, 24, 0)], 0u);
+  EXPECT_GT(completed.count[LayerIndex(completed, 0, 24)], 0u);
+  EXPECT_GT(completed.count[LayerIndex(completed, -25, 0)], 0u);
+  ElevationLayers current;
+  map.snapshot(current);
+  EXPECT_EQ(current.count[LayerIndex(current, 24, 0)], 2u);
+  EXPECT_EQ(current.count[LayerIndex(current, 0, 24)], 0u);
+}
+
+TEST(ElevationMap, RollsWithRobot) {
+  const VelodyneLidarParameters parameters = GetVelodyneParameters(VelodyneModelType::VLP16);
+  ElevationMapOptions options;
+  options.clear_at_revolution = false;
+  ElevationMap map(parameters, options);
+  WriteColumn(parameters, 0.0, 20.0, map);
+  WriteColumn(parameters, -kPi, 20.0, map);
+  ElevationLayers layers;
+  map.snapshot(layers);
+  EXPECT_EQ(layers.origin_x, -128);
+  EXPECT_GT(layers.count[LayerIndex(layers, 99, 0)], 0u);
+  EXPECT_GT(layers.count[LayerIndex(layers, -100, 0)], 0u);
+
+  // Moving by forty cells drops the cells behind the robot
+  map.setPose(8.0, 0.0, 0.0);
+  map.snapshot(layers);
+  EXPECT_EQ(layers.origin_x, -88);
+  EXPECT_GT(layers.count[LayerIndex(layers, 99, 0)], 0u);
+  map.setPose(0.0, 0.0, 0.0);
+  map.snapshot(layers);
+  EXPECT_EQ(layers.count[LayerIndex(layers, -100, 0)], 0u);
+  EXPECT_GT(layers.count[LayerIndex(layers, 99, 0)], 0u);
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
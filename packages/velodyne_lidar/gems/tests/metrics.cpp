@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <regex>
+#include <sstream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "packages/velodyne_lidar/gems/metrics.hpp"
+#include "packages/velodyne_lidar/gems/metrics_server.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+// A port on the loopback interface which is currently free
+int FreePort() {
+  const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t length = sizeof(address);
+  if (::bind(fd, reinterpret_cast<sockaddr*>(&address), length) != 0 ||
+      ::getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+    ::close(fd);
+    return -1;
+  }
+  ::close(fd);
+  return ntohs(address.sin_port);
+}
+
+// Sends a GET request to the loopback interface and returns the whole response, or an empty
+// string if the connection failed
+std::string Get(int port, const std::string& path) {
+  const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(static_cast<uint16_t>(port));
+  if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+    ::close(fd);
+    return "";
+  }
+  const std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  ::send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+  std::string response;
+  char buffer[4096];
+  ssize_t length;
+  while ((length = ::recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+    response.append(buffer, length);
+  }
+  ::close(fd);
+  return response;
+}
+
+// The line of the exposition which starts with the given text
+std::string FindLine(const std::string& text, const std::string& start) {
+  std::istringstream lines(text);
+  std::string line;
+  while (std::getline(lines, line)) {
+    if (line.compare(0, start.size(), start) == 0) {
+      return line;
+    }
+  }
+  return "";
+}
+
+// The value of the sample with the given name and labels
+double Sample(const std::string& text, const std::string& series) {
+  const std::string line = FindLine(text, series + " ");
+  return line.empty() ? NAN : std::stod(line.substr(series.size() + 1));
+}
+}  // namespace
+
+TEST(Histogram, EmptyHistogramHasNoQuantiles) {
+  Histogram histogram;
+  EXPECT_EQ(histogram.quantile(0.5), 0.0);
+  EXPECT_EQ(histogram.count(), 0u);
+}
+
+TEST(Histogram, InterpolatesWithinBucket) {
+  // All observations fall into the first bucket which covers [0, 100] ns
+  Histogram histogram;
+  for (int i = 0; i < 100; i++) {
+    histogram.observe(50);
+  }
+  EXPECT_DOUBLE_EQ(histogram.quantile(0.5), 50.0);
+  EXPECT_DOUBLE_EQ(histogram.quantile(0.9), 90.0);
+  EXPECT_DOUBLE_EQ(histogram.quantile(1.0), 100.0);
+  EXPECT_EQ(histogram.count(), 100u);
+  EXPECT_EQ(histogram.sum(), 5000);
+}
+
+TEST(Histogram, QuantilesAreAccurateWithinOneBucket) {
+  // Buckets grow by sqrt(2), thus an estimate is within that factor of the true quantile
+  Histogram histogram;
+  for (int64_t i = 1; i <= 100000; i++) {
+    histogram.observe(i * 10);
+  }
+  for (double q : {0.1, 0.5, 0.9, 0.99}) {
+    const double expected = q * 1000000.0;
+    EXPECT_LE(histogram.quantile(q), expected * std::sqrt(2.0)) << q;
+    EXPECT_GE(histogram.quantile(q), expected / std::sqrt(2.0)) << q;
+  }
+  // Quantiles never decrease
+  EXPECT_LE(histogram.quantile(0.5), histogram.quantile(0.9));
+  EXPECT_LE(histogram.quantile(0.9), histogram.quantile(0.99));
+}
+
+TEST(Histogram, LargeValuesSaturate) {
+  Histogram histogram;
+  histogram.observe(int64_t{1} << 62);
+  const double bound = 100.0 * std::exp2(0.5 * (Histogram::kBuckets - 1));
+  EXPECT_DOUBLE_EQ(histogram.quantile(1.0), bound);
+}
+
+TEST(MetricsRegistry, RendersTextExposition) {
+  auto metrics = std::make_shared<SensorMetrics>("front");
+  metrics->packets.add(40);
+  metrics->packets.add(2);
+  metrics->lost_packets.set(7);
+  metrics->rpm.set(600.5);
+  for (int i = 0; i < 10; i++) {
+    metrics->decode_time.observe(50);
+  }
+  MetricsRegistry::Get().add(metrics);
+  const std::string text = MetricsRegistry::Get().render();
+
+  EXPECT_FALSE(FindLine(text, "# HELP velodyne_packets_total ").empty());
+  EXPECT_EQ(FindLine(text, "# TYPE velodyne_packets_total"),
+            "# TYPE velodyne_packets_total counter");
+  EXPECT_EQ(FindLine(text, "# TYPE velodyne_rpm"), "# TYPE velodyne_rpm gauge");
+  EXPECT_EQ(FindLine(text, "# TYPE velodyne_decode_seconds"),
+            "# TYPE velodyne_decode_seconds summary");
+  EXPECT_EQ(Sample(text, "velodyne_packets_total{sensor=\"front\"}"), 42.0);
+  EXPECT_EQ(Sample(text, "velodyne_lost_packets_total{sensor=\"front\"}"), 7.0);
+  EXPECT_EQ(Sample(text, "velodyne_rpm{sensor=\"front\"}"), 600.5);
+  // Durations are exported in seconds
+  EXPECT_DOUBLE_EQ(Sample(text, "velodyne_decode_seconds{sensor=\"front\",quantile=\"0.5\"}"),
+                   50e-9);
+  EXPECT_DOUBLE_EQ(Sample(text, "velodyne_decode_seconds_sum{sensor=\"front\"}"), 500e-9);
+  EXPECT_EQ(Sample(text, "velodyne_decode_seconds_count{sensor=\"front\"}"), 10.0);
+
+  // Every line is a comment or a sample with labels and a value
+  const std::regex sample(R"(velodyne_[a-z_]+\{sensor="front"(,quantile="[0-9.]+")?\} \S+)");
+  const std::regex comment(R"(# (HELP velodyne_[a-z_]+ .+|TYPE velodyne_[a-z_]+ )"
+                           R"((counter|gauge|summary)))");
+  std::istringstream lines(text);
+  std::string line;
+  while (std::getline(lines, line)) {
+    EXPECT_TRUE(std::regex_match(line, sample) || std::regex_match(line, comment)) << line;
+  }
+
+  MetricsRegistry::Get().remove(metrics);
+  EXPECT_TRUE(FindLine(MetricsRegistry::Get().render(), "velodyne_packets_total{").empty());
+}
+
+TEST(MetricsRegistry, EscapesSensorNames) {
+  // Longer than the line buffer and with characters which need to be escaped
+  const std::string name = std::string(300, 'x') + "\"a\\b\nc";
+  auto metrics = std::make_shared<SensorMetrics>(name);
+  metrics->packets.add(42);
+  MetricsRegistry::Get().add(metrics);
+  const std::string text = MetricsRegistry::Get().render();
+  MetricsRegistry::Get().remove(metrics);
+
+  const std::string label = std::string(300, 'x') + "\\\"a\\\\b\\nc";
+  EXPECT_EQ(Sample(text, "velodyne_packets_total{sensor=\"" + label + "\"}"), 42.0);
+  EXPECT_EQ(Sample(text, "velodyne_decode_seconds_count{sensor=\"" + label + "\"}"), 0.0);
+  // The newline in the name does not break a sample into two lines
+  EXPECT_EQ(text.find("\nc\"}"), std::string::npos);
+}
+
+TEST(MetricsServer, ServesMetricsOnLoopback) {
+  auto metrics = std::make_shared<SensorMetrics>("server_test");
+  metrics->scans.add(3);
+  MetricsRegistry::Get().add(metrics);
+  const int port = FreePort();
+  ASSERT_GT(port, 0);
+  std::shared_ptr<MetricsServer> server = MetricsServer::Acquire(port);
+  ASSERT_NE(server, nullptr);
+
+  const std::string response = Get(port, "/metrics");
+  EXPECT_EQ(response.compare(0, 15, "HTTP/1.0 200 OK"), 0) << response;
+  EXPECT_NE(response.find("Content-Type: text/plain; version=0.0.4\r\n"), std::string::npos);
+  const size_t body = response.find("\r\n\r\n");
+  ASSERT_NE(body, std::string::npos);
+  EXPECT_NE(response.find("\r\nContent-Length: " + std::to_string(response.size() - body - 4) +
+                          "\r\n"),
+            std::string::npos);
+  EXPECT_EQ(Sample(response.substr(body + 4), "velodyne_scans_total{sensor=\"server_test\"}"),
+            3.0);
+
+  const std::string missing = Get(port, "/status");
+  EXPECT_EQ(missing.compare(0, 22, "HTTP/1.0 404 Not Found"), 0) << missing;
+
+  MetricsRegistry::Get().remove(metrics);
+}
+
+TEST(MetricsServer, DriversShareServerPerPort) {
+  const int port = FreePort();
+  ASSERT_GT(port, 0);
+  std::shared_ptr<MetricsServer> first = MetricsServer::Acquire(port);
+  std::shared_ptr<MetricsServer> second = MetricsServer::Acquire(port);
+  ASSERT_NE(first, nullptr);
+  EXPECT_EQ(first, second);
+
+  // The server stops once the last driver releases it, after which the port can be used again
+  first.reset();
+  EXPECT_FALSE(Get(port, "/metrics").empty());
+  second.reset();
+  EXPECT_TRUE(Get(port, "/metrics").empty());
+  std::shared_ptr<MetricsServer> third = MetricsServer::Acquire(port);
+  ASSERT_NE(third, nullptr);
+  EXPECT_FALSE(Get(port, "/metrics").empty());
+}
+
+TEST(MetricsServer, FailsIfPortIsTaken) {
+  const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t length = sizeof(address);
+  ASSERT_EQ(::bind(fd, reinterpret_cast<sockaddr*>(&address), length), 0);
+  ASSERT_EQ(::listen(fd, 1), 0);
+  ASSERT_EQ(::getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length), 0);
+  EXPECT_EQ(MetricsServer::Acquire(ntohs(address.sin_port)), nullptr);
+  ::close(fd);
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
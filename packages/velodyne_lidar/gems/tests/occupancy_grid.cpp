@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "packages/velodyne_lidar/gems/occupancy_grid.hpp"
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+constexpr double kPi = 3.14159265358979323846;
+
+// Columns all around the sensor with a return at `range` meters for every beam
+struct Ring {
+  Ring(const VelodyneLidarParameters& parameters, size_t columns, double range) {
+    ranges.resize(columns * parameters.vertical_beams,
+                  static_cast<uint16_t>(range / parameters.distance_resolution));
+    intensities.resize(ranges.size(), 0);
+    for (size_t c = 0; c < columns; c++) {
+      thetas.push_back(-2.0 * kPi * c / columns);
+    }
+  }
+
+  void write(OccupancyGrid& grid) const {
+    grid.write(ranges.data(), intensities.data(), thetas.data(), thetas.size());
+  }
+
+  std::vector<uint16_t> ranges;
+  std::vector<uint8_t> intensities;
+  std::vector<double> thetas;
+};
+
+// The cell in which a return at `range` meters of a beam at 1 degree ends
+int64_t HitCell(const VelodyneLidarParameters& parameters, double range, double cell_size) {
+  const uint16_t raw = static_cast<uint16_t>(range / parameters.distance_resolution);
+  return static_cast<int64_t>(
+      std::floor(raw * parameters.distance_resolution * std::cos(kPi / 180.0) / cell_size));
+}
+}  // namespace
+
+TEST(OccupancyGrid, CastsColumns) {
+  const VelodyneLidarParameters parameters = GetVelodyneParameters(VelodyneModelType::VLP16);
+  OccupancyGridOptions options;
+  OccupancyGrid grid(parameters, options);
+  // The VLP16 has beams at -1 and +1 degrees
+  ASSERT_EQ(grid.beams(), 2u);
+  Ring(parameters, 3600, 3.0).write(grid);
+  const int64_t hit = HitCell(parameters, 3.0, options.cell_size);
+  EXPECT_GT(grid.logOdds(hit, 0), 0);
+  EXPECT_GT(grid.logOdds(-hit - 1, 0), 0);
+  EXPECT_GT(grid.logOdds(0, hit), 0);
+  EXPECT_LT(grid.logOdds(hit - 5, 0), 0);
+  EXPECT_LT(grid.logOdds(-10, -10), 0);
+  EXPECT_EQ(grid.logOdds(hit + 5, 0), 0);
+  EXPECT_EQ(grid.logOdds(hit + 5, hit + 5), 0);
+  // Far outside of the window
+  EXPECT_EQ(grid.logOdds(10000, 0), 0);
+
+  // A single column changes the log-odds once per cell
+  grid.clear();
+  Ring(parameters, 1, 3.0).write(grid);
+  EXPECT_EQ(grid.logOdds(hit, 0), options.hit);
+  EXPECT_EQ(grid.logOdds(hit / 2, 0), options.miss);
+  // The log-odds saturate
+  for (int i = 0; i < 20; i++) {
+    Ring(parameters, 360, 3.0).write(grid);
+  }
+  EXPECT_EQ(grid.logOdds(hit, 0), options.maximum);
+  EXPECT_EQ(grid.logOdds(hit / 2, 0), options.minimum);
+
+  // Columns without returns do not change the grid
+  std::vector<int16_t> before(grid.cells() * grid.cells());
+  grid.copy(before.data());
+  Ring(parameters, 360, 0.0).write(grid);
+  std::vector<int16_t> after(before.size());
+  grid.copy(after.data());
+  EXPECT_EQ(before, after);
+}
+
+TEST(OccupancyGrid, RollsWithSensor) {
+  const VelodyneLidarParameters parameters = GetVelodyneParameters(VelodyneModelType::VLP16);
+  OccupancyGridOptions options;
+  options.cells = 512;
+  OccupancyGrid grid(parameters, options);
+  EXPECT_EQ(grid.originX(), -256);
+  Ring(parameters, 7200, 25.0).write(grid);
+  const int64_t hit = HitCell(parameters, 25.0, options.cell_size);
+  ASSERT_GT(grid.logOdds(-hit - 1, 0), 0);
+  ASSERT_GT(grid.logOdds(hit, 0), 0);
+  ASSERT_GT(hit + 1, 256 - 10);
+
+  // Moving by ten cells drops the cells behind the sensor and keeps the others in place
+  grid.setPose(1.05, 0.0, 0.0);
+  EXPECT_EQ(grid.originX(), -246);
+  EXPECT_EQ(grid.originY(), -256);
+  EXPECT_EQ(grid.logOdds(-hit - 1, 0), 0);
+  EXPECT_GT(grid.logOdds(hit, 0), 0);
+  EXPECT_LT(grid.logOdds(0, 0), 0);
+  // The cells which entered the window are unknown
+  for (int64_t x = 256; x < 266; x++) {
+    EXPECT_EQ(grid.logOdds(x, 0), 0);
+  }
+  grid.setPose(0.0, 0.0, 0.0);
+  EXPECT_EQ(grid.logOdds(-hit - 1, 0), 0);
+  EXPECT_GT(grid.logOdds(hit, 0), 0);
+
+  // The rays start at the sensor and are rotated by its heading
+  grid.clear();
+  grid.setPose(-2.0, 1.0, kPi / 2.0);
+  const std::vector<uint16_t> ranges(parameters.vertical_beams,
+                                     static_cast<uint16_t>(3.0 / parameters.distance_resolution));
+  const std::vector<uint8_t> intensities(parameters.vertical_beams, 0);
+  const double theta = 0.0;
+  grid.write(ranges.data(), intensities.data(), &theta, 1);
+  EXPECT_GT(grid.logOdds(-20, 10 + HitCell(parameters, 3.0, options.cell_size)), 0);
+  EXPECT_LT(grid.logOdds(-20, 20), 0);
+
+  // Moving farther than the window clears it
+  grid.setPose(100.0, 0.0, 0.0);
+  std::vector<int16_t> cells(grid.cells() * grid.cells(), 1);
+  grid.copy(cells.data());
+  EXPECT_EQ(std::count(cells.begin(), cells.end(), 0), static_cast<int64_t>(cells.size()));
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,286 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "packages/velodyne_lidar/gems/decoder.hpp"
+#include "packages/velodyne_lidar/gems/output_products.hpp"
+#include "packages/velodyne_lidar/gems/tests/corpus.hpp"
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kFlatscanAngle = 0.03;
+
+// The products of a single scan
+struct Products {
+  std::vector<float> flatscan_angles;
+  std::vector<float> flatscan_ranges;
+  std::vector<float> positions;
+  std::vector<float> intensities;
+};
+
+// Decodes the corpus into scans of one revolution. If `fused` is true the products are computed
+// with the output engine after every packet, otherwise every writer reads the full scan after it
+// was emitted like a separate consumer would.
+std::vector<Products> DecodeCorpus(const Corpus& corpus, bool fused) {
+  VelodyneLidarParameters parameters = corpus.parameters;
+  // The vertical angles of the VLS128 are specific to every unit
+  if (parameters.vertical_angles.empty()) {
+    std::vector<double> degrees(parameters.vertical_beams);
+    for (size_t i = 0; i < degrees.size(); i++) {
+      degrees[i] = -25.0 + 40.0 * i / degrees.size();
+    }
+    EXPECT_TRUE(SetVerticalAngles(degrees, parameters));
+  }
+  FlatscanWriter flatscan(parameters, -kFlatscanAngle, kFlatscanAngle);
+  PointCloudOptions options;
+  options.column_stride = 3;
+  options.beam_stride = 2;
+  PointCloudWriter cloud(parameters, options);
+  OutputEngine engine(parameters.vertical_beams);
+  engine.add(&flatscan);
+  engine.add(&cloud);
+
+  DecoderOptions decoder_options;
+  decoder_options.split_at_revolution = true;
+  Decoder decoder(parameters, decoder_options);
+  const size_t capacity = 2 * 36000 / 10;
+  std::vector<uint16_t> ranges(capacity * parameters.vertical_beams);
+  std::vector<uint8_t> intensities(ranges.size());
+  std::vector<double> thetas(capacity);
+  decoder.setOutput({ranges.data(), intensities.data(), thetas.data(), capacity});
+  std::vector<Products> scans;
+  decoder.setCallback([&](const ColumnBatch& batch) {
+    if (fused) {
+      engine.update({ranges.data(), intensities.data(), thetas.data(), capacity}, batch.size, 0);
+      EXPECT_EQ(engine.columns(), batch.size);
+    } else {
+      flatscan.begin();
+      cloud.begin();
+      flatscan.write(batch.ranges, batch.intensities, batch.thetas, batch.size);
+      cloud.write(batch.ranges, batch.intensities, batch.thetas, batch.size);
+    }
+    scans.push_back(
+        {flatscan.angles(), flatscan.ranges(), cloud.positions(), cloud.intensities()});
+    engine.begin();
+  });
+  engine.begin();
+  for (size_t i = 0; i < corpus.size(); i++) {
+    decoder.feed(corpus.packet(i), corpus.packetSize(), corpus.timestamps[i]);
+    if (fused) {
+      engine.update(decoder.output(), decoder.bufferedColumns(), 0);
+    }
+  }
+  decoder.finish();
+  return scans;
+}
+
+// Records the chunks and the ends of revolutions which a writer sees
+struct ChunkRecorder : public ProductWriter {
+  void begin() override {}
+  void write(const uint16_t* ranges, const uint8_t* intensities, const double* thetas,
+             size_t count) override {
+    chunks.push_back(count);
+  }
+  void endRevolution(int64_t timestamp) override {
+    ends.push_back(chunks.size());
+    timestamps.push_back(timestamp);
+  }
+
+  std::vector<size_t> chunks;
+  // Number of chunks which were written before every end of a revolution and its timestamp
+  std::vector<size_t> ends;
+  std::vector<int64_t> timestamps;
+};
+}  // namespace
+
+TEST(OutputEngine, MatchesSeparateConsumers) {
+  for (const CorpusEntry& entry : CorpusEntries()) {
+    Corpus corpus;
+    ASSERT_TRUE(LoadCorpus(entry, corpus)) << entry.name;
+    const std::vector<Products> fused = DecodeCorpus(corpus, true);
+    const std::vector<Products> separate = DecodeCorpus(corpus, false);
+    ASSERT_GT(fused.size(), 1u) << entry.name;
+    ASSERT_EQ(fused.size(), separate.size()) << entry.name;
+    for (size_t i = 0; i < fused.size(); i++) {
+      EXPECT_FALSE(fused[i].flatscan_ranges.empty()) << entry.name;
+      EXPECT_FALSE(fused[i].positions.empty()) << entry.name;
+      EXPECT_EQ(fused[i].flatscan_angles, separate[i].flatscan_angles) << entry.name;
+      EXPECT_EQ(fused[i].flatscan_ranges, separate[i].flatscan_ranges) << entry.name;
+      EXPECT_EQ(fused[i].positions, separate[i].positions) << entry.name;
+      EXPECT_EQ(fused[i].intensities, separate[i].intensities) << entry.name;
+    }
+  }
+}
+
+TEST(OutputEngine, EndsRevolutionsBetweenChunks) {
+  const size_t beams = 16;
+  // Two revolutions of 50 columns followed by 10 columns of the next one
+  std::vector<double> thetas;
+  for (size_t c = 0; c < 110; c++) {
+    thetas.push_back(-2.0 * kPi * (c % 50) / 50);
+  }
+  std::vector<uint16_t> ranges(thetas.size() * beams, 0);
+  std::vector<uint8_t> intensities(ranges.size(), 0);
+  ChunkRecorder recorder;
+  OutputEngine engine(beams);
+  engine.add(&recorder);
+  engine.begin();
+  // Revolutions span scans of 40 columns and chunks end before the first column of a revolution.
+  // Every scan is stamped with the index of its first column.
+  for (size_t c = 0; c < thetas.size(); c += 40) {
+    const size_t count = std::min<size_t>(40, thetas.size() - c);
+    engine.update({ranges.data() + c * beams, intensities.data() + c * beams, thetas.data() + c,
+                   count}, count, c);
+    engine.begin();
+  }
+  EXPECT_EQ(engine.revolutions(), 2u);
+  EXPECT_EQ(recorder.chunks, std::vector<size_t>({32, 8, 10, 30, 20, 10}));
+  EXPECT_EQ(recorder.ends, std::vector<size_t>({3, 5}));
+  EXPECT_EQ(recorder.timestamps, std::vector<int64_t>({40, 80}));
+}
+
+TEST(FlatscanWriter, ReportsClosestReturnInBand) {
+  VelodyneLidarParameters parameters = GetVelodyneParameters(VelodyneModelType::VLP16);
+  // The VLP16 has beams at -1 and +1 degrees
+  FlatscanWriter writer(parameters, -0.02, 0.02);
+  ASSERT_EQ(writer.beams(), 2u);
+  std::vector<uint16_t> ranges(2 * parameters.vertical_beams, 0);
+  std::vector<uint8_t> intensities(ranges.size(), 0);
+  const std::vector<double> thetas = {0.5, 0.6};
+  for (uint32_t i = 0; i < parameters.vertical_beams; i++) {
+    const double angle = parameters.vertical_angles[i];
+    // Beams outside of the band are closer but ignored
+    ranges[i] = std::abs(angle) < 0.02 ? 1000 + i : 10;
+  }
+  writer.begin();
+  writer.write(ranges.data(), intensities.data(), thetas.data(), 2);
+  ASSERT_EQ(writer.ranges().size(), 2u);
+  float expected = parameters.maximum_range;
+  for (uint32_t i = 0; i < parameters.vertical_beams; i++) {
+    if (std::abs(parameters.vertical_angles[i]) < 0.02) {
+      expected = std::min<float>(expected, (1000 + i) * parameters.distance_resolution);
+    }
+  }
+  EXPECT_FLOAT_EQ(writer.ranges()[0], expected);
+  EXPECT_FLOAT_EQ(writer.angles()[0], 0.5f);
+  // A column without returns is reported at the maximum range
+  EXPECT_FLOAT_EQ(writer.ranges()[1], parameters.maximum_range);
+  EXPECT_FLOAT_EQ(writer.angles()[1], 0.6f);
+}
+
+TEST(PointCloudWriter, KeepsStrideAcrossChunks) {
+  VelodyneLidarParameters parameters = GetVelodyneParameters(VelodyneModelType::VLP16);
+  PointCloudOptions options;
+  options.column_stride = 4;
+  options.beam_stride = 16;
+  PointCloudWriter writer(parameters, options);
+  const size_t columns = 10;
+  std::vector<uint16_t> ranges(columns * parameters.vertical_beams, 500);
+  std::vector<uint8_t> intensities(ranges.size(), 255);
+  std::vector<double> thetas(columns, 0.0);
+  writer.begin();
+  // Chunks of 3 columns keep columns 0, 4 and 8 of the scan
+  for (size_t i = 0; i < columns; i += 3) {
+    const size_t count = std::min<size_t>(3, columns - i);
+    writer.write(ranges.data() + i * parameters.vertical_beams,
+                 intensities.data() + i * parameters.vertical_beams, thetas.data() + i, count);
+  }
+  ASSERT_EQ(writer.size(), 3u);
+  const float range = 500 * parameters.distance_resolution;
+  const double phi = parameters.vertical_angles[0];
+  EXPECT_NEAR(writer.positions()[0], range * std::cos(phi), 1e-5);
+  EXPECT_NEAR(writer.positions()[1], 0.0, 1e-5);
+  EXPECT_NEAR(writer.positions()[2], range * std::sin(phi), 1e-5);
+  EXPECT_FLOAT_EQ(writer.intensities()[0], 1.0f);
+}
+
+TEST(PointCloudWriter, DropsPointsOutsideOfRegion) {
+  VelodyneLidarParameters parameters = GetVelodyneParameters(VelodyneModelType::VLP16);
+  const size_t columns = 360;
+  std::vector<uint16_t> ranges(columns * parameters.vertical_beams);
+  for (size_t i = 0; i < ranges.size(); i++) {
+    ranges[i] = static_cast<uint16_t>(i % 7 == 0 ? 0 : 500 + (i * 37) % 4000);
+  }
+  std::vector<uint8_t> intensities(ranges.size());
+  for (size_t i = 0; i < intensities.size(); i++) {
+    intensities[i] = static_cast<uint8_t>(i);
+  }
+  std::vector<double> thetas(columns);
+  for (size_t c = 0; c < columns; c++) {
+    thetas[c] = -2.0 * 3.14159265358979323846 * c / columns;
+  }
+  PointCloudWriter all(parameters, PointCloudOptions());
+  all.begin();
+  all.write(ranges.data(), intensities.data(), thetas.data(), columns);
+
+  // A box in front of the sensor and a lane to its left
+  PointCloudOptions options;
+  options.region.has_box = true;
+  options.region.box_minimum = {-3.0, -6.0, -0.5};
+  options.region.box_maximum = {6.0, 6.0, 0.5};
+  RegionOfInterest::Polygon lane;
+  lane.corners = {{-3.0, 0.0}, {6.0, 0.0}, {6.0, 2.0}, {-3.0, 2.0}};
+  options.region.polygons.push_back(lane);
+  PointCloudWriter writer(parameters, options);
+
+  std::vector<float> expected_positions;
+  std::vector<float> expected_intensities;
+  for (size_t i = 0; i < all.size(); i++) {
+    const float* p = all.positions().data() + 3 * i;
+    if (p[0] >= -3.0f && p[0] <= 6.0f && p[1] >= 0.0f && p[1] <= 2.0f && p[2] >= -0.5f &&
+        p[2] <= 0.5f) {
+      expected_positions.insert(expected_positions.end(), p, p + 3);
+      expected_intensities.push_back(all.intensities()[i]);
+    }
+  }
+  EXPECT_GT(expected_intensities.size(), 10u);
+  EXPECT_LT(expected_intensities.size(), all.size() / 4);
+  // Chunks of the output engine and a whole scan at once, which grows the buffers of a chunk
+  for (size_t chunk : {32, 360}) {
+    writer.begin();
+    for (size_t i = 0; i < columns; i += chunk) {
+      const size_t count = std::min(chunk, columns - i);
+      writer.write(ranges.data() + i * parameters.vertical_beams,
+                   intensities.data() + i * parameters.vertical_beams, thetas.data() + i, count);
+    }
+    EXPECT_EQ(writer.positions(), expected_positions) << chunk;
+    EXPECT_EQ(writer.intensities(), expected_intensities) << chunk;
+  }
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "packages/velodyne_lidar/gems/decoder.hpp"
+#include "packages/velodyne_lidar/gems/packet_encoder.hpp"
+#include "packages/velodyne_lidar/gems/tests/corpus.hpp"
+
+// The packet bridge feeds simulated scans through the driver by encoding them into packets. These
+// tests decode the packets of the corpus, encode the decoded columns again and check that the
+// decoder reads back the same columns.
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+// Angles are only transmitted in hundredths of a degree
+constexpr double kThetaTolerance = 1e-9;
+
+// The columns of a decoded packet
+struct Columns {
+  std::vector<double> thetas;
+  std::vector<uint16_t> ranges;
+  std::vector<uint8_t> intensities;
+};
+
+// Decodes a single packet with a fresh decoder so that every packet is interpolated on its own
+Columns Decode(const VelodyneLidarParameters& parameters, const uint8_t* packet,
+               int64_t timestamp) {
+  const size_t beams = parameters.vertical_beams;
+  const size_t columns = ColumnsPerPacket(parameters);
+  DecoderOptions options;
+  options.batch_size = columns;
+  Decoder decoder(parameters, options);
+  std::vector<double> thetas(columns);
+  std::vector<uint16_t> ranges(columns * beams);
+  std::vector<uint8_t> intensities(columns * beams);
+  decoder.setOutput({ranges.data(), intensities.data(), thetas.data(), columns});
+  Columns result;
+  decoder.setCallback([&](const ColumnBatch& batch) {
+    result.thetas.insert(result.thetas.end(), batch.thetas, batch.thetas + batch.size);
+    result.ranges.insert(result.ranges.end(), batch.ranges, batch.ranges + batch.size * beams);
+    result.intensities.insert(result.intensities.end(), batch.intensities,
+                              batch.intensities + batch.size * beams);
+  });
+  decoder.feed(packet, parameters.packet_sans_header_size, timestamp);
+  decoder.finish();
+  return result;
+}
+}  // namespace
+
+TEST(PacketEncoder, ReencodesCorpus) {
+  for (const CorpusEntry& entry : CorpusEntries()) {
+    SCOPED_TRACE(entry.name);
+    Corpus corpus;
+    ASSERT_TRUE(LoadCorpus(entry, corpus));
+    const size_t beams = corpus.parameters.vertical_beams;
+    const size_t data_size = corpus.parameters.blocks_per_packet * corpus.parameters.block_size;
+    PacketEncoder encoder(corpus.parameters);
+    for (size_t i = 0; i < corpus.size(); i++) {
+      SCOPED_TRACE(i);
+      const Columns original = Decode(corpus.parameters, corpus.packet(i), corpus.timestamps[i]);
+      ASSERT_EQ(original.thetas.size(), encoder.columnsPerPacket());
+      for (size_t c = 0; c < original.thetas.size(); c++) {
+        const bool completed =
+            encoder.addColumn(original.thetas[c], original.ranges.data() + c * beams,
+                              original.intensities.data() + c * beams, corpus.timestamps[i]);
+        ASSERT_EQ(completed, c + 1 == original.thetas.size());
+      }
+      // The data blocks carry all measurements and need to be identical
+      EXPECT_EQ(std::memcmp(encoder.packet(), corpus.packet(i), data_size), 0);
+
+      const Columns decoded = Decode(corpus.parameters, encoder.packet(), corpus.timestamps[i]);
+      EXPECT_EQ(decoded.ranges, original.ranges);
+      EXPECT_EQ(decoded.intensities, original.intensities);
+      ASSERT_EQ(decoded.thetas.size(), original.thetas.size());
+      for (size_t c = 0; c < decoded.thetas.size(); c++) {
+        EXPECT_NEAR(decoded.thetas[c], original.thetas[c], kThetaTolerance);
+      }
+    }
+  }
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "engine/core/byte.hpp"
+#include "gtest/gtest.h"
+#include "packages/velodyne_lidar/gems/packet_receiver.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+constexpr int kPort = 23680;
+constexpr size_t kPacketSize = 1206;
+constexpr int64_t kTimeout = 100'000'000;
+
+// Sends a datagram of the given size from the loopback interface with every byte set to `value`
+void Send(size_t size, byte value) {
+  const int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+  ASSERT_GE(fd, 0);
+  sockaddr_in target{};
+  target.sin_family = AF_INET;
+  target.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  target.sin_port = htons(kPort);
+  const std::vector<byte> payload(size, value);
+  EXPECT_EQ(::sendto(fd, payload.data(), payload.size(), 0,
+                     reinterpret_cast<const sockaddr*>(&target), sizeof(target)),
+            static_cast<ssize_t>(size));
+  ::close(fd);
+}
+}  // namespace
+
+TEST(PacketReceiver, ReceivesPackets) {
+  PacketReceiver receiver;
+  ASSERT_TRUE(receiver.open("127.0.0.1", kPort));
+  Send(kPacketSize, 7);
+
+  std::vector<byte> buffer(kPacketSize);
+  size_t received = 0;
+  int64_t timestamp = 0;
+  const int64_t before = PacketReceiver::NowNs();
+  ASSERT_EQ(receiver.receive(buffer.data(), buffer.size(), kTimeout, received, timestamp),
+            PacketReceiver::Status::kSuccess);
+  EXPECT_EQ(received, kPacketSize);
+  EXPECT_EQ(buffer.back(), 7);
+  EXPECT_LE(before - kTimeout, timestamp);
+  EXPECT_LE(timestamp, PacketReceiver::NowNs());
+  EXPECT_EQ(receiver.truncatedPackets(), 0u);
+}
+
+TEST(PacketReceiver, DropsTruncatedPackets) {
+  PacketReceiver receiver;
+  ASSERT_TRUE(receiver.open("127.0.0.1", kPort));
+  Send(kPacketSize + 42, 1);
+  Send(kPacketSize, 2);
+
+  std::vector<byte> buffer(kPacketSize);
+  size_t received = 0;
+  int64_t timestamp = 0;
+  ASSERT_EQ(receiver.receive(buffer.data(), buffer.size(), kTimeout, received, timestamp),
+            PacketReceiver::Status::kSuccess);
+  EXPECT_EQ(received, kPacketSize);
+  EXPECT_EQ(buffer.front(), 2);
+  EXPECT_EQ(receiver.truncatedPackets(), 1u);
+
+  EXPECT_EQ(receiver.receive(buffer.data(), buffer.size(), kTimeout, received, timestamp),
+            PacketReceiver::Status::kTimeout);
+}
+
+TEST(PacketReceiver, ReportsSocketOptions) {
+  PacketReceiver receiver;
+  ASSERT_TRUE(receiver.open("", kPort));
+  EXPECT_TRUE(receiver.kernelTimestamps());
+  EXPECT_GT(receiver.receiveBufferSize(), 0u);
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
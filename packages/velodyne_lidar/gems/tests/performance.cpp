@@ -0,0 +1,369 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <malloc.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "capnp/message.h"
+#include "engine/core/buffers/shared_buffer.hpp"
+#include "engine/gems/serialization/json.hpp"
+#include "gtest/gtest.h"
+#include "messages/range_scan.capnp.h"
+#include "packages/velodyne_lidar/gems/channel_kernels.hpp"
+#include "packages/velodyne_lidar/gems/decoder.hpp"
+#include "packages/velodyne_lidar/gems/range_scan_writer.hpp"
+#include "packages/velodyne_lidar/gems/tests/corpus.hpp"
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+
+// Replays the packet corpus in `data` through the decoder and through the `RangeScanWriter` with
+// which the driver turns packets into range scan messages. The test fails if the number of heap
+// allocations, the peak heap usage or the time per point relative to the scalar decoder in the
+// same process exceed the budgets recorded in `data/performance_budgets.json` by more than the
+// tolerance stated there. Relative times still depend on the channel kernel, thus they are only
+// checked if the fastest kernel of the CPU is the one with which the budgets were recorded. The
+// measured values are written to `performance.json` in the undeclared test outputs and can be
+// copied into the budgets after an intended change.
+
+namespace {
+// Heap usage of the whole process as seen through the allocation functions below
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<int64_t> g_heap_bytes{0};
+std::atomic<int64_t> g_peak_heap_bytes{0};
+
+void* TrackAllocation(void* pointer) {
+  if (pointer != nullptr) {
+    const int64_t size = malloc_usable_size(pointer);
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    const int64_t bytes = g_heap_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+    int64_t peak = g_peak_heap_bytes.load(std::memory_order_relaxed);
+    while (bytes > peak && !g_peak_heap_bytes.compare_exchange_weak(peak, bytes)) {
+    }
+  }
+  return pointer;
+}
+
+void TrackDeallocation(void* pointer) {
+  if (pointer != nullptr) {
+    g_heap_bytes.fetch_sub(malloc_usable_size(pointer), std::memory_order_relaxed);
+  }
+}
+}  // namespace
+
+// All heap allocations including the ones by operator new and by the Isaac allocators end up in
+// these functions which replace the ones of the C library
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* pointer, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* pointer);
+
+void* malloc(size_t size) {
+  return TrackAllocation(__libc_malloc(size));
+}
+
+void* calloc(size_t count, size_t size) {
+  return TrackAllocation(__libc_calloc(count, size));
+}
+
+void* realloc(void* pointer, size_t size) {
+  TrackDeallocation(pointer);
+  return TrackAllocation(__libc_realloc(pointer, size));
+}
+
+void* memalign(size_t alignment, size_t size) {
+  return TrackAllocation(__libc_memalign(alignment, size));
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+  return TrackAllocation(__libc_memalign(alignment, size));
+}
+
+int posix_memalign(void** pointer, size_t alignment, size_t size) {
+  void* result = TrackAllocation(__libc_memalign(alignment, size));
+  if (result == nullptr) {
+    return ENOMEM;
+  }
+  *pointer = result;
+  return 0;
+}
+
+void free(void* pointer) {
+  TrackDeallocation(pointer);
+  __libc_free(pointer);
+}
+}  // extern "C"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+// Number of times the corpus is replayed per measurement and number of measurements of which the
+// fastest one is used
+constexpr int kReplays = 20;
+constexpr int kRepetitions = 10;
+// The driver publishes a scan for every 5 packets
+constexpr size_t kPacketsPerScan = 5;
+
+// Costs measured for one sensor model. Times are in nanoseconds per point or relative to the time
+// which the scalar channel kernel needs.
+struct Measurement {
+  std::string kernel;
+  double scalar_ns_per_point = 0.0;
+  double decoder_ns_per_point = 0.0;
+  double decoder_time_ratio = 0.0;
+  double decoder_allocations = 0.0;
+  double driver_ns_per_point = 0.0;
+  double driver_time_ratio = 0.0;
+  double driver_allocations_per_scan = 0.0;
+  double driver_peak_heap_bytes = 0.0;
+};
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Feeds all packets of the corpus `kReplays` times and returns the elapsed time in nanoseconds
+int64_t Replay(const Corpus& corpus, Decoder& decoder) {
+  const size_t packet_size = corpus.packetSize();
+  const int64_t start = NowNs();
+  for (int replay = 0; replay < kReplays; replay++) {
+    decoder.reset();
+    for (size_t i = 0; i < corpus.size(); i++) {
+      decoder.feed(corpus.packet(i), packet_size, corpus.timestamps[i]);
+    }
+    decoder.finish();
+  }
+  return NowNs() - start;
+}
+
+// Decodes into buffers which are allocated once, as done by consumers of the decoder gem. Returns
+// the time per point.
+double MeasureDecoder(const Corpus& corpus, const std::string& kernel, double& allocations) {
+  const VelodyneLidarParameters& parameters = corpus.parameters;
+  DecoderOptions options;
+  options.split_at_revolution = true;
+  options.kernel = kernel;
+  Decoder decoder(parameters, options);
+  const size_t capacity = corpus.size() * ColumnsPerPacket(parameters);
+  std::vector<uint16_t> ranges(capacity * parameters.vertical_beams);
+  std::vector<uint8_t> intensities(capacity * parameters.vertical_beams);
+  std::vector<double> thetas(capacity);
+  decoder.setOutput({ranges.data(), intensities.data(), thetas.data(), capacity});
+  uint64_t points = 0;
+  decoder.setCallback([&](const ColumnBatch& batch) {
+    points += batch.size * parameters.vertical_beams;
+  });
+  const uint64_t allocations_before = g_allocations.load();
+  const int64_t duration = Replay(corpus, decoder);
+  allocations = static_cast<double>(g_allocations.load() - allocations_before);
+  EXPECT_GT(points, 0u);
+  return points > 0 ? static_cast<double>(duration) / points : 0.0;
+}
+
+// Decodes scans of `kPacketsPerScan` packets into the range scan writer of the driver and writes
+// every scan into a message
+class DriverPath {
+ public:
+  explicit DriverPath(const VelodyneLidarParameters& parameters)
+      : parameters_(parameters), scans_(0) {
+    // The VLS128 has no default vertical angles
+    if (parameters_.vertical_angles.empty()) {
+      SetVerticalAngles(std::vector<double>(parameters_.vertical_beams, 0.0), parameters_);
+    }
+    DecoderOptions options;
+    options.batch_size = kPacketsPerScan * ColumnsPerPacket(parameters_);
+    // The default sampling of the driver for the ring health
+    options.ring_statistics_stride = 256;
+    decoder_.reset(new Decoder(parameters_, options));
+    decoder_->setCallback([this](const ColumnBatch& batch) { publishScan(batch); });
+    thetas_.resize(options.batch_size);
+    writer_.reset(new RangeScanWriter(parameters_, options.batch_size, thetas_.data()));
+    decoder_->setOutput(writer_->buffers());
+  }
+
+  Decoder& decoder() { return *decoder_; }
+  uint64_t scans() const { return scans_; }
+  uint64_t points() const { return scans_ * writer_->columns() * parameters_.vertical_beams; }
+
+ private:
+  void publishScan(const ColumnBatch& batch) {
+    ::capnp::MallocMessageBuilder message;
+    std::vector<SharedBuffer> buffers;
+    writer_->write(batch.size, message.initRoot<::RangeScanProto>(), buffers);
+    decoder_->setOutput(writer_->buffers());
+    scans_++;
+  }
+
+  VelodyneLidarParameters parameters_;
+  std::unique_ptr<Decoder> decoder_;
+  std::unique_ptr<RangeScanWriter> writer_;
+  std::vector<double> thetas_;
+  uint64_t scans_;
+};
+
+// Returns the time per point of the driver path
+double MeasureDriver(const Corpus& corpus, Measurement& measurement) {
+  const int64_t baseline = g_heap_bytes.load();
+  g_peak_heap_bytes.store(baseline);
+  const uint64_t allocations = g_allocations.load();
+  DriverPath driver(corpus.parameters);
+  const int64_t duration = Replay(corpus, driver.decoder());
+  EXPECT_GT(driver.scans(), 0u);
+  if (driver.scans() == 0) {
+    return 0.0;
+  }
+  measurement.driver_allocations_per_scan =
+      static_cast<double>(g_allocations.load() - allocations) / driver.scans();
+  measurement.driver_peak_heap_bytes = static_cast<double>(g_peak_heap_bytes.load() - baseline);
+  return static_cast<double>(duration) / driver.points();
+}
+
+// The scalar baseline is measured in turns with the other paths such that all of them see the
+// same load on the machine. The fastest repetition of every path is used.
+void Measure(const Corpus& corpus, Measurement& measurement) {
+  measurement.kernel = FindChannelKernel("")->name;
+  double scalar_allocations = 0.0;
+  for (int repetition = 0; repetition < kRepetitions; repetition++) {
+    const double scalar = MeasureDecoder(corpus, "scalar", scalar_allocations);
+    const double decoder = MeasureDecoder(corpus, "", measurement.decoder_allocations);
+    const double driver = MeasureDriver(corpus, measurement);
+    if (repetition == 0) {
+      measurement.scalar_ns_per_point = scalar;
+      measurement.decoder_ns_per_point = decoder;
+      measurement.driver_ns_per_point = driver;
+    } else {
+      measurement.scalar_ns_per_point = std::min(measurement.scalar_ns_per_point, scalar);
+      measurement.decoder_ns_per_point = std::min(measurement.decoder_ns_per_point, decoder);
+      measurement.driver_ns_per_point = std::min(measurement.driver_ns_per_point, driver);
+    }
+  }
+  measurement.decoder_time_ratio =
+      measurement.decoder_ns_per_point / measurement.scalar_ns_per_point;
+  measurement.driver_time_ratio = measurement.driver_ns_per_point / measurement.scalar_ns_per_point;
+}
+
+Json ToJson(const Measurement& measurement) {
+  Json json;
+  json["kernel"] = measurement.kernel;
+  json["scalar_ns_per_point"] = measurement.scalar_ns_per_point;
+  json["decoder_ns_per_point"] = measurement.decoder_ns_per_point;
+  json["decoder_time_ratio"] = measurement.decoder_time_ratio;
+  json["decoder_allocations"] = measurement.decoder_allocations;
+  json["driver_ns_per_point"] = measurement.driver_ns_per_point;
+  json["driver_time_ratio"] = measurement.driver_time_ratio;
+  json["driver_allocations_per_scan"] = measurement.driver_allocations_per_scan;
+  json["driver_peak_heap_bytes"] = measurement.driver_peak_heap_bytes;
+  return json;
+}
+
+// Compares every measured value against its budget with the given relative tolerance. Relative
+// times are skipped if the budgets were recorded with a different channel kernel.
+void ExpectWithinBudget(const Json& measured, const Json& budget, const Json& tolerances,
+                        bool check_times) {
+  for (auto it = budget.begin(); it != budget.end(); ++it) {
+    if (!check_times && it.key().find("time_ratio") != std::string::npos) {
+      continue;
+    }
+    ASSERT_TRUE(measured.count(it.key())) << it.key();
+    ASSERT_TRUE(tolerances.count(it.key())) << it.key();
+    const double limit = it.value().get<double>() * (1.0 + tolerances[it.key()].get<double>());
+    EXPECT_LE(measured[it.key()].get<double>(), limit)
+        << it.key() << " exceeds its budget of " << it.value().get<double>();
+  }
+}
+
+class PerformanceTest : public ::testing::Test {
+ protected:
+  static void SetUpTestCase() {
+    const std::string filename = std::string(kTestDataDirectory) + "performance_budgets.json";
+    const auto json = serialization::TryLoadJsonFromFile(filename);
+    ASSERT_TRUE(json) << "Could not load the performance budgets";
+    budgets_ = *json;
+  }
+
+  static void TearDownTestCase() {
+    const char* directory = std::getenv("TEST_UNDECLARED_OUTPUTS_DIR");
+    if (directory != nullptr) {
+      std::ofstream file(std::string(directory) + "/performance.json");
+      file << measured_.dump(2) << std::endl;
+    }
+  }
+
+  void check(const CorpusEntry& entry) {
+    Corpus corpus;
+    ASSERT_TRUE(LoadCorpus(entry, corpus)) << "Could not load " << entry.name;
+    Measurement measurement;
+    Measure(corpus, measurement);
+    Json& measured = measured_["models"][entry.name];
+    measured = ToJson(measurement);
+    std::cout << entry.name << ": " << measured.dump() << std::endl;
+    ASSERT_TRUE(budgets_["models"].count(entry.name)) << "No budget for " << entry.name;
+    const bool check_times = budgets_["kernel"] == measurement.kernel;
+    if (!check_times) {
+      std::cout << "Skipping relative times as the budgets were recorded with the '"
+                << budgets_["kernel"].get<std::string>() << "' kernel" << std::endl;
+    }
+    ExpectWithinBudget(measured, budgets_["models"][entry.name], budgets_["tolerances"],
+                       check_times);
+  }
+
+  static Json budgets_;
+  static Json measured_;
+};
+
+Json PerformanceTest::budgets_;
+Json PerformanceTest::measured_;
+
+TEST_F(PerformanceTest, Vlp16) {
+  check(CorpusEntries()[0]);
+}
+
+TEST_F(PerformanceTest, Vlp32c) {
+  check(CorpusEntries()[1]);
+}
+
+TEST_F(PerformanceTest, Vls128) {
+  check(CorpusEntries()[2]);
+}
+
+}  // namespace
+}  // namespace velodyne_lidar
+}  // namespace isaac
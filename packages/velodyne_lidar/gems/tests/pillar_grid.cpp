@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "packages/velodyne_lidar/gems/pillar_grid.hpp"
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+#include "packages/velodyne_lidar/gems/worker_pool.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+constexpr double kPi = 3.14159265358979323846;
+
+// Random columns all around the sensor
+struct Columns {
+  Columns(const VelodyneLidarParameters& parameters, size_t count) {
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> range(0, 20000);
+    std::uniform_int_distribution<int> intensity(0, 255);
+    for (size_t c = 0; c < count; c++) {
+      thetas.push_back(-2.0 * kPi * c / count);
+      for (uint32_t j = 0; j < parameters.vertical_beams; j++) {
+        ranges.push_back(static_cast<uint16_t>(range(rng)));
+        intensities.push_back(static_cast<uint8_t>(intensity(rng)));
+      }
+    }
+  }
+
+  std::vector<uint16_t> ranges;
+  std::vector<uint8_t> intensities;
+  std::vector<double> thetas;
+};
+}  // namespace
+
+TEST(PillarGrid, FillsChannels) {
+  const VelodyneLidarParameters parameters = GetVelodyneParameters(VelodyneModelType::VLP16);
+  PillarGridOptions options;
+  PillarGrid grid(parameters, options);
+  // A column straight ahead at 7.1 meters puts the beams within 9 degrees of the horizon into one
+  // cell. The beam at 9 degrees is above the band of heights.
+  const std::vector<uint16_t> ranges(parameters.vertical_beams,
+                                     static_cast<uint16_t>(7.1 / parameters.distance_resolution));
+  std::vector<uint8_t> intensities(parameters.vertical_beams, 10);
+  intensities[3] = 200;
+  intensities[15] = 250;
+  const double theta = 0.0;
+  grid.write(ranges.data(), intensities.data(), &theta, 1);
+
+  const size_t cells = grid.rows() * grid.columns();
+  std::vector<float> tensor(PillarGrid::kChannels * cells, -1.0f);
+  grid.merge(tensor.data());
+  const size_t cell = 291 * grid.columns() + 256;
+  const double distance = static_cast<uint16_t>(7.1 / parameters.distance_resolution) *
+                          parameters.distance_resolution;
+  const double height = distance * std::sin(7.0 * kPi / 180.0);
+  EXPECT_NEAR(tensor[cell], (height + 3.0) / 4.0, 1e-5);
+  EXPECT_NEAR(tensor[cells + cell], std::log(10.0) / std::log(64.0), 1e-5);
+  // Laser 3 is at 1 degree and laser 15 at 15 degrees
+  EXPECT_NEAR(tensor[2 * cells + cell], 200.0 / 255.0, 1e-6);
+  size_t occupied = 0;
+  for (size_t i = 0; i < cells; i++) {
+    if (tensor[cells + i] > 0.0f) occupied++;
+  }
+  // The beams below -9 degrees end in the cell behind
+  EXPECT_EQ(occupied, 2u);
+
+  // Clearing empties all cells
+  grid.clear();
+  grid.merge(tensor.data());
+  for (float value : tensor) {
+    ASSERT_EQ(value, 0.0f);
+  }
+}
+
+TEST(PillarGrid, MergesThreads) {
+  const VelodyneLidarParameters parameters = GetVelodyneParameters(VelodyneModelType::VLP32C);
+  const Columns columns(parameters, 1800);
+  PillarGridOptions options;
+  options.threads = 4;
+  PillarGrid grid(parameters, options);
+  const size_t size = PillarGrid::kChannels * grid.rows() * grid.columns();
+
+  // Chunks written one after another
+  for (size_t c = 0; c < 1800; c += 32) {
+    const size_t count = std::min<size_t>(32, 1800 - c);
+    grid.write(columns.ranges.data() + c * parameters.vertical_beams,
+               columns.intensities.data() + c * parameters.vertical_beams,
+               columns.thetas.data() + c, count);
+  }
+  std::vector<float> expected(size);
+  grid.merge(expected.data());
+  size_t occupied = 0;
+  for (size_t i = grid.rows() * grid.columns(); i < 2 * grid.rows() * grid.columns(); i++) {
+    if (expected[i] > 0.0f) occupied++;
+  }
+  EXPECT_GT(occupied, 1000u);
+
+  for (size_t threads : {1, 3, 4, 8}) {
+    WorkerPool pool(threads);
+    grid.clear();
+    grid.scatter(columns.ranges.data(), columns.intensities.data(), columns.thetas.data(), 1800,
+                 pool);
+    std::vector<float> tensor(size);
+    grid.merge(tensor.data());
+    EXPECT_EQ(tensor, expected) << threads;
+  }
+}
+
+TEST(PillarGrid, CompletesRevolutions) {
+  const VelodyneLidarParameters parameters = GetVelodyneParameters(VelodyneModelType::VLP16);
+  const Columns columns(parameters, 900);
+  PillarGrid grid(parameters, PillarGridOptions());
+  const size_t size = PillarGrid::kChannels * grid.rows() * grid.columns();
+  WorkerPool pool(1);
+  grid.scatter(columns.ranges.data(), columns.intensities.data(), columns.thetas.data(), 900, pool);
+  std::vector<float> expected(size);
+  grid.merge(expected.data());
+  grid.clear();
+
+  // Scans of 100 columns do not end the revolution
+  for (int revolution = 0; revolution < 2; revolution++) {
+    for (size_t c = 0; c < 900; c += 100) {
+      grid.begin();
+      grid.write(columns.ranges.data() + c * parameters.vertical_beams,
+                 columns.intensities.data() + c * parameters.vertical_beams,
+                 columns.thetas.data() + c, 100);
+      EXPECT_EQ(grid.revolutions(), static_cast<uint64_t>(revolution));
+    }
+    grid.endRevolution(0);
+  }
+  EXPECT_EQ(grid.revolutions(), 2u);
+  std::vector<float> tensor(size);
+  grid.mergeCompleted(tensor.data());
+  EXPECT_EQ(tensor, expected);
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
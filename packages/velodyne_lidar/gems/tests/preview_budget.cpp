@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "gtest/gtest.h"
+#include "packages/velodyne_lidar/gems/preview_budget.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+constexpr int64_t kSecond = 1000000000;
+
+// Totals of a simulated stream of previews
+struct Stream {
+  size_t published_bytes = 0;
+  size_t published = 0;
+  int decimation = 0;
+};
+
+// Feeds `count` scans of `full_bytes` bytes at `rate` Hz. A preview keeps `ratio` of the bytes of
+// the columns which survive the decimation, as if quantization merged points.
+Stream Simulate(PreviewBudget& budget, size_t full_bytes, double rate, double ratio,
+                size_t count, int64_t& time) {
+  Stream stream;
+  for (size_t i = 0; i < count; i++) {
+    time += static_cast<int64_t>(kSecond / rate);
+    stream.decimation = budget.decimation(full_bytes, time);
+    const size_t preview_bytes =
+        static_cast<size_t>(std::ceil(ratio * full_bytes / stream.decimation));
+    if (budget.consume(full_bytes, preview_bytes, time)) {
+      stream.published_bytes += preview_bytes;
+      stream.published++;
+    }
+  }
+  return stream;
+}
+}  // namespace
+
+TEST(PreviewBudget, DecimationConvergesBelowTheBudget) {
+  // 10 MB/s of full data which the preview halves, while the budget is 250 kB/s
+  PreviewBudget budget(250000.0, 0.5, 64);
+  int64_t time = 0;
+  Simulate(budget, 1000000, 10.0, 0.5, 200, time);
+  const Stream stream = Simulate(budget, 1000000, 10.0, 0.5, 600, time);
+  // 5 MB/s need to shrink by 20 to fit, and the decimation aims slightly below the budget
+  EXPECT_GE(stream.decimation, 20);
+  EXPECT_LE(stream.decimation, 24);
+  // Within a minute the published bytes stay within the budget and few previews are dropped
+  EXPECT_LE(stream.published_bytes, 60 * 250000);
+  EXPECT_GE(stream.published, 590u);
+}
+
+TEST(PreviewBudget, DecimationFollowsTheRate) {
+  PreviewBudget budget(250000.0, 0.5, 64);
+  int64_t time = 0;
+  const Stream fast = Simulate(budget, 1000000, 10.0, 0.5, 300, time);
+  const Stream slow = Simulate(budget, 1000000, 2.0, 0.5, 100, time);
+  EXPECT_GT(fast.decimation, slow.decimation);
+  EXPECT_GE(slow.decimation, 4);
+  EXPECT_LE(slow.decimation, 5);
+}
+
+TEST(PreviewBudget, BudgetHoldsAtMaximumDecimation) {
+  // Even the most decimated previews are twice as large as the budget allows
+  PreviewBudget budget(100000.0, 0.5, 10);
+  int64_t time = 0;
+  Simulate(budget, 400000, 10.0, 0.5, 100, time);
+  const Stream stream = Simulate(budget, 400000, 10.0, 0.5, 600, time);
+  EXPECT_EQ(stream.decimation, 10);
+  EXPECT_LE(stream.published_bytes, 60 * 100000 + 50000);
+  EXPECT_GE(stream.published_bytes, 60 * 100000 - 50000);
+  EXPECT_GT(budget.dropped(), 0u);
+}
+
+TEST(PreviewBudget, PublishesPreviewsLargerThanTheBurst) {
+  // A single preview holds 10 seconds of budget while only 0.1 seconds are saved up
+  PreviewBudget budget(100.0, 0.1, 1);
+  int64_t time = 0;
+  const Stream stream = Simulate(budget, 1000, 10.0, 1.0, 1000, time);
+  EXPECT_GE(stream.published, 9u);
+  EXPECT_LE(stream.published, 11u);
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
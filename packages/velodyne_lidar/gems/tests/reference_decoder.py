@@ -0,0 +1,194 @@
+"""
+Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+ * Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+ * Neither the name of NVIDIA CORPORATION nor the names of its
+   contributors may be used to endorse or promote products derived
+   from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+"""
+
+# Writes the reference values in data/decoder_golden.json without using the C++ decoder. The data
+# packets of the captures are read byte by byte following the packet layout of the sensor manuals:
+#
+# - A packet holds 12 data blocks of 100 bytes followed by a 4 byte time stamp and 2 factory bytes.
+# - A data block starts with a 2 byte flag and a 2 byte azimuth in hundredths of a degree followed
+#   by 32 channels of a 2 byte distance and a 1 byte reflectivity, all little endian.
+# - The VLP16 fires twice per block. The azimuth of the second firing is halfway to the azimuth of
+#   the next block, which is extrapolated for the last block of the capture.
+# - The VLP32C fires once per block. The VLS128 spreads a firing over 4 consecutive blocks, one per
+#   bank of 32 lasers, which all carry the same azimuth.
+#
+# Angles follow the convention of the driver, i.e. theta = -azimuth. Distances outside of the range
+# limits of a model are reported as zero range and intensity. Scans are formed like the driver does
+# from every 5 packets and the last scan is padded with empty columns whose angles are extrapolated.
+#
+# Usage from the root of the workspace:
+#   python3 packages/velodyne_lidar/gems/tests/reference_decoder.py > decoder_golden.json
+
+import json
+import math
+import struct
+
+DATA_DIRECTORY = 'packages/velodyne_lidar/gems/tests/data/'
+DATA_PORT = 2368
+PACKET_SIZE = 1206
+BLOCKS_PER_PACKET = 12
+BLOCK_SIZE = 100
+CHANNELS_PER_BLOCK = 32
+PACKETS_PER_SCAN = 5
+# A packet is counted as lost if the azimuth advances by more than this factor of the usual advance
+LOST_PACKET_THRESHOLD = 1.5
+
+# Beams, minimum and maximum range in meters and distance resolution in meters of every capture
+MODELS = {
+    'vlp16': (16, 0.2, 100.0, 0.002),
+    'vlp32c': (32, 0.2, 200.0, 0.004),
+    'vls128': (128, 0.2, 245.0, 0.004),
+}
+
+
+def read_packets(path):
+    '''The UDP payloads sent to the data port in a classic pcap file with Ethernet frames'''
+    with open(path, 'rb') as file:
+        data = file.read()
+    endian = '<' if struct.unpack_from('<I', data, 0)[0] in (0xA1B2C3D4, 0xA1B23C4D) else '>'
+    offset = 24
+    packets = []
+    while offset + 16 <= len(data):
+        captured = struct.unpack_from(endian + 'I', data, offset + 8)[0]
+        frame = data[offset + 16:offset + 16 + captured]
+        offset += 16 + captured
+        if len(frame) < 42 or frame[12:14] != b'\x08\x00' or frame[23] != 17:
+            continue
+        header = (frame[14] & 0x0F) * 4
+        port = struct.unpack_from('>H', frame, 14 + header + 2)[0]
+        payload = frame[14 + header + 8:]
+        if port == DATA_PORT and len(payload) == PACKET_SIZE:
+            packets.append(payload)
+    return packets
+
+
+def delta(a, b):
+    '''The signed difference a - b of two angles normalized to [-pi, pi['''
+    return math.fmod(a - b + math.pi, 2.0 * math.pi) % (2.0 * math.pi) - math.pi
+
+
+def azimuth(packet, block):
+    '''The angle of the given data block in radians'''
+    value = struct.unpack_from('<H', packet, block * BLOCK_SIZE + 2)[0]
+    return -(value / 100.0) * (math.pi / 180.0)
+
+
+def microradians(theta):
+    '''Rounds half away from zero like std::llround'''
+    value = theta * 1e6
+    return int(math.copysign(math.floor(abs(value) + 0.5), value))
+
+
+def fnv1a(data):
+    '''The 64 bit FNV-1a hash of the given bytes'''
+    value = 0xCBF29CE484222325
+    for byte in data:
+        value = ((value ^ byte) * 0x100000001B3) & 0xFFFFFFFFFFFFFFFF
+    return '{:016x}'.format(value)
+
+
+def decode(name):
+    beams, minimum_range, maximum_range, resolution = MODELS[name]
+    min_range = int(minimum_range / resolution)
+    max_range = int(maximum_range / resolution)
+    firings = max(1, CHANNELS_PER_BLOCK // beams)
+    banks = max(1, beams // CHANNELS_PER_BLOCK)
+    groups = BLOCKS_PER_PACKET // banks
+    bank_beams = beams // banks
+    packets = read_packets(DATA_DIRECTORY + name + '.pcap')
+
+    statistics = {'packets': len(packets), 'invalid_blocks': 0, 'columns': 0, 'revolutions': 0,
+                  'lost_packets': 0}
+    thetas, ranges, intensities = [], [], []
+    for index, packet in enumerate(packets):
+        group_azimuths = [azimuth(packet, j * banks) for j in range(groups)]
+        if index + 1 < len(packets):
+            next_azimuth = azimuth(packets[index + 1], 0)
+            expected = abs(delta(group_azimuths[-1], group_azimuths[0])) / (groups - 1) * groups
+            advance = abs(delta(next_azimuth, group_azimuths[0]))
+            if expected > 0.0 and advance > LOST_PACKET_THRESHOLD * expected:
+                statistics['lost_packets'] += int(math.floor(advance / expected + 0.5)) - 1
+        else:
+            next_azimuth = group_azimuths[-1] + delta(group_azimuths[-1], group_azimuths[-2])
+        for j in range(groups):
+            for bank in range(banks):
+                flag = struct.unpack_from('<H', packet, (j * banks + bank) * BLOCK_SIZE)[0]
+                if flag != [0xEEFF, 0xDDFF, 0xCCFF, 0xBBFF][bank]:
+                    statistics['invalid_blocks'] += 1
+            following = group_azimuths[j + 1] if j + 1 < groups else next_azimuth
+            step = delta(following, group_azimuths[j])
+            for firing in range(firings):
+                theta = group_azimuths[j] + (firing / firings) * step if firing else \
+                    group_azimuths[j]
+                if thetas and theta - thetas[-1] > math.pi:
+                    statistics['revolutions'] += 1
+                thetas.append(theta)
+                for bank in range(banks):
+                    base = (j * banks + bank) * BLOCK_SIZE + 4
+                    for channel in range(firing * bank_beams, (firing + 1) * bank_beams):
+                        distance, reflectivity = struct.unpack_from('<HB', packet,
+                                                                    base + 3 * channel)
+                        valid = min_range <= distance <= max_range
+                        ranges.append(distance if valid else 0)
+                        intensities.append(reflectivity if valid else 0)
+    statistics['columns'] = len(thetas)
+
+    columns = PACKETS_PER_SCAN * groups * firings
+    scans = []
+    for first in range(0, len(thetas), columns):
+        scan_thetas = thetas[first:first + columns]
+        valid = len(scan_thetas)
+        padding = [0] * ((columns - valid) * beams)
+        scan_ranges = ranges[first * beams:(first + valid) * beams] + padding
+        scan_intensities = intensities[first * beams:(first + valid) * beams] + padding
+        for i in range(valid, columns):
+            scan_thetas.append(2.0 * scan_thetas[i - 1] - scan_thetas[i - 2] if i >= 2 else 0.0)
+        scans.append({
+            'valid_columns': valid,
+            'ranges': fnv1a(struct.pack('<{}H'.format(len(scan_ranges)), *scan_ranges)),
+            'intensities': fnv1a(bytes(scan_intensities)),
+            'thetas': [microradians(theta) for theta in scan_thetas],
+        })
+    return {'statistics': statistics, 'scans': scans}
+
+
+def main():
+    '''Prints the reference values with one line per scan to keep differences readable'''
+    golden = {name: decode(name) for name in MODELS}
+    lines = []
+    for name, model in golden.items():
+        scans = ',\n'.join(json.dumps(scan, sort_keys=True, separators=(',', ':'))
+                           for scan in model['scans'])
+        statistics = json.dumps(model['statistics'], sort_keys=True, separators=(',', ':'))
+        lines.append('"{}": {{\n"statistics": {},\n"scans": [\n{}\n]}}'.format(
+            name, statistics, scans))
+    print('{\n' + ',\n'.join(lines) + '\n}')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "packages/velodyne_lidar/gems/region_of_interest.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+constexpr double kPi = 3.14159265358979323846;
+}  // namespace
+
+TEST(RegionOfInterest, ParsesJson) {
+  RegionOfInterest region;
+  ASSERT_TRUE(ParseRegionOfInterest(Json::object(), region));
+  EXPECT_TRUE(region.empty());
+  ASSERT_TRUE(ParseRegionOfInterest(Json::parse(R"({
+      "box": {"min": [-5, -2, -0.5], "max": [20, 2, 3]},
+      "polygons": [{"polygon": [[0, -1], [9, -1], [9, 1], [0, 1]], "heights": [-0.5, 2]},
+                   {"polygon": [[0, 0], [-3, 1], [-3, -1]]}]
+    })"), region));
+  EXPECT_TRUE(region.has_box);
+  EXPECT_EQ(region.box_maximum[2], 3.0);
+  ASSERT_EQ(region.polygons.size(), 2u);
+  EXPECT_EQ(region.polygons[0].corners.size(), 4u);
+  EXPECT_EQ(region.polygons[0].max_height, 2.0);
+  EXPECT_TRUE(std::isinf(region.polygons[1].max_height));
+
+  EXPECT_FALSE(ParseRegionOfInterest(Json::array(), region));
+  EXPECT_FALSE(ParseRegionOfInterest(Json::parse(R"({"box": {"min": [0, 0, 0]}})"), region));
+  EXPECT_FALSE(ParseRegionOfInterest(
+      Json::parse(R"({"box": {"min": [0, 0, 0], "max": [1, -1, 1]}})"), region));
+  EXPECT_FALSE(ParseRegionOfInterest(Json::parse(R"({"polygons": [{"polygon": [[0, 0]]}]})"),
+                                     region));
+}
+
+TEST(RegionFilter, MatchesPointwiseTest) {
+  RegionOfInterest region;
+  region.vehicle_T_sensor = RigidTransform::FromAxisAngle({0.0, 0.0, 1.0}, kPi / 2, {1.0, 0, 1.5});
+  region.has_box = true;
+  region.box_minimum = {-10.0, -10.0, 0.0};
+  region.box_maximum = {10.0, 10.0, 3.0};
+  RegionOfInterest::Polygon lane;
+  lane.corners = {{0.0, -2.0}, {8.0, -2.0}, {8.0, 2.0}, {0.0, 2.0}};
+  lane.max_height = 2.0;
+  RegionOfInterest::Polygon triangle;
+  triangle.corners = {{0.0, 0.0}, {-6.0, 4.0}, {-6.0, -4.0}};
+  region.polygons = {lane, triangle};
+  const RegionFilter filter(region);
+
+  std::mt19937 rng(5);
+  std::uniform_real_distribution<float> coordinate(-12.0f, 12.0f);
+  const size_t count = 1000;
+  std::vector<float> x(count);
+  std::vector<float> y(count);
+  std::vector<float> z(count);
+  for (size_t i = 0; i < count; i++) {
+    x[i] = coordinate(rng);
+    y[i] = coordinate(rng);
+    z[i] = coordinate(rng) * 0.25f;
+  }
+  std::vector<uint8_t> inside(count, 2);
+  filter.test(x.data(), y.data(), z.data(), count, inside.data());
+  size_t kept = 0;
+  for (size_t i = 0; i < count; i++) {
+    // The sensor looks to the left of the vehicle, one meter ahead and 1.5 meters up
+    const double vx = 1.0 - y[i];
+    const double vy = x[i];
+    const double vz = z[i] + 1.5;
+    const bool in_box = std::abs(vx) <= 10.0 && std::abs(vy) <= 10.0 && vz >= 0.0 && vz <= 3.0;
+    const bool in_lane = vx >= 0.0 && vx <= 8.0 && std::abs(vy) <= 2.0 && vz <= 2.0;
+    const bool in_triangle = vx <= 0.0 && vx >= -6.0 && std::abs(vy) <= -vx * 4.0 / 6.0;
+    EXPECT_EQ(inside[i], in_box && (in_lane || in_triangle) ? 1 : 0) << vx << " " << vy;
+    EXPECT_EQ(filter.contains(x[i], y[i], z[i]), inside[i]) << vx << " " << vy;
+    kept += inside[i];
+  }
+  EXPECT_GT(kept, 20u);
+
+  // Without a region all points are kept
+  const RegionFilter everything{RegionOfInterest()};
+  EXPECT_TRUE(everything.empty());
+  everything.test(x.data(), y.data(), z.data(), count, inside.data());
+  for (size_t i = 0; i < count; i++) {
+    ASSERT_EQ(inside[i], 1);
+    ASSERT_EQ(everything.contains(x[i], y[i], z[i]), 1);
+  }
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
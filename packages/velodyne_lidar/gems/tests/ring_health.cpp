@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "packages/velodyne_lidar/gems/decoder.hpp"
+#include "packages/velodyne_lidar/gems/ring_health.hpp"
+#include "packages/velodyne_lidar/gems/tests/corpus.hpp"
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+// Number of packets per window of the ring health monitor
+constexpr size_t kWindowPackets = 64;
+
+// Calls `modify` for every channel of the given laser in the corpus
+template <typename Modify>
+void ModifyLaser(Corpus& corpus, uint32_t laser, Modify modify) {
+  const VelodyneLidarParameters& parameters = corpus.parameters;
+  const size_t blocks_per_column = BlocksPerColumn(parameters);
+  const size_t bank_beams = parameters.vertical_beams / blocks_per_column;
+  const size_t bank = laser / bank_beams;
+  for (size_t i = 0; i < corpus.size(); i++) {
+    uint8_t* packet = corpus.packets.data() + i * corpus.packetSize();
+    for (size_t j = bank; j < parameters.blocks_per_packet; j += blocks_per_column) {
+      auto* block = reinterpret_cast<VelodyneRawDataBlock*>(packet + j * parameters.block_size);
+      for (size_t f = 0; f < FiringsPerBlock(parameters); f++) {
+        modify(block->channels[f * bank_beams + laser % bank_beams]);
+      }
+    }
+  }
+}
+
+// Decodes the corpus and evaluates the ring health every `kWindowPackets` packets. Returns the
+// report of the last window.
+RingHealthReport MonitorCorpus(const Corpus& corpus, size_t* windows = nullptr) {
+  DecoderOptions options;
+  options.ring_statistics_stride = 1;
+  Decoder decoder(corpus.parameters, options);
+  const size_t capacity = ColumnsPerPacket(corpus.parameters);
+  std::vector<uint16_t> ranges(capacity * corpus.parameters.vertical_beams);
+  std::vector<uint8_t> intensities(ranges.size());
+  std::vector<double> thetas(capacity);
+  decoder.setOutput({ranges.data(), intensities.data(), thetas.data(), capacity});
+  RingHealthMonitor monitor(corpus.parameters);
+  RingHealthReport report;
+  size_t count = 0;
+  for (size_t i = 0; i < corpus.size(); i++) {
+    decoder.feed(corpus.packet(i), corpus.packetSize(), corpus.timestamps[i]);
+    if ((i + 1) % kWindowPackets == 0 && monitor.update(decoder.ringStatistics(), report)) {
+      count++;
+    }
+  }
+  if (windows != nullptr) {
+    *windows = count;
+  }
+  return report;
+}
+}  // namespace
+
+TEST(RingStatistics, MatchDecodedColumns) {
+  for (const CorpusEntry& entry : CorpusEntries()) {
+    Corpus corpus;
+    ASSERT_TRUE(LoadCorpus(entry, corpus)) << entry.name;
+    const size_t beams = corpus.parameters.vertical_beams;
+    DecoderOptions options;
+    options.ring_statistics_stride = 1;
+    // Batches which end in the middle of a packet split its columns over two output buffers
+    options.batch_size = 5 * ColumnsPerPacket(corpus.parameters) / 2;
+    Decoder decoder(corpus.parameters, options);
+    std::vector<uint16_t> ranges(options.batch_size * beams);
+    std::vector<uint8_t> intensities(ranges.size());
+    std::vector<double> thetas(options.batch_size);
+    decoder.setOutput({ranges.data(), intensities.data(), thetas.data(), options.batch_size});
+    RingStatistics expected;
+    expected.returns.resize(beams, 0);
+    expected.range_sums.resize(beams, 0);
+    expected.intensity_sums.resize(beams, 0);
+    decoder.setCallback([&](const ColumnBatch& batch) {
+      expected.columns += batch.size;
+      for (size_t i = 0; i < batch.size * beams; i++) {
+        expected.returns[i % beams] += batch.ranges[i] != 0;
+        expected.range_sums[i % beams] += batch.ranges[i];
+        expected.intensity_sums[i % beams] += batch.intensities[i];
+      }
+    });
+    for (size_t i = 0; i < corpus.size(); i++) {
+      decoder.feed(corpus.packet(i), corpus.packetSize(), corpus.timestamps[i]);
+    }
+    decoder.finish();
+
+    const RingStatistics& statistics = decoder.ringStatistics();
+    EXPECT_EQ(statistics.columns, expected.columns) << entry.name;
+    EXPECT_EQ(statistics.returns, expected.returns) << entry.name;
+    EXPECT_EQ(statistics.range_sums, expected.range_sums) << entry.name;
+    EXPECT_EQ(statistics.intensity_sums, expected.intensity_sums) << entry.name;
+  }
+}
+
+TEST(RingStatistics, SampleEveryNthPacket) {
+  Corpus corpus;
+  ASSERT_TRUE(LoadCorpus(CorpusEntries()[0], corpus));
+  const size_t columns_per_packet = ColumnsPerPacket(corpus.parameters);
+  DecoderOptions options;
+  options.ring_statistics_stride = 16;
+  Decoder decoder(corpus.parameters, options);
+  std::vector<uint16_t> ranges(columns_per_packet * corpus.parameters.vertical_beams);
+  std::vector<uint8_t> intensities(ranges.size());
+  std::vector<double> thetas(columns_per_packet);
+  decoder.setOutput({ranges.data(), intensities.data(), thetas.data(), columns_per_packet});
+  for (size_t i = 0; i < corpus.size(); i++) {
+    decoder.feed(corpus.packet(i), corpus.packetSize(), corpus.timestamps[i]);
+  }
+  decoder.finish();
+  EXPECT_EQ(decoder.ringStatistics().columns,
+            (corpus.size() + options.ring_statistics_stride - 1) /
+                options.ring_statistics_stride * columns_per_packet);
+
+  // Without sampling no statistics are collected
+  Decoder disabled(corpus.parameters);
+  EXPECT_TRUE(disabled.ringStatistics().returns.empty());
+}
+
+TEST(RingHealthMonitor, HealthySensor) {
+  for (const CorpusEntry& entry : CorpusEntries()) {
+    Corpus corpus;
+    ASSERT_TRUE(LoadCorpus(entry, corpus)) << entry.name;
+    size_t windows = 0;
+    const RingHealthReport report = MonitorCorpus(corpus, &windows);
+    EXPECT_EQ(windows, corpus.size() / kWindowPackets) << entry.name;
+    ASSERT_EQ(report.rings.size(), corpus.parameters.vertical_beams);
+    for (size_t k = 0; k < report.rings.size(); k++) {
+      EXPECT_FALSE(report.rings[k].degraded) << entry.name << " ring " << k;
+      EXPECT_GT(report.rings[k].return_ratio, 0.5) << entry.name << " ring " << k;
+      EXPECT_GT(report.rings[k].mean_range, corpus.parameters.minimum_range);
+    }
+    EXPECT_TRUE(report.alarm_rings.empty()) << entry.name;
+  }
+}
+
+TEST(RingHealthMonitor, DeadLaser) {
+  for (const CorpusEntry& entry : CorpusEntries()) {
+    Corpus corpus;
+    ASSERT_TRUE(LoadCorpus(entry, corpus)) << entry.name;
+    const uint32_t laser = corpus.parameters.vertical_beams / 2 + 1;
+    ModifyLaser(corpus, laser, [](VelodyneRawChannel& channel) {
+      channel.distance = 0;
+      channel.reflectivity = 0;
+    });
+    const RingHealthReport report = MonitorCorpus(corpus);
+    EXPECT_EQ(report.rings[laser].return_ratio, 0.0) << entry.name;
+    EXPECT_TRUE(report.rings[laser].degraded) << entry.name;
+    EXPECT_EQ(report.alarm_rings, std::vector<uint32_t>{laser}) << entry.name;
+  }
+}
+
+TEST(RingHealthMonitor, DimLaser) {
+  Corpus corpus;
+  ASSERT_TRUE(LoadCorpus(CorpusEntries()[0], corpus));
+  const uint32_t laser = 3;
+  ModifyLaser(corpus, laser, [](VelodyneRawChannel& channel) { channel.reflectivity /= 4; });
+  const RingHealthReport report = MonitorCorpus(corpus);
+  EXPECT_GT(report.rings[laser].return_ratio, 0.5);
+  EXPECT_EQ(report.alarm_rings, std::vector<uint32_t>{laser});
+}
+
+TEST(RingHealthMonitor, AlarmNeedsConsecutiveWindows) {
+  Corpus corpus;
+  ASSERT_TRUE(LoadCorpus(CorpusEntries()[0], corpus));
+  RingHealthOptions options;
+  options.alarm_windows = 3;
+  RingHealthMonitor monitor(corpus.parameters, options);
+  const size_t beams = corpus.parameters.vertical_beams;
+  RingStatistics statistics;
+  statistics.returns.assign(beams, 0);
+  statistics.range_sums.assign(beams, 0);
+  statistics.intensity_sums.assign(beams, 0);
+  // Adds a window in which every ring returns for all columns except ring 0 if `degraded`
+  auto add_window = [&](bool degraded) {
+    statistics.columns += 1000;
+    for (size_t k = 0; k < beams; k++) {
+      const uint64_t returns = degraded && k == 0 ? 100 : 1000;
+      statistics.returns[k] += returns;
+      statistics.range_sums[k] += returns * 1000;
+      statistics.intensity_sums[k] += returns * 50;
+    }
+  };
+  RingHealthReport report;
+  for (bool degraded : {true, true, false, true, true, true}) {
+    add_window(degraded);
+    ASSERT_TRUE(monitor.update(statistics, report));
+    EXPECT_EQ(report.rings[0].degraded, degraded);
+  }
+  EXPECT_EQ(report.alarm_rings, std::vector<uint32_t>{0});
+
+  // Too few columns are added to the next window
+  statistics.columns += 10;
+  EXPECT_FALSE(monitor.update(statistics, report));
+  // A reset of the decoder restarts the windows
+  statistics = RingStatistics();
+  statistics.returns.assign(beams, 0);
+  statistics.range_sums.assign(beams, 0);
+  statistics.intensity_sums.assign(beams, 0);
+  EXPECT_FALSE(monitor.update(statistics, report));
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cstdint>
+
+#include "gtest/gtest.h"
+#include "packages/velodyne_lidar/gems/rolling_grid.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+// Sets every cell of the window to a value derived from its world coordinates
+void Fill(RollingGrid<int>& grid) {
+  for (size_t row = 0; row < grid.size(); row++) {
+    for (size_t column = 0; column < grid.size(); column++) {
+      const int64_t x = grid.originX() + column;
+      const int64_t y = grid.originY() + row;
+      grid[grid.index(x, y)] = static_cast<int>(1000 * y + x);
+    }
+  }
+}
+}  // namespace
+
+TEST(RollingGrid, StartsCenteredAtTheOrigin) {
+  RollingGrid<int> grid(8, -1);
+  EXPECT_EQ(grid.originX(), -4);
+  EXPECT_EQ(grid.originY(), -4);
+  EXPECT_TRUE(grid.contains(-4, 3));
+  EXPECT_FALSE(grid.contains(4, 0));
+  EXPECT_FALSE(grid.contains(0, -5));
+  EXPECT_EQ(grid.at(0, 0), -1);
+}
+
+TEST(RollingGrid, KeepsCellsWhichStayInTheWindow) {
+  RollingGrid<int> grid(8, -1);
+  Fill(grid);
+  grid.center(3, -2);
+  EXPECT_EQ(grid.originX(), -1);
+  EXPECT_EQ(grid.originY(), -6);
+  for (size_t row = 0; row < grid.size(); row++) {
+    for (size_t column = 0; column < grid.size(); column++) {
+      const int64_t x = grid.originX() + column;
+      const int64_t y = grid.originY() + row;
+      const bool kept = x < 4 && y >= -4;
+      EXPECT_EQ(grid.at(row, column), kept ? 1000 * y + x : -1) << x << " " << y;
+    }
+  }
+}
+
+TEST(RollingGrid, ClearsTheWindowAfterALargeMove) {
+  RollingGrid<int> grid(8, -1);
+  Fill(grid);
+  grid.center(100, 0);
+  EXPECT_EQ(grid.originX(), 96);
+  for (size_t row = 0; row < grid.size(); row++) {
+    for (size_t column = 0; column < grid.size(); column++) {
+      EXPECT_EQ(grid.at(row, column), -1);
+    }
+  }
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "packages/velodyne_lidar/gems/decoder.hpp"
+#include "packages/velodyne_lidar/gems/packet_encoder.hpp"
+#include "packages/velodyne_lidar/gems/safety_fields.hpp"
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+constexpr double kPi = 3.14159265358979323846;
+
+// A field in front of the sensor which also covers it
+SafetyField FrontField() {
+  SafetyField field;
+  field.name = "front";
+  field.polygon = {{-0.5, -1.0}, {3.0, -1.0}, {3.0, 1.0}, {-0.5, 1.0}};
+  field.min_height = -0.5;
+  field.max_height = 0.5;
+  return field;
+}
+
+// Encodes a packet in which every column starts at `theta` and moves by `step`. Only the given
+// laser has a return at `range` meters.
+std::vector<uint8_t> EncodePacket(const VelodyneLidarParameters& parameters, double theta,
+                                  double step, size_t laser, double range) {
+  PacketEncoder encoder(parameters);
+  std::vector<uint16_t> ranges(parameters.vertical_beams, 0);
+  std::vector<uint8_t> intensities(parameters.vertical_beams, 100);
+  ranges[laser] = static_cast<uint16_t>(range / parameters.distance_resolution);
+  for (size_t c = 0;; c++) {
+    if (encoder.addColumn(theta + c * step, ranges.data(), intensities.data(), 0)) {
+      return std::vector<uint8_t>(encoder.packet(), encoder.packet() + encoder.packetSize());
+    }
+  }
+}
+
+// Signed distance of a point to the border of a convex polygon, positive inside
+double DistanceToBorder(const std::vector<std::pair<double, double>>& polygon, double x,
+                        double y) {
+  double distance = std::numeric_limits<double>::infinity();
+  for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+    const double ex = polygon[i].first - polygon[j].first;
+    const double ey = polygon[i].second - polygon[j].second;
+    // The corners are ordered counter-clockwise thus the inside is on the left of every edge
+    const double cross = ex * (y - polygon[j].second) - ey * (x - polygon[j].first);
+    distance = std::min(distance, cross / std::hypot(ex, ey));
+  }
+  return distance;
+}
+}  // namespace
+
+TEST(SafetyFields, Parse) {
+  std::vector<SafetyField> fields;
+  const Json json = Json::parse(R"([
+      {"name": "protective", "action": "stop", "polygon": [[-1, -1], [1, -1], [1, 1], [-1, 1]],
+       "heights": [-0.3, 1.5]},
+      {"action": "slowdown", "polygon": [[-2, -2], [2, -2], [0, 2]]}])");
+  ASSERT_TRUE(ParseSafetyFields(json, fields));
+  ASSERT_EQ(fields.size(), 2u);
+  EXPECT_EQ(fields[0].name, "protective");
+  EXPECT_EQ(fields[0].action, SafetyAction::kStop);
+  EXPECT_EQ(fields[0].polygon.size(), 4u);
+  EXPECT_DOUBLE_EQ(fields[0].min_height, -0.3);
+  EXPECT_DOUBLE_EQ(fields[0].max_height, 1.5);
+  EXPECT_EQ(fields[1].name, "field 1");
+  EXPECT_EQ(fields[1].action, SafetyAction::kSlowDown);
+  EXPECT_TRUE(std::isinf(fields[1].max_height));
+
+  EXPECT_FALSE(ParseSafetyFields(Json::parse(R"({"polygon": []})"), fields));
+  EXPECT_FALSE(ParseSafetyFields(Json::parse(R"([{"name": "a"}])"), fields));
+  EXPECT_FALSE(ParseSafetyFields(
+      Json::parse(R"([{"action": "brake", "polygon": [[0, 0], [1, 0], [1, 1]]}])"), fields));
+  EXPECT_FALSE(ParseSafetyFields(
+      Json::parse(R"([{"polygon": [[0, 0], [1, 0], [1, 1]], "heights": [1, -1]}])"), fields));
+}
+
+TEST(SafetyMonitor, RejectsInvalidFields) {
+  const VelodyneLidarParameters parameters = GetVelodyneParameters(VelodyneModelType::VLP16);
+  SafetyMonitor monitor(parameters, SafetyMonitorOptions());
+  SafetyField field = FrontField();
+  EXPECT_TRUE(monitor.addField(field));
+  // The sensor needs to be inside of the field
+  field.polygon = {{1.0, -1.0}, {3.0, -1.0}, {3.0, 1.0}, {1.0, 1.0}};
+  EXPECT_FALSE(monitor.addField(field));
+  field.polygon = {{-1.0, -1.0}, {3.0, 0.0}};
+  EXPECT_FALSE(monitor.addField(field));
+  EXPECT_EQ(monitor.fields().size(), 1u);
+}
+
+TEST(SafetyMonitor, DetectsReturnsInField) {
+  const VelodyneLidarParameters parameters = GetVelodyneParameters(VelodyneModelType::VLP16);
+  SafetyMonitorOptions options;
+  options.min_returns = 1;
+  SafetyMonitor monitor(parameters, options);
+  const SafetyField field = FrontField();
+  ASSERT_TRUE(monitor.addField(field));
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<double> angle(-kPi, kPi);
+  std::uniform_real_distribution<double> distance(0.5, 6.0);
+  std::uniform_int_distribution<size_t> laser(0, parameters.vertical_beams - 1);
+  int inside = 0;
+  int outside = 0;
+  for (int n = 0; n < 2000; n++) {
+    const double theta = angle(rng);
+    const double range = distance(rng);
+    const size_t i = laser(rng);
+    const double phi = parameters.vertical_angles[i];
+    const double horizontal = range * std::cos(phi);
+    const double x = horizontal * std::cos(theta);
+    const double y = horizontal * std::sin(theta);
+    const double z = range * std::sin(phi);
+    const double border = std::min({DistanceToBorder(field.polygon, x, y),
+                                    z - field.min_height, field.max_height - z});
+    // Points close to the border may be reported either way
+    if (std::abs(border) < 0.1) continue;
+    monitor.reset();
+    const std::vector<uint8_t> packet = EncodePacket(parameters, theta, 0.0, i, range);
+    EXPECT_EQ(monitor.process(packet.data()), border > 0.0) << x << " " << y << " " << z;
+    EXPECT_EQ(monitor.action(), border > 0.0 ? SafetyAction::kStop : SafetyAction::kNone);
+    (border > 0.0 ? inside : outside)++;
+  }
+  EXPECT_GT(inside, 100);
+  EXPECT_GT(outside, 100);
+}
+
+TEST(SafetyMonitor, CoversConcaveFields) {
+  const VelodyneLidarParameters parameters = GetVelodyneParameters(VelodyneModelType::VLP16);
+  SafetyMonitorOptions options;
+  options.min_returns = 1;
+  SafetyMonitor monitor(parameters, options);
+  // A notch from above between x = 1 and x = 2 hides the end of the field from the sensor
+  SafetyField field = FrontField();
+  field.polygon = {{-1.0, -1.0}, {3.0, -1.0}, {3.0, 1.0}, {2.0, 1.0},
+                   {2.0, -0.5}, {1.0, -0.5}, {1.0, 1.0}, {-1.0, 1.0}};
+  ASSERT_TRUE(monitor.addField(field));
+  // A laser close to the horizon
+  size_t laser = 0;
+  for (size_t i = 1; i < parameters.vertical_beams; i++) {
+    if (std::abs(parameters.vertical_angles[i]) < std::abs(parameters.vertical_angles[laser])) {
+      laser = i;
+    }
+  }
+  ASSERT_LT(std::abs(parameters.vertical_angles[laser]), 0.05);
+  // An obstacle in the hidden part behind the notch
+  const std::vector<uint8_t> hidden = EncodePacket(parameters, 0.0, 0.0, laser, 2.5);
+  EXPECT_TRUE(monitor.process(hidden.data()));
+  EXPECT_EQ(monitor.action(), SafetyAction::kStop);
+  // An obstacle beyond the field on the same ray
+  monitor.reset();
+  const std::vector<uint8_t> beyond = EncodePacket(parameters, 0.0, 0.0, laser, 3.5);
+  EXPECT_FALSE(monitor.process(beyond.data()));
+}
+
+TEST(SafetyMonitor, ClearsAfterFullTurn) {
+  const VelodyneLidarParameters parameters = GetVelodyneParameters(VelodyneModelType::VLS128);
+  std::vector<double> degrees(parameters.vertical_beams);
+  for (size_t i = 0; i < degrees.size(); i++) {
+    degrees[i] = -25.0 + 40.0 * i / degrees.size();
+  }
+  VelodyneLidarParameters calibrated = parameters;
+  ASSERT_TRUE(SetVerticalAngles(degrees, calibrated));
+  SafetyMonitor monitor(calibrated, SafetyMonitorOptions());
+  SafetyField warning = FrontField();
+  warning.action = SafetyAction::kSlowDown;
+  warning.polygon = {{-1.0, -2.0}, {5.0, -2.0}, {5.0, 2.0}, {-1.0, 2.0}};
+  ASSERT_TRUE(monitor.addField(warning));
+  ASSERT_TRUE(monitor.addField(FrontField()));
+  // A laser close to the horizon
+  const size_t laser = 80;
+  ASSERT_LT(std::abs(calibrated.vertical_angles[laser]), 0.05);
+
+  // The sensor turns with decreasing angles. An obstacle at 4 meters is only in the larger field.
+  const double step = -0.2 * kPi / 180.0;
+  const size_t columns = ColumnsPerPacket(calibrated);
+  double theta = 0.5;
+  auto next = [&](double range) {
+    const std::vector<uint8_t> packet = EncodePacket(calibrated, theta, step, laser, range);
+    theta += columns * step;
+    return monitor.process(packet.data());
+  };
+  EXPECT_FALSE(next(20.0));
+  while (theta > 0.01) {
+    EXPECT_FALSE(next(20.0));
+  }
+  EXPECT_TRUE(next(4.0));
+  EXPECT_EQ(monitor.violated(), 1u);
+  EXPECT_EQ(monitor.action(), SafetyAction::kSlowDown);
+  EXPECT_TRUE(next(2.0));
+  EXPECT_EQ(monitor.violated(), 3u);
+  EXPECT_EQ(monitor.action(), SafetyAction::kStop);
+  // Both fields stay violated until the sensor looked around once more
+  const double violated_at = theta;
+  while (theta > violated_at - 2.0 * kPi + 0.05) {
+    EXPECT_FALSE(next(20.0));
+    EXPECT_EQ(monitor.violated(), 3u);
+  }
+  size_t packets = 0;
+  while (!next(20.0)) {
+    ASSERT_LT(++packets, 10u);
+  }
+  EXPECT_EQ(monitor.violated(), 0u);
+  EXPECT_EQ(monitor.action(), SafetyAction::kNone);
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "packages/velodyne_lidar/gems/output_products.hpp"
+#include "packages/velodyne_lidar/gems/scan_features.hpp"
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+constexpr double kPi = 3.14159265358979323846;
+
+// A revolution of `count` columns all around the sensor with the given ranges in meters per column
+struct Scan {
+  Scan(const VelodyneLidarParameters& parameters, const std::vector<double>& column_ranges) {
+    const size_t count = column_ranges.size();
+    for (size_t c = 0; c < count; c++) {
+      thetas.push_back(-2.0 * kPi * c / count);
+      ranges.insert(ranges.end(), parameters.vertical_beams,
+                    static_cast<uint16_t>(column_ranges[c] / parameters.distance_resolution));
+    }
+    intensities.resize(ranges.size(), 0);
+  }
+
+  // Hands the revolution to the engine in scans of `chunk` columns and starts a new scan after
+  // every one like the driver does
+  void write(OutputEngine& engine, size_t chunk) {
+    const size_t beams = ranges.size() / thetas.size();
+    for (size_t c = 0; c < thetas.size(); c += chunk) {
+      const size_t count = std::min(chunk, thetas.size() - c);
+      engine.update({ranges.data() + c * beams, intensities.data() + c * beams,
+                     thetas.data() + c, count}, count, 0);
+      engine.begin();
+    }
+  }
+
+  // Writes the start of the next revolution which completes the previous one
+  void startNext(OutputEngine& engine) {
+    engine.update({ranges.data(), intensities.data(), thetas.data(), thetas.size()},
+                  std::min<size_t>(16, thetas.size()), 0);
+    engine.begin();
+  }
+
+  // Writes the revolution followed by the start of the next one
+  void complete(OutputEngine& engine, size_t chunk) {
+    write(engine, chunk);
+    startNext(engine);
+  }
+
+  std::vector<uint16_t> ranges;
+  std::vector<uint8_t> intensities;
+  std::vector<double> thetas;
+};
+
+// A feature extractor which receives the columns through an output engine
+struct Extractor {
+  Extractor(const VelodyneLidarParameters& parameters, const FeatureOptions& options)
+      : features(parameters, options), engine(parameters.vertical_beams) {
+    engine.add(&features);
+  }
+
+  FeatureExtractor features;
+  OutputEngine engine;
+};
+
+// Expects that the features of the last completed revolution of both extractors are identical
+void ExpectSameFeatures(const FeatureExtractor& actual, const FeatureExtractor& expected) {
+  ASSERT_EQ(actual.edges().size(), expected.edges().size());
+  ASSERT_EQ(actual.planes().size(), expected.planes().size());
+  for (size_t i = 0; i < actual.edges().size(); i++) {
+    EXPECT_EQ(actual.edges()[i].x, expected.edges()[i].x);
+    EXPECT_EQ(actual.edges()[i].y, expected.edges()[i].y);
+    EXPECT_EQ(actual.edges()[i].laser, expected.edges()[i].laser);
+    EXPECT_EQ(actual.edges()[i].curvature, expected.edges()[i].curvature);
+  }
+  for (size_t i = 0; i < actual.planes().size(); i++) {
+    EXPECT_EQ(actual.planes()[i].x, expected.planes()[i].x);
+    EXPECT_EQ(actual.planes()[i].y, expected.planes()[i].y);
+    EXPECT_EQ(actual.planes()[i].laser, expected.planes()[i].laser);
+    EXPECT_EQ(actual.planes()[i].curvature, expected.planes()[i].curvature);
+  }
+}
+
+// Piecewise constant ranges with noise which give both edges and planes
+std::vector<double> RandomRanges(size_t count, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> range(2.0, 40.0);
+  std::vector<double> ranges(count);
+  double base = range(rng);
+  for (size_t c = 0; c < ranges.size(); c++) {
+    if (c % 37 == 0) base = range(rng);
+    ranges[c] = base + (c % 5) * 0.002;
+  }
+  return ranges;
+}
+}  // namespace
+
+TEST(FeatureExtractor, FindsPlanes) {
+  const VelodyneLidarParameters parameters = GetVelodyneParameters(VelodyneModelType::VLP16);
+  FeatureOptions options;
+  Extractor extractor(parameters, options);
+  // A cylinder around the sensor has no curvature along the rings
+  Scan scan(parameters, std::vector<double>(1800, 10.0));
+  scan.write(extractor.engine, 32);
+  // The revolution is only complete once the next one started
+  EXPECT_EQ(extractor.features.revolutions(), 0u);
+  EXPECT_TRUE(extractor.features.planes().empty());
+  scan.startNext(extractor.engine);
+  EXPECT_EQ(extractor.features.revolutions(), 1u);
+  EXPECT_TRUE(extractor.features.edges().empty());
+  ASSERT_EQ(extractor.features.planes().size(),
+            parameters.vertical_beams * options.sectors * options.planes_per_sector);
+  for (const ScanFeature& plane : extractor.features.planes()) {
+    EXPECT_NEAR(std::hypot(plane.x, plane.y, plane.z), 10.0, 0.01);
+    EXPECT_EQ(plane.curvature, 0.0f);
+  }
+}
+
+TEST(FeatureExtractor, FindsEdges) {
+  const VelodyneLidarParameters parameters = GetVelodyneParameters(VelodyneModelType::VLP16);
+  FeatureOptions options;
+  Extractor extractor(parameters, options);
+  // A step from 10 to 5 meters at column 960 and back to 10 meters where the next revolution
+  // starts, and a column without returns at column 300
+  std::vector<double> ranges(1800, 10.0);
+  std::fill(ranges.begin() + 960, ranges.end(), 5.0);
+  ranges[300] = 0.0;
+  Scan(parameters, ranges).complete(extractor.engine, 7);
+  ASSERT_EQ(extractor.features.revolutions(), 1u);
+  // The columns on the near side next to the steps are the sharpest, one per step and ring
+  ASSERT_EQ(extractor.features.edges().size(), 2 * parameters.vertical_beams);
+  for (const ScanFeature& edge : extractor.features.edges()) {
+    EXPECT_NEAR(std::hypot(edge.x, edge.y, edge.z), 5.0, 0.01);
+    const double angle = std::atan2(edge.y, edge.x);
+    const double step = angle > 1.0 ? 2.0 * kPi - 2.0 * kPi * 960 / 1800 : 2.0 * kPi / 1800;
+    EXPECT_NEAR(angle, step, 1e-3);
+    EXPECT_NEAR(edge.curvature, 0.5f, 0.01f);
+  }
+  // No return next to the column without returns is a feature
+  for (const ScanFeature& plane : extractor.features.planes()) {
+    const double azimuth = std::atan2(-plane.y, plane.x);
+    EXPECT_GT(std::abs(azimuth - 2.0 * kPi * 300 / 1800), 2.0 * kPi * 5 / 1800);
+  }
+}
+
+TEST(FeatureExtractor, ChunksDoNotMatter) {
+  const VelodyneLidarParameters parameters = GetVelodyneParameters(VelodyneModelType::VLP32C);
+  Scan scan(parameters, RandomRanges(1800, 3));
+  FeatureOptions options;
+  Extractor expected(parameters, options);
+  scan.complete(expected.engine, scan.thetas.size());
+  EXPECT_FALSE(expected.features.edges().empty());
+  EXPECT_FALSE(expected.features.planes().empty());
+  for (size_t chunk : {1, 32}) {
+    Extractor extractor(parameters, options);
+    scan.complete(extractor.engine, chunk);
+    ExpectSameFeatures(extractor.features, expected.features);
+  }
+}
+
+// The driver hands the columns of every scan of 5 packets to the extractor, which are 15 columns
+// of the VLS128. The features of the second revolution also see the windows which span the
+// boundary to the first one.
+TEST(FeatureExtractor, DriverScansMatchAFullRevolution) {
+  VelodyneLidarParameters parameters = GetVelodyneParameters(VelodyneModelType::VLS128);
+  std::vector<double> angles;
+  for (size_t i = 0; i < parameters.vertical_beams; i++) {
+    angles.push_back(-25.0 + 40.0 * i / parameters.vertical_beams);
+  }
+  ASSERT_TRUE(SetVerticalAngles(angles, parameters));
+  Scan scan(parameters, RandomRanges(3600, 5));
+  FeatureOptions options;
+  Extractor expected(parameters, options);
+  Extractor extractor(parameters, options);
+  for (int revolution = 0; revolution < 2; revolution++) {
+    scan.write(expected.engine, scan.thetas.size());
+    scan.write(extractor.engine, 15);
+  }
+  scan.complete(expected.engine, scan.thetas.size());
+  scan.complete(extractor.engine, 15);
+  EXPECT_EQ(extractor.features.revolutions(), 3u);
+  EXPECT_FALSE(expected.features.edges().empty());
+  EXPECT_FALSE(expected.features.planes().empty());
+  ExpectSameFeatures(extractor.features, expected.features);
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "packages/velodyne_lidar/gems/scan_registration.hpp"
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+constexpr double kPi = 3.14159265358979323846;
+
+// A scan of a box shaped room taken by a sensor with the given pose in the room
+struct RoomScan {
+  RoomScan(const VelodyneLidarParameters& parameters, const RigidTransform& room_T_sensor,
+           size_t columns = 1800) {
+    const std::array<double, 3> minimum = {-12.0, -7.0, -1.8};
+    const std::array<double, 3> maximum = {9.0, 10.0, 4.0};
+    for (size_t c = 0; c < columns; c++) {
+      const double theta = -2.0 * kPi * c / columns;
+      thetas.push_back(theta);
+      for (double phi : parameters.vertical_angles) {
+        const std::array<double, 3> local = {std::cos(phi) * std::cos(theta),
+                                             std::cos(phi) * std::sin(theta), std::sin(phi)};
+        std::array<double, 3> direction;
+        for (int i = 0; i < 3; i++) {
+          direction[i] = room_T_sensor.rotation[3 * i] * local[0] +
+                         room_T_sensor.rotation[3 * i + 1] * local[1] +
+                         room_T_sensor.rotation[3 * i + 2] * local[2];
+        }
+        // The closest wall which the ray hits from inside of the room
+        double distance = std::numeric_limits<double>::infinity();
+        for (int i = 0; i < 3; i++) {
+          if (direction[i] > 1e-9) {
+            distance = std::min(distance,
+                                (maximum[i] - room_T_sensor.translation[i]) / direction[i]);
+          } else if (direction[i] < -1e-9) {
+            distance = std::min(distance,
+                                (minimum[i] - room_T_sensor.translation[i]) / direction[i]);
+          }
+        }
+        ranges.push_back(static_cast<uint16_t>(distance / parameters.distance_resolution));
+      }
+    }
+  }
+
+  std::vector<uint16_t> ranges;
+  std::vector<double> thetas;
+};
+
+// Largest difference of the entries of two transformations
+double Difference(const RigidTransform& a, const RigidTransform& b) {
+  double difference = 0.0;
+  for (int i = 0; i < 9; i++) {
+    difference = std::max(difference, std::abs(a.rotation[i] - b.rotation[i]));
+  }
+  for (int i = 0; i < 3; i++) {
+    difference = std::max(difference, std::abs(a.translation[i] - b.translation[i]));
+  }
+  return difference;
+}
+}  // namespace
+
+TEST(ScanRegistration, RecoversMotion) {
+  const VelodyneLidarParameters parameters = GetVelodyneParameters(VelodyneModelType::VLP32C);
+  const RigidTransform motion =
+      RigidTransform::FromAxisAngle({0.1, 0.0, 0.995}, 0.05, {0.3, -0.1, 0.05});
+  const RoomScan reference(parameters, RigidTransform());
+  const RoomScan scan(parameters, motion);
+  for (size_t threads : {1, 3}) {
+    RegistrationOptions options;
+    options.threads = threads;
+    ScanRegistration registration(parameters, options);
+    registration.setReference(reference.ranges.data(), reference.thetas.data(),
+                              reference.thetas.size());
+    RegistrationResult result;
+    ASSERT_TRUE(registration.align(scan.ranges.data(), scan.thetas.data(), scan.thetas.size(),
+                                   RigidTransform(), result));
+    EXPECT_TRUE(result.converged);
+    EXPECT_LT(Difference(result.transform, motion), 0.01) << threads;
+    EXPECT_GT(result.correspondences, 10000u);
+    EXPECT_LT(result.rms_error, 0.02);
+  }
+}
+
+TEST(ScanRegistration, AlignsConsecutiveRevolutions) {
+  const VelodyneLidarParameters parameters = GetVelodyneParameters(VelodyneModelType::VLP16);
+  ScanRegistration registration(parameters, RegistrationOptions());
+  const RigidTransform step = RigidTransform::FromAxisAngle({0.0, 0.0, 1.0}, 0.02, {0.2, 0, 0});
+  RigidTransform pose;
+  RegistrationResult result;
+  for (int i = 0; i < 4; i++) {
+    const RoomScan scan(parameters, pose);
+    // The writer sees the revolution in chunks
+    for (size_t c = 0; c < scan.thetas.size(); c += 32) {
+      const size_t count = std::min<size_t>(32, scan.thetas.size() - c);
+      registration.write(scan.ranges.data() + c * parameters.vertical_beams, nullptr,
+                         scan.thetas.data() + c, count);
+    }
+    EXPECT_EQ(registration.revolutions(), static_cast<uint64_t>(i));
+    registration.endRevolution(100 * (i + 1));
+    // The first revolution only becomes the reference
+    EXPECT_EQ(registration.update(RigidTransform(), result), i > 0);
+    if (i > 0) {
+      EXPECT_LT(Difference(result.transform, step), 0.01);
+      EXPECT_EQ(result.source_timestamp, 100 * (i + 1));
+      EXPECT_EQ(result.target_timestamp, 100 * i);
+    }
+    // A revolution is only aligned once
+    EXPECT_FALSE(registration.update(RigidTransform(), result));
+    pose = pose * step;
+  }
+
+  // A scan without returns can not be aligned
+  const std::vector<uint16_t> ranges(1800 * parameters.vertical_beams, 0);
+  const std::vector<double> thetas(1800, 0.0);
+  EXPECT_FALSE(registration.align(ranges.data(), thetas.data(), 1800, RigidTransform(), result));
+}
+
+TEST(ScanRegistration, AlignsInTheBackground) {
+  const VelodyneLidarParameters parameters = GetVelodyneParameters(VelodyneModelType::VLP16);
+  RegistrationOptions options;
+  options.threads = 3;
+  ScanRegistration registration(parameters, options);
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::vector<bool> aligned;
+  std::vector<RegistrationResult> results;
+  registration.start([&](bool success, const RegistrationResult& result) {
+    std::lock_guard<std::mutex> lock(mutex);
+    aligned.push_back(success);
+    results.push_back(result);
+    condition.notify_one();
+  });
+  const RigidTransform step = RigidTransform::FromAxisAngle({0.0, 0.0, 1.0}, 0.02, {0.2, 0, 0});
+  RigidTransform pose;
+  for (size_t i = 0; i < 4; i++) {
+    const RoomScan scan(parameters, pose);
+    registration.write(scan.ranges.data(), nullptr, scan.thetas.data(), scan.thetas.size());
+    registration.endRevolution(i);
+    // Waits for the alignment such that no revolution is skipped
+    std::unique_lock<std::mutex> lock(mutex);
+    ASSERT_TRUE(condition.wait_for(lock, std::chrono::seconds(10),
+                                   [&] { return aligned.size() == i + 1; }));
+    pose = pose * step;
+  }
+  registration.stop();
+  EXPECT_EQ(registration.skippedRevolutions(), 0u);
+  // The first revolution only becomes the reference
+  EXPECT_EQ(aligned, std::vector<bool>({false, true, true, true}));
+  for (size_t i = 1; i < results.size(); i++) {
+    EXPECT_LT(Difference(results[i].transform, step), 0.01) << i;
+  }
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
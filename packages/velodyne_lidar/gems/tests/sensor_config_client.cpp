@@ -0,0 +1,307 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "packages/velodyne_lidar/gems/sensor_config_client.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+constexpr char kStatus[] =
+    R"({"gps":{"pps_state":"Locked","position":""},"motor":{"state":"On","rpm":599,)"
+    R"("lock":"On","phase":17999},"laser":{"state":"On"}})";
+
+// A request received by the mock server
+struct Request {
+  std::string method;
+  std::string path;
+  std::string body;
+};
+
+// A response of the mock server. A status code of 0 means that the server never responds.
+struct Response {
+  int code;
+  std::string body;
+};
+
+// Mock of the web interface of the sensor which accepts one connection at a time on a random
+// port of the loopback interface
+class MockServer {
+ public:
+  using Handler = std::function<Response(const Request&)>;
+
+  explicit MockServer(Handler handler) : handler_(std::move(handler)) {
+    fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    if (::bind(fd_, reinterpret_cast<sockaddr*>(&address), length) != 0 ||
+        ::listen(fd_, 4) != 0 ||
+        ::getsockname(fd_, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+      std::abort();
+    }
+    port_ = ntohs(address.sin_port);
+    thread_ = std::thread([this] { run(); });
+  }
+
+  ~MockServer() {
+    stop_ = true;
+    thread_.join();
+    ::close(fd_);
+  }
+
+  int port() const { return port_; }
+
+  std::vector<Request> requests() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return requests_;
+  }
+
+ private:
+  // Waits until the socket is readable or the server is stopped
+  bool waitReadable(int fd) {
+    while (!stop_) {
+      pollfd descriptor{fd, POLLIN, 0};
+      if (::poll(&descriptor, 1, 10) > 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void run() {
+    while (waitReadable(fd_)) {
+      const int connection = ::accept(fd_, nullptr, nullptr);
+      if (connection < 0) {
+        continue;
+      }
+      Request request;
+      if (read(connection, request)) {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          requests_.push_back(request);
+        }
+        const Response response = handler_(request);
+        if (response.code == 0) {
+          // Keep the connection open without answering
+          while (waitReadable(connection) && ::recv(connection, nullptr, 0, 0) > 0) {
+          }
+        } else {
+          const std::string message = "HTTP/1.0 " + std::to_string(response.code) +
+                                      " Status\r\nContent-Length: " +
+                                      std::to_string(response.body.size()) + "\r\n\r\n" +
+                                      response.body;
+          ::send(connection, message.data(), message.size(), MSG_NOSIGNAL);
+        }
+      }
+      ::close(connection);
+    }
+  }
+
+  // Reads a request with a body of the length given by the Content-Length header
+  bool read(int connection, Request& request) {
+    std::string data;
+    char buffer[1024];
+    size_t header_end = std::string::npos;
+    size_t content_length = 0;
+    while (header_end == std::string::npos || data.size() < header_end + 4 + content_length) {
+      if (!waitReadable(connection)) {
+        return false;
+      }
+      const ssize_t result = ::recv(connection, buffer, sizeof(buffer), 0);
+      if (result <= 0) {
+        return false;
+      }
+      data.append(buffer, result);
+      header_end = data.find("\r\n\r\n");
+      const size_t length = data.find("Content-Length: ");
+      if (length != std::string::npos && length < header_end) {
+        content_length = std::strtoul(data.c_str() + length + 16, nullptr, 10);
+      }
+    }
+    const size_t method_end = data.find(' ');
+    const size_t path_end = data.find(' ', method_end + 1);
+    request.method = data.substr(0, method_end);
+    request.path = data.substr(method_end + 1, path_end - method_end - 1);
+    request.body = data.substr(header_end + 4);
+    return true;
+  }
+
+  Handler handler_;
+  int fd_;
+  int port_;
+  std::atomic<bool> stop_{false};
+  std::thread thread_;
+  mutable std::mutex mutex_;
+  std::vector<Request> requests_;
+};
+
+// Waits up to one second for the condition to become true
+bool WaitFor(const std::function<bool()>& condition) {
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+  while (!condition()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+SensorSettings AllSettings() {
+  SensorSettings settings;
+  settings.rpm = 600;
+  settings.return_mode = "Dual";
+  settings.fov = std::make_pair(90, 270);
+  settings.phase_lock_offset = 180;
+  return settings;
+}
+}  // namespace
+
+TEST(SensorConfigClient, AppliesSettingsAndPollsStatus) {
+  MockServer server([](const Request& request) {
+    return Response{200, request.path == "/cgi/status.json" ? kStatus : ""};
+  });
+  SensorConfigClient client;
+  ASSERT_TRUE(client.start("127.0.0.1", server.port(), AllSettings(), 0.01, 1.0));
+  ASSERT_TRUE(WaitFor([&] { return client.status().valid; }));
+  client.stop();
+
+  EXPECT_TRUE(client.settingsApplied());
+  EXPECT_EQ(client.failedRequests(), 0u);
+  const SensorStatus status = client.status();
+  EXPECT_TRUE(status.motor_on);
+  EXPECT_DOUBLE_EQ(status.motor_rpm, 599.0);
+  EXPECT_TRUE(status.phase_locked);
+  EXPECT_TRUE(status.laser_on);
+  EXPECT_EQ(status.pps_state, "Locked");
+
+  const std::vector<Request> requests = server.requests();
+  ASSERT_GE(requests.size(), 5u);
+  const std::pair<std::string, std::string> expected[] = {
+      {"/cgi/setting", "rpm=600"},
+      {"/cgi/setting", "returns=Dual"},
+      {"/cgi/setting/fov", "start=90&end=270"},
+      {"/cgi/setting/phaselock", "enabled=on&offset=180"},
+  };
+  for (size_t i = 0; i < 4; i++) {
+    EXPECT_EQ(requests[i].method, "POST");
+    EXPECT_EQ(requests[i].path, expected[i].first);
+    EXPECT_EQ(requests[i].body, expected[i].second);
+  }
+  EXPECT_EQ(requests[4].method, "GET");
+  EXPECT_EQ(requests[4].path, "/cgi/status.json");
+}
+
+TEST(SensorConfigClient, RetriesFailedSettings) {
+  // The web server of the sensor answers with errors while it is booting
+  std::atomic<int> errors{3};
+  MockServer server([&](const Request& request) {
+    if (request.method == "POST" && errors > 0) {
+      errors--;
+      return Response{500, ""};
+    }
+    return Response{200, request.path == "/cgi/status.json" ? kStatus : ""};
+  });
+  SensorSettings settings;
+  settings.rpm = 900;
+  SensorConfigClient client;
+  ASSERT_TRUE(client.start("127.0.0.1", server.port(), settings, 0.01, 1.0));
+  ASSERT_TRUE(WaitFor([&] { return client.settingsApplied(); }));
+  client.stop();
+
+  EXPECT_EQ(client.failedRequests(), 3u);
+  size_t posts = 0;
+  for (const Request& request : server.requests()) {
+    if (request.method == "POST") {
+      EXPECT_EQ(request.body, "rpm=900");
+      posts++;
+    }
+  }
+  EXPECT_EQ(posts, 4u);
+}
+
+TEST(SensorConfigClient, IgnoresInvalidStatus) {
+  MockServer server([](const Request&) { return Response{200, "<html>"}; });
+  SensorConfigClient client;
+  ASSERT_TRUE(client.start("127.0.0.1", server.port(), SensorSettings(), 0.01, 1.0));
+  ASSERT_TRUE(WaitFor([&] { return client.failedRequests() > 0; }));
+  client.stop();
+  EXPECT_FALSE(client.status().valid);
+}
+
+TEST(SensorConfigClient, StalledServerDoesNotBlock) {
+  MockServer server([](const Request&) { return Response{0, ""}; });
+  SensorConfigClient client;
+  ASSERT_TRUE(client.start("127.0.0.1", server.port(), AllSettings(), 0.01, 60.0));
+  ASSERT_TRUE(WaitFor([&] { return !server.requests().empty(); }));
+
+  // Accessors return immediately while the background thread waits for the response
+  const auto start = std::chrono::steady_clock::now();
+  EXPECT_FALSE(client.status().valid);
+  EXPECT_FALSE(client.settingsApplied());
+  // Stopping aborts the request in flight instead of waiting for the timeout
+  client.stop();
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(500));
+}
+
+TEST(SensorConfigClient, TimesOut) {
+  MockServer server([](const Request&) { return Response{0, ""}; });
+  SensorSettings settings;
+  settings.rpm = 300;
+  SensorConfigClient client;
+  ASSERT_TRUE(client.start("127.0.0.1", server.port(), settings, 0.0, 0.05));
+  ASSERT_TRUE(WaitFor([&] { return client.failedRequests() > 0; }));
+  client.stop();
+  EXPECT_FALSE(client.settingsApplied());
+}
+
+TEST(SensorConfigClient, RejectsInvalidAddress) {
+  SensorConfigClient client;
+  EXPECT_FALSE(client.start("sensor", 80, SensorSettings(), 1.0, 1.0));
+  client.stop();
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "engine/gems/serialization/json.hpp"
+#include "gtest/gtest.h"
+#include "packages/velodyne_lidar/gems/trace.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+constexpr size_t kThreads = 4;
+// Every thread wraps around its ring buffer a few times before the writers are stopped, and
+// gives up the CPU eventually on machines with few cores
+constexpr uint64_t kMinimumEvents = 3 * trace::kEventsPerThread;
+constexpr uint64_t kMaximumEvents = 100 * trace::kEventsPerThread;
+const char* const kNames[kThreads] = {"first", "second", "third", "fourth"};
+
+// A file in the test's temporary directory
+std::string TemporaryFile(const std::string& name) {
+  const char* directory = std::getenv("TEST_TMPDIR");
+  return std::string(directory != nullptr ? directory : "/tmp") + "/" + name + "_" +
+         std::to_string(::getpid()) + ".json";
+}
+
+// Records events until stopped and returns their number in `count`. Start and duration in
+// microseconds are derived from the ID so that a torn event can be detected.
+void RecordEvents(size_t writer, const std::atomic<bool>& stop, std::atomic<uint64_t>& count) {
+  uint64_t id = 0;
+  while (id < kMinimumEvents || (!stop.load() && id < kMaximumEvents)) {
+    const int64_t start = static_cast<int64_t>(id) * 1000;
+    trace::Record(kNames[writer], id, start, start + static_cast<int64_t>(id % 7) * 1000);
+    count.store(++id);
+  }
+}
+
+// Parses a written trace and checks that every event is consistent. Returns the IDs of the
+// events of every writer.
+std::map<std::string, std::vector<uint64_t>> ReadTrace(const std::string& filename) {
+  std::map<std::string, std::vector<uint64_t>> ids;
+  std::ifstream file(filename);
+  const Json trace = Json::parse(file, nullptr, false);
+  EXPECT_FALSE(trace.is_discarded()) << "The trace is not valid JSON";
+  if (trace.is_discarded()) {
+    return ids;
+  }
+  std::map<int, std::string> thread_names;
+  for (const Json& event : trace["traceEvents"]) {
+    const std::string name = event["name"];
+    const uint64_t id = event["args"]["id"];
+    EXPECT_EQ(event["ph"], "X");
+    EXPECT_DOUBLE_EQ(event["ts"].get<double>(), static_cast<double>(id)) << name << " " << id;
+    EXPECT_DOUBLE_EQ(event["dur"].get<double>(), static_cast<double>(id % 7)) << name << " " << id;
+    // Every thread records events with a single name
+    const auto inserted = thread_names.emplace(event["tid"].get<int>(), name);
+    EXPECT_EQ(inserted.first->second, name);
+    ids[name].push_back(id);
+  }
+  return ids;
+}
+}  // namespace
+
+TEST(Trace, ConcurrentWritersProduceConsistentEvents) {
+  const std::string filename = TemporaryFile("trace");
+  std::atomic<bool> stop{false};
+  std::vector<std::atomic<uint64_t>> counts(kThreads);
+  std::vector<std::thread> writers;
+  for (size_t i = 0; i < kThreads; i++) {
+    counts[i] = 0;
+    writers.emplace_back(RecordEvents, i, std::cref(stop), std::ref(counts[i]));
+  }
+  // Write traces while the rings wrap around. Overwritten events need to be discarded.
+  for (int i = 0; i < 3; i++) {
+    ASSERT_TRUE(trace::WriteChromeTrace(filename));
+    for (const auto& entry : ReadTrace(filename)) {
+      const std::vector<uint64_t>& ids = entry.second;
+      ASSERT_LE(ids.size(), trace::kEventsPerThread);
+      // The events of a thread are ordered and without gaps
+      for (size_t j = 1; j < ids.size(); j++) {
+        ASSERT_EQ(ids[j], ids[j - 1] + 1) << entry.first;
+      }
+    }
+  }
+  stop = true;
+  for (std::thread& writer : writers) {
+    writer.join();
+  }
+
+  // Once the writers finished only the most recent events of every thread are left
+  ASSERT_TRUE(trace::WriteChromeTrace(filename));
+  const auto ids = ReadTrace(filename);
+  ASSERT_EQ(ids.size(), kThreads);
+  for (size_t i = 0; i < kThreads; i++) {
+    const std::vector<uint64_t>& events = ids.at(kNames[i]);
+    ASSERT_EQ(events.size(), trace::kEventsPerThread);
+    EXPECT_EQ(events.front(), counts[i] - trace::kEventsPerThread);
+    EXPECT_EQ(events.back(), counts[i] - 1);
+  }
+  std::remove(filename.c_str());
+}
+
+TEST(Trace, WritingFailsForInvalidPath) {
+  EXPECT_FALSE(trace::WriteChromeTrace("/nonexistent/directory/trace.json"));
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
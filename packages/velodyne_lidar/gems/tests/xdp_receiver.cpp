@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <arpa/inet.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "packages/velodyne_lidar/gems/xdp_receiver.hpp"
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+constexpr char kInterface[] = "vlxdp0";
+constexpr char kPeer[] = "vlxdp1";
+constexpr char kSensorIp[] = "192.168.1.201";
+constexpr int kPort = 2368;
+constexpr size_t kPacketSize = 1206;
+constexpr int64_t kTimeout = 100'000'000;
+
+// A veth pair on which the test injects Ethernet frames into the peer which then arrive on the
+// interface the receiver is attached to. Needs CAP_NET_ADMIN.
+class VethPair {
+ public:
+  VethPair() {
+    Remove();
+    const std::string commands = std::string("ip link add ") + kInterface +
+                                 " type veth peer name " + kPeer + " && ip link set " +
+                                 kInterface + " up && ip link set " + kPeer + " up";
+    if (std::system((commands + " 2>/dev/null").c_str()) != 0) {
+      return;
+    }
+    fd_ = ::socket(AF_PACKET, SOCK_RAW, 0);
+    address_.sll_family = AF_PACKET;
+    address_.sll_ifindex = if_nametoindex(kPeer);
+    address_.sll_halen = ETH_ALEN;
+  }
+  ~VethPair() {
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+    Remove();
+  }
+
+  bool ready() const { return fd_ >= 0 && address_.sll_ifindex != 0; }
+
+  // Sends a UDP datagram with the given payload as an Ethernet frame into the pair
+  bool send(const std::string& source_ip, int port, const std::vector<uint8_t>& payload) {
+    std::vector<uint8_t> frame(14 + 20 + 8 + payload.size(), 0);
+    std::memset(frame.data(), 0xff, ETH_ALEN);
+    frame[6] = 0x02;
+    frame[12] = 0x08;
+    uint8_t* ip = frame.data() + 14;
+    ip[0] = 0x45;
+    const uint16_t total_length = htons(20 + 8 + payload.size());
+    std::memcpy(ip + 2, &total_length, sizeof(total_length));
+    ip[8] = 64;
+    ip[9] = IPPROTO_UDP;
+    inet_pton(AF_INET, source_ip.c_str(), ip + 12);
+    inet_pton(AF_INET, "192.168.1.100", ip + 16);
+    uint32_t sum = 0;
+    for (int i = 0; i < 20; i += 2) {
+      sum += (ip[i] << 8) | ip[i + 1];
+    }
+    sum = (sum & 0xffff) + (sum >> 16);
+    const uint16_t checksum = htons(~(sum + (sum >> 16)) & 0xffff);
+    std::memcpy(ip + 10, &checksum, sizeof(checksum));
+    uint8_t* udp = ip + 20;
+    const uint16_t source_port = htons(kPort);
+    const uint16_t destination_port = htons(port);
+    const uint16_t udp_length = htons(8 + payload.size());
+    std::memcpy(udp, &source_port, sizeof(source_port));
+    std::memcpy(udp + 2, &destination_port, sizeof(destination_port));
+    std::memcpy(udp + 4, &udp_length, sizeof(udp_length));
+    std::memcpy(udp + 8, payload.data(), payload.size());
+    return ::sendto(fd_, frame.data(), frame.size(), 0, reinterpret_cast<sockaddr*>(&address_),
+                    sizeof(address_)) == static_cast<ssize_t>(frame.size());
+  }
+
+ private:
+  static void Remove() {
+    std::system((std::string("ip link del ") + kInterface + " 2>/dev/null").c_str());
+  }
+
+  int fd_ = -1;
+  sockaddr_ll address_{};
+};
+
+std::vector<uint8_t> Payload(int index) {
+  std::vector<uint8_t> payload(kPacketSize);
+  for (size_t i = 0; i < payload.size(); i++) {
+    payload[i] = static_cast<uint8_t>(index + i);
+  }
+  return payload;
+}
+}  // namespace
+
+// Sets up the veth pair and the receiver or skips the test if that is not possible
+#define OPEN_RECEIVER(VETH, RECEIVER, IP)                                             \
+  if (!XdpReceiver::kAvailable) {                                                     \
+    GTEST_SKIP() << "Built without --define velodyne_af_xdp=true";                    \
+  }                                                                                   \
+  VethPair VETH;                                                                      \
+  if (!VETH.ready()) {                                                                \
+    GTEST_SKIP() << "Could not create a veth pair";                                   \
+  }                                                                                   \
+  XdpReceiver RECEIVER;                                                               \
+  if (!RECEIVER.open(kInterface, 0, IP, kPort)) {                                     \
+    GTEST_SKIP() << "Could not attach the receiver: " << std::strerror(errno);        \
+  }
+
+TEST(XdpReceiver, ReceivesSensorPackets) {
+  OPEN_RECEIVER(veth, receiver, kSensorIp);
+  EXPECT_FALSE(receiver.zeroCopy());
+  for (int i = 0; i < 100; i++) {
+    const int64_t sent = PacketReceiver::NowNs();
+    ASSERT_TRUE(veth.send(kSensorIp, kPort, Payload(i)));
+    const byte* payload = nullptr;
+    size_t size = 0;
+    int64_t timestamp = 0;
+    ASSERT_EQ(receiver.receive(payload, size, kTimeout, timestamp), XdpReceiver::Status::kSuccess);
+    ASSERT_EQ(size, kPacketSize);
+    EXPECT_EQ(std::vector<uint8_t>(payload, payload + size), Payload(i));
+    // The timestamp is taken on arrival which happens between sending and receiving
+    EXPECT_GE(timestamp, sent - 1'000'000);
+    EXPECT_LE(timestamp, PacketReceiver::NowNs() + 1'000'000);
+  }
+  EXPECT_EQ(receiver.kernelDrops(), 0u);
+}
+
+TEST(XdpReceiver, KeepsPacketsWhileBusy) {
+  OPEN_RECEIVER(veth, receiver, "");
+  // More packets than fit into the receive ring at once are queued up
+  constexpr int kCount = 1000;
+  for (int i = 0; i < kCount; i++) {
+    ASSERT_TRUE(veth.send(kSensorIp, kPort, Payload(i)));
+  }
+  for (int i = 0; i < kCount; i++) {
+    const byte* payload = nullptr;
+    size_t size = 0;
+    int64_t timestamp = 0;
+    ASSERT_EQ(receiver.receive(payload, size, kTimeout, timestamp), XdpReceiver::Status::kSuccess);
+    ASSERT_EQ(size, kPacketSize);
+    EXPECT_EQ(payload[0], static_cast<uint8_t>(i));
+  }
+}
+
+TEST(XdpReceiver, PassesOtherTraffic) {
+  OPEN_RECEIVER(veth, receiver, kSensorIp);
+  ASSERT_TRUE(veth.send(kSensorIp, kPort + 1, Payload(0)));
+  ASSERT_TRUE(veth.send("192.168.1.202", kPort, Payload(1)));
+  const byte* payload = nullptr;
+  size_t size = 0;
+  int64_t timestamp = 0;
+  EXPECT_EQ(receiver.receive(payload, size, kTimeout, timestamp), XdpReceiver::Status::kTimeout);
+  // The receiver still works after a timeout
+  ASSERT_TRUE(veth.send(kSensorIp, kPort, Payload(2)));
+  ASSERT_EQ(receiver.receive(payload, size, kTimeout, timestamp), XdpReceiver::Status::kSuccess);
+  EXPECT_EQ(payload[0], 2);
+}
+
+TEST(XdpReceiver, FailsWithoutInterface) {
+  XdpReceiver receiver;
+  EXPECT_FALSE(receiver.open("vlxdp_missing", 0, "", kPort));
+  EXPECT_EQ(errno, XdpReceiver::kAvailable ? ENODEV : ENOTSUP);
+  const byte* payload = nullptr;
+  size_t size = 0;
+  int64_t timestamp = 0;
+  EXPECT_EQ(receiver.receive(payload, size, 0, timestamp), XdpReceiver::Status::kError);
+}
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
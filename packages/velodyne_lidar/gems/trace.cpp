@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "trace.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace isaac {
+namespace velodyne_lidar {
+namespace trace {
+
+namespace {
+struct Event {
+  const char* name;
+  uint64_t id;
+  int64_t start;
+  int64_t end;
+};
+
+// An event in the ring buffer of a thread. The fields are atomic since readers may copy a slot
+// while it is overwritten.
+struct Slot {
+  std::atomic<const char*> name;
+  std::atomic<uint64_t> id;
+  std::atomic<int64_t> start;
+  std::atomic<int64_t> end;
+};
+
+// Events of a single thread. Only the owning thread writes. Readers copy the events and discard
+// those whose slot was reused while copying, like a sequence lock per slot.
+struct ThreadBuffer {
+  std::array<Slot, kEventsPerThread> slots;
+  // Number of events which were started and completely written
+  std::atomic<uint64_t> started{0};
+  std::atomic<uint64_t> written{0};
+  uint32_t thread_id = 0;
+};
+
+// Buffers of all threads which ever recorded an event. Buffers are never released so that the
+// events of finished threads can still be written.
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+};
+
+Registry& GetRegistry() {
+  static Registry registry;
+  return registry;
+}
+
+ThreadBuffer* GetThreadBuffer() {
+  thread_local ThreadBuffer* buffer = nullptr;
+  if (buffer == nullptr) {
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.buffers.push_back(std::make_unique<ThreadBuffer>());
+    buffer = registry.buffers.back().get();
+    buffer->thread_id = static_cast<uint32_t>(registry.buffers.size());
+  }
+  return buffer;
+}
+}  // namespace
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void Record(const char* name, uint64_t id, int64_t start, int64_t end) {
+  ThreadBuffer* buffer = GetThreadBuffer();
+  const uint64_t index = buffer->written.load(std::memory_order_relaxed);
+  // Readers which see any part of the new event also see that the slot is being reused
+  buffer->started.store(index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  Slot& slot = buffer->slots[index % kEventsPerThread];
+  slot.name.store(name, std::memory_order_relaxed);
+  slot.id.store(id, std::memory_order_relaxed);
+  slot.start.store(start, std::memory_order_relaxed);
+  slot.end.store(end, std::memory_order_relaxed);
+  buffer->written.store(index + 1, std::memory_order_release);
+}
+
+bool WriteChromeTrace(const std::string& filename) {
+  // Copy the events first to keep the time in which writers may overwrite them short
+  std::vector<std::pair<uint32_t, Event>> events;
+  {
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (const auto& buffer : registry.buffers) {
+      const uint64_t end = buffer->written.load(std::memory_order_acquire);
+      const uint64_t begin = end > kEventsPerThread ? end - kEventsPerThread : 0;
+      const size_t offset = events.size();
+      for (uint64_t i = begin; i < end; i++) {
+        const Slot& slot = buffer->slots[i % kEventsPerThread];
+        events.emplace_back(buffer->thread_id, Event{slot.name.load(std::memory_order_relaxed),
+                                                     slot.id.load(std::memory_order_relaxed),
+                                                     slot.start.load(std::memory_order_relaxed),
+                                                     slot.end.load(std::memory_order_relaxed)});
+      }
+      // Events whose slot was reused in the meantime are not consistent. This includes the slot
+      // which may currently be written.
+      std::atomic_thread_fence(std::memory_order_acquire);
+      const uint64_t started = buffer->started.load(std::memory_order_relaxed);
+      if (started > begin + kEventsPerThread) {
+        const uint64_t overwritten = std::min(end - begin, started - begin - kEventsPerThread);
+        events.erase(events.begin() + offset, events.begin() + offset + overwritten);
+      }
+    }
+  }
+
+  std::FILE* file = std::fopen(filename.c_str(), "w");
+  if (file == nullptr) {
+    return false;
+  }
+  std::fprintf(file, "{\"traceEvents\":[\n");
+  for (size_t i = 0; i < events.size(); i++) {
+    const Event& event = events[i].second;
+    // Chrome traces use microseconds
+    std::fprintf(file,
+                 "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,"
+                 "\"args\":{\"id\":%" PRIu64 "}}%s\n",
+                 event.name, events[i].first, event.start * 1e-3, (event.end - event.start) * 1e-3,
+                 event.id, i + 1 < events.size() ? "," : "");
+  }
+  std::fprintf(file, "],\"displayTimeUnit\":\"ns\"}\n");
+  return std::fclose(file) == 0;
+}
+
+}  // namespace trace
+}  // namespace velodyne_lidar
+}  // namespace isaac
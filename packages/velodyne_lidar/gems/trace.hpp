@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Scoped trace events for the stages of the driver pipeline. Events are only recorded if the
+// package is built with VELODYNE_LIDAR_TRACING defined, e.g. with `--define velodyne_tracing=true`.
+// Otherwise the macros expand to nothing and their arguments are not evaluated.
+//
+// Every thread records into its own ring buffer without taking locks. The most recent events of
+// all threads can be written to a file in the Chrome trace format which can be opened in
+// chrome://tracing or Perfetto.
+
+namespace isaac {
+namespace velodyne_lidar {
+namespace trace {
+
+#ifdef VELODYNE_LIDAR_TRACING
+constexpr bool kEnabled = true;
+#else
+constexpr bool kEnabled = false;
+#endif
+
+// Number of most recent events which are kept per thread
+constexpr size_t kEventsPerThread = 1 << 16;
+
+// The current time on the time base of trace events in nanoseconds
+int64_t NowNs();
+// Records an event with a static name, for example the ID of a packet or scan, and its start and
+// end time in nanoseconds
+void Record(const char* name, uint64_t id, int64_t start, int64_t end);
+// Writes the recorded events of all threads to a file in the Chrome trace format. Returns false
+// if the file could not be written.
+bool WriteChromeTrace(const std::string& filename);
+
+// Records an event for the lifetime of the object
+class Scope {
+ public:
+  Scope(const char* name, uint64_t id) : name_(name), id_(id), start_(NowNs()) {}
+  ~Scope() { Record(name_, id_, start_, NowNs()); }
+
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+ private:
+  const char* name_;
+  uint64_t id_;
+  int64_t start_;
+};
+
+}  // namespace trace
+}  // namespace velodyne_lidar
+}  // namespace isaac
+
+#ifdef VELODYNE_LIDAR_TRACING
+#define VELODYNE_TRACE_CONCAT_IMPL(A, B) A##B
+#define VELODYNE_TRACE_CONCAT(A, B) VELODYNE_TRACE_CONCAT_IMPL(A, B)
+// Records an event with the given name and ID until the end of the enclosing scope
+#define VELODYNE_TRACE_SCOPE(NAME, ID)                                                  \
+  ::isaac::velodyne_lidar::trace::Scope VELODYNE_TRACE_CONCAT(velodyne_trace_, __LINE__)( \
+      NAME, ID)
+#else
+#define VELODYNE_TRACE_SCOPE(NAME, ID) static_cast<void>(0)
+#endif
@@ -28,24 +28,58 @@
 #include "velodyne_constants.hpp"
 
 #include "engine/core/assert.hpp"
+#include "engine/core/math/utils.hpp"
 
 namespace isaac {
 namespace velodyne_lidar {
 namespace {
 // VLP16 specific constants
-constexpr uint32_t kVLP16DataPacketSize = 1248;  // Size of a packet
-constexpr uint32_t kVLP16HeaderPacketSize = 42;  // Size of the packet header
-constexpr uint32_t kVLP16BlocksPerPacket = 12;   // Number of blocks per packets
-constexpr uint32_t kVLP16ChannelsPerBlock = 32;  // Number of channels per blocks
-constexpr uint32_t kVLP16VerticalBeams = 16;     // Number of vertical beams
-constexpr double kVLP16MaxRange = 100.0;         // Max range in meters
-constexpr double kVLP16MinRange = 0.2;           // Min range in meters
+constexpr uint32_t kVLP16DataPacketSize = 1248;     // Size of a packet
+constexpr uint32_t kVLP16HeaderPacketSize = 42;     // Size of the packet header
+constexpr uint32_t kVLP16BlocksPerPacket = 12;      // Number of blocks per packets
+constexpr uint32_t kVLP16ChannelsPerBlock = 32;     // Number of channels per blocks
+constexpr uint32_t kVLP16VerticalBeams = 16;        // Number of vertical beams
+constexpr double kVLP16MaxRange = 100.0;            // Max range in meters
+constexpr double kVLP16MinRange = 0.2;              // Min range in meters
+constexpr double kVLP16DistanceResolution = 0.002;  // Size of one distance unit in meters
+constexpr double kVLP16FiringCycle = 55.296e-6;     // Time between two columns in seconds
+constexpr uint8_t kVLP16ProductId = 0x22;           // Product ID in the factory bytes
 
 // Vertical scanning angles in radians for VLP16
 static const double kVLP16VerticalAngles[] = {
     -0.2617993878,  0.01745329252, -0.2268928028,  0.05235987756, -0.1919862177, 0.0872664626,
     -0.1570796327,  0.1221730476,  -0.1221730476,  0.1570796327,  -0.0872664626, 0.1919862177,
     -0.05235987756, 0.2268928028,  -0.01745329252, 0.2617993878};
+
+// VLP32C specific constants
+constexpr uint32_t kVLP32CDataPacketSize = 1248;     // Size of a packet
+constexpr uint32_t kVLP32CHeaderPacketSize = 42;     // Size of the packet header
+constexpr uint32_t kVLP32CBlocksPerPacket = 12;      // Number of blocks per packets
+constexpr uint32_t kVLP32CChannelsPerBlock = 32;     // Number of channels per blocks
+constexpr uint32_t kVLP32CVerticalBeams = 32;        // Number of vertical beams
+constexpr double kVLP32CMaxRange = 200.0;            // Max range in meters
+constexpr double kVLP32CMinRange = 0.2;              // Min range in meters
+constexpr double kVLP32CDistanceResolution = 0.004;  // Size of one distance unit in meters
+constexpr double kVLP32CFiringCycle = 55.296e-6;     // Time between two columns in seconds
+constexpr uint8_t kVLP32CProductId = 0x28;           // Product ID in the factory bytes
+
+// Vertical scanning angles in degrees for VLP32C ordered by laser ID
+static const double kVLP32CVerticalAnglesDegrees[] = {
+    -25.0,  -1.0,   -1.667, -15.639, -11.31, 0.0,    -0.667, -8.843, -7.254, 0.333, -0.333,
+    -6.148, -5.333, 1.333,  0.667,   -4.0,   -4.667, 1.667,  1.0,    -3.667, -3.333, 3.333,
+    2.333,  -2.667, -3.0,   7.0,     4.667,  -2.333, -2.0,   15.0,   10.333, -1.333};
+
+// VLS128 specific constants. The vertical angles are specific to every unit.
+constexpr uint32_t kVLS128DataPacketSize = 1248;     // Size of a packet
+constexpr uint32_t kVLS128HeaderPacketSize = 42;     // Size of the packet header
+constexpr uint32_t kVLS128BlocksPerPacket = 12;      // Number of blocks per packets
+constexpr uint32_t kVLS128ChannelsPerBlock = 32;     // Number of channels per blocks
+constexpr uint32_t kVLS128VerticalBeams = 128;       // Number of vertical beams
+constexpr double kVLS128MaxRange = 245.0;            // Max range in meters
+constexpr double kVLS128MinRange = 0.2;              // Min range in meters
+constexpr double kVLS128DistanceResolution = 0.004;  // Size of one distance unit in meters
+constexpr double kVLS128FiringCycle = 53.3e-6;       // Time between two columns in seconds
+constexpr uint8_t kVLS128ProductId = 0xA1;           // Product ID in the factory bytes
 }  // namespace
 
 VelodyneLidarParameters GetVelodyneParameters(const VelodyneModelType model_type) {
@@ -60,14 +94,57 @@ VelodyneLidarParameters GetVelodyneParameters(const VelodyneModelType model_type
       result.block_size = 2 + 2 + 3 * kVLP16ChannelsPerBlock;  // 100
       result.channels_per_block = kVLP16ChannelsPerBlock;
       result.blocks_per_packet = kVLP16BlocksPerPacket;
+      result.distance_resolution = kVLP16DistanceResolution;
+      result.firing_cycle = kVLP16FiringCycle;
+      result.product_id = kVLP16ProductId;
       result.vertical_angles.insert(result.vertical_angles.begin(), kVLP16VerticalAngles,
                                     kVLP16VerticalAngles + 16);
       break;
+    case VelodyneModelType::VLP32C:
+      result.vertical_beams = kVLP32CVerticalBeams;
+      result.minimum_range = kVLP32CMinRange;
+      result.maximum_range = kVLP32CMaxRange;
+      result.packet_header_size = kVLP32CHeaderPacketSize;
+      result.packet_sans_header_size = kVLP32CDataPacketSize - kVLP32CHeaderPacketSize;
+      result.block_size = 2 + 2 + 3 * kVLP32CChannelsPerBlock;  // 100
+      result.channels_per_block = kVLP32CChannelsPerBlock;
+      result.blocks_per_packet = kVLP32CBlocksPerPacket;
+      result.distance_resolution = kVLP32CDistanceResolution;
+      result.firing_cycle = kVLP32CFiringCycle;
+      result.product_id = kVLP32CProductId;
+      for (double angle : kVLP32CVerticalAnglesDegrees) {
+        result.vertical_angles.push_back(DegToRad(angle));
+      }
+      break;
+    case VelodyneModelType::VLS128:
+      result.vertical_beams = kVLS128VerticalBeams;
+      result.minimum_range = kVLS128MinRange;
+      result.maximum_range = kVLS128MaxRange;
+      result.packet_header_size = kVLS128HeaderPacketSize;
+      result.packet_sans_header_size = kVLS128DataPacketSize - kVLS128HeaderPacketSize;
+      result.block_size = 2 + 2 + 3 * kVLS128ChannelsPerBlock;  // 100
+      result.channels_per_block = kVLS128ChannelsPerBlock;
+      result.blocks_per_packet = kVLS128BlocksPerPacket;
+      result.distance_resolution = kVLS128DistanceResolution;
+      result.firing_cycle = kVLS128FiringCycle;
+      result.product_id = kVLS128ProductId;
+      break;
     default:
       PANIC("Unknown Velodyne Model: %x", model_type);
   }
   return result;
 }
 
+bool SetVerticalAngles(const std::vector<double>& degrees, VelodyneLidarParameters& parameters) {
+  if (degrees.size() != parameters.vertical_beams) {
+    return false;
+  }
+  parameters.vertical_angles.clear();
+  for (double angle : degrees) {
+    parameters.vertical_angles.push_back(DegToRad(angle));
+  }
+  return true;
+}
+
 }  // namespace velodyne_lidar
 }  // namespace isaac
@@ -35,15 +35,20 @@ namespace velodyne_lidar {
 
 // VLP model specific parameters
 struct VelodyneLidarParameters {
-  double minimum_range;                 // Min range in meters
-  double maximum_range;                 // Max range in meters
-  uint32_t packet_header_size;          // Size of packet header in bytes
-  uint32_t packet_sans_header_size;     // Size of packet without header in bytes
-  uint32_t block_size;                  // Size of block in bytes
-  uint32_t channels_per_block;          // Number of channels per blocks
-  uint32_t blocks_per_packet;           // Number of blocks per packets
-  uint32_t vertical_beams;              // Number of vertical beams
-  std::vector<double> vertical_angles;  // Vertical scanning angles in radians
+  double minimum_range;              // Min range in meters
+  double maximum_range;              // Max range in meters
+  uint32_t packet_header_size;       // Size of packet header in bytes
+  uint32_t packet_sans_header_size;  // Size of packet without header in bytes
+  uint32_t block_size;               // Size of block in bytes
+  uint32_t channels_per_block;       // Number of channels per blocks
+  uint32_t blocks_per_packet;        // Number of blocks per packets
+  uint32_t vertical_beams;           // Number of vertical beams
+  double distance_resolution;        // Size of one distance unit in meters
+  double firing_cycle;               // Time between two columns in seconds
+  uint8_t product_id;                // Product ID in the factory bytes of every packet
+  // Vertical scanning angles in radians. Empty for models whose angles are specific to the
+  // calibration of every unit. These need to be provided by the user.
+  std::vector<double> vertical_angles;
 };
 
 // Mode the laser in is (what it sends us back)
@@ -51,8 +56,11 @@ constexpr uint8_t kVelodyneModeStrong = 0x37;
 constexpr uint8_t kVelodyneModeLast = 0x38;
 constexpr uint8_t kVelodyneModeDual = 0x39;
 constexpr uint32_t kMaxIntensity = 100;  // Max value for the intensity (100%)
-constexpr double kDistanceToMeters = 0.002f;
-constexpr uint16_t kDeltaTime = 50;  // Time between firings in microseconds
+constexpr uint16_t kBlockFlag = 0xEEFF;  // Flag at the start of every data block
+// Sensors with more beams than channels per block spread a column over several blocks. Each of
+// these blocks starts with the flag of the bank of lasers whose channels it contains.
+constexpr uint16_t kBankBlockFlags[] = {0xEEFF, 0xDDFF, 0xCCFF, 0xBBFF};
+constexpr uint32_t kFactoryBytesSize = 6;  // Timestamp, return mode and product ID
 
 #pragma pack(push, 1)
 
@@ -67,12 +75,16 @@ struct VelodyneRawDataBlock {
   VelodyneRawChannel channels[];
 };  // 100 bytes for VLP16
 
-enum class VelodyneModelType { VLP16, INVALID };
+enum class VelodyneModelType { VLP16, VLP32C, VLS128, INVALID };
 
 #pragma pack(pop)
 
 // Factory method to retrieve parameters for specific VLP model
 VelodyneLidarParameters GetVelodyneParameters(const VelodyneModelType);
 
+// Replaces the vertical angles of the parameters by the given angles in degrees ordered by laser
+// ID. Returns false if the number of angles does not match the number of vertical beams.
+bool SetVerticalAngles(const std::vector<double>& degrees, VelodyneLidarParameters& parameters);
+
 }  // namespace velodyne_lidar
 }  // namespace isaac
@@ -0,0 +1,500 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "xdp_receiver.hpp"
+
+#include <cerrno>
+
+#ifdef VELODYNE_LIDAR_AF_XDP
+
+#include <arpa/inet.h>
+#include <linux/bpf.h>
+#include <linux/if_ether.h>
+#include <linux/if_link.h>
+#include <linux/if_xdp.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+#endif
+
+namespace isaac {
+namespace velodyne_lidar {
+
+#ifdef VELODYNE_LIDAR_AF_XDP
+
+namespace {
+
+constexpr int64_t kNanosecondsPerSecond = 1'000'000'000;
+// Every frame of the shared memory holds one packet. Velodyne packets fit into the smallest
+// frame size supported by the kernel together with the headroom reserved by XDP.
+constexpr uint32_t kFrameSize = 2048;
+// About a second of packets of a VLS-128 in dual return mode
+constexpr uint32_t kFrameCount = 8192;
+// All frames which are not waiting in the receive ring are kept in the fill ring
+constexpr uint32_t kFillRingSize = kFrameCount;
+constexpr uint32_t kRxRingSize = kFrameCount / 2;
+// Packets are never sent, but the kernel insists on a completion ring
+constexpr uint32_t kCompletionRingSize = 64;
+// Size of the receive timestamp which the XDP program stores in front of the packet
+constexpr int kMetadataSize = sizeof(uint64_t);
+// Size of Ethernet, IPv4 and UDP headers without IP options
+constexpr size_t kEthernetHeaderSize = 14;
+constexpr size_t kIpHeaderSize = 20;
+constexpr size_t kUdpHeaderSize = 8;
+
+int64_t ToNanoseconds(const timespec& time) {
+  return static_cast<int64_t>(time.tv_sec) * kNanosecondsPerSecond + time.tv_nsec;
+}
+
+int Bpf(int command, bpf_attr& attributes) {
+  return static_cast<int>(::syscall(__NR_bpf, command, &attributes, sizeof(attributes)));
+}
+
+bpf_insn Instruction(uint8_t code, uint8_t destination, uint8_t source, int16_t offset,
+                     int32_t immediate) {
+  bpf_insn instruction{};
+  instruction.code = code;
+  instruction.dst_reg = destination;
+  instruction.src_reg = source;
+  instruction.off = offset;
+  instruction.imm = immediate;
+  return instruction;
+}
+
+// Assembles the XDP program which redirects the UDP packets of the sensor into the socket bound
+// to the receive queue and passes everything else on to the network stack. Before redirecting
+// the program stores the monotonic receive time in the metadata area in front of the packet.
+std::vector<bpf_insn> AssembleProgram(int map_fd, uint32_t source_address, uint16_t port) {
+  std::vector<bpf_insn> code;
+  // Jumps to the end of the program which passes the packet on. Offsets are patched at the end.
+  std::vector<size_t> pass_jumps;
+  const auto jump_to_pass = [&](uint8_t operation, uint8_t source, int32_t immediate,
+                                uint8_t destination) {
+    pass_jumps.push_back(code.size());
+    code.push_back(Instruction(operation, destination, source, 0, immediate));
+  };
+  const auto load = [&](uint8_t size, uint8_t destination, uint8_t source, int16_t offset) {
+    code.push_back(Instruction(BPF_LDX | BPF_MEM | size, destination, source, offset, 0));
+  };
+  const auto move = [&](uint8_t destination, uint8_t source) {
+    code.push_back(Instruction(BPF_ALU64 | BPF_MOV | BPF_X, destination, source, 0, 0));
+  };
+  const auto add = [&](uint8_t destination, int32_t immediate) {
+    code.push_back(Instruction(BPF_ALU64 | BPF_ADD | BPF_K, destination, 0, 0, immediate));
+  };
+  const auto call = [&](int32_t helper) {
+    code.push_back(Instruction(BPF_JMP | BPF_CALL, 0, 0, 0, helper));
+  };
+  // Compares the 32 bit register with an immediate and passes the packet on if they differ
+  const auto expect = [&](uint8_t reg, uint32_t value) {
+    jump_to_pass(BPF_JMP32 | BPF_JNE | BPF_K, 0, static_cast<int32_t>(value), reg);
+  };
+  const int16_t udp = kEthernetHeaderSize + kIpHeaderSize;
+
+  // r6 = ctx, r2 = data, r3 = data_end
+  move(BPF_REG_6, BPF_REG_1);
+  load(BPF_W, BPF_REG_2, BPF_REG_6, offsetof(xdp_md, data));
+  load(BPF_W, BPF_REG_3, BPF_REG_6, offsetof(xdp_md, data_end));
+  // The headers need to be in bounds
+  move(BPF_REG_4, BPF_REG_2);
+  add(BPF_REG_4, udp + kUdpHeaderSize);
+  jump_to_pass(BPF_JMP | BPF_JGT | BPF_X, BPF_REG_3, 0, BPF_REG_4);
+  // IPv4 without options carrying an unfragmented UDP datagram
+  load(BPF_H, BPF_REG_4, BPF_REG_2, 12);
+  expect(BPF_REG_4, htons(ETH_P_IP));
+  load(BPF_B, BPF_REG_4, BPF_REG_2, kEthernetHeaderSize);
+  expect(BPF_REG_4, 0x45);
+  load(BPF_B, BPF_REG_4, BPF_REG_2, kEthernetHeaderSize + 9);
+  expect(BPF_REG_4, IPPROTO_UDP);
+  load(BPF_H, BPF_REG_4, BPF_REG_2, kEthernetHeaderSize + 6);
+  code.push_back(Instruction(BPF_ALU64 | BPF_AND | BPF_K, BPF_REG_4, 0, 0, htons(0x3fff)));
+  expect(BPF_REG_4, 0);
+  if (source_address != 0) {
+    load(BPF_W, BPF_REG_4, BPF_REG_2, kEthernetHeaderSize + 12);
+    expect(BPF_REG_4, source_address);
+  }
+  load(BPF_H, BPF_REG_4, BPF_REG_2, udp + 2);
+  expect(BPF_REG_4, port);
+
+  // Reserves room for the timestamp in front of the packet
+  move(BPF_REG_1, BPF_REG_6);
+  code.push_back(Instruction(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_2, 0, 0, -kMetadataSize));
+  call(BPF_FUNC_xdp_adjust_meta);
+  expect(BPF_REG_0, 0);
+  call(BPF_FUNC_ktime_get_ns);
+  load(BPF_W, BPF_REG_2, BPF_REG_6, offsetof(xdp_md, data_meta));
+  load(BPF_W, BPF_REG_3, BPF_REG_6, offsetof(xdp_md, data));
+  move(BPF_REG_4, BPF_REG_2);
+  add(BPF_REG_4, kMetadataSize);
+  jump_to_pass(BPF_JMP | BPF_JGT | BPF_X, BPF_REG_3, 0, BPF_REG_4);
+  code.push_back(Instruction(BPF_STX | BPF_MEM | BPF_DW, BPF_REG_2, BPF_REG_0, 0, 0));
+
+  // return bpf_redirect_map(&map, ctx->rx_queue_index, XDP_PASS)
+  code.push_back(Instruction(BPF_LD | BPF_DW | BPF_IMM, BPF_REG_1, BPF_PSEUDO_MAP_FD, 0, map_fd));
+  code.push_back(Instruction(0, 0, 0, 0, 0));
+  load(BPF_W, BPF_REG_2, BPF_REG_6, offsetof(xdp_md, rx_queue_index));
+  code.push_back(Instruction(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_3, 0, 0, XDP_PASS));
+  call(BPF_FUNC_redirect_map);
+  code.push_back(Instruction(BPF_JMP | BPF_EXIT, 0, 0, 0, 0));
+
+  // return XDP_PASS
+  for (size_t jump : pass_jumps) {
+    code[jump].off = static_cast<int16_t>(code.size() - jump - 1);
+  }
+  code.push_back(Instruction(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_0, 0, 0, XDP_PASS));
+  code.push_back(Instruction(BPF_JMP | BPF_EXIT, 0, 0, 0, 0));
+  return code;
+}
+
+}  // namespace
+
+XdpReceiver::~XdpReceiver() {
+  close();
+}
+
+bool XdpReceiver::open(const std::string& interface, int queue, const std::string& ip, int port,
+                       HugePages huge_pages) {
+  close();
+  source_address_ = 0;
+  if (!ip.empty()) {
+    in_addr address;
+    if (inet_pton(AF_INET, ip.c_str(), &address) != 1) {
+      errno = EINVAL;
+      return false;
+    }
+    source_address_ = address.s_addr;
+  }
+  port_ = htons(static_cast<uint16_t>(port));
+  const int ifindex = static_cast<int>(if_nametoindex(interface.c_str()));
+  if (ifindex == 0 || queue < 0) {
+    errno = ifindex == 0 ? ENODEV : EINVAL;
+    return false;
+  }
+  if (!openSocket(ifindex, queue, huge_pages) ||
+      !attachProgram(ifindex, queue, source_address_, port)) {
+    const int error = errno;
+    close();
+    errno = error;
+    return false;
+  }
+  return true;
+}
+
+bool XdpReceiver::openSocket(int ifindex, int queue, HugePages huge_pages) {
+  fd_ = ::socket(AF_XDP, SOCK_RAW, 0);
+  if (fd_ < 0) {
+    return false;
+  }
+
+  // The shared memory needs to be page aligned
+  const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  const size_t umem_size = static_cast<size_t>(kFrameCount) * kFrameSize;
+  if (!umem_.open(Arena::Footprint(umem_size, page_size), huge_pages)) {
+    return false;
+  }
+  frames_ = static_cast<byte*>(umem_.allocate(umem_size, page_size));
+  xdp_umem_reg registration{};
+  registration.addr = reinterpret_cast<uint64_t>(frames_);
+  registration.len = umem_size;
+  registration.chunk_size = kFrameSize;
+  registration.headroom = 0;
+  if (::setsockopt(fd_, SOL_XDP, XDP_UMEM_REG, &registration, sizeof(registration)) < 0 ||
+      ::setsockopt(fd_, SOL_XDP, XDP_UMEM_FILL_RING, &kFillRingSize, sizeof(kFillRingSize)) < 0 ||
+      ::setsockopt(fd_, SOL_XDP, XDP_UMEM_COMPLETION_RING, &kCompletionRingSize,
+                   sizeof(kCompletionRingSize)) < 0 ||
+      ::setsockopt(fd_, SOL_XDP, XDP_RX_RING, &kRxRingSize, sizeof(kRxRingSize)) < 0) {
+    return false;
+  }
+
+  xdp_mmap_offsets offsets{};
+  socklen_t length = sizeof(offsets);
+  if (::getsockopt(fd_, SOL_XDP, XDP_MMAP_OFFSETS, &offsets, &length) < 0 ||
+      !mapRing(fill_, offsets.fr, kFillRingSize, sizeof(uint64_t), XDP_UMEM_PGOFF_FILL_RING) ||
+      !mapRing(completion_, offsets.cr, kCompletionRingSize, sizeof(uint64_t),
+               XDP_UMEM_PGOFF_COMPLETION_RING) ||
+      !mapRing(rx_, offsets.rx, kRxRingSize, sizeof(xdp_desc), XDP_PGOFF_RX_RING)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < kFrameCount; i++) {
+    fillFrame(static_cast<uint64_t>(i) * kFrameSize);
+  }
+
+  // Network cards which support it write directly into the shared memory, the others copy
+  sockaddr_xdp address{};
+  address.sxdp_family = AF_XDP;
+  address.sxdp_ifindex = ifindex;
+  address.sxdp_queue_id = queue;
+  address.sxdp_flags = XDP_ZEROCOPY | XDP_USE_NEED_WAKEUP;
+  zero_copy_ = true;
+  if (::bind(fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+    address.sxdp_flags = XDP_COPY | XDP_USE_NEED_WAKEUP;
+    zero_copy_ = false;
+    if (::bind(fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+      return false;
+    }
+  }
+  wakeUpFillRing();
+  kernel_drops_ = 0;
+  return true;
+}
+
+bool XdpReceiver::mapRing(Ring& ring, const xdp_ring_offset& offsets, uint32_t size,
+                          size_t entry_size, off_t pgoff) {
+  ring.map_size = offsets.desc + size * entry_size;
+  void* map = ::mmap(nullptr, ring.map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     fd_, pgoff);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+  byte* base = static_cast<byte*>(map);
+  ring.map = map;
+  ring.producer = reinterpret_cast<uint32_t*>(base + offsets.producer);
+  ring.consumer = reinterpret_cast<uint32_t*>(base + offsets.consumer);
+  ring.flags = reinterpret_cast<uint32_t*>(base + offsets.flags);
+  ring.descriptors = base + offsets.desc;
+  ring.size = size;
+  return true;
+}
+
+bool XdpReceiver::attachProgram(int ifindex, int queue, uint32_t source_address, int port) {
+  bpf_attr attributes{};
+  attributes.map_type = BPF_MAP_TYPE_XSKMAP;
+  attributes.key_size = sizeof(uint32_t);
+  attributes.value_size = sizeof(uint32_t);
+  attributes.max_entries = queue + 1;
+  map_fd_ = Bpf(BPF_MAP_CREATE, attributes);
+  if (map_fd_ < 0) {
+    return false;
+  }
+  const uint32_t key = queue;
+  const uint32_t value = fd_;
+  attributes = {};
+  attributes.map_fd = map_fd_;
+  attributes.key = reinterpret_cast<uint64_t>(&key);
+  attributes.value = reinterpret_cast<uint64_t>(&value);
+  if (Bpf(BPF_MAP_UPDATE_ELEM, attributes) < 0) {
+    return false;
+  }
+
+  const std::vector<bpf_insn> code =
+      AssembleProgram(map_fd_, source_address, htons(static_cast<uint16_t>(port)));
+  static const char kLicense[] = "Dual BSD/GPL";
+  attributes = {};
+  attributes.prog_type = BPF_PROG_TYPE_XDP;
+  attributes.insns = reinterpret_cast<uint64_t>(code.data());
+  attributes.insn_cnt = code.size();
+  attributes.license = reinterpret_cast<uint64_t>(kLicense);
+  attributes.expected_attach_type = BPF_XDP;
+  program_fd_ = Bpf(BPF_PROG_LOAD, attributes);
+  if (program_fd_ < 0) {
+    return false;
+  }
+
+  // The program is detached when the link is closed, even if the process crashes. Drivers which
+  // do not support XDP run it on the slower generic path.
+  for (uint32_t flags : {XDP_FLAGS_DRV_MODE, XDP_FLAGS_SKB_MODE}) {
+    attributes = {};
+    attributes.link_create.prog_fd = program_fd_;
+    attributes.link_create.target_ifindex = ifindex;
+    attributes.link_create.attach_type = BPF_XDP;
+    attributes.link_create.flags = flags;
+    link_fd_ = Bpf(BPF_LINK_CREATE, attributes);
+    if (link_fd_ >= 0) {
+      native_mode_ = flags == XDP_FLAGS_DRV_MODE;
+      return true;
+    }
+  }
+  return false;
+}
+
+void XdpReceiver::close() {
+  if (link_fd_ >= 0) {
+    ::close(link_fd_);
+    link_fd_ = -1;
+  }
+  if (program_fd_ >= 0) {
+    ::close(program_fd_);
+    program_fd_ = -1;
+  }
+  if (map_fd_ >= 0) {
+    ::close(map_fd_);
+    map_fd_ = -1;
+  }
+  for (Ring* ring : {&fill_, &completion_, &rx_}) {
+    if (ring->map != nullptr) {
+      ::munmap(ring->map, ring->map_size);
+    }
+    *ring = Ring();
+  }
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+  umem_.close();
+  frames_ = nullptr;
+  held_frame_ = -1;
+  zero_copy_ = false;
+  native_mode_ = false;
+}
+
+void XdpReceiver::fillFrame(uint64_t address) {
+  // The fill ring has room for all frames, thus it never overflows
+  const uint32_t producer = *fill_.producer;
+  static_cast<uint64_t*>(fill_.descriptors)[producer & (fill_.size - 1)] = address;
+  __atomic_store_n(fill_.producer, producer + 1, __ATOMIC_RELEASE);
+}
+
+void XdpReceiver::wakeUpFillRing() {
+  // With XDP_USE_NEED_WAKEUP the driver stops polling the fill ring once it ran empty and only
+  // picks up new frames after a system call on the socket
+  if (__atomic_load_n(fill_.flags, __ATOMIC_ACQUIRE) & XDP_RING_NEED_WAKEUP) {
+    ::recvfrom(fd_, nullptr, 0, MSG_DONTWAIT, nullptr, nullptr);
+  }
+}
+
+void XdpReceiver::updateKernelDrops() {
+  xdp_statistics statistics{};
+  socklen_t length = sizeof(statistics);
+  if (::getsockopt(fd_, SOL_XDP, XDP_STATISTICS, &statistics, &length) == 0) {
+    kernel_drops_ = static_cast<uint32_t>(statistics.rx_dropped + statistics.rx_ring_full);
+  }
+}
+
+bool XdpReceiver::parseFrame(const byte* frame, size_t length, const byte*& payload,
+                             size_t& size) const {
+  if (length < kEthernetHeaderSize + kIpHeaderSize + kUdpHeaderSize) {
+    return false;
+  }
+  const byte* ip = frame + kEthernetHeaderSize;
+  const byte* udp = ip + kIpHeaderSize;
+  uint32_t source_address;
+  uint16_t port, udp_length;
+  std::memcpy(&source_address, ip + 12, sizeof(source_address));
+  std::memcpy(&port, udp + 2, sizeof(port));
+  std::memcpy(&udp_length, udp + 4, sizeof(udp_length));
+  udp_length = ntohs(udp_length);
+  if (port != port_ || (source_address_ != 0 && source_address != source_address_) ||
+      udp_length < kUdpHeaderSize || udp + udp_length > frame + length) {
+    return false;
+  }
+  payload = udp + kUdpHeaderSize;
+  size = udp_length - kUdpHeaderSize;
+  return true;
+}
+
+XdpReceiver::Status XdpReceiver::receive(const byte*& payload, size_t& size, int64_t timeout_ns,
+                                         int64_t& timestamp_ns) {
+  if (fd_ < 0) {
+    errno = EBADF;
+    return Status::kError;
+  }
+  // The caller is done with the previous packet
+  if (held_frame_ >= 0) {
+    fillFrame(static_cast<uint64_t>(held_frame_));
+    wakeUpFillRing();
+    held_frame_ = -1;
+  }
+
+  const int64_t deadline = timeout_ns < 0 ? -1 : PacketReceiver::NowNs() + timeout_ns;
+  while (true) {
+    const uint32_t consumer = *rx_.consumer;
+    if (__atomic_load_n(rx_.producer, __ATOMIC_ACQUIRE) == consumer) {
+      updateKernelDrops();
+      // Polling also wakes up the kernel if it needs a system call to process the rings
+      pollfd descriptor{fd_, POLLIN, 0};
+      timespec timeout;
+      timespec* timeout_ptr = nullptr;
+      if (deadline >= 0) {
+        const int64_t now = PacketReceiver::NowNs();
+        const int64_t remaining = deadline > now ? deadline - now : 0;
+        timeout.tv_sec = remaining / kNanosecondsPerSecond;
+        timeout.tv_nsec = remaining % kNanosecondsPerSecond;
+        timeout_ptr = &timeout;
+      }
+      const int ready = ::ppoll(&descriptor, 1, timeout_ptr, nullptr);
+      if (ready < 0) {
+        if (errno == EINTR) continue;
+        return Status::kError;
+      }
+      if (ready == 0) {
+        return Status::kTimeout;
+      }
+      continue;
+    }
+
+    const xdp_desc descriptor =
+        static_cast<const xdp_desc*>(rx_.descriptors)[consumer & (rx_.size - 1)];
+    __atomic_store_n(rx_.consumer, consumer + 1, __ATOMIC_RELEASE);
+    const byte* frame = frames_ + descriptor.addr;
+    if (!parseFrame(frame, descriptor.len, payload, size)) {
+      fillFrame(descriptor.addr & ~static_cast<uint64_t>(kFrameSize - 1));
+      wakeUpFillRing();
+      continue;
+    }
+    held_frame_ = static_cast<int64_t>(descriptor.addr & ~static_cast<uint64_t>(kFrameSize - 1));
+
+    // The program stamped the packet on the monotonic clock
+    uint64_t monotonic;
+    std::memcpy(&monotonic, frame - kMetadataSize, sizeof(monotonic));
+    timespec realtime_now, monotonic_now;
+    clock_gettime(CLOCK_REALTIME, &realtime_now);
+    clock_gettime(CLOCK_MONOTONIC, &monotonic_now);
+    timestamp_ns = static_cast<int64_t>(monotonic) + ToNanoseconds(realtime_now) -
+                   ToNanoseconds(monotonic_now);
+    return Status::kSuccess;
+  }
+}
+
+#else
+
+XdpReceiver::~XdpReceiver() {}
+
+bool XdpReceiver::open(const std::string&, int, const std::string&, int, HugePages) {
+  errno = ENOTSUP;
+  return false;
+}
+
+void XdpReceiver::close() {}
+
+XdpReceiver::Status XdpReceiver::receive(const byte*&, size_t&, int64_t, int64_t&) {
+  errno = EBADF;
+  return Status::kError;
+}
+
+#endif
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
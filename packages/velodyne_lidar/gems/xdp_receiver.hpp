@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "engine/core/byte.hpp"
+#include "packages/velodyne_lidar/gems/arena.hpp"
+#include "packages/velodyne_lidar/gems/packet_receiver.hpp"
+
+struct xdp_ring_offset;
+
+namespace isaac {
+namespace velodyne_lidar {
+
+// Receives Velodyne UDP packets with an AF_XDP socket which bypasses the network stack of the
+// kernel. A small XDP program attached to the network interface steers the UDP flow of the sensor
+// into a memory region shared with user space, all other traffic takes the regular path. Packets
+// are handed out as pointers into that region so that they can be decoded without a copy.
+//
+// The backend is only compiled in with `bazel build --define velodyne_af_xdp=true` and needs
+// CAP_NET_ADMIN and CAP_BPF (or CAP_SYS_ADMIN). Callers are expected to fall back to
+// `PacketReceiver` if `open` fails.
+class XdpReceiver {
+ public:
+  using Status = PacketReceiver::Status;
+
+  // True if the backend was compiled in
+#ifdef VELODYNE_LIDAR_AF_XDP
+  static constexpr bool kAvailable = true;
+#else
+  static constexpr bool kAvailable = false;
+#endif
+
+  XdpReceiver() = default;
+  ~XdpReceiver();
+
+  XdpReceiver(const XdpReceiver&) = delete;
+  XdpReceiver& operator=(const XdpReceiver&) = delete;
+
+  // Receives the UDP packets sent to `port` which arrive on the given receive queue of the network
+  // interface. If `ip` is not empty only packets sent from that address are accepted. The shared
+  // memory is allocated with the given type of pages. Returns false on failure in which case errno
+  // is set, for example to ENOTSUP if the backend was not compiled in.
+  bool open(const std::string& interface, int queue, const std::string& ip, int port,
+            HugePages huge_pages = HugePages::kNone);
+  // Detaches the XDP program and closes the socket. It is safe to call this function multiple
+  // times.
+  void close();
+
+  // Waits for the next packet for at most `timeout_ns` nanoseconds like `PacketReceiver::receive`.
+  // On success `payload` points to the UDP payload of `size` bytes which stays valid until the
+  // next call to `receive` or `close`. The timestamp is taken by the XDP program when the packet
+  // arrived and is reported in nanoseconds on the time base of `PacketReceiver::NowNs`.
+  Status receive(const byte*& payload, size_t& size, int64_t timeout_ns, int64_t& timestamp_ns);
+
+  // Number of packets which the kernel dropped because the rings were full. Updated whenever no
+  // packet is waiting.
+  uint32_t kernelDrops() const { return kernel_drops_; }
+  // True if the network card writes packets directly into the shared memory
+  bool zeroCopy() const { return zero_copy_; }
+  // True if the XDP program runs in the driver of the network card instead of the generic path
+  bool nativeMode() const { return native_mode_; }
+
+ private:
+  // A ring shared with the kernel
+  struct Ring {
+    void* map = nullptr;
+    size_t map_size = 0;
+    uint32_t* producer = nullptr;
+    uint32_t* consumer = nullptr;
+    uint32_t* flags = nullptr;
+    void* descriptors = nullptr;
+    uint32_t size = 0;
+  };
+
+  // Creates the socket, registers the shared memory and maps the rings
+  bool openSocket(int ifindex, int queue, HugePages huge_pages);
+  // Loads the XDP program and attaches it to the interface
+  bool attachProgram(int ifindex, int queue, uint32_t source_address, int port);
+  // Maps a ring of `size` entries of `entry_size` bytes at the given offset of the socket
+  bool mapRing(Ring& ring, const xdp_ring_offset& offsets, uint32_t size, size_t entry_size,
+               off_t pgoff);
+  // Hands a frame to the kernel to receive packets into
+  void fillFrame(uint64_t address);
+  // Wakes up the kernel if it waits for frames in the fill ring
+  void wakeUpFillRing();
+  // Reads the drop counters of the socket
+  void updateKernelDrops();
+  // Extracts the UDP payload of a received frame. Returns false for frames of other flows.
+  bool parseFrame(const byte* frame, size_t length, const byte*& payload, size_t& size) const;
+
+  int fd_ = -1;
+  int map_fd_ = -1;
+  int program_fd_ = -1;
+  int link_fd_ = -1;
+  Arena umem_;
+  byte* frames_ = nullptr;
+  Ring fill_;
+  Ring completion_;
+  Ring rx_;
+  // Address of the frame handed out by the last call to `receive`, or -1
+  int64_t held_frame_ = -1;
+  // Expected source address and port in network byte order
+  uint32_t source_address_ = 0;
+  uint16_t port_ = 0;
+  uint32_t kernel_drops_ = 0;
+  bool zero_copy_ = false;
+  bool native_mode_ = false;
+};
+
+}  // namespace velodyne_lidar
+}  // namespace isaac
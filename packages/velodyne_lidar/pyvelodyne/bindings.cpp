@@ -0,0 +1,322 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "packages/velodyne_lidar/gems/decoder.hpp"
+#include "packages/velodyne_lidar/gems/pcap_reader.hpp"
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+#include "pybind11/numpy.h"
+#include "pybind11/pybind11.h"
+#include "pybind11/stl.h"
+
+namespace py = pybind11;
+
+namespace isaac {
+namespace velodyne_lidar {
+
+namespace {
+
+// Parses the name of a sensor model as used in the configuration of the driver
+VelodyneModelType ParseModel(const std::string& name) {
+  if (name == "VLP16") return VelodyneModelType::VLP16;
+  if (name == "VLP32C") return VelodyneModelType::VLP32C;
+  if (name == "VLS128") return VelodyneModelType::VLS128;
+  throw py::value_error("Unknown Velodyne model: " + name);
+}
+
+// Hands a vector over to a numpy array without copying. The array owns the memory afterwards.
+template <typename T>
+py::array_t<T> ToNumpy(std::vector<T>&& data, std::vector<py::ssize_t> shape) {
+  auto* owner = new std::vector<T>(std::move(data));
+  py::capsule capsule(owner, [](void* pointer) { delete static_cast<std::vector<T>*>(pointer); });
+  return py::array_t<T>(std::move(shape), owner->data(), capsule);
+}
+
+// Memory for decoded columns which is handed over to numpy once a batch is complete
+struct BatchStorage {
+  std::vector<uint16_t> ranges;
+  std::vector<uint8_t> intensities;
+  std::vector<double> thetas;
+  size_t size = 0;
+  uint64_t first_column = 0;
+  int64_t first_timestamp = -1;
+  int64_t last_timestamp = -1;
+  bool end_of_revolution = false;
+};
+
+// Streaming decoder which returns decoded batches as numpy arrays. Columns are decoded directly
+// into memory which is afterwards owned by the returned arrays.
+class PyDecoder {
+ public:
+  PyDecoder(const std::string& model, size_t batch_size, bool split_at_revolution,
+            size_t capacity)
+      : parameters_(GetVelodyneParameters(ParseModel(model))), capacity_(capacity) {
+    DecoderOptions options;
+    options.batch_size = batch_size;
+    options.split_at_revolution = split_at_revolution;
+    if (capacity_ == 0) {
+      throw py::value_error("capacity needs to be positive");
+    }
+    decoder_ = std::make_unique<Decoder>(parameters_, options);
+    decoder_->setCallback([this](const ColumnBatch& batch) { onBatch(batch); });
+    allocate();
+  }
+
+  // Feeds packets given as an array with one packet per row. Returns the completed batches.
+  py::list feed(py::array_t<uint8_t, py::array::c_style | py::array::forcecast> packets,
+                py::array_t<int64_t, py::array::c_style | py::array::forcecast> timestamps) {
+    const size_t packet_size = parameters_.packet_sans_header_size;
+    if (packets.ndim() != 2 || static_cast<size_t>(packets.shape(1)) != packet_size) {
+      throw py::value_error("packets needs to have shape (N, " + std::to_string(packet_size) +
+                            ")");
+    }
+    const size_t count = packets.shape(0);
+    if (timestamps.ndim() != 1 || static_cast<size_t>(timestamps.shape(0)) != count) {
+      throw py::value_error("timestamps needs one entry per packet");
+    }
+    const uint8_t* data = packets.data();
+    const int64_t* stamps = timestamps.data();
+    {
+      py::gil_scoped_release release;
+      for (size_t i = 0; i < count; i++) {
+        decoder_->feed(data + i * packet_size, packet_size, stamps[i]);
+      }
+    }
+    return takeBatches();
+  }
+
+  // Decodes the held back packet and returns all remaining columns
+  py::list finish() {
+    decoder_->finish();
+    return takeBatches();
+  }
+
+  void reset() {
+    decoder_->reset();
+    finished_.clear();
+    allocate();
+  }
+
+  py::dict statistics() const {
+    const DecoderStatistics& statistics = decoder_->statistics();
+    py::dict result;
+    result["packets"] = statistics.packets;
+    result["rejected_packets"] = statistics.rejected_packets;
+    result["invalid_blocks"] = statistics.invalid_blocks;
+    result["columns"] = statistics.columns;
+    result["dropped_columns"] = statistics.dropped_columns;
+    result["revolutions"] = statistics.revolutions;
+    result["lost_packets"] = statistics.lost_packets;
+    return result;
+  }
+
+ private:
+  // Prepares new memory for the next batch
+  void allocate() {
+    current_ = BatchStorage();
+    current_.ranges.resize(capacity_ * parameters_.vertical_beams);
+    current_.intensities.resize(capacity_ * parameters_.vertical_beams);
+    current_.thetas.resize(capacity_);
+    decoder_->setOutput({current_.ranges.data(), current_.intensities.data(),
+                         current_.thetas.data(), capacity_});
+  }
+
+  // Called by the decoder without holding the GIL
+  void onBatch(const ColumnBatch& batch) {
+    current_.size = batch.size;
+    current_.first_column = batch.first_column;
+    current_.first_timestamp = batch.first_timestamp;
+    current_.last_timestamp = batch.last_timestamp;
+    current_.end_of_revolution = batch.end_of_revolution;
+    finished_.push_back(std::move(current_));
+    allocate();
+  }
+
+  // Converts all finished batches to dictionaries of numpy arrays
+  py::list takeBatches() {
+    py::list result;
+    const py::ssize_t beams = parameters_.vertical_beams;
+    for (BatchStorage& storage : finished_) {
+      const py::ssize_t size = storage.size;
+      // Shrinking does not reallocate thus the memory written by the decoder is kept.
+      storage.ranges.resize(size * beams);
+      storage.intensities.resize(size * beams);
+      storage.thetas.resize(size);
+      py::dict batch;
+      batch["ranges"] = ToNumpy(std::move(storage.ranges), {size, beams});
+      batch["intensities"] = ToNumpy(std::move(storage.intensities), {size, beams});
+      batch["thetas"] = ToNumpy(std::move(storage.thetas), {size});
+      batch["first_column"] = storage.first_column;
+      batch["first_timestamp"] = storage.first_timestamp;
+      batch["last_timestamp"] = storage.last_timestamp;
+      batch["end_of_revolution"] = storage.end_of_revolution;
+      result.append(std::move(batch));
+    }
+    finished_.clear();
+    return result;
+  }
+
+  VelodyneLidarParameters parameters_;
+  size_t capacity_;
+  std::unique_ptr<Decoder> decoder_;
+  BatchStorage current_;
+  std::vector<BatchStorage> finished_;
+};
+
+// Reads all UDP payloads with the given size and port from a capture file
+py::tuple ReadPcap(const std::string& filename, uint16_t port, size_t packet_size) {
+  std::vector<uint8_t> payloads;
+  std::vector<int64_t> timestamps;
+  {
+    py::gil_scoped_release release;
+    PcapReader reader;
+    if (!reader.open(filename)) {
+      py::gil_scoped_acquire acquire;
+      throw py::value_error("Could not read capture file: " + filename);
+    }
+    UdpPacket packet;
+    while (reader.next(packet, port)) {
+      if (packet.size != packet_size) continue;
+      payloads.insert(payloads.end(), packet.payload, packet.payload + packet.size);
+      timestamps.push_back(packet.timestamp);
+    }
+  }
+  const py::ssize_t count = timestamps.size();
+  const py::ssize_t size = packet_size;
+  return py::make_tuple(ToNumpy(std::move(payloads), {count, size}),
+                        ToNumpy(std::move(timestamps), {count}));
+}
+
+// Decodes all data packets of a capture file into one set of arrays
+py::dict DecodePcap(const std::string& filename, const std::string& model, uint16_t port) {
+  const VelodyneLidarParameters parameters = GetVelodyneParameters(ParseModel(model));
+  const size_t packet_size = parameters.packet_sans_header_size;
+  const size_t beams = parameters.vertical_beams;
+  std::vector<uint16_t> ranges;
+  std::vector<uint8_t> intensities;
+  std::vector<double> thetas;
+  std::vector<int64_t> timestamps;
+  size_t size = 0;
+  {
+    py::gil_scoped_release release;
+    PcapReader reader;
+    if (!reader.open(filename)) {
+      py::gil_scoped_acquire acquire;
+      throw py::value_error("Could not read capture file: " + filename);
+    }
+    // Count the packets first so that all columns can be decoded into a single allocation
+    size_t count = 0;
+    UdpPacket packet;
+    while (reader.next(packet, port)) {
+      if (packet.size == packet_size) count++;
+    }
+    const size_t capacity = count * ColumnsPerPacket(parameters);
+    ranges.resize(capacity * beams);
+    intensities.resize(capacity * beams);
+    thetas.resize(capacity);
+    timestamps.resize(capacity);
+
+    // Every batch holds the columns of a single packet and the output moves on after each batch
+    // so that the whole capture ends up in one set of arrays.
+    const size_t columns_per_packet = ColumnsPerPacket(parameters);
+    DecoderOptions options;
+    options.batch_size = columns_per_packet;
+    Decoder decoder(parameters, options);
+    decoder.setOutput({ranges.data(), intensities.data(), thetas.data(), capacity});
+    decoder.setCallback([&](const ColumnBatch& batch) {
+      std::fill(timestamps.begin() + size, timestamps.begin() + size + batch.size,
+                batch.first_timestamp);
+      size += batch.size;
+      decoder.setOutput({ranges.data() + size * beams, intensities.data() + size * beams,
+                         thetas.data() + size, capacity - size});
+    });
+    reader.rewind();
+    while (reader.next(packet, port)) {
+      if (packet.size != packet_size) continue;
+      decoder.feed(packet.payload, packet.size, packet.timestamp);
+    }
+    decoder.finish();
+  }
+  ranges.resize(size * beams);
+  intensities.resize(size * beams);
+  thetas.resize(size);
+  timestamps.resize(size);
+  const py::ssize_t columns = size;
+  const py::ssize_t rows = beams;
+  py::dict result;
+  result["ranges"] = ToNumpy(std::move(ranges), {columns, rows});
+  result["intensities"] = ToNumpy(std::move(intensities), {columns, rows});
+  result["thetas"] = ToNumpy(std::move(thetas), {columns});
+  result["timestamps"] = ToNumpy(std::move(timestamps), {columns});
+  return result;
+}
+
+// Vertical angles of the beams of the given model in radians. Empty if the angles are specific to
+// every unit.
+py::array_t<double> VerticalAngles(const std::string& model) {
+  std::vector<double> angles = GetVelodyneParameters(ParseModel(model)).vertical_angles;
+  const py::ssize_t size = angles.size();
+  return ToNumpy(std::move(angles), {size});
+}
+
+}  // namespace
+}  // namespace velodyne_lidar
+}  // namespace isaac
+
+PYBIND11_MODULE(velodyne_pybind, m) {
+  using namespace isaac::velodyne_lidar;
+
+  m.doc() = "Decoding of Velodyne data packets into numpy arrays";
+
+  py::class_<PyDecoder>(m, "Decoder")
+      .def(py::init<const std::string&, size_t, bool, size_t>(), py::arg("model") = "VLP16",
+           py::arg("batch_size") = 0, py::arg("split_at_revolution") = true,
+           py::arg("capacity") = 8192)
+      .def("feed", &PyDecoder::feed, py::arg("packets"), py::arg("timestamps"),
+           "Feeds packets of shape (N, packet size) and returns the completed batches")
+      .def("finish", &PyDecoder::finish, "Decodes the held back packet and returns all columns")
+      .def("reset", &PyDecoder::reset)
+      .def("statistics", &PyDecoder::statistics);
+
+  m.def("read_pcap", &ReadPcap, py::arg("filename"), py::arg("port") = 2368,
+        py::arg("packet_size") = 1206,
+        "Reads UDP payloads from a capture file into arrays of packets and timestamps");
+  m.def("decode_pcap", &DecodePcap, py::arg("filename"), py::arg("model") = "VLP16",
+        py::arg("port") = 2368, "Decodes all data packets of a capture file");
+  m.def("vertical_angles", &VerticalAngles, py::arg("model") = "VLP16");
+  m.def(
+      "distance_resolution",
+      [](const std::string& model) {
+        return GetVelodyneParameters(ParseModel(model)).distance_resolution;
+      },
+      py::arg("model") = "VLP16", "Size of one distance unit in meters");
+}
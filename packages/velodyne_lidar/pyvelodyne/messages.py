@@ -0,0 +1,87 @@
+"""
+Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+ * Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+ * Neither the name of NVIDIA CORPORATION nor the names of its
+   contributors may be used to endorse or promote products derived
+   from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+"""
+
+import numpy as np
+
+# Numpy types for the element types of TensorProto
+_ELEMENT_TYPES = {
+    'uint8': np.uint8,
+    'uint16': np.uint16,
+    'uint32': np.uint32,
+    'uint64': np.uint64,
+    'int8': np.int8,
+    'int16': np.int16,
+    'int32': np.int32,
+    'int64': np.int64,
+    'float16': np.float16,
+    'float32': np.float32,
+    'float64': np.float64,
+}
+
+
+def tensor_to_numpy(tensor, buffers):
+    '''Returns a read-only numpy view on the buffer which holds the data of a TensorProto'''
+    dtype = _ELEMENT_TYPES.get(str(tensor.elementType))
+    if dtype is None:
+        raise ValueError('Unsupported tensor element type: {}'.format(tensor.elementType))
+    shape = tuple(tensor.sizes)
+    count = int(np.prod(shape)) if shape else 0
+    return np.frombuffer(buffers[tensor.dataBufferIndex], dtype=dtype, count=count).reshape(shape)
+
+
+def range_scan_to_numpy(message):
+    '''Converts a received RangeScanProto message into numpy arrays.
+
+    Ranges and intensities are views on the message buffers and are not copied. They have one
+    row per horizontal slice and one column per vertical beam. Angles are stored as capnp lists
+    in the message and are thus copied, which is cheap as there is one value per row or column.
+    '''
+    proto = message.proto
+    return {
+        'ranges': tensor_to_numpy(proto.ranges, message.buffers),
+        'intensities': tensor_to_numpy(proto.intensities, message.buffers),
+        'thetas': np.array(proto.theta, dtype=np.float32),
+        'phis': np.array(proto.phi, dtype=np.float32),
+        'range_denormalizer': proto.rangeDenormalizer,
+        'intensity_denormalizer': proto.intensityDenormalizer,
+        'acqtime': message.acqtime,
+    }
+
+
+def ranges_in_meters(scan):
+    '''Converts the raw ranges of a scan returned by range_scan_to_numpy into meters'''
+    return scan['ranges'] * np.float32(scan['range_denormalizer'] / 65535.0)
+
+
+def raw_packet_batch_to_numpy(message):
+    '''Returns the packets of a VelodyneRawPacketBatchProto message as an array with one packet
+    per row together with their receive timestamps. The packets are a view on the message.'''
+    proto = message.proto
+    timestamps = np.array(proto.timestamps, dtype=np.int64)
+    payloads = np.frombuffer(proto.payloads, dtype=np.uint8)
+    return payloads.reshape(len(timestamps), proto.packetSize), timestamps
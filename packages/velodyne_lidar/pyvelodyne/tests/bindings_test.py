@@ -0,0 +1,148 @@
+"""
+Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+ * Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+ * Neither the name of NVIDIA CORPORATION nor the names of its
+   contributors may be used to endorse or promote products derived
+   from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+"""
+
+import json
+import types
+import unittest
+
+import numpy as np
+
+from packages.velodyne_lidar.pyvelodyne import Decoder, decode_pcap, raw_packet_batch_to_numpy, \
+    read_pcap, tensor_to_numpy
+
+# The packet corpus and the reference output of the C++ decoder relative to the runfiles
+DATA_DIRECTORY = 'packages/velodyne_lidar/gems/tests/data/'
+CAPTURE = DATA_DIRECTORY + 'vlp16.pcap'
+GOLDEN = DATA_DIRECTORY + 'decoder_golden.json'
+# Angles are stored in microradians in the reference and need to match within one microradian
+MICRORADIANS = 1e6
+THETA_TOLERANCE = 1
+
+
+def fnv1a(data):
+    '''The 64 bit FNV-1a hash of the given bytes as used by the reference'''
+    value = 0xCBF29CE484222325
+    for byte in data:
+        value = ((value ^ byte) * 0x100000001B3) & 0xFFFFFFFFFFFFFFFF
+    return '{:016x}'.format(value)
+
+
+def fill_missing_columns(batch, columns):
+    '''Pads a batch to the given number of columns in the same way as FillMissingColumns'''
+    valid = len(batch['thetas'])
+    beams = batch['ranges'].shape[1]
+    ranges = np.zeros((columns, beams), dtype=np.uint16)
+    intensities = np.zeros((columns, beams), dtype=np.uint8)
+    thetas = np.zeros(columns, dtype=np.float64)
+    ranges[:valid] = batch['ranges']
+    intensities[:valid] = batch['intensities']
+    thetas[:valid] = batch['thetas']
+    for i in range(valid, columns):
+        thetas[i] = 2.0 * thetas[i - 1] - thetas[i - 2] if i >= 2 else 0.0
+    return ranges, intensities, thetas
+
+
+class BindingsTest(unittest.TestCase):
+    @classmethod
+    def setUpClass(cls):
+        with open(GOLDEN) as file:
+            cls.golden = json.load(file)['vlp16']
+        # The reference splits the capture into scans of 5 packets like the driver
+        cls.columns = len(cls.golden['scans'][0]['thetas'])
+        cls.packets, cls.timestamps = read_pcap(CAPTURE)
+        decoder = Decoder('VLP16', batch_size=cls.columns, split_at_revolution=False,
+                          capacity=cls.columns)
+        cls.batches = decoder.feed(cls.packets, cls.timestamps) + decoder.finish()
+        cls.statistics = decoder.statistics()
+
+    def test_decoder_matches_reference(self):
+        scans = self.golden['scans']
+        self.assertEqual(len(self.batches), len(scans))
+        for index, (batch, scan) in enumerate(zip(self.batches, scans)):
+            self.assertEqual(len(batch['thetas']), scan['valid_columns'], 'scan %d' % index)
+            self.assertEqual(batch['ranges'].shape, (scan['valid_columns'], 16))
+            self.assertEqual(batch['intensities'].shape, (scan['valid_columns'], 16))
+            ranges, intensities, thetas = fill_missing_columns(batch, self.columns)
+            self.assertEqual(fnv1a(ranges.astype('<u2').tobytes()), scan['ranges'],
+                             'ranges of scan %d' % index)
+            self.assertEqual(fnv1a(intensities.tobytes()), scan['intensities'],
+                             'intensities of scan %d' % index)
+            difference = np.abs(np.rint(thetas * MICRORADIANS) - np.array(scan['thetas']))
+            self.assertLessEqual(difference.max(), THETA_TOLERANCE, 'angles of scan %d' % index)
+        for key, value in self.golden['statistics'].items():
+            self.assertEqual(self.statistics[key], value, key)
+
+    def test_decode_pcap_matches_decoder(self):
+        decoded = decode_pcap(CAPTURE, 'VLP16')
+        columns = self.golden['statistics']['columns']
+        self.assertEqual(decoded['ranges'].shape, (columns, 16))
+        self.assertEqual(decoded['intensities'].shape, (columns, 16))
+        self.assertEqual(decoded['thetas'].shape, (columns, ))
+        self.assertEqual(decoded['timestamps'].shape, (columns, ))
+        np.testing.assert_array_equal(
+            decoded['ranges'], np.concatenate([batch['ranges'] for batch in self.batches]))
+        np.testing.assert_array_equal(
+            decoded['intensities'],
+            np.concatenate([batch['intensities'] for batch in self.batches]))
+        np.testing.assert_array_equal(
+            decoded['thetas'], np.concatenate([batch['thetas'] for batch in self.batches]))
+        self.assertTrue(np.all(np.diff(decoded['timestamps']) >= 0))
+
+    def test_decoded_arrays_are_not_copied(self):
+        # The arrays wrap the memory the decoder wrote into and are kept alive by a capsule
+        decoded = decode_pcap(CAPTURE, 'VLP16')
+        for array in list(decoded.values()) + [self.packets, self.timestamps]:
+            self.assertFalse(array.flags.owndata)
+        for batch in self.batches:
+            for key in ('ranges', 'intensities', 'thetas'):
+                self.assertFalse(batch[key].flags.owndata)
+
+    def test_messages_are_not_copied(self):
+        # Changing the message buffer needs to be visible through the arrays
+        data = bytearray(np.arange(6, dtype=np.uint16).tobytes())
+        tensor = types.SimpleNamespace(elementType='uint16', sizes=[2, 3], dataBufferIndex=0)
+        array = tensor_to_numpy(tensor, [data])
+        self.assertEqual(array.shape, (2, 3))
+        self.assertFalse(array.flags.owndata)
+        data[0] = 42
+        self.assertEqual(array[0, 0], 42)
+
+        payloads = bytearray(self.packets[:2].tobytes())
+        proto = types.SimpleNamespace(
+            timestamps=list(self.timestamps[:2]), payloads=payloads,
+            packetSize=self.packets.shape[1])
+        packets, timestamps = raw_packet_batch_to_numpy(types.SimpleNamespace(proto=proto))
+        np.testing.assert_array_equal(packets, self.packets[:2])
+        np.testing.assert_array_equal(timestamps, self.timestamps[:2])
+        self.assertFalse(packets.flags.owndata)
+        payloads[0] ^= 0xFF
+        self.assertEqual(packets[0, 0], self.packets[0, 0] ^ 0xFF)
+
+
+if __name__ == '__main__':
+    unittest.main()
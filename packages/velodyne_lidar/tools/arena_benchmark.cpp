@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "packages/velodyne_lidar/gems/arena.hpp"
+#include "packages/velodyne_lidar/gems/decoder.hpp"
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+
+DEFINE_int32(sensors, 4, "Number of simulated sensors which are decoded in turns");
+DEFINE_double(ring_seconds, 30.0, "Duration of the packet ring of every sensor in seconds");
+DEFINE_int32(iterations, 3, "Number of times all rings are decoded");
+
+namespace isaac {
+namespace velodyne_lidar {
+namespace {
+
+// Packets per second of a VLP16 in single return mode
+constexpr double kPacketRate = 754.0;
+
+// Counts data TLB misses of the calling thread if the kernel permits it
+class TlbMissCounter {
+ public:
+  TlbMissCounter() {
+    perf_event_attr attributes;
+    std::memset(&attributes, 0, sizeof(attributes));
+    attributes.size = sizeof(attributes);
+    attributes.type = PERF_TYPE_HW_CACHE;
+    attributes.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attributes.disabled = 1;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    fd_ = static_cast<int>(::syscall(__NR_perf_event_open, &attributes, 0, -1, -1, 0));
+  }
+  ~TlbMissCounter() {
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+  }
+
+  bool available() const { return fd_ >= 0; }
+  void start() {
+    if (fd_ >= 0) {
+      ::ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+      ::ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+  uint64_t stop() {
+    uint64_t count = 0;
+    if (fd_ >= 0) {
+      ::ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+      if (::read(fd_, &count, sizeof(count)) != sizeof(count)) {
+        count = 0;
+      }
+    }
+    return count;
+  }
+
+ private:
+  int fd_;
+};
+
+// The buffers of a simulated sensor, all carved from one arena
+struct Sensor {
+  Arena arena;
+  uint8_t* packets;
+  size_t count;
+  ColumnBuffers buffers;
+  std::unique_ptr<Decoder> decoder;
+};
+
+// Fills the packets with random ranges for a sensor spinning at 600 rpm
+void FillPackets(const VelodyneLidarParameters& parameters, uint8_t* packets, size_t count,
+                 uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> distance(0, 60000);
+  std::uniform_int_distribution<int> reflectivity(0, 255);
+  uint32_t azimuth = 0;
+  for (size_t i = 0; i < count; i++) {
+    uint8_t* packet = packets + i * parameters.packet_sans_header_size;
+    for (uint32_t j = 0; j < parameters.blocks_per_packet; j++) {
+      auto* block = reinterpret_cast<VelodyneRawDataBlock*>(packet + j * parameters.block_size);
+      block->dataBlockFlag = kBlockFlag;
+      block->azimuth = azimuth;
+      azimuth = (azimuth + 40) % 36000;
+      for (uint32_t k = 0; k < parameters.channels_per_block; k++) {
+        block->channels[k].distance = distance(rng);
+        block->channels[k].reflectivity = reflectivity(rng);
+      }
+    }
+  }
+}
+
+// Decodes the rings of all sensors in turns, one packet of every sensor at a time, like a driver
+// process serving several sensors would. Returns false if the buffers can not be allocated.
+bool Run(const VelodyneLidarParameters& parameters, HugePages huge_pages) {
+  const size_t packet_size = parameters.packet_sans_header_size;
+  const size_t count = static_cast<size_t>(FLAGS_ring_seconds * kPacketRate);
+  const size_t capacity = 2 * 36000 / 10;  // A full revolution at the lowest rotation speed
+  const size_t beams = parameters.vertical_beams;
+  std::vector<Sensor> sensors(FLAGS_sensors);
+  HugePages pages = huge_pages;
+  for (size_t s = 0; s < sensors.size(); s++) {
+    Sensor& sensor = sensors[s];
+    const size_t size = Arena::Footprint(count * packet_size) +
+                        Arena::Footprint(capacity * beams * sizeof(uint16_t)) +
+                        Arena::Footprint(capacity * beams) +
+                        Arena::Footprint(capacity * sizeof(double));
+    if (!sensor.arena.open(size, huge_pages)) {
+      std::perror("Could not allocate arena");
+      return false;
+    }
+    pages = sensor.arena.pages();
+    sensor.packets = static_cast<uint8_t*>(sensor.arena.allocate(count * packet_size));
+    sensor.count = count;
+    sensor.buffers.ranges = sensor.arena.allocate<uint16_t>(capacity * beams);
+    sensor.buffers.intensities = sensor.arena.allocate<uint8_t>(capacity * beams);
+    sensor.buffers.thetas = sensor.arena.allocate<double>(capacity);
+    sensor.buffers.capacity = capacity;
+    FillPackets(parameters, sensor.packets, count, s);
+    DecoderOptions options;
+    options.split_at_revolution = true;
+    sensor.decoder = std::make_unique<Decoder>(parameters, options);
+    sensor.decoder->setOutput(sensor.buffers);
+  }
+
+  TlbMissCounter tlb_misses;
+  tlb_misses.start();
+  const auto start = std::chrono::steady_clock::now();
+  for (int iteration = 0; iteration < FLAGS_iterations; iteration++) {
+    for (size_t i = 0; i < count; i++) {
+      for (Sensor& sensor : sensors) {
+        sensor.decoder->feed(sensor.packets + i * packet_size, packet_size, i);
+      }
+    }
+  }
+  const auto end = std::chrono::steady_clock::now();
+  const uint64_t misses = tlb_misses.stop();
+
+  const double seconds = std::chrono::duration<double>(end - start).count();
+  const double total_packets = static_cast<double>(count) * sensors.size() * FLAGS_iterations;
+  const double total_points =
+      total_packets * parameters.blocks_per_packet * parameters.channels_per_block;
+  std::printf("%-12s %-12s %10.1f %10.2f", HugePagesName(huge_pages), HugePagesName(pages),
+              sensors.size() * sensors[0].arena.size() / 1e6, seconds * 1e9 / total_points);
+  if (tlb_misses.available()) {
+    std::printf(" %14.3f\n", misses / total_packets);
+  } else {
+    std::printf(" %14s\n", "n/a");
+  }
+  return true;
+}
+
+int Main() {
+  const VelodyneLidarParameters parameters = GetVelodyneParameters(VelodyneModelType::VLP16);
+  std::printf("%d sensors with %.0f s packet rings\n", FLAGS_sensors, FLAGS_ring_seconds);
+  std::printf("%-12s %-12s %10s %10s %14s\n", "requested", "pages", "MB", "ns/point",
+              "dTLB miss/pkt");
+  for (HugePages huge_pages : {HugePages::kNone, HugePages::kTransparent, HugePages::kExplicit}) {
+    if (!Run(parameters, huge_pages)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+}  // namespace
+}  // namespace velodyne_lidar
+}  // namespace isaac
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  return isaac::velodyne_lidar::Main();
+}
@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "packages/velodyne_lidar/gems/packet_encoder.hpp"
+#include "packages/velodyne_lidar/gems/pcap_writer.hpp"
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+
+DEFINE_string(output_directory, "packages/velodyne_lidar/gems/tests/data",
+              "Directory into which the capture files are written");
+DEFINE_int32(packets, 256, "Number of data packets per sensor model");
+DEFINE_int32(seed, 2368, "Seed of the random number generator");
+
+namespace isaac {
+namespace velodyne_lidar {
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kDegToRad = kPi / 180.0;
+constexpr double kRotationsPerSecond = 10.0;
+constexpr double kSensorHeight = 1.8;
+// The room around the sensor given as [x_min, x_max] and [y_min, y_max] in meters
+constexpr double kRoom[2][2] = {{-20.0, 25.0}, {-15.0, 12.0}};
+// Pillars in the room given as x, y and radius in meters
+constexpr double kPillars[][3] = {{4.0, 3.0, 0.3}, {-6.0, -2.5, 0.5}, {12.0, -8.0, 0.4}};
+// Capture time of the first packet in nanoseconds since the epoch
+constexpr int64_t kStartTime = 1'577'837'000'250'000'000;
+// Time between firing the last column of a packet and the kernel receiving it
+constexpr int64_t kNetworkDelay = 120'000;
+constexpr uint32_t kSourceIp = 0xC0A801C9;  // 192.168.1.201
+constexpr uint16_t kDataPort = 2368;
+constexpr uint16_t kPositionPort = 8308;
+constexpr size_t kPositionPacketSize = 512;
+constexpr int kPositionPacketInterval = 100;
+// Number of consecutive data packets which are dropped two thirds into the capture
+constexpr int kDroppedPackets = 3;
+// Fraction of beams without a return
+constexpr double kDropoutRate = 0.01;
+constexpr double kRangeNoise = 0.01;
+
+// Vertical angles in degrees used for the VLS128 which has no default calibration
+std::vector<double> Vls128Angles(uint32_t beams) {
+  std::vector<double> angles(beams);
+  for (uint32_t i = 0; i < beams; i++) {
+    angles[i] = -25.0 + 40.0 * i / (beams - 1);
+  }
+  return angles;
+}
+
+// Casts a ray from the sensor into the room with the angle conventions of the decoder. Returns
+// the distance in meters or a negative value if nothing was hit, and the reflectivity of the
+// surface.
+double CastRay(double theta, double elevation, uint8_t& reflectivity) {
+  const double dx = std::cos(elevation) * std::cos(theta);
+  const double dy = std::cos(elevation) * std::sin(theta);
+  const double dz = std::sin(elevation);
+  double best = -1.0;
+  auto consider = [&](double distance, uint8_t value) {
+    if (distance > 0.0 && (best < 0.0 || distance < best)) {
+      best = distance;
+      reflectivity = value;
+    }
+  };
+  if (dz < 0.0) {
+    consider(-kSensorHeight / dz, 30);
+  }
+  for (int axis = 0; axis < 2; axis++) {
+    const double direction = axis == 0 ? dx : dy;
+    if (direction == 0.0) continue;
+    for (int side = 0; side < 2; side++) {
+      consider(kRoom[axis][side] / direction, 80);
+    }
+  }
+  for (const auto& pillar : kPillars) {
+    // Intersection of the ray projected onto the ground with a circle
+    const double horizontal = std::cos(elevation);
+    const double b = dx * pillar[0] + dy * pillar[1];
+    const double c = pillar[0] * pillar[0] + pillar[1] * pillar[1] - pillar[2] * pillar[2];
+    const double discriminant = b * b - horizontal * horizontal * c;
+    if (discriminant >= 0.0) {
+      consider((b - std::sqrt(discriminant)) / (horizontal * horizontal), 180);
+    }
+  }
+  return best;
+}
+
+// Writes a capture of the simulated room as seen by the given sensor model
+bool WriteCorpus(const std::string& name, VelodyneModelType model_type, std::mt19937& rng) {
+  VelodyneLidarParameters parameters = GetVelodyneParameters(model_type);
+  if (parameters.vertical_angles.empty()) {
+    SetVerticalAngles(Vls128Angles(parameters.vertical_beams), parameters);
+  }
+  PacketEncoder encoder(parameters);
+  const std::string filename = FLAGS_output_directory + "/" + name + ".pcap";
+  PcapWriter writer;
+  if (!writer.open(filename)) {
+    std::fprintf(stderr, "Could not create '%s'\n", filename.c_str());
+    return false;
+  }
+
+  // Start such that the sensor completes a revolution in the middle of the capture
+  const size_t columns = FLAGS_packets * encoder.columnsPerPacket();
+  const double column_angle = 2.0 * kPi * kRotationsPerSecond * parameters.firing_cycle;
+  const double start_azimuth = 2.0 * kPi - 0.5 * columns * column_angle;
+  const int64_t column_period = static_cast<int64_t>(parameters.firing_cycle * 1e9);
+
+  std::normal_distribution<double> noise(0.0, kRangeNoise);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  std::vector<uint16_t> ranges(parameters.vertical_beams);
+  std::vector<uint8_t> intensities(parameters.vertical_beams);
+  const std::vector<uint8_t> position_packet(kPositionPacketSize, 0);
+  const int dropped_packet = 2 * FLAGS_packets / 3;
+  int packet = 0;
+  for (size_t column = 0; column < columns; column++) {
+    // The sensor spins clockwise while the decoder reports counter clockwise angles
+    const double azimuth = std::fmod(start_azimuth + column * column_angle, 2.0 * kPi);
+    const double theta = -azimuth;
+    for (uint32_t beam = 0; beam < parameters.vertical_beams; beam++) {
+      uint8_t reflectivity = 0;
+      const double distance = CastRay(theta, parameters.vertical_angles[beam], reflectivity);
+      const double measured = distance + noise(rng);
+      const bool valid = distance > 0.0 && uniform(rng) >= kDropoutRate &&
+                         measured >= parameters.minimum_range &&
+                         measured <= parameters.maximum_range;
+      ranges[beam] =
+          valid ? static_cast<uint16_t>(std::lround(measured / parameters.distance_resolution))
+                : 0;
+      intensities[beam] = valid ? reflectivity : 0;
+    }
+    const int64_t timestamp = kStartTime + static_cast<int64_t>(column) * column_period;
+    if (!encoder.addColumn(theta, ranges.data(), intensities.data(), timestamp)) {
+      continue;
+    }
+    const int index = packet++;
+    if (index >= dropped_packet && index < dropped_packet + kDroppedPackets) {
+      continue;
+    }
+    const int64_t receive_time = timestamp + kNetworkDelay;
+    if (!writer.write(encoder.packet(), encoder.packetSize(), receive_time, kDataPort,
+                      kSourceIp)) {
+      std::fprintf(stderr, "Could not write to '%s'\n", filename.c_str());
+      return false;
+    }
+    if (index % kPositionPacketInterval == 0) {
+      writer.write(position_packet.data(), position_packet.size(), receive_time + 1000,
+                   kPositionPort, kSourceIp);
+    }
+  }
+  std::printf("Wrote %d packets to '%s'\n", packet - kDroppedPackets, filename.c_str());
+  return true;
+}
+
+int Main() {
+  std::mt19937 rng(FLAGS_seed);
+  const bool success = WriteCorpus("vlp16", VelodyneModelType::VLP16, rng) &&
+                       WriteCorpus("vlp32c", VelodyneModelType::VLP32C, rng) &&
+                       WriteCorpus("vls128", VelodyneModelType::VLS128, rng);
+  return success ? 0 : 1;
+}
+
+}  // namespace
+}  // namespace velodyne_lidar
+}  // namespace isaac
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  return isaac::velodyne_lidar::Main();
+}
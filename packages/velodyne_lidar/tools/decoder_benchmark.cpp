@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *  * Neither the name of NVIDIA CORPORATION nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "packages/velodyne_lidar/gems/decoder.hpp"
+#include "packages/velodyne_lidar/gems/output_products.hpp"
+#include "packages/velodyne_lidar/gems/pcap_reader.hpp"
+#include "packages/velodyne_lidar/gems/region_of_interest.hpp"
+#include "packages/velodyne_lidar/gems/velodyne_constants.hpp"
+
+DEFINE_string(pcap, "", "Capture file with Velodyne data packets. Synthetic packets if empty.");
+DEFINE_int32(port, 2368, "Destination port of the data packets in the capture file");
+DEFINE_int32(packets, 10000, "Number of synthetic packets to generate");
+DEFINE_int32(iterations, 20, "Number of times all packets are decoded");
+DEFINE_bool(split_at_revolution, true, "Emit one batch per revolution instead of fixed batches");
+DEFINE_int32(batch_size, 0, "Number of columns per batch if not split at revolutions");
+DEFINE_string(kernel, "", "Channel kernel to use. The fastest supported one if empty.");
+DEFINE_int32(ring_statistics_stride, 0, "Sample every n-th packet for the ring statistics");
+DEFINE_bool(products, false,
+            "Also compute a flat scan and a point cloud, once in a single pass while decoding and "
+            "once by separate passes over every decoded batch");
+DEFINE_bool(region, false,
+            "Also compute the point cloud once without and once inside a region of interest");
+DEFINE_string(region_json, "",
+              "Region of interest for --region as JSON, see ParseRegionOfInterest. A lane in "
+              "front of the sensor if empty.");
+
+namespace isaac {
+namespace velodyne_lidar {
+namespace {
+
+// Creates packets with random ranges for a sensor spinning at 600 rpm
+std::vector<uint8_t> CreateSyntheticPackets(const VelodyneLidarParameters& parameters,
+                                            int count) {
+  std::vector<uint8_t> packets(count * parameters.packet_sans_header_size);
+  std::mt19937 rng(1337);
+  std::uniform_int_distribution<int> distance(0, 60000);
+  std::uniform_int_distribution<int> reflectivity(0, 255);
+  uint32_t azimuth = 0;
+  for (int i = 0; i < count; i++) {
+    uint8_t* packet = packets.data() + i * parameters.packet_sans_header_size;
+    for (uint32_t j = 0; j < parameters.blocks_per_packet; j++) {
+      auto* block = reinterpret_cast<VelodyneRawDataBlock*>(packet + j * parameters.block_size);
+      block->dataBlockFlag = kBlockFlag;
+      block->azimuth = azimuth;
+      azimuth = (azimuth + 40) % 36000;
+      for (uint32_t k = 0; k < parameters.channels_per_block; k++) {
+        block->channels[k].distance = distance(rng);
+        block->channels[k].reflectivity = reflectivity(rng);
+      }
+    }
+  }
+  return packets;
+}
+
+// A lane of 4 meters width and 30 meters length in front of the sensor, like a vehicle which only
+// keeps the points on its path
+RegionOfInterest DefaultRegion() {
+  RegionOfInterest region;
+  region.has_box = true;
+  region.box_minimum = {-5.0, -10.0, -1.5};
+  region.box_maximum = {30.0, 10.0, 2.0};
+  RegionOfInterest::Polygon lane;
+  lane.corners = {{0.0, -2.0}, {30.0, -2.0}, {30.0, 2.0}, {0.0, 2.0}};
+  region.polygons.push_back(lane);
+  return region;
+}
+
+// Reads all data packets from a capture file
+std::vector<uint8_t> ReadPackets(const VelodyneLidarParameters& parameters,
+                                 const std::string& filename, uint16_t port) {
+  std::vector<uint8_t> packets;
+  PcapReader reader;
+  if (!reader.open(filename)) {
+    std::fprintf(stderr, "Could not read capture file '%s'\n", filename.c_str());
+    return packets;
+  }
+  UdpPacket packet;
+  while (reader.next(packet, port)) {
+    if (packet.size == parameters.packet_sans_header_size) {
+      packets.insert(packets.end(), packet.payload, packet.payload + packet.size);
+    }
+  }
+  return packets;
+}
+
+int Main() {
+  const VelodyneLidarParameters parameters = GetVelodyneParameters(VelodyneModelType::VLP16);
+  const size_t packet_size = parameters.packet_sans_header_size;
+  const std::vector<uint8_t> packets =
+      FLAGS_pcap.empty() ? CreateSyntheticPackets(parameters, FLAGS_packets)
+                         : ReadPackets(parameters, FLAGS_pcap, FLAGS_port);
+  const size_t number_of_packets = packets.size() / packet_size;
+  if (number_of_packets == 0) {
+    std::fprintf(stderr, "No packets to decode\n");
+    return 1;
+  }
+
+  DecoderOptions options;
+  options.split_at_revolution = FLAGS_split_at_revolution;
+  options.batch_size = FLAGS_batch_size;
+  options.kernel = FLAGS_kernel;
+  options.ring_statistics_stride = FLAGS_ring_statistics_stride;
+  if (FindChannelKernel(options.kernel) == nullptr) {
+    std::fprintf(stderr, "Channel kernel '%s' is not available\n", FLAGS_kernel.c_str());
+    return 1;
+  }
+  Decoder decoder(parameters, options);
+
+  // Enough room for a full revolution at the lowest rotation speed
+  const size_t capacity = 2 * 36000 / 10;
+  std::vector<uint16_t> ranges(capacity * parameters.vertical_beams);
+  std::vector<uint8_t> intensities(capacity * parameters.vertical_beams);
+  std::vector<double> thetas(capacity);
+  const ColumnBuffers buffers{ranges.data(), intensities.data(), thetas.data(), capacity};
+  decoder.setOutput(buffers);
+
+  // The products which are typically requested by navigation and mapping
+  FlatscanWriter flatscan(parameters, -0.02, 0.02);
+  PointCloudOptions cloud_options;
+  cloud_options.column_stride = 2;
+  PointCloudWriter cloud(parameters, cloud_options);
+  OutputEngine engine(parameters.vertical_beams);
+  engine.add(&flatscan);
+  engine.add(&cloud);
+
+  // The point cloud alone, once without and once inside the region of interest
+  PointCloudOptions region_options = cloud_options;
+  region_options.region = DefaultRegion();
+  if (!FLAGS_region_json.empty()) {
+    const Json json = Json::parse(FLAGS_region_json, nullptr, false);
+    if (json.is_discarded() || !ParseRegionOfInterest(json, region_options.region)) {
+      std::fprintf(stderr, "Invalid region of interest '%s'\n", FLAGS_region_json.c_str());
+      return 1;
+    }
+  }
+  PointCloudWriter plain_cloud(parameters, cloud_options);
+  PointCloudWriter region_cloud(parameters, region_options);
+  OutputEngine plain_engine(parameters.vertical_beams);
+  plain_engine.add(&plain_cloud);
+  OutputEngine region_engine(parameters.vertical_beams);
+  region_engine.add(&region_cloud);
+
+  // Decodes all packets and returns the time it took in seconds. In the fused mode the products
+  // of `products` are computed after every packet, in the separate mode the flat scan and the
+  // cloud read the full batch. The points of `counted` are summed over all batches.
+  enum class Mode { kDecode, kFused, kSeparate };
+  uint64_t batches = 0;
+  uint64_t points = 0;
+  const auto run = [&](Mode mode, OutputEngine& products,
+                       const PointCloudWriter* counted = nullptr) {
+    decoder.setCallback([&](const ColumnBatch& batch) {
+      batches++;
+      if (mode == Mode::kFused) {
+        products.update(buffers, batch.size, 0);
+        points += counted != nullptr ? counted->size() : 0;
+        products.begin();
+      } else if (mode == Mode::kSeparate) {
+        for (ProductWriter* writer : {static_cast<ProductWriter*>(&flatscan),
+                                      static_cast<ProductWriter*>(&cloud)}) {
+          writer->begin();
+          writer->write(batch.ranges, batch.intensities, batch.thetas, batch.size);
+        }
+      }
+    });
+    batches = 0;
+    points = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int iteration = 0; iteration < FLAGS_iterations; iteration++) {
+      decoder.reset();
+      products.begin();
+      for (size_t i = 0; i < number_of_packets; i++) {
+        decoder.feed(packets.data() + i * packet_size, packet_size, i);
+        if (mode == Mode::kFused) {
+          products.update(buffers, decoder.bufferedColumns(), 0);
+        }
+      }
+      decoder.finish();
+    }
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+  };
+
+  const double seconds = run(Mode::kDecode, engine);
+  const double total_packets = static_cast<double>(number_of_packets) * FLAGS_iterations;
+  const double total_points =
+      total_packets * parameters.blocks_per_packet * parameters.channels_per_block;
+  std::printf("kernel:       %s\n", decoder.kernelName());
+  std::printf("packets:      %zu x %d iterations\n", number_of_packets, FLAGS_iterations);
+  std::printf("batches:      %lu\n", static_cast<unsigned long>(batches));
+  std::printf("ns/packet:    %.1f\n", seconds * 1e9 / total_packets);
+  std::printf("ns/point:     %.2f\n", seconds * 1e9 / total_points);
+  std::printf("Mpoints/s:    %.1f\n", total_points / seconds * 1e-6);
+  if (FLAGS_products) {
+    const double fused = run(Mode::kFused, engine);
+    const double separate = run(Mode::kSeparate, engine);
+    std::printf("products:     flatscan, cloud\n");
+    std::printf("fused:        %.2f ns/point (+%.2f over decoding)\n", fused * 1e9 / total_points,
+                (fused - seconds) * 1e9 / total_points);
+    std::printf("separate:     %.2f ns/point (+%.2f over decoding)\n",
+                separate * 1e9 / total_points, (separate - seconds) * 1e9 / total_points);
+  }
+  if (FLAGS_region) {
+    const double plain = run(Mode::kFused, plain_engine, &plain_cloud);
+    const uint64_t plain_points = points;
+    const double inside = run(Mode::kFused, region_engine, &region_cloud);
+    std::printf("region:       %.2f%% of the points kept\n",
+                plain_points > 0 ? 100.0 * points / plain_points : 0.0);
+    std::printf("cloud:        %.2f ns/point (+%.2f over decoding)\n", plain * 1e9 / total_points,
+                (plain - seconds) * 1e9 / total_points);
+    std::printf("cloud region: %.2f ns/point (+%.2f over decoding)\n",
+                inside * 1e9 / total_points, (inside - seconds) * 1e9 / total_points);
+  }
+  return 0;
+}
+
+}  // namespace
+}  // namespace velodyne_lidar
+}  // namespace isaac
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  return isaac::velodyne_lidar::Main();
+}